@@ -94,6 +94,13 @@ else()
   set(BLAS_LIBRARIES ${MKL_LIB_PATH}/mkl_core_dll.lib ${MKL_LIB_PATH}/mkl_sequential_dll.lib ${MKL_LIB_PATH}/mkl_intel_lp64_dll.lib)
 endif()
 message(STATUS "Found Blas Lib: " ${BLAS_LIBRARIES})
+# other blas libs are taken as running a gemm on threads of their own
+if ("${BLAS_LIBRARIES}" MATCHES "mkl")
+  add_definitions(-DWITH_MKL)
+  if ("${BLAS_LIBRARIES}" MATCHES "mkl_sequential")
+    add_definitions(-DWITH_SEQUENTIAL_BLAS)
+  endif()
+endif()
 
 set(oneflow_third_party_libs
     ${CMAKE_THREAD_LIBS_INIT}
@@ -121,6 +128,11 @@ if(WIN32)
   list(APPEND oneflow_third_party_libs "Ws2_32.lib")
 endif()
 
+if(UNIX)
+  # shm_open of the shared memory rings, in librt before glibc 2.34
+  list(APPEND oneflow_third_party_libs rt)
+endif()
+
 set(oneflow_third_party_dependencies
   zlib_copy_headers_to_destination
   zlib_copy_libs_to_destination
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/epoll/striped_read.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -23,6 +24,8 @@ limitations under the License.
 #ifdef PLATFORM_POSIX
 
 #include <netinet/tcp.h>
+#include <fstream>
+#include <random>
 
 namespace oneflow {
 
@@ -36,11 +39,17 @@ sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
   return sa;
 }
 
-int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_num) {
+// sent by the connecting side right after connect, since several sockets come from every peer
+struct SocketHandshake {
+  int64_t machine_id;
+  int32_t stripe_id;
+};
+
+int SockListen(int listen_sockfd, uint16_t listen_port, int32_t backlog) {
   sockaddr_in sa = GetSockAddr("0.0.0.0", listen_port);
   int bind_result = bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
   if (bind_result == 0) {
-    PCHECK(listen(listen_sockfd, total_machine_num) == 0);
+    PCHECK(listen(listen_sockfd, backlog) == 0);
     LOG(INFO) << "CommNet:Epoll listening on "
               << "0.0.0.0:" + std::to_string(listen_port);
   } else {
@@ -49,14 +58,32 @@ int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_nu
   return bind_result;
 }
 
-int64_t GetMachineId(const sockaddr_in& sa) {
-  char addr[INET_ADDRSTRLEN];
-  memset(addr, '\0', sizeof(addr));
-  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
-  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
-    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
+void WriteHandshake(int sockfd, const SocketHandshake& handshake) {
+  const char* ptr = reinterpret_cast<const char*>(&handshake);
+  size_t size = sizeof(handshake);
+  while (size > 0) {
+    ssize_t n = write(sockfd, ptr, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR));
+    if (n > 0) {
+      ptr += n;
+      size -= n;
+    }
   }
-  UNIMPLEMENTED();
+}
+
+SocketHandshake ReadHandshake(int sockfd) {
+  SocketHandshake handshake;
+  char* ptr = reinterpret_cast<char*>(&handshake);
+  size_t size = sizeof(handshake);
+  while (size > 0) {
+    ssize_t n = read(sockfd, ptr, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR)) << "sockfd " << sockfd << " closed by peer";
+    if (n > 0) {
+      ptr += n;
+      size -= n;
+    }
+  }
+  return handshake;
 }
 
 std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
@@ -71,6 +98,33 @@ uint16_t PullPort(int64_t machine_id) {
   return port;
 }
 
+const size_t kSharedMemoryRingCapacity = 8 << 20;
+
+// peers with the same host id are likely on this host, they get shared memory if they can open
+// the rings of each other
+std::string GetHostId() {
+  char hostname[256] = {0};
+  PCHECK(gethostname(hostname, sizeof(hostname) - 1) == 0);
+  std::string boot_id;
+  std::ifstream boot_id_file("/proc/sys/kernel/random/boot_id");
+  if (boot_id_file) { std::getline(boot_id_file, boot_id); }
+  return std::string(hostname) + "/" + boot_id;
+}
+
+std::string GenHostIdKey(int64_t machine_id) {
+  return "EpollHostId/" + std::to_string(machine_id);
+}
+
+std::string GenRingNameKey(int64_t src_machine_id, int64_t dst_machine_id) {
+  return "EpollShmRingName/" + std::to_string(src_machine_id) + "/"
+         + std::to_string(dst_machine_id);
+}
+
+std::string GenRingOpenedKey(int64_t src_machine_id, int64_t dst_machine_id) {
+  return "EpollShmRingOpened/" + std::to_string(src_machine_id) + "/"
+         + std::to_string(dst_machine_id);
+}
+
 }  // namespace
 
 EpollCommNet::~EpollCommNet() {
@@ -79,6 +133,7 @@ EpollCommNet::~EpollCommNet() {
     pollers_[i]->Stop();
   }
   OF_BARRIER();
+  machine_id2shared_memory_helper_.clear();
   for (IOEventPoller* poller : pollers_) { delete poller; }
   for (auto& pair : sockfd2helper_) { delete pair.second; }
 }
@@ -91,11 +146,22 @@ void EpollCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& actor_ms
   SocketMsg msg;
   msg.msg_type = SocketMsgType::kActor;
   msg.actor_msg = actor_msg;
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  auto it = machine_id2shared_memory_helper_.find(dst_machine_id);
+  if (it != machine_id2shared_memory_helper_.end()) {
+    it->second->AsyncWrite(msg);
+  } else {
+    GetSocketHelper(dst_machine_id, 0)->AsyncWrite(msg);
+  }
 }
 
-void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, int32_t stripe_id,
+                                 const SocketMsg& msg) {
+  GetSocketHelper(dst_machine_id, stripe_id)->AsyncWrite(msg);
+}
+
+void EpollCommNet::StripeReadDone(void* read_id, int32_t stripe_num) {
+  void* done_read_id = StripedReadDone(read_id, stripe_num);
+  if (done_read_id != nullptr) { ReadDone(done_read_id); }
 }
 
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
@@ -107,8 +173,11 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
 
 EpollCommNet::EpollCommNet(const Plan& plan) : CommNetIf(plan) {
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
+  stripe_num_ = Global<ResourceDesc, ForSession>::Get()->CommNetStripeNum();
+  CHECK_GE(stripe_num_, 1);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
   InitSockets();
+  InitSharedMemory();
   for (IOEventPoller* poller : pollers_) { poller->Start(); }
 }
 
@@ -116,26 +185,34 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(stripe_num_, -1));
   sockfd2helper_.clear();
-  size_t poller_idx = 0;
-  auto NewSocketHelper = [&](int sockfd) {
-    IOEventPoller* poller = pollers_[poller_idx];
-    poller_idx = (poller_idx + 1) % pollers_.size();
-    return new SocketHelper(sockfd, poller);
+  auto AddSocket = [&](int sockfd, int64_t peer_id, int32_t stripe_id) {
+    CHECK_GE(peer_id, 0);
+    CHECK_LT(peer_id, total_machine_num);
+    CHECK_GE(stripe_id, 0);
+    CHECK_LT(stripe_id, stripe_num_);
+    CHECK_EQ(machine_id2sockfds_[peer_id][stripe_id], -1);
+    // the stripes to a peer go to consecutive pollers
+    IOEventPoller* poller = pollers_[(peer_id * stripe_num_ + stripe_id) % pollers_.size()];
+    auto* helper = new SocketHelper(
+        sockfd, poller, Global<ResourceDesc, ForSession>::Get()->enable_comm_net_zero_copy());
+    CHECK(sockfd2helper_.emplace(sockfd, helper).second);
+    machine_id2sockfds_[peer_id][stripe_id] = sockfd;
   };
 
   // listen
   int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
   int32_t this_listen_port = Global<EnvDesc>::Get()->data_port();
+  const int32_t backlog = total_machine_num * stripe_num_;
   if (this_listen_port != -1) {
-    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, total_machine_num), 0);
+    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, backlog), 0);
     PushPort(this_machine_id,
              ((this_machine.data_port_agent() != -1) ? (this_machine.data_port_agent())
                                                      : (this_listen_port)));
   } else {
     for (this_listen_port = 1024; this_listen_port < GetMaxVal<uint16_t>(); ++this_listen_port) {
-      if (SockListen(listen_sockfd, this_listen_port, total_machine_num) == 0) {
+      if (SockListen(listen_sockfd, this_listen_port, backlog) == 0) {
         PushPort(this_machine_id, this_listen_port);
         break;
       }
@@ -153,47 +230,136 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int32_t, stripe_id, 0, stripe_num_) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      WriteHandshake(sockfd, SocketHandshake{this_machine_id, stripe_id});
+      AddSocket(sockfd, peer_id, stripe_id);
+    }
   }
 
   // accept
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
-    sockaddr_in peer_sockaddr;
-    socklen_t len = sizeof(peer_sockaddr);
-    int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * stripe_num_) {
+    int sockfd = accept(listen_sockfd, nullptr, nullptr);
     PCHECK(sockfd != -1);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
-    machine_id2sockfd_[peer_machine_id] = sockfd;
+    const SocketHandshake handshake = ReadHandshake(sockfd);
+    AddSocket(sockfd, handshake.machine_id, handshake.stripe_id);
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    FOR_RANGE(int32_t, stripe_id, 0, stripe_num_) {
+      LOG(INFO) << "machine " << machine_id << " stripe " << stripe_id << " sockfd "
+                << machine_id2sockfds_[machine_id][stripe_id];
+    }
   }
 }
 
-SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+void EpollCommNet::InitSharedMemory() {
+  if (!Global<ResourceDesc, ForSession>::Get()->enable_comm_net_shared_memory()) { return; }
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  const std::string host_id = GetHostId();
+  Global<CtrlClient>::Get()->PushKV(GenHostIdKey(this_machine_id), host_id);
+  std::vector<int64_t> local_peer_ids;
+  for (int64_t peer_id : peer_machine_id()) {
+    std::string peer_host_id;
+    Global<CtrlClient>::Get()->PullKV(GenHostIdKey(peer_id), &peer_host_id);
+    if (peer_host_id == host_id) { local_peer_ids.push_back(peer_id); }
+  }
+  std::sort(local_peer_ids.begin(), local_peer_ids.end());
+
+  // every process creates the rings it writes, the names are unique among the processes of a host
+  const std::string name_prefix = "/oneflow_comm_net_" + std::to_string(getpid()) + "_"
+                                  + std::to_string(std::random_device()()) + "_";
+  HashMap<int64_t, std::unique_ptr<SharedMemoryRing>> peer_id2send_ring;
+  for (int64_t peer_id : local_peer_ids) {
+    const std::string name = name_prefix + std::to_string(peer_id);
+    std::unique_ptr<SharedMemoryRing> ring =
+        SharedMemoryRing::Create(name, kSharedMemoryRingCapacity);
+    // an empty name tells the peer to keep using the sockets
+    Global<CtrlClient>::Get()->PushKV(GenRingNameKey(this_machine_id, peer_id),
+                                      ring ? name : "");
+    if (ring) { peer_id2send_ring.emplace(peer_id, std::move(ring)); }
+  }
+  HashMap<int64_t, std::unique_ptr<SharedMemoryRing>> peer_id2recv_ring;
+  for (int64_t peer_id : local_peer_ids) {
+    std::string name;
+    Global<CtrlClient>::Get()->PullKV(GenRingNameKey(peer_id, this_machine_id), &name);
+    std::unique_ptr<SharedMemoryRing> ring;
+    if (!name.empty()) { ring = SharedMemoryRing::Open(name); }
+    Global<CtrlClient>::Get()->PushKV(GenRingOpenedKey(peer_id, this_machine_id),
+                                      ring ? "1" : "0");
+    if (ring) { peer_id2recv_ring.emplace(peer_id, std::move(ring)); }
+  }
+  // shared memory is used only if both sides could open the ring of the other one
+  for (int64_t peer_id : local_peer_ids) {
+    std::string opened;
+    Global<CtrlClient>::Get()->PullKV(GenRingOpenedKey(this_machine_id, peer_id), &opened);
+    auto send_ring_it = peer_id2send_ring.find(peer_id);
+    if (send_ring_it == peer_id2send_ring.end()) { continue; }
+    SharedMemoryRing::Unlink(name_prefix + std::to_string(peer_id));
+    auto recv_ring_it = peer_id2recv_ring.find(peer_id);
+    if (opened != "1" || recv_ring_it == peer_id2recv_ring.end()) { continue; }
+    machine_id2shared_memory_helper_.emplace(
+        peer_id, std::make_unique<SharedMemoryHelper>(std::move(send_ring_it->second),
+                                                      std::move(recv_ring_it->second)));
+    LOG(INFO) << "CommNet:Epoll shared memory with machine " << peer_id;
+  }
+  OF_BARRIER();
+  Global<CtrlClient>::Get()->ClearKV(GenHostIdKey(this_machine_id));
+  for (int64_t peer_id : local_peer_ids) {
+    Global<CtrlClient>::Get()->ClearKV(GenRingNameKey(this_machine_id, peer_id));
+    Global<CtrlClient>::Get()->ClearKV(GenRingOpenedKey(this_machine_id, peer_id));
+  }
+}
+
+SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id, int32_t stripe_id) {
+  int sockfd = machine_id2sockfds_.at(machine_id).at(stripe_id);
   return sockfd2helper_.at(sockfd);
 }
 
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
-  SocketMsg msg;
-  msg.msg_type = SocketMsgType::kRequestWrite;
-  msg.request_write_msg.src_token = src_token;
-  msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
-  msg.request_write_msg.dst_token = dst_token;
-  msg.request_write_msg.read_id = read_id;
-  GetSocketHelper(src_machine_id)->AsyncWrite(msg);
+  const int64_t byte_size = static_cast<const SocketMemDesc*>(dst_token)->byte_size;
+  auto shared_memory_helper_it = machine_id2shared_memory_helper_.find(src_machine_id);
+  if (shared_memory_helper_it != machine_id2shared_memory_helper_.end()) {
+    // the body comes back in pieces, which are counted as stripes
+    const int32_t piece_num = SharedMemoryHelper::PieceNum(byte_size);
+    SocketMsg msg;
+    msg.msg_type = SocketMsgType::kRequestWrite;
+    msg.request_write_msg.src_token = src_token;
+    msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+    msg.request_write_msg.dst_token = dst_token;
+    msg.request_write_msg.read_id = NewStripedReadId(read_id, piece_num);
+    msg.request_write_msg.offset = 0;
+    msg.request_write_msg.byte_size = byte_size;
+    msg.request_write_msg.stripe_id = 0;
+    msg.request_write_msg.stripe_num = piece_num;
+    shared_memory_helper_it->second->AsyncWrite(msg);
+    return;
+  }
+  const int32_t stripe_num = StripeNum4ByteSize(byte_size, stripe_num_);
+  void* striped_read_id = NewStripedReadId(read_id, stripe_num);
+  FOR_RANGE(int32_t, stripe_id, 0, stripe_num) {
+    int64_t offset = 0;
+    int64_t stripe_size = 0;
+    GetStripeRange(byte_size, stripe_id, stripe_num, &offset, &stripe_size);
+    SocketMsg msg;
+    msg.msg_type = SocketMsgType::kRequestWrite;
+    msg.request_write_msg.src_token = src_token;
+    msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+    msg.request_write_msg.dst_token = dst_token;
+    msg.request_write_msg.read_id = striped_read_id;
+    msg.request_write_msg.offset = offset;
+    msg.request_write_msg.byte_size = stripe_size;
+    msg.request_write_msg.stripe_id = stripe_id;
+    msg.request_write_msg.stripe_num = stripe_num;
+    GetSocketHelper(src_machine_id, stripe_id)->AsyncWrite(msg);
+  }
 }
 
 }  // namespace oneflow
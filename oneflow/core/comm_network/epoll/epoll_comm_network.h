@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/comm_network.h"
 #include "oneflow/core/comm_network/epoll/socket_helper.h"
+#include "oneflow/core/comm_network/epoll/shared_memory_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
 #ifdef PLATFORM_POSIX
@@ -34,19 +35,29 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   void RegisterMemoryDone() override;
 
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
-  void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
+  void SendSocketMsg(int64_t dst_machine_id, int32_t stripe_id, const SocketMsg& msg);
+  // called once the body of a stripe has been received, the read is done after all its stripes
+  void StripeReadDone(void* read_id, int32_t stripe_num);
 
  private:
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
 
   EpollCommNet(const Plan& plan);
   void InitSockets();
-  SocketHelper* GetSocketHelper(int64_t machine_id);
+  // pairs of shared memory rings to the peers on this host
+  void InitSharedMemory();
+  SocketHelper* GetSocketHelper(int64_t machine_id, int32_t stripe_id);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  // There are stripe_num_ sockets to every peer, spread over the pollers. Actor messages and
+  // small register bodies go through the first one, large bodies are striped over all of them.
+  int32_t stripe_num_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
+  // Peers on this host exchange the socket messages and bodies over shared memory instead, the
+  // sockets to them stay unused.
+  HashMap<int64_t, std::unique_ptr<SharedMemoryHelper>> machine_id2shared_memory_helper_;
 };
 
 template<>
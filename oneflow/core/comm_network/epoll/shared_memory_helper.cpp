@@ -0,0 +1,106 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/shared_memory_helper.h"
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/actor/actor_message_bus.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+const int64_t kPieceSize = 1 << 20;
+
+}  // namespace
+
+SharedMemoryHelper::SharedMemoryHelper(std::unique_ptr<SharedMemoryRing> send_ring,
+                                       std::unique_ptr<SharedMemoryRing> recv_ring)
+    : send_ring_(std::move(send_ring)), recv_ring_(std::move(recv_ring)) {
+  recv_thread_ = std::thread([this]() { PollRecvRing(); });
+  body_send_thread_ = std::thread([this]() { SendBodies(); });
+}
+
+SharedMemoryHelper::~SharedMemoryHelper() {
+  request_write_msgs_.Close();
+  send_ring_->Close();
+  recv_ring_->Close();
+  body_send_thread_.join();
+  recv_thread_.join();
+}
+
+int32_t SharedMemoryHelper::PieceNum(int64_t byte_size) {
+  return static_cast<int32_t>(std::max<int64_t>(RoundUp(byte_size, kPieceSize) / kPieceSize, 1));
+}
+
+void SharedMemoryHelper::AsyncWrite(const SocketMsg& msg) {
+  CHECK(msg.msg_type == SocketMsgType::kActor || msg.msg_type == SocketMsgType::kRequestWrite);
+  std::unique_lock<std::mutex> lock(send_mutex_);
+  send_ring_->Write(reinterpret_cast<const char*>(&msg), sizeof(msg));
+}
+
+void SharedMemoryHelper::PollRecvRing() {
+  SocketMsg msg;
+  while (recv_ring_->Read(reinterpret_cast<char*>(&msg), sizeof(msg))) {
+    if (msg.msg_type == SocketMsgType::kActor) {
+      Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(msg.actor_msg);
+    } else if (msg.msg_type == SocketMsgType::kRequestWrite) {
+      request_write_msgs_.Send(msg.request_write_msg);
+    } else if (msg.msg_type == SocketMsgType::kRequestRead) {
+      const RequestReadMsg& request_read_msg = msg.request_read_msg;
+      auto mem_desc = static_cast<const SocketMemDesc*>(request_read_msg.dst_token);
+      CHECK_LE(request_read_msg.offset + request_read_msg.byte_size,
+               static_cast<int64_t>(mem_desc->byte_size));
+      if (!recv_ring_->Read(static_cast<char*>(mem_desc->mem_ptr) + request_read_msg.offset,
+                            request_read_msg.byte_size)) {
+        break;
+      }
+      Global<EpollCommNet>::Get()->StripeReadDone(request_read_msg.read_id,
+                                                  request_read_msg.stripe_num);
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+}
+
+void SharedMemoryHelper::SendBodies() {
+  RequestWriteMsg request_write_msg;
+  while (request_write_msgs_.Receive(&request_write_msg) == kChannelStatusSuccess) {
+    auto mem_desc = static_cast<const SocketMemDesc*>(request_write_msg.src_token);
+    const int64_t end = request_write_msg.offset + request_write_msg.byte_size;
+    CHECK_LE(end, static_cast<int64_t>(mem_desc->byte_size));
+    CHECK_EQ(request_write_msg.stripe_num, PieceNum(request_write_msg.byte_size));
+    FOR_RANGE(int32_t, piece_id, 0, request_write_msg.stripe_num) {
+      SocketMsg msg;
+      msg.msg_type = SocketMsgType::kRequestRead;
+      msg.request_read_msg.src_token = request_write_msg.src_token;
+      msg.request_read_msg.dst_token = request_write_msg.dst_token;
+      msg.request_read_msg.read_id = request_write_msg.read_id;
+      msg.request_read_msg.offset = request_write_msg.offset + piece_id * kPieceSize;
+      msg.request_read_msg.byte_size = std::min(kPieceSize, end - msg.request_read_msg.offset);
+      msg.request_read_msg.stripe_num = request_write_msg.stripe_num;
+      // a piece at a time, actor messages get in between them
+      std::unique_lock<std::mutex> lock(send_mutex_);
+      send_ring_->Write(reinterpret_cast<const char*>(&msg), sizeof(msg));
+      send_ring_->Write(static_cast<const char*>(mem_desc->mem_ptr) + msg.request_read_msg.offset,
+                        msg.request_read_msg.byte_size);
+    }
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -0,0 +1,61 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_HELPER_H_
+#define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_HELPER_H_
+
+#include "oneflow/core/comm_network/epoll/shared_memory_ring.h"
+#include "oneflow/core/comm_network/epoll/socket_message.h"
+#include "oneflow/core/common/channel.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// Carries the socket messages to a peer on the same host over a pair of shared memory rings, in
+// place of the sockets. A thread reads the incoming ring, landing request read bodies straight in
+// the registered memory. Another one serves the request writes of the peer, copying the bodies
+// into the outgoing ring in pieces, so that actor messages are not stuck behind large bodies.
+class SharedMemoryHelper final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SharedMemoryHelper);
+  SharedMemoryHelper(std::unique_ptr<SharedMemoryRing> send_ring,
+                     std::unique_ptr<SharedMemoryRing> recv_ring);
+  ~SharedMemoryHelper();
+
+  // the number of pieces, and so of request reads, a body of byte_size is sent in
+  static int32_t PieceNum(int64_t byte_size);
+
+  // Actor messages and request writes only. The message is in the ring on return, which blocks
+  // only while the ring is full.
+  void AsyncWrite(const SocketMsg& msg);
+
+ private:
+  void PollRecvRing();
+  void SendBodies();
+
+  std::unique_ptr<SharedMemoryRing> send_ring_;
+  std::unique_ptr<SharedMemoryRing> recv_ring_;
+  std::mutex send_mutex_;
+  Channel<RequestWriteMsg> request_write_msgs_;
+  std::thread recv_thread_;
+  std::thread body_send_thread_;
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_HELPER_H_
@@ -0,0 +1,212 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/shared_memory_ring.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+const int64_t kSpinCount = 4096;
+const int64_t kYieldCount = 16;
+
+void FutexWait(std::atomic<uint32_t>* addr, uint32_t val) {
+  // a timeout, so that a wake up missed for whatever reason costs a millisecond only
+  timespec timeout{0, 1000000};
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, val, &timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT32_MAX, nullptr, nullptr,
+          0);
+}
+
+}  // namespace
+
+// the two positions count the bytes written and read so far, they are on cache lines of their own
+// since they are written by different processes
+struct SharedMemoryRing::Header {
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> write_pos;
+  alignas(64) std::atomic<uint64_t> read_pos;
+  alignas(64) std::atomic<uint32_t> reader_waiting;
+  alignas(64) std::atomic<uint32_t> writer_waiting;
+};
+
+SharedMemoryRing::SharedMemoryRing(Header* header, size_t mapped_size)
+    : header_(header),
+      data_(reinterpret_cast<char*>(header) + RoundUp(sizeof(Header), 4096)),
+      capacity_(header->capacity),
+      mapped_size_(mapped_size),
+      closed_(false) {
+  CHECK(header_->write_pos.is_lock_free());
+  CHECK_EQ(capacity_ & (capacity_ - 1), 0);
+  CHECK_EQ(RoundUp(sizeof(Header), 4096) + capacity_, mapped_size_);
+}
+
+SharedMemoryRing::~SharedMemoryRing() { PCHECK(munmap(header_, mapped_size_) == 0); }
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Create(const std::string& name,
+                                                           size_t capacity) {
+  size_t rounded_capacity = 4096;
+  while (rounded_capacity < capacity) { rounded_capacity *= 2; }
+  const size_t mapped_size = RoundUp(sizeof(Header), 4096) + rounded_capacity;
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd == -1) {
+    PLOG(WARNING) << "shm_open " << name;
+    return nullptr;
+  }
+  // ftruncate alone reserves no pages, a full /dev/shm would then raise SIGBUS on the first write
+  const int err = posix_fallocate(fd, 0, mapped_size);
+  void* ptr = MAP_FAILED;
+  if (err == 0) {
+    ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) { PLOG(WARNING) << "mmap " << name; }
+  } else {
+    LOG(WARNING) << "posix_fallocate " << name << ": " << strerror(err);
+  }
+  PCHECK(close(fd) == 0);
+  if (ptr == MAP_FAILED) {
+    Unlink(name);
+    return nullptr;
+  }
+  Header* header = new (ptr) Header();
+  header->capacity = rounded_capacity;
+  header->write_pos.store(0);
+  header->read_pos.store(0);
+  header->reader_waiting.store(0);
+  header->writer_waiting.store(0);
+  return std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(header, mapped_size));
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Open(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd == -1) {
+    PCHECK(errno == ENOENT || errno == EACCES) << name;
+    return nullptr;
+  }
+  struct stat st;
+  PCHECK(fstat(fd, &st) == 0);
+  const size_t mapped_size = st.st_size;
+  void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  PCHECK(ptr != MAP_FAILED);
+  PCHECK(close(fd) == 0);
+  return std::unique_ptr<SharedMemoryRing>(
+      new SharedMemoryRing(static_cast<Header*>(ptr), mapped_size));
+}
+
+void SharedMemoryRing::Unlink(const std::string& name) {
+  PCHECK(shm_unlink(name.c_str()) == 0 || errno == ENOENT) << name;
+}
+
+void SharedMemoryRing::Write(const char* data, size_t size) {
+  const uint64_t mask = capacity_ - 1;
+  uint64_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  while (size > 0) {
+    uint64_t read_pos = header_->read_pos.load(std::memory_order_acquire);
+    if (write_pos - read_pos == capacity_) {
+      Wait(&header_->writer_waiting, [&]() {
+        read_pos = header_->read_pos.load(std::memory_order_acquire);
+        return write_pos - read_pos < capacity_;
+      });
+      if (closed_) { return; }
+    }
+    const size_t n = std::min<size_t>(size, capacity_ - (write_pos - read_pos));
+    const size_t begin = write_pos & mask;
+    const size_t first = std::min(n, capacity_ - begin);
+    memcpy(data_ + begin, data, first);
+    memcpy(data_, data + first, n - first);
+    write_pos += n;
+    data += n;
+    size -= n;
+    header_->write_pos.store(write_pos, std::memory_order_seq_cst);
+    if (header_->reader_waiting.load(std::memory_order_seq_cst) != 0) {
+      Wake(&header_->reader_waiting);
+    }
+  }
+}
+
+bool SharedMemoryRing::Read(char* data, size_t size) {
+  const uint64_t mask = capacity_ - 1;
+  uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  while (size > 0) {
+    uint64_t write_pos = header_->write_pos.load(std::memory_order_acquire);
+    if (write_pos == read_pos) {
+      Wait(&header_->reader_waiting, [&]() {
+        write_pos = header_->write_pos.load(std::memory_order_acquire);
+        return write_pos != read_pos;
+      });
+      if (closed_) { return false; }
+    }
+    const size_t n = std::min<size_t>(size, write_pos - read_pos);
+    const size_t begin = read_pos & mask;
+    const size_t first = std::min(n, capacity_ - begin);
+    memcpy(data, data_ + begin, first);
+    memcpy(data + first, data_, n - first);
+    read_pos += n;
+    data += n;
+    size -= n;
+    header_->read_pos.store(read_pos, std::memory_order_seq_cst);
+    if (header_->writer_waiting.load(std::memory_order_seq_cst) != 0) {
+      Wake(&header_->writer_waiting);
+    }
+  }
+  return true;
+}
+
+void SharedMemoryRing::Close() {
+  closed_ = true;
+  FutexWake(&header_->reader_waiting);
+  FutexWake(&header_->writer_waiting);
+}
+
+void SharedMemoryRing::Wait(std::atomic<uint32_t>* waiting, const std::function<bool()>& Ready) {
+  // spinning only holds up the other side when there is a single core
+  static const int64_t spin_count = std::thread::hardware_concurrency() > 1 ? kSpinCount : 0;
+  FOR_RANGE(int64_t, i, 0, spin_count) {
+    if (Ready()) { return; }
+  }
+  FOR_RANGE(int64_t, i, 0, kYieldCount) {
+    if (Ready()) { return; }
+    std::this_thread::yield();
+  }
+  while (!closed_) {
+    // the other side stores its position before loading the flag and this side stores the flag
+    // before loading the position, so at least one of them sees the store of the other
+    waiting->store(1, std::memory_order_seq_cst);
+    if (Ready()) {
+      waiting->store(0, std::memory_order_relaxed);
+      return;
+    }
+    FutexWait(waiting, 1);
+  }
+}
+
+void SharedMemoryRing::Wake(std::atomic<uint32_t>* waiting) {
+  if (waiting->exchange(0, std::memory_order_seq_cst) != 0) { FutexWake(waiting); }
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_RING_H_
+#define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_RING_H_
+
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/common/util.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// A single producer, single consumer byte stream in a POSIX shared memory segment, for two
+// processes of one host. The positions are lock free atomics in the segment. A side finding the
+// ring empty (full) spins for a while and then sleeps on a futex in the segment, which the other
+// side wakes up after moving its position.
+class SharedMemoryRing final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SharedMemoryRing);
+  ~SharedMemoryRing();
+
+  // Creates the segment with a capacity rounded up to a power of two. The segment stays until
+  // Unlink, the ones opening it need its name only. nullptr if the segment cannot be created or
+  // its pages cannot be reserved, e.g. /dev/shm is too small.
+  static std::unique_ptr<SharedMemoryRing> Create(const std::string& name, size_t capacity);
+  // nullptr if there is no segment of the name, which is the case for a creator on another host
+  static std::unique_ptr<SharedMemoryRing> Open(const std::string& name);
+  static void Unlink(const std::string& name);
+
+  // Blocks until all size bytes are in the ring, by the writing side only.
+  void Write(const char* data, size_t size);
+  // Blocks until size bytes have been read, by the reading side only. Returns false if the ring
+  // is closed before.
+  bool Read(char* data, size_t size);
+  // Wakes up and fails the waiting reads and writes of this process.
+  void Close();
+
+ private:
+  struct Header;
+
+  SharedMemoryRing(Header* header, size_t mapped_size);
+  // waits for Ready on *waiting until it returns true or the ring is closed
+  void Wait(std::atomic<uint32_t>* waiting, const std::function<bool()>& Ready);
+  static void Wake(std::atomic<uint32_t>* waiting);
+
+  Header* header_;
+  char* data_;
+  size_t capacity_;
+  size_t mapped_size_;
+  std::atomic<bool> closed_;
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_EPOLL_SHARED_MEMORY_RING_H_
@@ -0,0 +1,231 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <netinet/tcp.h>
+#include <sys/wait.h>
+#include "oneflow/core/comm_network/epoll/shared_memory_ring.h"
+#include "oneflow/core/comm_network/epoll/socket_message.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+std::string RingName(const std::string& suffix) {
+  return "/oneflow_shared_memory_ring_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+// a connected pair of loopback tcp sockets
+std::pair<int, int> LoopbackSockets() {
+  int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(listen_sockfd != -1);
+  sockaddr_in sa{};
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sa.sin_port = 0;
+  PCHECK(bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+  PCHECK(listen(listen_sockfd, 1) == 0);
+  socklen_t len = sizeof(sa);
+  PCHECK(getsockname(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), &len) == 0);
+  int lhs_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  const int val = 1;
+  PCHECK(setsockopt(lhs_sockfd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(int)) == 0);
+  PCHECK(connect(lhs_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+  int rhs_sockfd = accept(listen_sockfd, nullptr, nullptr);
+  PCHECK(rhs_sockfd != -1);
+  PCHECK(setsockopt(rhs_sockfd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(int)) == 0);
+  PCHECK(close(listen_sockfd) == 0);
+  return std::make_pair(lhs_sockfd, rhs_sockfd);
+}
+
+void WriteFully(int sockfd, const char* ptr, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(sockfd, ptr, size);
+    PCHECK(n > 0);
+    ptr += n;
+    size -= n;
+  }
+}
+
+void ReadFully(int sockfd, char* ptr, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(sockfd, ptr, size);
+    PCHECK(n > 0);
+    ptr += n;
+    size -= n;
+  }
+}
+
+// The same exchanges over both transports, Send and Recv of the parent, PeerSend and PeerRecv of
+// the forked child: round trips of socket message sized messages, then bodies sent one way.
+struct Transport {
+  std::function<void(const char*, size_t)> Send;
+  std::function<void(char*, size_t)> Recv;
+  std::function<void(const char*, size_t)> PeerSend;
+  std::function<void(char*, size_t)> PeerRecv;
+};
+
+const int64_t kRoundTripNum = 20000;
+const int64_t kBodySize = 64 << 20;
+const int64_t kBodyNum = 8;
+
+void RunPeer(const Transport& transport) {
+  SocketMsg msg;
+  FOR_RANGE(int64_t, i, 0, kRoundTripNum) {
+    transport.PeerRecv(reinterpret_cast<char*>(&msg), sizeof(msg));
+    transport.PeerSend(reinterpret_cast<const char*>(&msg), sizeof(msg));
+  }
+  std::vector<char> body(kBodySize, 1);
+  FOR_RANGE(int64_t, i, 0, kBodyNum) { transport.PeerSend(body.data(), body.size()); }
+  transport.PeerRecv(reinterpret_cast<char*>(&msg), sizeof(msg));
+}
+
+// returns the round trip latency in us and the bandwidth in GiB/s
+std::pair<double, double> Measure(const Transport& transport) {
+  SocketMsg msg;
+  std::memset(&msg, 0, sizeof(msg));
+  auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, kRoundTripNum) {
+    transport.Send(reinterpret_cast<const char*>(&msg), sizeof(msg));
+    transport.Recv(reinterpret_cast<char*>(&msg), sizeof(msg));
+  }
+  const double latency_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()
+      / kRoundTripNum;
+  std::vector<char> body(kBodySize);
+  start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, kBodyNum) { transport.Recv(body.data(), body.size()); }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CHECK_EQ(body.front(), 1);
+  CHECK_EQ(body.back(), 1);
+  transport.Send(reinterpret_cast<const char*>(&msg), sizeof(msg));
+  return std::make_pair(latency_us, kBodySize * kBodyNum / seconds / (1 << 30));
+}
+
+std::pair<double, double> MeasureWithPeerProcess(const Transport& transport) {
+  const pid_t pid = fork();
+  PCHECK(pid >= 0);
+  if (pid == 0) {
+    RunPeer(transport);
+    _exit(0);
+  }
+  const std::pair<double, double> result = Measure(transport);
+  int status = 0;
+  PCHECK(waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  return result;
+}
+
+}  // namespace
+
+TEST(SharedMemoryRing, stream_wraps_around) {
+  const std::string name = RingName("stream");
+  std::unique_ptr<SharedMemoryRing> writer = SharedMemoryRing::Create(name, 4000);
+  std::unique_ptr<SharedMemoryRing> reader = SharedMemoryRing::Open(name);
+  ASSERT_TRUE(reader);
+  SharedMemoryRing::Unlink(name);
+  const int64_t total_size = 10 << 20;
+  std::thread writer_thread([&]() {
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<size_t> dis(1, 10000);
+    std::vector<char> buffer;
+    for (int64_t offset = 0; offset < total_size;) {
+      buffer.resize(std::min<size_t>(dis(gen), total_size - offset));
+      FOR_RANGE(size_t, i, 0, buffer.size()) { buffer[i] = static_cast<char>((offset + i) % 251); }
+      writer->Write(buffer.data(), buffer.size());
+      offset += buffer.size();
+    }
+  });
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<size_t> dis(1, 7000);
+  std::vector<char> buffer;
+  for (int64_t offset = 0; offset < total_size;) {
+    buffer.resize(std::min<size_t>(dis(gen), total_size - offset));
+    ASSERT_TRUE(reader->Read(buffer.data(), buffer.size()));
+    FOR_RANGE(size_t, i, 0, buffer.size()) {
+      ASSERT_EQ(buffer[i], static_cast<char>((offset + i) % 251));
+    }
+    offset += buffer.size();
+  }
+  writer_thread.join();
+}
+
+TEST(SharedMemoryRing, open_missing_and_close) {
+  ASSERT_FALSE(SharedMemoryRing::Open(RingName("missing")));
+  const std::string name = RingName("close");
+  std::unique_ptr<SharedMemoryRing> writer = SharedMemoryRing::Create(name, 4096);
+  std::unique_ptr<SharedMemoryRing> reader = SharedMemoryRing::Open(name);
+  SharedMemoryRing::Unlink(name);
+  ASSERT_FALSE(SharedMemoryRing::Open(name));
+  char value = 0;
+  std::thread reader_thread([&]() { ASSERT_FALSE(reader->Read(&value, 1)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  reader->Close();
+  reader_thread.join();
+}
+
+TEST(SharedMemoryRing, create_failure) {
+  const std::string name = RingName("create_failure");
+  std::unique_ptr<SharedMemoryRing> ring = SharedMemoryRing::Create(name, 4096);
+  ASSERT_TRUE(ring);
+  // the name is taken, which leaves the segment of the name alone
+  ASSERT_FALSE(SharedMemoryRing::Create(name, 4096));
+  ASSERT_TRUE(SharedMemoryRing::Open(name));
+  SharedMemoryRing::Unlink(name);
+  // no /dev/shm has room for this
+  const std::string huge_name = RingName("huge");
+  ASSERT_FALSE(SharedMemoryRing::Create(huge_name, size_t(1) << 50));
+  ASSERT_FALSE(SharedMemoryRing::Open(huge_name));
+}
+
+TEST(SharedMemoryRing, benchmark_compared_with_loopback_tcp) {
+  const std::string lhs_name = RingName("lhs");
+  const std::string rhs_name = RingName("rhs");
+  std::unique_ptr<SharedMemoryRing> lhs = SharedMemoryRing::Create(lhs_name, 8 << 20);
+  std::unique_ptr<SharedMemoryRing> rhs = SharedMemoryRing::Create(rhs_name, 8 << 20);
+  Transport ring_transport;
+  ring_transport.Send = [&](const char* data, size_t size) { lhs->Write(data, size); };
+  ring_transport.Recv = [&](char* data, size_t size) { CHECK(rhs->Read(data, size)); };
+  ring_transport.PeerSend = [&](const char* data, size_t size) { rhs->Write(data, size); };
+  ring_transport.PeerRecv = [&](char* data, size_t size) { CHECK(lhs->Read(data, size)); };
+  const std::pair<double, double> ring_result = MeasureWithPeerProcess(ring_transport);
+  SharedMemoryRing::Unlink(lhs_name);
+  SharedMemoryRing::Unlink(rhs_name);
+
+  const std::pair<int, int> sockfds = LoopbackSockets();
+  Transport tcp_transport;
+  tcp_transport.Send = [&](const char* data, size_t size) {
+    WriteFully(sockfds.first, data, size);
+  };
+  tcp_transport.Recv = [&](char* data, size_t size) { ReadFully(sockfds.first, data, size); };
+  tcp_transport.PeerSend = [&](const char* data, size_t size) {
+    WriteFully(sockfds.second, data, size);
+  };
+  tcp_transport.PeerRecv = [&](char* data, size_t size) { ReadFully(sockfds.second, data, size); };
+  const std::pair<double, double> tcp_result = MeasureWithPeerProcess(tcp_transport);
+  PCHECK(close(sockfds.first) == 0);
+  PCHECK(close(sockfds.second) == 0);
+  LOG(INFO) << "round trip of a socket message, loopback tcp: " << tcp_result.first
+            << " us, shared memory: " << ring_result.first << " us";
+  LOG(INFO) << "64MiB bodies, loopback tcp: " << tcp_result.second
+            << " GiB/s, shared memory: " << ring_result.second << " GiB/s";
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
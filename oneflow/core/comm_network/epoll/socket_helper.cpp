@@ -19,11 +19,12 @@ limitations under the License.
 
 namespace oneflow {
 
-SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller) {
+SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller, bool enable_zero_copy) {
   read_helper_ = new SocketReadHelper(sockfd);
-  write_helper_ = new SocketWriteHelper(sockfd, poller);
+  write_helper_ = new SocketWriteHelper(sockfd, poller, enable_zero_copy);
   poller->AddFd(sockfd, [this]() { read_helper_->NotifyMeSocketReadable(); },
-                [this]() { write_helper_->NotifyMeSocketWriteable(); });
+                [this]() { write_helper_->NotifyMeSocketWriteable(); },
+                [this]() { write_helper_->NotifyMeSocketError(); });
 }
 
 SocketHelper::~SocketHelper() {
@@ -45,17 +45,26 @@ enum class SocketMsgType {
 #undef MAKE_ENTRY
 };
 
+// A register body is read as stripe_num stripes, each of them [offset, offset + byte_size) of the
+// body and sent over socket stripe_id to the peer. Bodies not striped have a single stripe.
 struct RequestWriteMsg {
   void* src_token;
   int64_t dst_machine_id;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int32_t stripe_id;
+  int32_t stripe_num;
 };
 
 struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int32_t stripe_num;
 };
 
 struct SocketMsg {
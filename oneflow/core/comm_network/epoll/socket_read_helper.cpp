@@ -20,15 +20,25 @@ limitations under the License.
 #ifdef PLATFORM_POSIX
 
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 
 namespace oneflow {
 
+namespace {
+
+const size_t kReadBufferSize = 64 << 10;
+
+}  // namespace
+
 SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
 SocketReadHelper::SocketReadHelper(int sockfd) {
   sockfd_ = sockfd;
+  buffer_.resize(kReadBufferSize);
+  buffer_begin_ = 0;
+  buffer_end_ = 0;
   SwitchToMsgHeadReadHandle();
 }
 
@@ -53,21 +63,41 @@ bool SocketReadHelper::MsgBodyReadHandle() {
 }
 
 bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)()) {
-  ssize_t n = read(sockfd_, read_ptr_, read_size_);
-  const int val = 1;
-  PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
-  if (n == read_size_) {
+  if (read_size_ == 0) {
     (this->*set_cur_read_done)();
     return true;
-  } else if (n >= 0) {
+  }
+  if (buffer_begin_ < buffer_end_) {
+    const size_t n = std::min(read_size_, buffer_end_ - buffer_begin_);
+    memcpy(read_ptr_, buffer_.data() + buffer_begin_, n);
+    buffer_begin_ += n;
     read_ptr_ += n;
     read_size_ -= n;
-    return true;
   } else {
-    CHECK_EQ(n, -1);
-    PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
-    return false;
+    // reads into what is being read and, past its end, into the buffer, which is where the
+    // following heads and small bodies land
+    iovec iov[2];
+    iov[0].iov_base = read_ptr_;
+    iov[0].iov_len = read_size_;
+    iov[1].iov_base = buffer_.data();
+    iov[1].iov_len = buffer_.size();
+    ssize_t n = readv(sockfd_, iov, 2);
+    const int val = 1;
+    PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
+    if (n == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      return false;
+    }
+    // closed by peer
+    if (n == 0) { return false; }
+    const size_t cur_n = std::min(static_cast<size_t>(n), read_size_);
+    read_ptr_ += cur_n;
+    read_size_ -= cur_n;
+    buffer_begin_ = 0;
+    buffer_end_ = n - cur_n;
   }
+  if (read_size_ == 0) { (this->*set_cur_read_done)(); }
+  return true;
 }
 
 void SocketReadHelper::SetStatusWhenMsgHeadDone() {
@@ -82,7 +112,8 @@ void SocketReadHelper::SetStatusWhenMsgHeadDone() {
 
 void SocketReadHelper::SetStatusWhenMsgBodyDone() {
   if (cur_msg_.msg_type == SocketMsgType::kRequestRead) {
-    Global<EpollCommNet>::Get()->ReadDone(cur_msg_.request_read_msg.read_id);
+    Global<EpollCommNet>::Get()->StripeReadDone(cur_msg_.request_read_msg.read_id,
+                                                cur_msg_.request_read_msg.stripe_num);
   }
   SwitchToMsgHeadReadHandle();
 }
@@ -93,15 +124,20 @@ void SocketReadHelper::SetStatusWhenRequestWriteMsgHeadDone() {
   msg_to_send.request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
   msg_to_send.request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
   msg_to_send.request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
+  msg_to_send.request_read_msg.offset = cur_msg_.request_write_msg.offset;
+  msg_to_send.request_read_msg.byte_size = cur_msg_.request_write_msg.byte_size;
+  msg_to_send.request_read_msg.stripe_num = cur_msg_.request_write_msg.stripe_num;
   Global<EpollCommNet>::Get()->SendSocketMsg(cur_msg_.request_write_msg.dst_machine_id,
-                                             msg_to_send);
+                                             cur_msg_.request_write_msg.stripe_id, msg_to_send);
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::SetStatusWhenRequestReadMsgHeadDone() {
   auto mem_desc = static_cast<const SocketMemDesc*>(cur_msg_.request_read_msg.dst_token);
-  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr);
-  read_size_ = mem_desc->byte_size;
+  CHECK_LE(cur_msg_.request_read_msg.offset + cur_msg_.request_read_msg.byte_size,
+           static_cast<int64_t>(mem_desc->byte_size));
+  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr) + cur_msg_.request_read_msg.offset;
+  read_size_ = cur_msg_.request_read_msg.byte_size;
   cur_read_handle_ = &SocketReadHelper::MsgBodyReadHandle;
 }
 
@@ -49,6 +49,11 @@ class SocketReadHelper final {
 
   int sockfd_;
 
+  // bytes read past the current head or body, saving a syscall per message
+  std::vector<char> buffer_;
+  size_t buffer_begin_;
+  size_t buffer_end_;
+
   SocketMsg cur_msg_;
   bool (SocketReadHelper::*cur_read_handle_)();
   char* read_ptr_;
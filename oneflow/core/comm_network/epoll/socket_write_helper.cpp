@@ -18,10 +18,18 @@ limitations under the License.
 
 #ifdef PLATFORM_POSIX
 
+#include <linux/errqueue.h>
 #include <sys/eventfd.h>
 
 namespace oneflow {
 
+namespace {
+
+const size_t kMaxBatchMsgNum = 256;
+const size_t kMinZeroCopyBodySize = 64 << 10;
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -32,17 +40,31 @@ SocketWriteHelper::~SocketWriteHelper() {
   }
 }
 
-SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
+SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller, bool enable_zero_copy) {
   sockfd_ = sockfd;
   queue_not_empty_fd_ = eventfd(0, 0);
   PCHECK(queue_not_empty_fd_ != -1);
   poller->AddFdWithOnlyReadHandler(queue_not_empty_fd_,
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
+  enable_zero_copy_ = false;
+  if (enable_zero_copy) {
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    const int val = 1;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == 0) {
+      enable_zero_copy_ = true;
+    } else {
+      PLOG(WARNING) << "MSG_ZEROCOPY not supported, sockfd " << sockfd_;
+    }
+#else
+    LOG(WARNING) << "MSG_ZEROCOPY not supported by this build";
+#endif
+  }
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  batch_msgs_.reserve(kMaxBatchMsgNum);
+  batch_iovs_.reserve(2 * kMaxBatchMsgNum);
+  batch_iov_idx_ = 0;
+  zero_copy_iov_idx_ = SIZE_MAX;
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -55,6 +77,36 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
 
 void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
 
+void SocketWriteHelper::NotifyMeSocketError() {
+#if defined(SO_EE_ORIGIN_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  // Drains the completions of MSG_ZEROCOPY sends. Nothing waits for them, the register of a body
+  // is reused only after the peer has received all of it.
+  char control[256];
+  while (true) {
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      // other control messages, such as timestamps, may come along and carry no error
+      const bool is_recv_err = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                               || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+      if (!is_recv_err) { continue; }
+      const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      CHECK_EQ(err->ee_origin, SO_EE_ORIGIN_ZEROCOPY)
+          << "sockfd " << sockfd_ << ": " << std::strerror(err->ee_errno);
+    }
+  }
+#endif
+  int error = 0;
+  socklen_t len = sizeof(error);
+  PCHECK(getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &error, &len) == 0);
+  CHECK_EQ(error, 0) << "sockfd " << sockfd_ << ": " << std::strerror(error);
+}
+
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
   PCHECK(write(queue_not_empty_fd_, &event_num, 8) == 8);
@@ -67,10 +119,13 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
+  while (true) {
+    if (batch_iov_idx_ == batch_iovs_.size() && !InitBatch()) { return; }
+    if (!WriteBatch()) { return; }
+  }
 }
 
-bool SocketWriteHelper::InitMsgWriteHandle() {
+bool SocketWriteHelper::InitBatch() {
   if (cur_msg_queue_->empty()) {
     {
       std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
@@ -78,66 +133,66 @@ bool SocketWriteHelper::InitMsgWriteHandle() {
     }
     if (cur_msg_queue_->empty()) { return false; }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
+  batch_msgs_.clear();
+  batch_iovs_.clear();
+  batch_iov_idx_ = 0;
+  zero_copy_iov_idx_ = SIZE_MAX;
+  while (!cur_msg_queue_->empty() && batch_msgs_.size() < kMaxBatchMsgNum) {
+    batch_msgs_.push_back(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+    const SocketMsg& msg = batch_msgs_.back();
+    batch_iovs_.push_back(iovec{const_cast<SocketMsg*>(&msg), sizeof(msg)});
+    if (msg.msg_type == SocketMsgType::kRequestRead) {
+      auto body = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+      const size_t byte_size = msg.request_read_msg.byte_size;
+      CHECK_LE(msg.request_read_msg.offset + byte_size, body->byte_size);
+      batch_iovs_.push_back(
+          iovec{static_cast<char*>(body->mem_ptr) + msg.request_read_msg.offset, byte_size});
+      if (enable_zero_copy_ && byte_size >= kMinZeroCopyBodySize) {
+        zero_copy_iov_idx_ = batch_iovs_.size() - 1;
+        break;
+      }
+    }
+  }
   return true;
 }
 
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
-}
-
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
-    return true;
-  } else {
-    CHECK_EQ(n, -1);
+bool SocketWriteHelper::WriteBatch() {
+  const bool is_zero_copy = batch_iov_idx_ >= zero_copy_iov_idx_;
+  const size_t iov_end = is_zero_copy ? batch_iovs_.size() : zero_copy_iov_idx_;
+  msghdr msg{};
+  msg.msg_iov = batch_iovs_.data() + batch_iov_idx_;
+  msg.msg_iovlen = std::min(iov_end, batch_iovs_.size()) - batch_iov_idx_;
+  int flags = 0;
+#ifdef MSG_ZEROCOPY
+  if (is_zero_copy) { flags |= MSG_ZEROCOPY; }
+#endif
+  ssize_t n = sendmsg(sockfd_, &msg, flags);
+  if (n == -1) {
+    if (is_zero_copy && errno == ENOBUFS) {
+      // out of the memory locked for zero copy, copy this body instead
+      zero_copy_iov_idx_ = SIZE_MAX;
+      return true;
+    }
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
     return false;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+  while (n > 0) {
+    iovec* iov = &batch_iovs_.at(batch_iov_idx_);
+    if (static_cast<size_t>(n) < iov->iov_len) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+      iov->iov_len -= n;
+      n = 0;
+    } else {
+      n -= iov->iov_len;
+      batch_iov_idx_ += 1;
+    }
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+  // skips empty bodies
+  while (batch_iov_idx_ < batch_iovs_.size() && batch_iovs_.at(batch_iov_idx_).iov_len == 0) {
+    batch_iov_idx_ += 1;
+  }
+  return true;
 }
 
 }  // namespace oneflow
@@ -21,6 +21,8 @@ limitations under the License.
 
 #ifdef PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
 class SocketWriteHelper final {
@@ -29,41 +31,40 @@ class SocketWriteHelper final {
   SocketWriteHelper() = delete;
   ~SocketWriteHelper();
 
-  SocketWriteHelper(int sockfd, IOEventPoller* poller);
+  // large bodies are sent with MSG_ZEROCOPY when enable_zero_copy and the kernel supports it
+  SocketWriteHelper(int sockfd, IOEventPoller* poller, bool enable_zero_copy);
 
   void AsyncWrite(const SocketMsg& msg);
 
   void NotifyMeSocketWriteable();
+  void NotifyMeSocketError();
 
  private:
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  // returns false if there is no message to write
+  bool InitBatch();
+  // returns false if the socket is not writeable
+  bool WriteBatch();
 
   int sockfd_;
   int queue_not_empty_fd_;
+  bool enable_zero_copy_;
 
   std::queue<SocketMsg>* cur_msg_queue_;
 
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // Messages taken from the queue, their heads and bodies gathered by iovecs and written with as
+  // few sendmsg as the socket allows. A body sent with MSG_ZEROCOPY ends the batch and is written
+  // on its own, the heads before it are copied as usual since their storage is reused.
+  std::vector<SocketMsg> batch_msgs_;
+  std::vector<iovec> batch_iovs_;
+  size_t batch_iov_idx_;
+  size_t zero_copy_iov_idx_;
 };
 
 }  // namespace oneflow
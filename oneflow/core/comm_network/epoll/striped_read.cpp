@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/striped_read.h"
+
+namespace oneflow {
+
+namespace {
+
+const int64_t kMinStripeSize = 1 << 20;
+
+struct StripedReadContext {
+  StripedReadContext(void* id, int32_t stripe_num)
+      : read_id(id), remaining_stripe_num(stripe_num) {}
+  void* read_id;
+  std::atomic<int32_t> remaining_stripe_num;
+};
+
+}  // namespace
+
+int32_t StripeNum4ByteSize(int64_t byte_size, int32_t max_stripe_num) {
+  return static_cast<int32_t>(
+      std::max<int64_t>(std::min<int64_t>(max_stripe_num, byte_size / kMinStripeSize), 1));
+}
+
+void GetStripeRange(int64_t byte_size, int32_t stripe_id, int32_t stripe_num, int64_t* offset,
+                    int64_t* stripe_size) {
+  CHECK_GE(stripe_id, 0);
+  CHECK_LT(stripe_id, stripe_num);
+  *offset = byte_size * stripe_id / stripe_num;
+  *stripe_size = byte_size * (stripe_id + 1) / stripe_num - *offset;
+}
+
+void* NewStripedReadId(void* read_id, int32_t stripe_num) {
+  CHECK_GE(stripe_num, 1);
+  if (stripe_num == 1) { return read_id; }
+  return new StripedReadContext(read_id, stripe_num);
+}
+
+void* StripedReadDone(void* striped_read_id, int32_t stripe_num) {
+  if (stripe_num == 1) { return striped_read_id; }
+  // the stripes land on different pollers, whichever finishes last completes the read, so that
+  // the reads of an actor still complete one by one in the order they were issued
+  auto* ctx = static_cast<StripedReadContext*>(striped_read_id);
+  if (ctx->remaining_stripe_num.fetch_sub(1, std::memory_order_acq_rel) != 1) { return nullptr; }
+  void* read_id = ctx->read_id;
+  delete ctx;
+  return read_id;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,42 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_STRIPED_READ_H_
+#define ONEFLOW_CORE_COMM_NETWORK_EPOLL_STRIPED_READ_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// The body of a large read is split into stripes of at least 1MiB, at most max_stripe_num of
+// them, sent over different sockets. Returns 1 for bodies not worth striping.
+int32_t StripeNum4ByteSize(int64_t byte_size, int32_t max_stripe_num);
+
+// [*offset, *offset + *stripe_size) of stripe stripe_id, the stripes are contiguous and their
+// sizes differ by at most one byte
+void GetStripeRange(int64_t byte_size, int32_t stripe_id, int32_t stripe_num, int64_t* offset,
+                    int64_t* stripe_size);
+
+// The read id carried by the stripes of a read of stripe_num stripes, read_id itself for a single
+// stripe, a counter of the pending stripes otherwise.
+void* NewStripedReadId(void* read_id, int32_t stripe_num);
+
+// Called once for every received stripe, from any thread. Returns the read_id given to
+// NewStripedReadId after the last stripe of the read, nullptr before.
+void* StripedReadDone(void* striped_read_id, int32_t stripe_num);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_EPOLL_STRIPED_READ_H_
@@ -0,0 +1,102 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/core/comm_network/epoll/striped_read.h"
+
+namespace oneflow {
+
+namespace {
+
+struct TestRead {
+  int64_t completed_bytes_at_done = -1;
+};
+
+// what DoRead and the pollers do with a read of byte_size bytes over max_stripe_num sockets: every
+// stripe is copied by a thread of its own, as it lands on its own poller
+void StripedCopy(int64_t byte_size, int32_t max_stripe_num, int32_t* stripe_num,
+                 int64_t* done_cnt, TestRead* read) {
+  std::vector<char> src(byte_size);
+  FOR_RANGE(int64_t, i, 0, byte_size) { src.at(i) = static_cast<char>(i * 131 + i / 4099); }
+  std::vector<char> dst(byte_size, 0);
+  *stripe_num = StripeNum4ByteSize(byte_size, max_stripe_num);
+  void* striped_read_id = NewStripedReadId(read, *stripe_num);
+  std::atomic<int64_t> completed_bytes(0);
+  std::atomic<int64_t> atomic_done_cnt(0);
+  std::vector<std::thread> pollers;
+  FOR_RANGE(int32_t, stripe_id, 0, *stripe_num) {
+    pollers.emplace_back([&, stripe_id]() {
+      int64_t offset = 0;
+      int64_t stripe_size = 0;
+      GetStripeRange(byte_size, stripe_id, *stripe_num, &offset, &stripe_size);
+      if (*stripe_num > 1) { CHECK_GE(stripe_size, 1 << 20); }
+      std::copy(src.data() + offset, src.data() + offset + stripe_size, dst.data() + offset);
+      completed_bytes += stripe_size;
+      void* done_read_id = StripedReadDone(striped_read_id, *stripe_num);
+      if (done_read_id != nullptr) {
+        atomic_done_cnt += 1;
+        static_cast<TestRead*>(done_read_id)->completed_bytes_at_done = completed_bytes;
+      }
+    });
+  }
+  for (std::thread& poller : pollers) { poller.join(); }
+  *done_cnt = atomic_done_cnt;
+  CHECK(src == dst);
+}
+
+}  // namespace
+
+TEST(StripedRead, stripe_num) {
+  ASSERT_EQ(StripeNum4ByteSize(0, 4), 1);
+  ASSERT_EQ(StripeNum4ByteSize((1 << 20) * 2 - 1, 4), 1);
+  ASSERT_EQ(StripeNum4ByteSize((1 << 20) * 2, 4), 2);
+  ASSERT_EQ(StripeNum4ByteSize((1 << 20) * 100, 4), 4);
+  ASSERT_EQ(StripeNum4ByteSize((1 << 20) * 100, 1), 1);
+}
+
+TEST(StripedRead, stripes_cover_the_body) {
+  const int64_t byte_size = (1 << 20) * 5 + 3;
+  const int32_t stripe_num = StripeNum4ByteSize(byte_size, 4);
+  ASSERT_EQ(stripe_num, 4);
+  int64_t end = 0;
+  FOR_RANGE(int32_t, stripe_id, 0, stripe_num) {
+    int64_t offset = 0;
+    int64_t stripe_size = 0;
+    GetStripeRange(byte_size, stripe_id, stripe_num, &offset, &stripe_size);
+    ASSERT_EQ(offset, end);
+    ASSERT_GE(stripe_size, byte_size / stripe_num);
+    ASSERT_LE(stripe_size, byte_size / stripe_num + 1);
+    end = offset + stripe_size;
+  }
+  ASSERT_EQ(end, byte_size);
+}
+
+TEST(StripedRead, single_read_done) {
+  // sizes that do not divide evenly among the stripes, and a single stripe below 2MiB
+  for (const int64_t byte_size :
+       {(1 << 20) * 5 + 3, (1 << 20) * 3 - 1, (1 << 20) * 2 + 1, (1 << 20) + 7}) {
+    FOR_RANGE(int32_t, repeat, 0, 20) {
+      TestRead read;
+      int32_t stripe_num = 0;
+      int64_t done_cnt = 0;
+      StripedCopy(byte_size, 4, &stripe_num, &done_cnt, &read);
+      ASSERT_EQ(stripe_num, std::min<int64_t>(4, std::max<int64_t>(1, byte_size >> 20)));
+      ASSERT_EQ(done_cnt, 1);
+      ASSERT_EQ(read.completed_bytes_at_done, byte_size);
+    }
+  }
+}
+
+}  // namespace oneflow
@@ -485,6 +485,24 @@ void cblas_zher2k(const enum CBLAS_ORDER Order, const enum CBLAS_UPLO Uplo,
 
 void cblas_xerbla(int p, const char *rout, const char *form, ...);
 
+#ifdef WITH_MKL
+/*
+ * Intel MKL extension, group_count groups of gemms, those of a group share sizes and scalars
+ */
+void cblas_sgemm_batch(const enum CBLAS_ORDER Layout, const enum CBLAS_TRANSPOSE *TransA_Array,
+                       const enum CBLAS_TRANSPOSE *TransB_Array, const int *M_Array,
+                       const int *N_Array, const int *K_Array, const float *alpha_Array,
+                       const float **A_Array, const int *lda_Array, const float **B_Array,
+                       const int *ldb_Array, const float *beta_Array, float **C_Array,
+                       const int *ldc_Array, const int group_count, const int *group_size);
+void cblas_dgemm_batch(const enum CBLAS_ORDER Layout, const enum CBLAS_TRANSPOSE *TransA_Array,
+                       const enum CBLAS_TRANSPOSE *TransB_Array, const int *M_Array,
+                       const int *N_Array, const int *K_Array, const double *alpha_Array,
+                       const double **A_Array, const int *lda_Array, const double **B_Array,
+                       const int *ldb_Array, const double *beta_Array, double **C_Array,
+                       const int *ldc_Array, const int group_count, const int *group_size);
+#endif  // WITH_MKL
+
 #ifdef __cplusplus
 }
 #endif
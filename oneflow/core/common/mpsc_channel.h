@@ -0,0 +1,251 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include <limits>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+// Multi-producer/single-consumer channel with the same interface as Channel<T>.
+//
+// Send() claims a slot of a bounded ring buffer with a single CAS and never takes a lock on the
+// fast path. When the ring is full the item goes to a mutex-protected overflow queue instead of
+// blocking the producer, so a consumer that sends to its own channel can not deadlock.
+// Once the overflow queue is non-empty all producers append to it until the consumer drains it,
+// and the consumer only takes from it once every claimed ring slot has been consumed, even one a
+// slow producer has not filled yet, which keeps the per-producer FIFO order.
+//
+// Receive()/ReceiveMany() must only be called from one thread. An empty consumer spins for an
+// adaptive number of rounds before parking on a condition variable; producers only touch the
+// mutex when the consumer is actually parked.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  explicit MpscChannel(size_t capacity);
+  MpscChannel() : MpscChannel(kDefaultCapacity) {}
+  ~MpscChannel() = default;
+
+  ChannelStatus Send(const T& item);
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+  size_t capacity() const { return slots_.size(); }
+
+  static const size_t kDefaultCapacity = 4096;
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    T item;
+  };
+  static const int64_t kMinSpinCount = 16;
+  static const int64_t kMaxSpinCount = 16384;
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t ret = 2;
+    while (ret < n) { ret <<= 1; }
+    return ret;
+  }
+  bool TryPushToRing(const T& item);
+  template<typename CallbackT>
+  size_t DrainRing(const CallbackT& Callback, size_t max_num);
+  template<typename CallbackT>
+  size_t Drain(const CallbackT& Callback, size_t max_num);
+  template<typename CallbackT>
+  ChannelStatus WaitAndDrain(const CallbackT& Callback, size_t max_num);
+  bool IsEmpty() const;
+  void WakeUpConsumerIfParked();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  char pad0_[64];
+  std::atomic<size_t> tail_;
+  char pad1_[64];
+  size_t head_;
+  int64_t spin_count_;
+  char pad2_[64];
+  std::atomic<size_t> overflow_size_;
+  std::mutex overflow_mutex_;
+  std::queue<T> overflow_queue_;
+  std::atomic<bool> is_closed_;
+  std::atomic<bool> is_parked_;
+  std::mutex park_mutex_;
+  std::condition_variable park_cond_;
+};
+
+template<typename T>
+const size_t MpscChannel<T>::kDefaultCapacity;
+template<typename T>
+const int64_t MpscChannel<T>::kMinSpinCount;
+template<typename T>
+const int64_t MpscChannel<T>::kMaxSpinCount;
+
+template<typename T>
+MpscChannel<T>::MpscChannel(size_t capacity)
+    : slots_(RoundUpToPowerOfTwo(capacity)),
+      mask_(slots_.size() - 1),
+      tail_(0),
+      head_(0),
+      spin_count_(kMinSpinCount),
+      overflow_size_(0),
+      is_closed_(false),
+      is_parked_(false) {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    slots_.at(i).seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPushToRing(const T& item) {
+  size_t pos = tail_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos & mask_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot->item = item;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Send(const T& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  if (overflow_size_.load(std::memory_order_acquire) > 0 || !TryPushToRing(item)) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    overflow_queue_.push(item);
+    overflow_size_.fetch_add(1, std::memory_order_release);
+  }
+  WakeUpConsumerIfParked();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::WakeUpConsumerIfParked() {
+  // pairs with the fence in WaitAndDrain so that either the consumer sees the new item or the
+  // producer sees is_parked_ == true
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_parked_.load(std::memory_order_relaxed)) {
+    { std::unique_lock<std::mutex> lock(park_mutex_); }
+    park_cond_.notify_one();
+  }
+}
+
+template<typename T>
+template<typename CallbackT>
+size_t MpscChannel<T>::DrainRing(const CallbackT& Callback, size_t max_num) {
+  size_t num = 0;
+  while (num < max_num) {
+    Slot* slot = &slots_[head_ & mask_];
+    if (slot->seq.load(std::memory_order_acquire) != head_ + 1) { break; }
+    Callback(&slot->item);
+    slot->seq.store(head_ + slots_.size(), std::memory_order_release);
+    ++head_;
+    ++num;
+  }
+  return num;
+}
+
+template<typename T>
+template<typename CallbackT>
+size_t MpscChannel<T>::Drain(const CallbackT& Callback, size_t max_num) {
+  size_t num = DrainRing(Callback, max_num);
+  if (num < max_num && overflow_size_.load(std::memory_order_acquire) > 0) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    // A slot claimed before an item of the overflow queue was pushed is seen here, since the item
+    // was pushed under the lock. Its item may be older than those of the overflow queue.
+    if (tail_.load(std::memory_order_relaxed) != head_) { return num; }
+    while (num < max_num && !overflow_queue_.empty()) {
+      Callback(&overflow_queue_.front());
+      overflow_queue_.pop();
+      overflow_size_.fetch_sub(1, std::memory_order_release);
+      ++num;
+    }
+  }
+  return num;
+}
+
+template<typename T>
+bool MpscChannel<T>::IsEmpty() const {
+  return slots_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1
+         && overflow_size_.load(std::memory_order_acquire) == 0;
+}
+
+template<typename T>
+template<typename CallbackT>
+ChannelStatus MpscChannel<T>::WaitAndDrain(const CallbackT& Callback, size_t max_num) {
+  size_t num = Drain(Callback, max_num);
+  if (num > 0) { return kChannelStatusSuccess; }
+  for (int64_t i = 0; i < spin_count_; ++i) {
+    num = Drain(Callback, max_num);
+    if (num > 0) {
+      spin_count_ = std::min(spin_count_ * 2, kMaxSpinCount);
+      return kChannelStatusSuccess;
+    }
+    if (is_closed_.load(std::memory_order_acquire)) { break; }
+    std::this_thread::yield();
+  }
+  spin_count_ = std::max(spin_count_ / 2, kMinSpinCount);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(park_mutex_);
+      is_parked_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      park_cond_.wait(lock, [this]() {
+        return !IsEmpty() || is_closed_.load(std::memory_order_acquire);
+      });
+      is_parked_.store(false, std::memory_order_relaxed);
+    }
+    num = Drain(Callback, max_num);
+    if (num > 0) { return kChannelStatusSuccess; }
+    if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  }
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Receive(T* item) {
+  return WaitAndDrain([item](T* front) { *item = std::move(*front); }, 1);
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  return WaitAndDrain([items](T* front) { items->push(std::move(*front)); },
+                      std::numeric_limits<size_t>::max());
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  std::unique_lock<std::mutex> lock(park_mutex_);
+  is_closed_.store(true, std::memory_order_release);
+  park_cond_.notify_all();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
@@ -0,0 +1,174 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/common/mpsc_channel.h"
+
+namespace oneflow {
+
+namespace {
+
+struct TestMsg {
+  int64_t sender_id;
+  int64_t seq;
+};
+
+template<typename ChannelT>
+void SendFromThread(ChannelT* channel, int64_t sender_id, int64_t msg_num) {
+  for (int64_t i = 0; i < msg_num; ++i) {
+    TestMsg msg;
+    msg.sender_id = sender_id;
+    msg.seq = i;
+    ASSERT_EQ(channel->Send(msg), kChannelStatusSuccess);
+  }
+}
+
+// Returns the number of messages received per second. Messages of each sender must arrive in
+// order and none may be lost.
+template<typename ChannelT>
+double RunSendersAndOneReceiver(ChannelT* channel, int64_t sender_num, int64_t msg_num) {
+  std::vector<int64_t> next_seq(sender_num, 0);
+  int64_t total = 0;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> senders;
+  for (int64_t i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread(SendFromThread<ChannelT>, channel, i, msg_num));
+  }
+  std::queue<TestMsg> msgs;
+  while (total < sender_num * msg_num) {
+    CHECK_EQ(channel->ReceiveMany(&msgs), kChannelStatusSuccess);
+    while (!msgs.empty()) {
+      const TestMsg& msg = msgs.front();
+      CHECK_EQ(msg.seq, next_seq.at(msg.sender_id));
+      next_seq.at(msg.sender_id) += 1;
+      total += 1;
+      msgs.pop();
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  for (std::thread& sender : senders) { sender.join(); }
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  return total / std::max(seconds, 1e-9);
+}
+
+// An item whose copy into a ring slot waits for release, so that the slot stays claimed but not
+// filled.
+struct StallingItem {
+  int64_t value = 0;
+  std::atomic<bool>* claimed = nullptr;
+  std::atomic<bool>* release = nullptr;
+
+  StallingItem() = default;
+  StallingItem(int64_t val, std::atomic<bool>* claimed_flag, std::atomic<bool>* release_flag)
+      : value(val), claimed(claimed_flag), release(release_flag) {}
+  StallingItem(const StallingItem&) = default;
+  StallingItem& operator=(const StallingItem& other) {
+    if (other.release != nullptr) {
+      other.claimed->store(true);
+      while (!other.release->load()) { std::this_thread::yield(); }
+    }
+    value = other.value;
+    return *this;
+  }
+  StallingItem& operator=(StallingItem&& other) {
+    value = other.value;
+    return *this;
+  }
+};
+
+}  // namespace
+
+TEST(MpscChannel, stalled_slot_keeps_fifo_with_overflow) {
+  MpscChannel<StallingItem> channel(2);
+  std::atomic<bool> claimed(false);
+  std::atomic<bool> release(false);
+  // the slow producer claims slot 0 and stalls before filling it
+  std::thread slow_producer([&]() {
+    ASSERT_EQ(channel.Send(StallingItem(0, &claimed, &release)), kChannelStatusSuccess);
+  });
+  while (!claimed.load()) { std::this_thread::yield(); }
+  // item 1 goes to slot 1, the ring is then full and item 2 of the same producer overflows
+  ASSERT_EQ(channel.Send(StallingItem(1, nullptr, nullptr)), kChannelStatusSuccess);
+  ASSERT_EQ(channel.Send(StallingItem(2, nullptr, nullptr)), kChannelStatusSuccess);
+  std::vector<int64_t> values;
+  std::thread receiver([&]() {
+    std::queue<StallingItem> items;
+    while (values.size() < 3) {
+      ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+      while (!items.empty()) {
+        values.push_back(items.front().value);
+        items.pop();
+      }
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  release.store(true);
+  slow_producer.join();
+  receiver.join();
+  ASSERT_EQ(values, std::vector<int64_t>({0, 1, 2}));
+}
+
+TEST(MpscChannel, single_thread) {
+  MpscChannel<int> channel(4);
+  ASSERT_EQ(channel.capacity(), 4U);
+  // the last 6 items go to the overflow queue
+  for (int i = 0; i < 10; ++i) { ASSERT_EQ(channel.Send(i), kChannelStatusSuccess); }
+  int item = -1;
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+  ASSERT_EQ(item, 0);
+  std::queue<int> items;
+  ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+  ASSERT_EQ(items.size(), 9U);
+  for (int i = 1; i < 10; ++i) {
+    ASSERT_EQ(items.front(), i);
+    items.pop();
+  }
+  channel.Close();
+  ASSERT_EQ(channel.Send(10), kChannelStatusErrorClosed);
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusErrorClosed);
+}
+
+TEST(MpscChannel, close_wakes_up_parked_receiver) {
+  MpscChannel<int> channel;
+  std::thread receiver([&channel]() {
+    std::queue<int> items;
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+    ASSERT_EQ(items.front(), 1);
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(channel.Send(1), kChannelStatusSuccess);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  channel.Close();
+  receiver.join();
+}
+
+TEST(MpscChannel, 30sender1receiver) {
+  MpscChannel<TestMsg> channel(64);
+  RunSendersAndOneReceiver(&channel, 30, 2000);
+}
+
+TEST(MpscChannel, throughput_compared_with_channel) {
+  const int64_t sender_num = 4;
+  const int64_t msg_num = 200000;
+  Channel<TestMsg> channel;
+  MpscChannel<TestMsg> mpsc_channel;
+  const double channel_msgs_per_sec = RunSendersAndOneReceiver(&channel, sender_num, msg_num);
+  const double mpsc_msgs_per_sec = RunSendersAndOneReceiver(&mpsc_channel, sender_num, msg_num);
+  LOG(INFO) << "Channel: " << channel_msgs_per_sec << " msgs/sec, MpscChannel: "
+            << mpsc_msgs_per_sec << " msgs/sec";
+}
+
+}  // namespace oneflow
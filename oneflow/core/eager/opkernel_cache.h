@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EAGER_OPKERNEL_CACHE_H_
+#define ONEFLOW_CORE_EAGER_OPKERNEL_CACHE_H_
+
+#include "oneflow/core/operator/operator.h"
+#include "oneflow/core/operator/op_node_signature_desc.h"
+#include "oneflow/core/register/blob_desc.h"
+
+namespace oneflow {
+namespace eager {
+
+// The operators and kernels an opkernel object has built for its op conf. An entry is reused
+// while the op node signature symbol, the parallel context and the input blob descs are the same
+// as when it was built, which spares constructing the operator, inferring the blob descs and
+// generating the kernel conf on every call.
+template<typename KernelT>
+class OpKernelCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OpKernelCache);
+  OpKernelCache() : hit_num_(0), miss_num_(0) {}
+  ~OpKernelCache() = default;
+
+  // returns the kernel of a matching entry after setting the output and tmp blob descs it
+  // inferred, nullptr if none matches
+  const std::shared_ptr<KernelT>& Find(
+      const OpNodeSignatureDesc* op_node_signature, const ParallelContext& parallel_ctx,
+      const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp);
+  // records a kernel just built from op, whose blob descs have been inferred
+  const std::shared_ptr<KernelT>& Add(
+      const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
+      const ParallelContext& parallel_ctx, const std::shared_ptr<const Operator>& op,
+      const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+      std::shared_ptr<KernelT>&& kernel);
+
+  void Clear() { entries_.clear(); }
+
+  size_t hit_num() const { return hit_num_; }
+  size_t miss_num() const { return miss_num_; }
+
+ private:
+  struct Entry {
+    // holding the symbol keeps another signature from taking its address
+    std::shared_ptr<const OpNodeSignatureDesc> op_node_signature;
+    ParallelContext parallel_ctx;
+    std::shared_ptr<const Operator> op;
+    // in the order of op->input_bns(), nullptr if the input is absent
+    std::vector<std::unique_ptr<const BlobDesc>> input_blob_descs;
+    std::vector<std::pair<std::string, std::unique_ptr<const BlobDesc>>> bn2inferred_blob_desc;
+    std::shared_ptr<KernelT> kernel;
+  };
+  static bool IsMatched(const Entry& entry, const OpNodeSignatureDesc* op_node_signature,
+                        const ParallelContext& parallel_ctx,
+                        const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp);
+
+  // most recently used first
+  std::list<std::unique_ptr<Entry>> entries_;
+  size_t hit_num_;
+  size_t miss_num_;
+};
+
+// entries of an op kept at most, calls seldom alternate between more input shapes
+const size_t kOpKernelCacheMaxEntryNum = 8;
+
+template<typename KernelT>
+const std::shared_ptr<KernelT>& OpKernelCache<KernelT>::Find(
+    const OpNodeSignatureDesc* op_node_signature, const ParallelContext& parallel_ctx,
+    const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp) {
+  static const std::shared_ptr<KernelT> kNone;
+  for (auto iter = entries_.begin(); iter != entries_.end(); ++iter) {
+    if (!IsMatched(**iter, op_node_signature, parallel_ctx, BlobDesc4BnInOp)) { continue; }
+    for (const auto& pair : (*iter)->bn2inferred_blob_desc) {
+      BlobDesc* blob_desc = BlobDesc4BnInOp(pair.first);
+      if (blob_desc != nullptr) { *blob_desc = *pair.second; }
+    }
+    entries_.splice(entries_.begin(), entries_, iter);
+    ++hit_num_;
+    return entries_.front()->kernel;
+  }
+  ++miss_num_;
+  return kNone;
+}
+
+template<typename KernelT>
+const std::shared_ptr<KernelT>& OpKernelCache<KernelT>::Add(
+    const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
+    const ParallelContext& parallel_ctx, const std::shared_ptr<const Operator>& op,
+    const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+    std::shared_ptr<KernelT>&& kernel) {
+  std::unique_ptr<Entry> entry(new Entry());
+  entry->op_node_signature = op_node_signature;
+  entry->parallel_ctx = parallel_ctx;
+  entry->op = op;
+  for (const std::string& ibn : op->input_bns()) {
+    const BlobDesc* blob_desc = BlobDesc4BnInOp(ibn);
+    entry->input_blob_descs.emplace_back(blob_desc == nullptr ? nullptr
+                                                              : new BlobDesc(*blob_desc));
+  }
+  const auto& AddInferredBlobDesc = [&](const std::string& bn_in_op) {
+    const BlobDesc* blob_desc = BlobDesc4BnInOp(bn_in_op);
+    if (blob_desc == nullptr) { return; }
+    entry->bn2inferred_blob_desc.emplace_back(
+        bn_in_op, std::unique_ptr<const BlobDesc>(new BlobDesc(*blob_desc)));
+  };
+  for (const std::string& obn : op->output_bns()) { AddInferredBlobDesc(obn); }
+  for (const std::string& tbn : op->tmp_bns()) { AddInferredBlobDesc(tbn); }
+  entry->kernel = std::move(kernel);
+  if (entries_.size() == kOpKernelCacheMaxEntryNum) { entries_.pop_back(); }
+  entries_.push_front(std::move(entry));
+  return entries_.front()->kernel;
+}
+
+template<typename KernelT>
+bool OpKernelCache<KernelT>::IsMatched(
+    const Entry& entry, const OpNodeSignatureDesc* op_node_signature,
+    const ParallelContext& parallel_ctx,
+    const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp) {
+  if (entry.op_node_signature.get() != op_node_signature) { return false; }
+  if (entry.parallel_ctx.parallel_id() != parallel_ctx.parallel_id()
+      || entry.parallel_ctx.parallel_num() != parallel_ctx.parallel_num()) {
+    return false;
+  }
+  const PbRpf<std::string>& input_bns = entry.op->input_bns();
+  FOR_RANGE(int32_t, i, 0, input_bns.size()) {
+    const BlobDesc* blob_desc = BlobDesc4BnInOp(input_bns.Get(i));
+    const BlobDesc* cached_blob_desc = entry.input_blob_descs.at(i).get();
+    if (blob_desc == nullptr || cached_blob_desc == nullptr) {
+      if (blob_desc != cached_blob_desc) { return false; }
+    } else if (!(*blob_desc == *cached_blob_desc)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace eager
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EAGER_OPKERNEL_CACHE_H_
@@ -288,18 +288,18 @@ Maybe<void> OpKernelInfer(OpKernelObject* opkernel_obj, vm::Instruction* instruc
   }
   std::function<BlobDesc*(const std::string&)> BlobDesc4BnInOp;
   JUST(MakeBlobDesc4BnInOp(instruction, args, &BlobDesc4BnInOp));
-  const OpNodeSignatureDesc* op_node_signature = nullptr;
+  std::shared_ptr<const OpNodeSignatureDesc> op_node_signature;
   {
     const auto* operand = instruction->operand_type(args.op_node_signature());
     const auto* op_node_signature_object =
         JUST(operand->template Get<vm::ObjectWrapper<OpNodeSignatureDesc>>());
-    op_node_signature = &op_node_signature_object->Get();
+    op_node_signature = op_node_signature_object->GetPtr();
   }
   ParallelContext parallel_ctx;
   JUST(instruction->parallel_desc()->GetParallelContext(
       &parallel_ctx, instruction->stream().machine_id(), instruction->stream().device_id()));
-  JUST(opkernel_obj->ResetOpAndKernel(*op_node_signature, &parallel_ctx, BlobDesc4BnInOp));
-  JUST(CheckBlobParallel(instruction, args, op_node_signature));
+  JUST(opkernel_obj->ResetOpAndKernel(op_node_signature, &parallel_ctx, BlobDesc4BnInOp));
+  JUST(CheckBlobParallel(instruction, args, op_node_signature.get()));
   JUST(ForEachObnAndBlobObject(instruction, args,
                                [](const std::string& obn, BlobObject* blob_object) -> Maybe<void> {
                                  return blob_object->TryInitBlob();
@@ -324,18 +324,18 @@ Maybe<void> OpKernelInfer(SystemOpKernelObject* opkernel_obj, vm::Instruction* i
   }
   std::function<BlobDesc*(const std::string&)> BlobDesc4BnInOp;
   JUST(MakeBlobDesc4BnInOp(instruction, args, &BlobDesc4BnInOp));
-  const OpNodeSignatureDesc* op_node_signature = nullptr;
+  std::shared_ptr<const OpNodeSignatureDesc> op_node_signature;
   {
     const auto* operand = instruction->operand_type(args.op_node_signature());
     const auto* op_node_signature_object =
         JUST(operand->template Get<vm::ObjectWrapper<OpNodeSignatureDesc>>());
-    op_node_signature = &op_node_signature_object->Get();
+    op_node_signature = op_node_signature_object->GetPtr();
   }
   ParallelContext parallel_ctx;
   JUST(instruction->parallel_desc()->GetParallelContext(
       &parallel_ctx, instruction->stream().machine_id(), instruction->stream().device_id()));
-  JUST(opkernel_obj->ResetKernel(*op_node_signature, &parallel_ctx, BlobDesc4BnInOp));
-  JUST(CheckBlobParallel(instruction, args, op_node_signature));
+  JUST(opkernel_obj->ResetKernel(op_node_signature, &parallel_ctx, BlobDesc4BnInOp));
+  JUST(CheckBlobParallel(instruction, args, op_node_signature.get()));
   JUST(ForEachObnAndBlobObject(instruction, args,
                                [](const std::string& obn, BlobObject* blob_object) -> Maybe<void> {
                                  return blob_object->TryInitBlob();
@@ -387,6 +387,10 @@ Maybe<void> OpKernelCompute(SystemOpKernelObject* opkernel_obj, vm::Instruction*
   return Maybe<void>::Ok();
 }
 
+// a stateless call starts from no state, as if the opkernel were new
+void ResetOpKernelState(OpKernelObject* opkernel) { opkernel->reset_opkernel_state(nullptr); }
+void ResetOpKernelState(SystemOpKernelObject*) {}
+
 template<typename T>
 Maybe<T*> GetSharedOpKernel(vm::Instruction* instruction, DeviceType device_type,
                             const StatelessCallOpKernelInstrOperand& args) {
@@ -401,6 +405,14 @@ Maybe<T*> GetSharedOpKernel(vm::Instruction* instruction, DeviceType device_type
   const auto& parallel_desc = instruction->parallel_desc();
   CHECK_OR_RETURN(static_cast<bool>(parallel_desc));
   CHECK_EQ_OR_RETURN(device_type, parallel_desc->device_type());
+  if (rw_mutexed_object->has_object() && rw_mutexed_object->Has<T>()) {
+    // keeps the kernels built for the same op conf by the previous calls
+    T* opkernel = rw_mutexed_object->Mut<T>();
+    if (&opkernel->job_desc() == job_desc_ptr.get() && opkernel->op_conf() == op_conf) {
+      ResetOpKernelState(opkernel);
+      return opkernel;
+    }
+  }
   rw_mutexed_object->reset_object();
   return rw_mutexed_object->Init<T>(op_conf, job_desc_ptr, device_type);
 }
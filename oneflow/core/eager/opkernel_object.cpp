@@ -19,13 +19,18 @@ namespace oneflow {
 namespace eager {
 
 Maybe<void> OpKernelObject::ResetOpAndKernel(
-    const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
+    const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
+    const ParallelContext* parallel_ctx,
     const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp) {
+  kernel_ = kernel_cache_.Find(op_node_signature.get(), *parallel_ctx, BlobDesc4BnInOp);
+  if (kernel_) { return Maybe<void>::Ok(); }
   auto op = ConstructOp(op_conf_, device_type_, job_desc_.get());
   std::unique_ptr<OpContext> op_ctx;
-  JUST(InferBlobDescs(*op, BlobDesc4BnInOp, &op_node_signature.sbp_signature(), parallel_ctx,
+  JUST(InferBlobDescs(*op, BlobDesc4BnInOp, &op_node_signature->sbp_signature(), parallel_ctx,
                       &op_ctx));
-  NewPartialInitializedKernel(*op, BlobDesc4BnInOp, op_node_signature, parallel_ctx, op_ctx.get());
+  kernel_ = kernel_cache_.Add(op_node_signature, *parallel_ctx, op, BlobDesc4BnInOp,
+                              NewPartialInitializedKernel(*op, BlobDesc4BnInOp, *op_node_signature,
+                                                          parallel_ctx, op_ctx.get()));
   return Maybe<void>::Ok();
 }
 
@@ -38,7 +43,7 @@ Maybe<void> OpKernelObject::InferBlobDescs(
   return Maybe<void>::Ok();
 }
 
-void OpKernelObject::NewPartialInitializedKernel(
+std::shared_ptr<EagerKernel> OpKernelObject::NewPartialInitializedKernel(
     const Operator& op, const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
     const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
     OpContext* op_ctx) {
@@ -47,17 +52,22 @@ void OpKernelObject::NewPartialInitializedKernel(
     return *CHECK_JUST(op_node_signature.LogicalBlobDesc4BnInOp(bn_in_op));
   };
   op.GenKernelConf(BlobDesc4BnInOp, parallel_ctx, &kernel_conf, op_ctx, LogicalBlobDesc4BnInOp);
-  kernel_.reset(new EagerKernel(job_desc_.get(), kernel_conf));
+  return std::make_shared<EagerKernel>(job_desc_.get(), kernel_conf);
 }
 
 Maybe<void> SystemOpKernelObject::ResetKernel(
-    const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
+    const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
+    const ParallelContext* parallel_ctx,
     const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp) {
+  kernel_ = kernel_cache_.Find(op_node_signature.get(), *parallel_ctx, BlobDesc4BnInOp);
+  if (kernel_) { return Maybe<void>::Ok(); }
   auto op = ConstructOp(op_conf_, device_type_, job_desc_.get());
   std::unique_ptr<OpContext> op_ctx;
-  JUST(InferBlobDescs(*op, BlobDesc4BnInOp, &op_node_signature.sbp_signature(), parallel_ctx,
+  JUST(InferBlobDescs(*op, BlobDesc4BnInOp, &op_node_signature->sbp_signature(), parallel_ctx,
                       &op_ctx));
-  ResetKernel(*op, BlobDesc4BnInOp, op_node_signature, parallel_ctx, op_ctx.get());
+  kernel_ = kernel_cache_.Add(
+      op_node_signature, *parallel_ctx, op, BlobDesc4BnInOp,
+      NewKernel(*op, BlobDesc4BnInOp, *op_node_signature, parallel_ctx, op_ctx.get()));
   return Maybe<void>::Ok();
 }
 
@@ -70,7 +80,7 @@ Maybe<void> SystemOpKernelObject::InferBlobDescs(
   return Maybe<void>::Ok();
 }
 
-void SystemOpKernelObject::ResetKernel(
+std::shared_ptr<const Kernel> SystemOpKernelObject::NewKernel(
     const Operator& op, const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
     const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
     OpContext* op_ctx) {
@@ -79,7 +89,7 @@ void SystemOpKernelObject::ResetKernel(
     return *CHECK_JUST(op_node_signature.LogicalBlobDesc4BnInOp(bn_in_op));
   };
   op.GenKernelConf(BlobDesc4BnInOp, parallel_ctx, &kernel_conf, op_ctx, LogicalBlobDesc4BnInOp);
-  kernel_ = ConstructKernel(job_desc_.get(), kernel_conf, nullptr);
+  return ConstructKernel(job_desc_.get(), kernel_conf, nullptr);
 }
 
 }  // namespace eager
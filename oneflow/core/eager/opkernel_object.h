@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/kernel/eager_kernel.h"
 #include "oneflow/core/eager/blob_object.h"
 #include "oneflow/core/operator/op_node_signature_desc.h"
+#include "oneflow/core/eager/opkernel_cache.h"
 
 namespace oneflow {
 
@@ -48,7 +49,11 @@ class OpKernelObject : public vm::Object {
   const JobDesc& job_desc() const { return *job_desc_; }
 
   const std::string& op_name() const { return op_conf_.name(); }
-  UserOpConf* mut_user_op_conf() { return op_conf_.mutable_user_conf(); }
+  const OperatorConf& op_conf() const { return op_conf_; }
+  UserOpConf* mut_user_op_conf() {
+    kernel_cache_.Clear();
+    return op_conf_.mutable_user_conf();
+  }
 
   const std::shared_ptr<user_op::OpKernelState>& opkernel_state() const { return opkernel_state_; }
 
@@ -58,16 +63,19 @@ class OpKernelObject : public vm::Object {
     opkernel_state_ = opkernel_state;
   }
 
-  Maybe<void> ResetOpAndKernel(const OpNodeSignatureDesc& op_node_signature,
-                               const ParallelContext* parallel_ctx,
-                               const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp);
+  Maybe<void> ResetOpAndKernel(
+      const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
+      const ParallelContext* parallel_ctx,
+      const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp);
+
+  const OpKernelCache<EagerKernel>& kernel_cache() const { return kernel_cache_; }
 
  private:
   Maybe<void> InferBlobDescs(const Operator& op,
                              const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
                              const SbpSignature* sbp_signature, const ParallelContext* parallel_ctx,
                              std::unique_ptr<OpContext>* op_ctx);
-  void NewPartialInitializedKernel(
+  std::shared_ptr<EagerKernel> NewPartialInitializedKernel(
       const Operator& op, const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
       const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
       OpContext* op_ctx);
@@ -75,8 +83,9 @@ class OpKernelObject : public vm::Object {
   OperatorConf op_conf_;
   std::shared_ptr<const JobDesc> job_desc_;
   DeviceType device_type_;
-  std::unique_ptr<EagerKernel> kernel_;
+  std::shared_ptr<EagerKernel> kernel_;
   std::shared_ptr<user_op::OpKernelState> opkernel_state_;
+  OpKernelCache<EagerKernel> kernel_cache_;
 };
 
 class SystemOpKernelObject : public vm::Object {
@@ -95,24 +104,27 @@ class SystemOpKernelObject : public vm::Object {
 
   const Kernel& kernel() const { return *kernel_; }
 
-  Maybe<void> ResetKernel(const OpNodeSignatureDesc& op_node_signature,
+  Maybe<void> ResetKernel(const std::shared_ptr<const OpNodeSignatureDesc>& op_node_signature,
                           const ParallelContext* parallel_ctx,
                           const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp);
 
+  const OpKernelCache<const Kernel>& kernel_cache() const { return kernel_cache_; }
+
  private:
   Maybe<void> InferBlobDescs(const Operator& op,
                              const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
                              const SbpSignature* sbp_signature, const ParallelContext* parallel_ctx,
                              std::unique_ptr<OpContext>* op_ctx);
-  void ResetKernel(const Operator& op,
-                   const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
-                   const OpNodeSignatureDesc& op_node_signature,
-                   const ParallelContext* parallel_ctx, OpContext* op_ctx);
+  std::shared_ptr<const Kernel> NewKernel(
+      const Operator& op, const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+      const OpNodeSignatureDesc& op_node_signature, const ParallelContext* parallel_ctx,
+      OpContext* op_ctx);
 
   OperatorConf op_conf_;
   std::shared_ptr<const JobDesc> job_desc_;
   DeviceType device_type_;
-  std::unique_ptr<const Kernel> kernel_;
+  std::shared_ptr<const Kernel> kernel_;
+  OpKernelCache<const Kernel> kernel_cache_;
 };
 
 }  // namespace eager
@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/eager/opkernel_object.h"
+#include "oneflow/core/vm/test_util.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/operator/op_conf.pb.h"
+#include "oneflow/core/operator/op_attribute.pb.h"
+
+namespace oneflow {
+namespace eager {
+namespace test {
+
+namespace {
+
+std::unique_ptr<OpKernelObject> NewCcreluOpKernelObject() {
+  OperatorConf op_conf;
+  op_conf.set_name("ccrelu_op_name");
+  auto* user_conf = op_conf.mutable_user_conf();
+  user_conf->set_op_type_name("ccrelu");
+  (*user_conf->mutable_input())["in"].add_s("ccrelu_op_name/in_0");
+  (*user_conf->mutable_output())["out"].add_s("ccrelu_op_name/out_0");
+  const auto& job_desc = std::make_shared<const JobDesc>(JobConfigProto(), 0);
+  return std::unique_ptr<OpKernelObject>(new OpKernelObject(op_conf, job_desc, DeviceType::kCPU));
+}
+
+std::shared_ptr<const OpNodeSignatureDesc> NewCcreluOpNodeSignature() {
+  OpNodeSignature op_node_signature;
+  auto* bn_in_op2sbp_parallel =
+      op_node_signature.mutable_sbp_signature()->mutable_bn_in_op2sbp_parallel();
+  auto* bn_in_op2blob_desc =
+      op_node_signature.mutable_logical_blob_desc_signature()->mutable_bn_in_op2blob_desc();
+  for (const std::string& bn_in_op : {"in_0", "out_0"}) {
+    (*bn_in_op2sbp_parallel)[bn_in_op].mutable_broadcast_parallel();
+    BlobDesc(Shape({10LL}), DataType::kFloat).ToProto(&(*bn_in_op2blob_desc)[bn_in_op]);
+  }
+  return std::make_shared<const OpNodeSignatureDesc>(op_node_signature);
+}
+
+// the blob descs of a call, as the instruction of the call makes them
+class CcreluBlobDescs final {
+ public:
+  explicit CcreluBlobDescs(int64_t elem_cnt)
+      : in_(Shape({elem_cnt}), DataType::kFloat),
+        out_(DataType::kFloat),
+        tmp_buffer_(DataType::kFloat) {}
+
+  std::function<BlobDesc*(const std::string&)> BlobDesc4BnInOp() {
+    return [this](const std::string& bn_in_op) -> BlobDesc* {
+      if (bn_in_op == "in_0") { return &in_; }
+      if (bn_in_op == "out_0") { return &out_; }
+      if (bn_in_op == "tmp_buffer_0") { return &tmp_buffer_; }
+      return nullptr;
+    };
+  }
+  const BlobDesc& out() const { return out_; }
+
+ private:
+  BlobDesc in_;
+  BlobDesc out_;
+  BlobDesc tmp_buffer_;
+};
+
+}  // namespace
+
+TEST(OpKernelObject, reuse_cached_kernel) {
+  vm::TestResourceDescScope scope(0, 1);
+  auto opkernel_obj = NewCcreluOpKernelObject();
+  const auto& op_node_signature = NewCcreluOpNodeSignature();
+  ParallelContext parallel_ctx;
+  parallel_ctx.set_parallel_id(0);
+  parallel_ctx.set_parallel_num(1);
+  const auto& ResetOpAndKernel = [&](int64_t elem_cnt) -> const EagerKernel* {
+    CcreluBlobDescs blob_descs(elem_cnt);
+    CHECK_JUST(opkernel_obj->ResetOpAndKernel(op_node_signature, &parallel_ctx,
+                                              blob_descs.BlobDesc4BnInOp()));
+    CHECK(blob_descs.out().shape() == Shape({elem_cnt}));
+    return &opkernel_obj->kernel();
+  };
+  const EagerKernel* kernel = ResetOpAndKernel(10);
+  ASSERT_EQ(ResetOpAndKernel(10), kernel);
+  ASSERT_EQ(opkernel_obj->kernel_cache().hit_num(), 1);
+  ASSERT_NE(ResetOpAndKernel(20), kernel);
+  ASSERT_EQ(opkernel_obj->kernel_cache().miss_num(), 2);
+  ASSERT_EQ(ResetOpAndKernel(10), kernel);
+  ASSERT_EQ(opkernel_obj->kernel_cache().hit_num(), 2);
+  parallel_ctx.set_parallel_num(2);
+  ASSERT_NE(ResetOpAndKernel(10), kernel);
+  ASSERT_EQ(opkernel_obj->kernel_cache().miss_num(), 3);
+}
+
+TEST(OpKernelObject, dispatch_throughput) {
+  vm::TestResourceDescScope scope(0, 1);
+  auto opkernel_obj = NewCcreluOpKernelObject();
+  const auto& op_node_signature = NewCcreluOpNodeSignature();
+  ParallelContext parallel_ctx;
+  parallel_ctx.set_parallel_id(0);
+  parallel_ctx.set_parallel_num(1);
+  const int64_t call_num = 2000;
+  // cycling through more input shapes than cached rebuilds the kernel on every call
+  const auto& CallsPerSecond = [&](int64_t shape_num) {
+    const auto start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, call_num) {
+      CcreluBlobDescs blob_descs(1 + i % shape_num);
+      CHECK_JUST(opkernel_obj->ResetOpAndKernel(op_node_signature, &parallel_ctx,
+                                                blob_descs.BlobDesc4BnInOp()));
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return call_num / elapsed.count();
+  };
+  const double rebuilt_calls_per_second = CallsPerSecond(2 * kOpKernelCacheMaxEntryNum);
+  const double cached_calls_per_second = CallsPerSecond(1);
+  LOG(INFO) << "eager ccrelu dispatch, rebuilt: " << rebuilt_calls_per_second
+            << " calls/s, cached: " << cached_calls_per_second << " calls/s";
+  ASSERT_EQ(opkernel_obj->kernel_cache().miss_num(), call_num + 1);
+  ASSERT_EQ(opkernel_obj->kernel_cache().hit_num(), call_num - 1);
+}
+
+}  // namespace test
+}  // namespace eager
+}  // namespace oneflow
@@ -17,13 +17,14 @@ limitations under the License.
 
 namespace oneflow {
 
+// task nodes are built concurrently, each creating the nodes and edges of its exec graph
 int64_t NewNodeId() {
-  static int64_t node_id = 0;
+  static std::atomic<int64_t> node_id(0);
   return node_id++;
 }
 
 int64_t NewEdgeId() {
-  static int64_t edge_id = 0;
+  static std::atomic<int64_t> edge_id(0);
   return edge_id++;
 }
 
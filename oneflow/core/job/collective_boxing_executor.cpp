@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -468,11 +469,22 @@ void NcclCollectiveBoxingExecutorBackend::Init(const CollectiveBoxingPlan& colle
 
 CollectiveBoxingExecutor::CollectiveBoxingExecutor(const Plan& plan)
     : collective_boxing_plan_(plan.collective_boxing_plan()) {
-  auto it =
-      backends_
-          .emplace(Backend::kBackendNCCL, std::make_unique<NcclCollectiveBoxingExecutorBackend>())
-          .first;
-  it->second->Init(collective_boxing_plan_);
+  // backends are created only when the plan uses them, so that cpu only plans need no gpu
+  std::set<Backend> used_backends;
+  for (const auto& job_id7request_set : collective_boxing_plan_.job_id2request_set()) {
+    for (const RequestDesc& request : job_id7request_set.second.request()) {
+      used_backends.emplace(request.op_desc().backend());
+    }
+  }
+  if (used_backends.count(Backend::kBackendNCCL) > 0) {
+    backends_.emplace(Backend::kBackendNCCL,
+                      std::make_unique<NcclCollectiveBoxingExecutorBackend>());
+  }
+  if (used_backends.count(Backend::kBackendCpu) > 0) {
+    backends_.emplace(Backend::kBackendCpu,
+                      std::make_unique<CpuCollectiveBoxingExecutorBackend>());
+  }
+  for (auto& pair : backends_) { pair.second->Init(collective_boxing_plan_); }
   Init();
   DumpSummary();
 }
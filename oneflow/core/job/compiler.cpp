@@ -18,9 +18,83 @@ limitations under the License.
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
+namespace {
+
+// Wall time of the phases of a compilation, in the order they ran.
+class CompilePhaseTimer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompilePhaseTimer);
+  CompilePhaseTimer() : last_time_(std::chrono::steady_clock::now()) {}
+  ~CompilePhaseTimer() = default;
+
+  // ends the phase started by the previous call
+  void Record(const std::string& phase) {
+    const auto now = std::chrono::steady_clock::now();
+    phase2seconds_.emplace_back(phase, std::chrono::duration<double>(now - last_time_).count());
+    last_time_ = now;
+  }
+
+  std::string ToString() const {
+    double total = 0;
+    std::string ret;
+    for (const auto& pair : phase2seconds_) {
+      total += pair.second;
+      ret += pair.first + " " + std::to_string(pair.second) + "s, ";
+    }
+    return ret + "total " + std::to_string(total) + "s";
+  }
+
+ private:
+  std::chrono::steady_clock::time_point last_time_;
+  std::vector<std::pair<std::string, double>> phase2seconds_;
+};
+
+// Calls Handler on every node after the nodes on all its in edges. With a thread pool, the nodes
+// ready at the same time are handled concurrently, so Handler may only touch the node itself and
+// read what its predecessors have produced.
+void TopoForEachNodeInParallel(const TaskGraph& task_gph, ThreadPool* thread_pool,
+                               const std::function<void(TaskNode*)>& Handler) {
+  if (thread_pool == nullptr) {
+    task_gph.TopoForEachNode(Handler);
+    return;
+  }
+  HashMap<TaskNode*, int64_t> node2index;
+  task_gph.ForEachNode([&](TaskNode* node) { node2index.emplace(node, node2index.size()); });
+  std::vector<std::atomic<int64_t>> node_index2pending_in_edge_cnt(node2index.size());
+  for (const auto& pair : node2index) {
+    node_index2pending_in_edge_cnt.at(pair.second) = pair.first->in_edges().size();
+  }
+  BlockingCounter counter(node2index.size());
+  std::function<void(TaskNode*)> Run;
+  Run = [&](TaskNode* node) {
+    // the last ready out node runs on this thread instead of going through the pool
+    while (node != nullptr) {
+      Handler(node);
+      TaskNode* next = nullptr;
+      for (TaskEdge* edge : node->out_edges()) {
+        TaskNode* out_node = edge->dst_node();
+        if (--node_index2pending_in_edge_cnt.at(node2index.at(out_node)) != 0) { continue; }
+        if (next != nullptr) { thread_pool->AddWork([&Run, next]() { Run(next); }); }
+        next = out_node;
+      }
+      counter.Decrease();
+      node = next;
+    }
+  };
+  for (TaskNode* source : task_gph.source_nodes()) {
+    thread_pool->AddWork([&Run, source]() { Run(source); });
+  }
+  counter.WaitUntilCntEqualZero();
+}
+
+}  // namespace
+
 void Compiler::GenNetTopo(Plan* plan) const {
   HashMap<int64_t, int64_t> rid2mid;
   HashMap<int64_t, int64_t> tid2mid;
@@ -64,37 +138,67 @@ void Compiler::GenNetTopo(Plan* plan) const {
 
 void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
   const JobDesc& job_desc = GlobalJobDesc();
-  if (need_job_complete) { JobCompleter().Complete(job); }
+  CompilePhaseTimer timer;
+  if (need_job_complete) {
+    JobCompleter().Complete(job);
+    timer.Record("complete_job");
+  }
   Global<OpGraph>::New(*job);
   if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
     TeePersistentLogStream::Create(StrCat("optimized_job", job_desc.job_id()))->Write(*job);
     Global<OpGraph>::Get()->ToDotWithFilePath("optimized_dlnet_" + std::to_string(job_desc.job_id())
                                               + "_op_graph.dot");
   }
+  timer.Record("build_op_graph");
   auto logical_gph = std::make_unique<LogicalGraph>(*job);
+  timer.Record("build_logical_graph");
   auto task_gph = std::make_unique<TaskGraph>(std::move(logical_gph));
+  timer.Record("build_task_graph");
+  const int64_t thread_num = Global<ResourceDesc, ForSession>::Get()->CompileThreadNum();
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (thread_num > 1) { thread_pool.reset(new ThreadPool(thread_num)); }
+  // regst desc ids are allocated in node order, producing and consuming stay sequential to keep
+  // them deterministic
   using std::placeholders::_1;
   task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
-  task_gph->TopoForEachNode(&TaskNode::Build);
+  timer.Record("produce_and_consume_regsts");
+  TopoForEachNodeInParallel(*task_gph, thread_pool.get(), &TaskNode::Build);
+  timer.Record("build_task_nodes");
   task_gph->RemoveEmptyRegsts();
   task_gph->AddOrderingCtrlEdgeInSameChain();
   if (job_desc.enable_inplace()) {
     auto IsReachable = Global<OpGraph>::Get()->MakePredicatorIsOpNameDataOrCtrlReachable();
     task_gph->EnableInplaceMemSharing(IsReachable);
   }
-  task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+  timer.Record("optimize_task_graph");
+  TopoForEachNodeInParallel(*task_gph, thread_pool.get(), &TaskNode::InferTimeShapeIfMeaningful);
+  timer.Record("infer_time_shapes");
 
+  std::vector<TaskNode*> meaningful_nodes;
   task_gph->ForEachNode([&](TaskNode* task_node) {
     if (task_node->IsMeaningLess()) { return; }
-    task_node->ToProto(plan->mutable_task()->Add());
+    meaningful_nodes.push_back(task_node);
   });
+  plan->mutable_task()->Reserve(meaningful_nodes.size());
+  for (size_t i = 0; i < meaningful_nodes.size(); ++i) { plan->mutable_task()->Add(); }
+  auto ToProto = [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { meaningful_nodes.at(i)->ToProto(plan->mutable_task(i)); }
+  };
+  if (thread_pool) {
+    thread_pool->ParallelFor(0, meaningful_nodes.size(), 0, ToProto);
+  } else {
+    ToProto(0, meaningful_nodes.size());
+  }
+  timer.Record("to_proto");
   {
     auto* job_id2job_conf = plan->mutable_job_confs()->mutable_job_id2job_conf();
     (*job_id2job_conf)[GlobalJobDesc().job_id()] = GlobalJobDesc().job_conf();
   }
   Global<OpGraph>::Delete();
+  LOG(INFO) << "compile phases of job " << job_desc.job_id() << " (" << job_desc.job_name()
+            << ") on " << std::max<int64_t>(thread_num, 1) << " threads: " << timer.ToString();
 }
 
 }  // namespace oneflow
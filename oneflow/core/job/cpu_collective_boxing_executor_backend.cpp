@@ -0,0 +1,275 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/common/shape.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+// sent by the connecting side right after connect, telling which link the socket is
+struct LinkHandshake {
+  int64_t comm_id;
+  int64_t src_rank;
+  int64_t dst_rank;
+};
+
+std::string GenPortKey(int64_t machine_id) {
+  return "CpuCollectiveBoxingPort/" + std::to_string(machine_id);
+}
+
+bool IsOnThisMachine(const DeviceDesc& device_desc) {
+  return device_desc.machine_id() == Global<MachineCtx>::Get()->this_machine_id();
+}
+
+void SetTcpNoDelay(int sockfd) {
+  const int val = 1;
+  PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+}
+
+void WriteHandshake(int sockfd, const LinkHandshake& handshake) {
+  const char* ptr = reinterpret_cast<const char*>(&handshake);
+  size_t size = sizeof(handshake);
+  while (size > 0) {
+    ssize_t n = write(sockfd, ptr, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR));
+    if (n > 0) {
+      ptr += n;
+      size -= n;
+    }
+  }
+}
+
+LinkHandshake ReadHandshake(int sockfd) {
+  LinkHandshake handshake;
+  char* ptr = reinterpret_cast<char*>(&handshake);
+  size_t size = sizeof(handshake);
+  while (size > 0) {
+    ssize_t n = read(sockfd, ptr, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR)) << "sockfd " << sockfd << " closed by peer";
+    if (n > 0) {
+      ptr += n;
+      size -= n;
+    }
+  }
+  return handshake;
+}
+
+void RunRequest(CpuCollectiveComm* comm, const OpDesc& op_desc,
+                const RuntimeRequestInfo& request_info) {
+  const int64_t elem_cnt = Shape(op_desc.shape()).elem_cnt();
+  const int64_t num_ranks = op_desc.num_ranks();
+  const DataType data_type = op_desc.data_type();
+  if (op_desc.op_type() == OpType::kOpTypeAllReduce) {
+    CHECK_EQ(op_desc.reduce_method(), ReduceMethod::kReduceMethodSum);
+    comm->AllReduce(request_info.send_buff, request_info.recv_buff, elem_cnt, data_type);
+  } else if (op_desc.op_type() == OpType::kOpTypeReduceScatter) {
+    CHECK_EQ(op_desc.reduce_method(), ReduceMethod::kReduceMethodSum);
+    CHECK_EQ(elem_cnt % num_ranks, 0);
+    comm->ReduceScatter(request_info.send_buff, request_info.recv_buff, elem_cnt / num_ranks,
+                        data_type);
+  } else if (op_desc.op_type() == OpType::kOpTypeAllGather) {
+    CHECK_EQ(elem_cnt % num_ranks, 0);
+    comm->AllGather(request_info.send_buff, request_info.recv_buff, elem_cnt / num_ranks,
+                    data_type);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace
+
+CpuCollectiveBoxingExecutorBackend::CpuCollectiveBoxingExecutorBackend() {
+  const CollectiveBoxingConf conf =
+      Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf();
+  CHECK_GT(conf.cpu_chunk_size_kb(), 0);
+  CHECK_GE(conf.cpu_recursive_threshold_kb(), 0);
+  chunk_size_ = conf.cpu_chunk_size_kb() * 1024;
+  recursive_threshold_ = conf.cpu_recursive_threshold_kb() * 1024;
+}
+
+CpuCollectiveBoxingExecutorBackend::~CpuCollectiveBoxingExecutorBackend() {
+  for (auto& pair : device_set2rank2worker_) {
+    for (auto& rank7worker : pair.second) { rank7worker.second->channel.Close(); }
+  }
+  for (auto& pair : device_set2rank2worker_) {
+    for (auto& rank7worker : pair.second) { rank7worker.second->thread.join(); }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::Init(const CollectiveBoxingPlan& collective_boxing_plan) {
+  // comm ids are the same on every machine, the order of device sets in the plan
+  std::vector<int64_t> job_ids;
+  for (const auto& job_id7request_set : collective_boxing_plan.job_id2request_set()) {
+    job_ids.push_back(job_id7request_set.first);
+  }
+  std::sort(job_ids.begin(), job_ids.end());
+  std::vector<const DeviceSet*> comm_id2device_set;
+  HashMap<DeviceSet, int64_t> device_set2comm_id;
+  for (const int64_t job_id : job_ids) {
+    std::vector<const RequestDesc*> requests;
+    for (const RequestDesc& request :
+         collective_boxing_plan.job_id2request_set().at(job_id).request()) {
+      if (request.op_desc().backend() == Backend::kBackendCpu) { requests.push_back(&request); }
+    }
+    std::sort(requests.begin(), requests.end(),
+              [](const RequestDesc* a, const RequestDesc* b) { return a->order() < b->order(); });
+    for (const RequestDesc* request : requests) {
+      if (device_set2comm_id.emplace(request->device_set(), comm_id2device_set.size()).second) {
+        comm_id2device_set.push_back(&request->device_set());
+      }
+    }
+  }
+
+  // links of the local ranks, indexed by comm id, rank and peer rank
+  std::vector<std::map<int64_t, std::vector<std::unique_ptr<CpuCollectiveLink>>>>
+      comm_id2rank2links(comm_id2device_set.size());
+  int64_t num_accepts = 0;
+  FOR_RANGE(int64_t, comm_id, 0, comm_id2device_set.size()) {
+    const DeviceSet& device_set = *comm_id2device_set.at(comm_id);
+    const int64_t num_ranks = device_set.device_size();
+    auto& rank2links = comm_id2rank2links.at(comm_id);
+    FOR_RANGE(int64_t, rank, 0, num_ranks) {
+      if (IsOnThisMachine(device_set.device(rank))) { rank2links[rank].resize(num_ranks); }
+    }
+    for (auto& rank7links : rank2links) {
+      const int64_t rank = rank7links.first;
+      for (const int64_t peer : CpuCollectiveComm::GetPeers(rank, num_ranks)) {
+        if (IsOnThisMachine(device_set.device(peer))) {
+          if (peer < rank) { continue; }
+          auto pair = NewInProcessCpuCollectiveLinkPair();
+          rank7links.second.at(peer) = std::move(pair.first);
+          rank2links.at(peer).at(rank) = std::move(pair.second);
+        } else if (peer < rank) {
+          num_accepts += 1;
+        }
+      }
+    }
+  }
+
+  // the lower rank of a link across machines connects to the machine of the higher rank
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  int listen_sockfd = -1;
+  if (num_accepts > 0) {
+    listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    PCHECK(listen_sockfd != -1);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    sa.sin_port = 0;
+    PCHECK(bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+    PCHECK(listen(listen_sockfd, num_accepts) == 0);
+    socklen_t len = sizeof(sa);
+    PCHECK(getsockname(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), &len) == 0);
+    Global<CtrlClient>::Get()->PushKV(GenPortKey(this_machine_id),
+                                      std::to_string(ntohs(sa.sin_port)));
+  }
+  FOR_RANGE(int64_t, comm_id, 0, comm_id2device_set.size()) {
+    const DeviceSet& device_set = *comm_id2device_set.at(comm_id);
+    for (auto& rank7links : comm_id2rank2links.at(comm_id)) {
+      const int64_t rank = rank7links.first;
+      for (const int64_t peer : CpuCollectiveComm::GetPeers(rank, device_set.device_size())) {
+        const int64_t peer_machine_id = device_set.device(peer).machine_id();
+        if (peer < rank || peer_machine_id == this_machine_id) { continue; }
+        uint16_t peer_port = 0;
+        Global<CtrlClient>::Get()->PullKV(GenPortKey(peer_machine_id), [&](const std::string& v) {
+          peer_port = oneflow_cast<uint16_t>(v);
+        });
+        const std::string& peer_addr =
+            Global<ResourceDesc, ForSession>::Get()->machine(peer_machine_id).addr();
+        sockaddr_in peer_sockaddr{};
+        peer_sockaddr.sin_family = AF_INET;
+        peer_sockaddr.sin_port = htons(peer_port);
+        PCHECK(inet_pton(AF_INET, peer_addr.c_str(), &peer_sockaddr.sin_addr) == 1);
+        const int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        PCHECK(sockfd != -1);
+        SetTcpNoDelay(sockfd);
+        PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+               == 0);
+        WriteHandshake(sockfd, LinkHandshake{comm_id, rank, peer});
+        rank7links.second.at(peer) = NewSocketCpuCollectiveLink(sockfd);
+      }
+    }
+  }
+  FOR_RANGE(int64_t, i, 0, num_accepts) {
+    const int sockfd = accept(listen_sockfd, nullptr, nullptr);
+    PCHECK(sockfd != -1);
+    SetTcpNoDelay(sockfd);
+    const LinkHandshake handshake = ReadHandshake(sockfd);
+    auto& link = comm_id2rank2links.at(handshake.comm_id)
+                     .at(handshake.dst_rank)
+                     .at(handshake.src_rank);
+    CHECK(!link);
+    link = NewSocketCpuCollectiveLink(sockfd);
+  }
+  if (listen_sockfd != -1) {
+    PCHECK(close(listen_sockfd) == 0);
+    Global<CtrlClient>::Get()->ClearKV(GenPortKey(this_machine_id));
+  }
+
+  FOR_RANGE(int64_t, comm_id, 0, comm_id2device_set.size()) {
+    auto& rank2worker = device_set2rank2worker_[*comm_id2device_set.at(comm_id)];
+    for (auto& rank7links : comm_id2rank2links.at(comm_id)) {
+      std::unique_ptr<Worker> worker(new Worker());
+      worker->comm.reset(new CpuCollectiveComm(rank7links.first, std::move(rank7links.second),
+                                               chunk_size_, recursive_threshold_));
+      Worker* raw_worker = worker.get();
+      worker->thread = std::thread([raw_worker]() {
+        std::function<void()> work;
+        while (raw_worker->channel.Receive(&work) == kChannelStatusSuccess) { work(); }
+      });
+      rank2worker.emplace(rank7links.first, std::move(worker));
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteGroup(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) {
+  CHECK_EQ(group.size(), ranks.size());
+  FOR_RANGE(int64_t, i, 0, group.size()) {
+    const RequestDesc* request = group.at(i);
+    auto& rank2worker = device_set2rank2worker_.at(request->device_set());
+    for (const auto& rank7request_info : ranks.at(i)) {
+      Worker* worker = rank2worker.at(rank7request_info.first).get();
+      const RuntimeRequestInfo request_info = rank7request_info.second;
+      std::function<void()> work = [worker, request, request_info]() {
+        RunRequest(worker->comm.get(), request->op_desc(), request_info);
+        request_info.callback(Maybe<void>::Ok());
+      };
+      CHECK_EQ(worker->channel.Send(work), kChannelStatusSuccess);
+    }
+  }
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+
+#include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_comm.h"
+#include "oneflow/core/graph/boxing/collective_boxing_util.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// Runs the requests of kBackendCpu on host memory with CpuCollectiveComm, so that collective
+// boxing works without gpus. Every local rank of a device set gets a comm and a worker thread
+// running its requests in order. Ranks on this machine are linked in process, ranks on other
+// machines over tcp sockets set up in Init.
+class CpuCollectiveBoxingExecutorBackend final : public CollectiveBoxingExecutorBackend {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingExecutorBackend);
+  CpuCollectiveBoxingExecutorBackend();
+  ~CpuCollectiveBoxingExecutorBackend() override;
+
+ private:
+  void Init(const CollectiveBoxingPlan& collective_boxing_plan) override;
+  void ExecuteGroup(const std::vector<const RequestDesc*>& group,
+                    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) override;
+
+  struct Worker {
+    std::unique_ptr<CpuCollectiveComm> comm;
+    Channel<std::function<void()>> channel;
+    std::thread thread;
+  };
+
+  int64_t chunk_size_;
+  int64_t recursive_threshold_;
+  HashMap<DeviceSet, std::map<int64_t, std::unique_ptr<Worker>>> device_set2rank2worker_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
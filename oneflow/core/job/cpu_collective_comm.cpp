@@ -0,0 +1,448 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_comm.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/data_type.h"
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+// a multiple of the size of every data type
+const size_t kSocketRecvPieceSize = 256 << 10;
+
+struct InProcessPipe {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::pair<const char*, size_t>> sends;
+  // bytes of the front send consumed already
+  size_t front_offset = 0;
+};
+
+class InProcessCpuCollectiveLink final : public CpuCollectiveLink {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(InProcessCpuCollectiveLink);
+  InProcessCpuCollectiveLink(std::shared_ptr<InProcessPipe> send_pipe,
+                             std::shared_ptr<InProcessPipe> recv_pipe)
+      : send_pipe_(std::move(send_pipe)), recv_pipe_(std::move(recv_pipe)) {}
+  ~InProcessCpuCollectiveLink() override = default;
+
+  void AsyncSend(const char* data, size_t size) override {
+    if (size == 0) { return; }
+    std::unique_lock<std::mutex> lock(send_pipe_->mutex);
+    send_pipe_->sends.emplace_back(data, size);
+    send_pipe_->cond.notify_all();
+  }
+
+  void WaitSendDone() override {
+    std::unique_lock<std::mutex> lock(send_pipe_->mutex);
+    send_pipe_->cond.wait(lock, [this]() { return send_pipe_->sends.empty(); });
+  }
+
+  void RecvInto(size_t size,
+                const std::function<void(const char*, size_t, size_t)>& Consume) override {
+    InProcessPipe* pipe = recv_pipe_.get();
+    size_t offset = 0;
+    while (offset < size) {
+      const char* piece = nullptr;
+      size_t n = 0;
+      {
+        std::unique_lock<std::mutex> lock(pipe->mutex);
+        pipe->cond.wait(lock, [pipe]() { return !pipe->sends.empty(); });
+        const auto& front = pipe->sends.front();
+        piece = front.first + pipe->front_offset;
+        n = std::min(front.second - pipe->front_offset, size - offset);
+      }
+      // the sender leaves the memory alone until it has been consumed
+      Consume(piece, offset, n);
+      {
+        std::unique_lock<std::mutex> lock(pipe->mutex);
+        pipe->front_offset += n;
+        if (pipe->front_offset == pipe->sends.front().second) {
+          pipe->sends.pop_front();
+          pipe->front_offset = 0;
+          pipe->cond.notify_all();
+        }
+      }
+      offset += n;
+    }
+  }
+
+ private:
+  std::shared_ptr<InProcessPipe> send_pipe_;
+  std::shared_ptr<InProcessPipe> recv_pipe_;
+};
+
+void WriteFully(int sockfd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(sockfd, data, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR));
+    if (n > 0) {
+      data += n;
+      size -= n;
+    }
+  }
+}
+
+void ReadFully(int sockfd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(sockfd, data, size);
+    PCHECK(n > 0 || (n == -1 && errno == EINTR)) << "sockfd " << sockfd << " closed by peer";
+    if (n > 0) {
+      data += n;
+      size -= n;
+    }
+  }
+}
+
+class SocketCpuCollectiveLink final : public CpuCollectiveLink {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SocketCpuCollectiveLink);
+  explicit SocketCpuCollectiveLink(int sockfd)
+      : sockfd_(sockfd), shutdown_(false), recv_buffer_(kSocketRecvPieceSize) {
+    send_thread_ = std::thread([this]() {
+      while (true) {
+        std::pair<const char*, size_t> send;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cond_.wait(lock, [this]() { return !sends_.empty() || shutdown_; });
+          if (sends_.empty()) { break; }
+          send = sends_.front();
+        }
+        WriteFully(sockfd_, send.first, send.second);
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          sends_.pop_front();
+          if (sends_.empty()) { cond_.notify_all(); }
+        }
+      }
+    });
+  }
+
+  ~SocketCpuCollectiveLink() override {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      shutdown_ = true;
+      cond_.notify_all();
+    }
+    send_thread_.join();
+    PCHECK(close(sockfd_) == 0);
+  }
+
+  void AsyncSend(const char* data, size_t size) override {
+    if (size == 0) { return; }
+    std::unique_lock<std::mutex> lock(mutex_);
+    sends_.emplace_back(data, size);
+    cond_.notify_all();
+  }
+
+  void WaitSendDone() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return sends_.empty(); });
+  }
+
+  void RecvInto(size_t size,
+                const std::function<void(const char*, size_t, size_t)>& Consume) override {
+    // the next piece arrives in the socket buffer while this one is consumed
+    for (size_t offset = 0; offset < size; offset += kSocketRecvPieceSize) {
+      const size_t n = std::min(kSocketRecvPieceSize, size - offset);
+      ReadFully(sockfd_, recv_buffer_.data(), n);
+      Consume(recv_buffer_.data(), offset, n);
+    }
+  }
+
+  void Recv(char* data, size_t size) override { ReadFully(sockfd_, data, size); }
+
+ private:
+  const int sockfd_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::pair<const char*, size_t>> sends_;
+  bool shutdown_;
+  std::thread send_thread_;
+  std::vector<char> recv_buffer_;
+};
+
+// plain loops over restrict pointers, which the compiler vectorizes
+template<typename T>
+void Sum(char* dst, const char* lhs, const char* rhs, size_t size) {
+  T* __restrict__ out = reinterpret_cast<T*>(dst);
+  const T* __restrict__ x = reinterpret_cast<const T*>(lhs);
+  const T* __restrict__ y = reinterpret_cast<const T*>(rhs);
+  const size_t n = size / sizeof(T);
+  if (dst == lhs) {
+    FOR_RANGE(size_t, i, 0, n) { out[i] += y[i]; }
+  } else {
+    FOR_RANGE(size_t, i, 0, n) { out[i] = x[i] + y[i]; }
+  }
+}
+
+bool IsPowerOfTwo(int64_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+}  // namespace
+
+void CpuCollectiveLink::Recv(char* data, size_t size) {
+  RecvInto(size, [data](const char* piece, size_t offset, size_t n) {
+    memcpy(data + offset, piece, n);
+  });
+}
+
+std::pair<std::unique_ptr<CpuCollectiveLink>, std::unique_ptr<CpuCollectiveLink>>
+NewInProcessCpuCollectiveLinkPair() {
+  std::shared_ptr<InProcessPipe> forward(new InProcessPipe());
+  std::shared_ptr<InProcessPipe> backward(new InProcessPipe());
+  std::unique_ptr<CpuCollectiveLink> lhs(new InProcessCpuCollectiveLink(forward, backward));
+  std::unique_ptr<CpuCollectiveLink> rhs(new InProcessCpuCollectiveLink(backward, forward));
+  return std::make_pair(std::move(lhs), std::move(rhs));
+}
+
+std::unique_ptr<CpuCollectiveLink> NewSocketCpuCollectiveLink(int sockfd) {
+  return std::unique_ptr<CpuCollectiveLink>(new SocketCpuCollectiveLink(sockfd));
+}
+
+CpuCollectiveComm::CpuCollectiveComm(int64_t rank,
+                                     std::vector<std::unique_ptr<CpuCollectiveLink>> rank2link,
+                                     int64_t chunk_size, int64_t recursive_threshold)
+    : rank_(rank),
+      num_ranks_(rank2link.size()),
+      rank2link_(std::move(rank2link)),
+      chunk_size_(chunk_size),
+      recursive_threshold_(recursive_threshold) {
+  CHECK_GE(rank_, 0);
+  CHECK_LT(rank_, num_ranks_);
+  CHECK_GT(chunk_size, 0);
+  CHECK_GE(recursive_threshold, 0);
+  for (int64_t peer : GetPeers(rank_, num_ranks_)) { CHECK(link(peer) != nullptr); }
+}
+
+std::vector<int64_t> CpuCollectiveComm::GetPeers(int64_t rank, int64_t num_ranks) {
+  std::set<int64_t> peers;
+  if (num_ranks > 1) {
+    peers.insert((rank + 1) % num_ranks);
+    peers.insert((rank + num_ranks - 1) % num_ranks);
+  }
+  if (IsPowerOfTwo(num_ranks)) {
+    for (int64_t mask = 1; mask < num_ranks; mask *= 2) { peers.insert(rank ^ mask); }
+  }
+  return std::vector<int64_t>(peers.begin(), peers.end());
+}
+
+bool CpuCollectiveComm::UseRecursive(size_t size) const {
+  // two ranks take a single step either way, the ring pipelines it
+  return num_ranks_ > 2 && IsPowerOfTwo(num_ranks_) && size <= recursive_threshold_;
+}
+
+void CpuCollectiveComm::ForEachChunk(size_t begin, size_t end, size_t elem_size,
+                                     const std::function<void(size_t, size_t)>& Handler) const {
+  const size_t chunk_size = std::max(elem_size, chunk_size_ / elem_size * elem_size);
+  for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size) {
+    Handler(chunk_begin, std::min(end, chunk_begin + chunk_size));
+  }
+}
+
+void CpuCollectiveComm::AllReduce(const void* send_buff, void* recv_buff, int64_t elem_cnt,
+                                  DataType data_type) {
+  const size_t elem_size = GetSizeOfDataType(data_type);
+  const char* src = static_cast<const char*>(send_buff);
+  char* dst = static_cast<char*>(recv_buff);
+  if (num_ranks_ == 1 || elem_cnt == 0) {
+    if (dst != src) { memcpy(dst, src, elem_cnt * elem_size); }
+    return;
+  }
+  const BalancedSplitter splitter(elem_cnt, num_ranks_);
+  Segments segments(num_ranks_);
+  FOR_RANGE(int64_t, i, 0, num_ranks_) {
+    segments.at(i).first = splitter.At(i).begin() * elem_size;
+    segments.at(i).second = splitter.At(i).end() * elem_size;
+  }
+  const ReduceFn Reduce = GetSumFn(data_type);
+  if (UseRecursive(elem_cnt * elem_size)) {
+    if (dst != src) { memcpy(dst, src, elem_cnt * elem_size); }
+    RecursiveHalvingReduceScatter(dst, segments, Reduce);
+    RecursiveDoublingAllGather(dst, segments);
+  } else {
+    const int64_t owner = Mod(rank_ + 1);
+    RingReduceScatter(
+        src, [&](int64_t idx) { return dst + segments.at(idx).first; }, segments, owner,
+        elem_size, Reduce, true);
+    RingAllGather(dst, segments, owner, elem_size, true);
+  }
+}
+
+void CpuCollectiveComm::ReduceScatter(const void* send_buff, void* recv_buff,
+                                      int64_t recv_elem_cnt, DataType data_type) {
+  const size_t elem_size = GetSizeOfDataType(data_type);
+  const size_t segment_size = recv_elem_cnt * elem_size;
+  const char* src = static_cast<const char*>(send_buff);
+  char* dst = static_cast<char*>(recv_buff);
+  if (num_ranks_ == 1 || recv_elem_cnt == 0) {
+    if (dst != src) { memcpy(dst, src, segment_size); }
+    return;
+  }
+  Segments segments(num_ranks_);
+  FOR_RANGE(int64_t, i, 0, num_ranks_) {
+    segments.at(i) = std::make_pair(i * segment_size, (i + 1) * segment_size);
+  }
+  const ReduceFn Reduce = GetSumFn(data_type);
+  scratch_.resize(segment_size * num_ranks_);
+  if (UseRecursive(segment_size * num_ranks_)) {
+    memcpy(scratch_.data(), src, segment_size * num_ranks_);
+    RecursiveHalvingReduceScatter(scratch_.data(), segments, Reduce);
+    memcpy(dst, scratch_.data() + segments.at(rank_).first, segment_size);
+  } else {
+    // partial sums go to the scratch, the last one to recv_buff
+    RingReduceScatter(
+        src,
+        [&](int64_t idx) {
+          return idx == rank_ ? dst : scratch_.data() + segments.at(idx).first;
+        },
+        segments, rank_, elem_size, Reduce, false);
+    link(Mod(rank_ + 1))->WaitSendDone();
+  }
+}
+
+void CpuCollectiveComm::AllGather(const void* send_buff, void* recv_buff, int64_t send_elem_cnt,
+                                  DataType data_type) {
+  const size_t elem_size = GetSizeOfDataType(data_type);
+  const size_t segment_size = send_elem_cnt * elem_size;
+  char* dst = static_cast<char*>(recv_buff);
+  if (dst + rank_ * segment_size != send_buff) {
+    memcpy(dst + rank_ * segment_size, send_buff, segment_size);
+  }
+  if (num_ranks_ == 1 || send_elem_cnt == 0) { return; }
+  Segments segments(num_ranks_);
+  FOR_RANGE(int64_t, i, 0, num_ranks_) {
+    segments.at(i) = std::make_pair(i * segment_size, (i + 1) * segment_size);
+  }
+  if (UseRecursive(segment_size * num_ranks_)) {
+    RecursiveDoublingAllGather(dst, segments);
+  } else {
+    RingAllGather(dst, segments, rank_, elem_size, false);
+  }
+}
+
+CpuCollectiveComm::ReduceFn CpuCollectiveComm::GetSumFn(DataType data_type) {
+#define SUM_FN_CASE(type_cpp, type_proto) \
+  case type_proto: return &Sum<type_cpp>;
+  switch (data_type) {
+    OF_PP_FOR_EACH_TUPLE(SUM_FN_CASE, ARITHMETIC_DATA_TYPE_SEQ)
+    default: UNIMPLEMENTED();
+  }
+#undef SUM_FN_CASE
+  return nullptr;
+}
+
+void CpuCollectiveComm::RingReduceScatter(const char* src,
+                                          const std::function<char*(int64_t)>& Dst,
+                                          const Segments& segments, int64_t owner,
+                                          size_t elem_size, ReduceFn Reduce, bool forward_owned) {
+  CpuCollectiveLink* next = link(Mod(rank_ + 1));
+  CpuCollectiveLink* prev = link(Mod(rank_ - 1));
+  const auto& first = segments.at(Mod(owner - 1));
+  ForEachChunk(first.first, first.second, elem_size,
+               [&](size_t begin, size_t end) { next->AsyncSend(src + begin, end - begin); });
+  FOR_RANGE(int64_t, step, 0, num_ranks_ - 1) {
+    const int64_t idx = Mod(owner - 2 - step);
+    const auto& segment = segments.at(idx);
+    char* segment_dst = Dst(idx);
+    // the segment reduced in a step is the one sent in the next
+    const bool forward = step < num_ranks_ - 2 || forward_owned;
+    ForEachChunk(segment.first, segment.second, elem_size, [&](size_t begin, size_t end) {
+      char* chunk_dst = segment_dst + (begin - segment.first);
+      const char* chunk_lhs = src + begin;
+      prev->RecvInto(end - begin, [&](const char* piece, size_t offset, size_t n) {
+        Reduce(chunk_dst + offset, chunk_lhs + offset, piece, n);
+      });
+      if (forward) { next->AsyncSend(chunk_dst, end - begin); }
+    });
+  }
+}
+
+void CpuCollectiveComm::RingAllGather(char* buff, const Segments& segments, int64_t owner,
+                                      size_t elem_size, bool owned_sent) {
+  CpuCollectiveLink* next = link(Mod(rank_ + 1));
+  CpuCollectiveLink* prev = link(Mod(rank_ - 1));
+  if (!owned_sent) {
+    const auto& owned = segments.at(owner);
+    ForEachChunk(owned.first, owned.second, elem_size,
+                 [&](size_t begin, size_t end) { next->AsyncSend(buff + begin, end - begin); });
+  }
+  FOR_RANGE(int64_t, step, 0, num_ranks_ - 1) {
+    const auto& segment = segments.at(Mod(owner - 1 - step));
+    const bool forward = step < num_ranks_ - 2;
+    ForEachChunk(segment.first, segment.second, elem_size, [&](size_t begin, size_t end) {
+      prev->Recv(buff + begin, end - begin);
+      if (forward) { next->AsyncSend(buff + begin, end - begin); }
+    });
+  }
+  next->WaitSendDone();
+}
+
+void CpuCollectiveComm::RecursiveHalvingReduceScatter(char* buff, const Segments& segments,
+                                                      ReduceFn Reduce) {
+  int64_t lo = 0;
+  int64_t hi = num_ranks_;
+  for (int64_t mask = num_ranks_ / 2; mask > 0; mask /= 2) {
+    CpuCollectiveLink* peer = link(rank_ ^ mask);
+    const int64_t mid = (lo + hi) / 2;
+    // the rank with the bit set keeps the upper half, so that rank i ends up with segment i
+    const bool keep_upper = (rank_ & mask) != 0;
+    const int64_t send_lo = keep_upper ? lo : mid;
+    const int64_t keep_lo = keep_upper ? mid : lo;
+    const size_t send_begin = segments.at(send_lo).first;
+    const size_t send_end = segments.at(send_lo + mask - 1).second;
+    const size_t keep_begin = segments.at(keep_lo).first;
+    const size_t keep_end = segments.at(keep_lo + mask - 1).second;
+    peer->AsyncSend(buff + send_begin, send_end - send_begin);
+    char* keep = buff + keep_begin;
+    peer->RecvInto(keep_end - keep_begin, [&](const char* piece, size_t offset, size_t n) {
+      Reduce(keep + offset, keep + offset, piece, n);
+    });
+    peer->WaitSendDone();
+    lo = keep_lo;
+    hi = keep_lo + mask;
+  }
+  CHECK_EQ(lo, rank_);
+}
+
+void CpuCollectiveComm::RecursiveDoublingAllGather(char* buff, const Segments& segments) {
+  int64_t lo = rank_;
+  int64_t hi = rank_ + 1;
+  for (int64_t mask = 1; mask < num_ranks_; mask *= 2) {
+    CpuCollectiveLink* peer = link(rank_ ^ mask);
+    const int64_t peer_lo = (rank_ & mask) != 0 ? lo - mask : hi;
+    const size_t begin = segments.at(lo).first;
+    const size_t end = segments.at(hi - 1).second;
+    const size_t peer_begin = segments.at(peer_lo).first;
+    const size_t peer_end = segments.at(peer_lo + mask - 1).second;
+    peer->AsyncSend(buff + begin, end - begin);
+    peer->Recv(buff + peer_begin, peer_end - peer_begin);
+    peer->WaitSendDone();
+    lo = std::min(lo, peer_lo);
+    hi = std::max(hi, peer_lo + mask);
+  }
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
@@ -0,0 +1,119 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_COMM_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_COMM_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/data_type.pb.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// One end of an in order, bidirectional byte stream between two ranks.
+class CpuCollectiveLink {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveLink);
+  CpuCollectiveLink() = default;
+  virtual ~CpuCollectiveLink() = default;
+
+  // Queues size bytes at data behind the earlier sends, they must stay unchanged until
+  // WaitSendDone returns.
+  virtual void AsyncSend(const char* data, size_t size) = 0;
+  virtual void WaitSendDone() = 0;
+  // Receives the next size bytes piece by piece, Consume(piece, offset, n) is handed the n bytes at
+  // offset of them. Pieces are multiples of the sizes sent, so no element is ever split.
+  virtual void RecvInto(size_t size,
+                        const std::function<void(const char*, size_t, size_t)>& Consume) = 0;
+  virtual void Recv(char* data, size_t size);
+};
+
+// Both ends of a link between two ranks of this process, the receiver reads straight out of the
+// memory of the sender.
+std::pair<std::unique_ptr<CpuCollectiveLink>, std::unique_ptr<CpuCollectiveLink>>
+NewInProcessCpuCollectiveLinkPair();
+
+// A link over a connected stream socket, which it takes the ownership of. Sends are written by a
+// thread of the link, receives are read by the receiving thread.
+std::unique_ptr<CpuCollectiveLink> NewSocketCpuCollectiveLink(int sockfd);
+
+// Collectives among num_ranks ranks on host memory, one comm per rank, driven by one thread each.
+//   - All-reduce, reduce-scatter and all-gather run over a ring, every rank sending to the next one
+//     and receiving from the previous one. Segments are pipelined in chunks of chunk_size bytes, a
+//     chunk is forwarded as soon as it has been reduced.
+//   - With a power of two ranks, payloads up to recursive_threshold bytes use recursive halving for
+//     the reduce-scatter and recursive doubling for the all-gather instead, in log2(num_ranks)
+//     steps.
+// Links are needed to the peers given by GetPeers only.
+class CpuCollectiveComm final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveComm);
+  // rank2link holds num_ranks links, indexed by the peer rank
+  CpuCollectiveComm(int64_t rank, std::vector<std::unique_ptr<CpuCollectiveLink>> rank2link,
+                    int64_t chunk_size, int64_t recursive_threshold);
+  ~CpuCollectiveComm() = default;
+
+  static std::vector<int64_t> GetPeers(int64_t rank, int64_t num_ranks);
+
+  // recv_buff may be send_buff
+  void AllReduce(const void* send_buff, void* recv_buff, int64_t elem_cnt, DataType data_type);
+  // rank i gets the sum of the i-th of num_ranks parts of send_buff, recv_elem_cnt elements each
+  void ReduceScatter(const void* send_buff, void* recv_buff, int64_t recv_elem_cnt,
+                     DataType data_type);
+  void AllGather(const void* send_buff, void* recv_buff, int64_t send_elem_cnt, DataType data_type);
+
+ private:
+  using ReduceFn = void (*)(char* dst, const char* lhs, const char* rhs, size_t size);
+  // [begin, end) bytes of every segment
+  using Segments = std::vector<std::pair<size_t, size_t>>;
+
+  static ReduceFn GetSumFn(DataType data_type);
+  CpuCollectiveLink* link(int64_t rank) const { return rank2link_.at(rank).get(); }
+  int64_t Mod(int64_t idx) const { return (idx % num_ranks_ + num_ranks_) % num_ranks_; }
+  bool UseRecursive(size_t size) const;
+  void ForEachChunk(size_t begin, size_t end, size_t elem_size,
+                    const std::function<void(size_t, size_t)>& Handler) const;
+
+  // steps send segment (owner - 1 - step) and reduce segment (owner - 2 - step), with lhs taken
+  // from src, into Dst(segment), so that this rank ends up with the sum of segment owner
+  void RingReduceScatter(const char* src, const std::function<char*(int64_t)>& Dst,
+                         const Segments& segments, int64_t owner, size_t elem_size,
+                         ReduceFn Reduce, bool forward_owned);
+  // steps receive segment (owner - 1 - step) of buff, owned_sent tells whether segment owner of
+  // this rank has been sent already
+  void RingAllGather(char* buff, const Segments& segments, int64_t owner, size_t elem_size,
+                     bool owned_sent);
+  // in place on buff, segment rank ends up summed
+  void RecursiveHalvingReduceScatter(char* buff, const Segments& segments, ReduceFn Reduce);
+  void RecursiveDoublingAllGather(char* buff, const Segments& segments);
+
+  const int64_t rank_;
+  const int64_t num_ranks_;
+  std::vector<std::unique_ptr<CpuCollectiveLink>> rank2link_;
+  const size_t chunk_size_;
+  const size_t recursive_threshold_;
+  std::vector<char> scratch_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_COMM_H_
@@ -0,0 +1,283 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "oneflow/core/job/cpu_collective_comm.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+std::vector<std::vector<std::unique_ptr<CpuCollectiveLink>>> NewInProcessLinks(
+    int64_t num_ranks) {
+  std::vector<std::vector<std::unique_ptr<CpuCollectiveLink>>> links(num_ranks);
+  for (auto& rank2link : links) { rank2link.resize(num_ranks); }
+  FOR_RANGE(int64_t, i, 0, num_ranks) {
+    for (int64_t j : CpuCollectiveComm::GetPeers(i, num_ranks)) {
+      if (j <= i) { continue; }
+      auto pair = NewInProcessCpuCollectiveLinkPair();
+      links.at(i).at(j) = std::move(pair.first);
+      links.at(j).at(i) = std::move(pair.second);
+    }
+  }
+  return links;
+}
+
+std::vector<std::unique_ptr<CpuCollectiveComm>> NewInProcessComms(int64_t num_ranks,
+                                                                  int64_t chunk_size,
+                                                                  int64_t recursive_threshold) {
+  auto links = NewInProcessLinks(num_ranks);
+  std::vector<std::unique_ptr<CpuCollectiveComm>> comms;
+  FOR_RANGE(int64_t, i, 0, num_ranks) {
+    comms.emplace_back(new CpuCollectiveComm(i, std::move(links.at(i)), chunk_size,
+                                             recursive_threshold));
+  }
+  return comms;
+}
+
+void RunOnEveryRank(int64_t num_ranks, const std::function<void(int64_t)>& Handler) {
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, i, 0, num_ranks) { threads.emplace_back(Handler, i); }
+  for (std::thread& thread : threads) { thread.join(); }
+}
+
+// small integers keep the sums exact for every data type
+template<typename T>
+T Value(int64_t rank, int64_t idx) {
+  return static_cast<T>((rank * 7 + idx * 3) % 11);
+}
+
+template<typename T>
+void TestAllReduce(int64_t num_ranks, int64_t elem_cnt, int64_t chunk_size,
+                   int64_t recursive_threshold, bool in_place) {
+  auto comms = NewInProcessComms(num_ranks, chunk_size, recursive_threshold);
+  std::vector<std::vector<T>> send(num_ranks, std::vector<T>(elem_cnt));
+  std::vector<std::vector<T>> recv(num_ranks, std::vector<T>(elem_cnt));
+  FOR_RANGE(int64_t, r, 0, num_ranks) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { send.at(r).at(i) = Value<T>(r, i); }
+  }
+  // twice, so that a second collective reuses the links
+  FOR_RANGE(int64_t, repeat, 0, 2) {
+    RunOnEveryRank(num_ranks, [&](int64_t r) {
+      T* out = in_place ? send.at(r).data() : recv.at(r).data();
+      if (in_place && repeat > 0) {
+        FOR_RANGE(int64_t, i, 0, elem_cnt) { out[i] = Value<T>(r, i); }
+      }
+      comms.at(r)->AllReduce(send.at(r).data(), out, elem_cnt, GetDataType<T>::value);
+    });
+    FOR_RANGE(int64_t, r, 0, num_ranks) {
+      const std::vector<T>& out = in_place ? send.at(r) : recv.at(r);
+      FOR_RANGE(int64_t, i, 0, elem_cnt) {
+        T expected = 0;
+        FOR_RANGE(int64_t, k, 0, num_ranks) { expected += Value<T>(k, i); }
+        ASSERT_EQ(out.at(i), expected) << "num_ranks " << num_ranks << ", elem_cnt " << elem_cnt
+                                       << ", rank " << r << ", idx " << i;
+      }
+    }
+  }
+}
+
+template<typename T>
+void TestReduceScatterAndAllGather(int64_t num_ranks, int64_t elem_cnt, int64_t chunk_size,
+                                   int64_t recursive_threshold) {
+  auto comms = NewInProcessComms(num_ranks, chunk_size, recursive_threshold);
+  std::vector<std::vector<T>> send(num_ranks, std::vector<T>(elem_cnt * num_ranks));
+  std::vector<std::vector<T>> scattered(num_ranks, std::vector<T>(elem_cnt));
+  std::vector<std::vector<T>> gathered(num_ranks, std::vector<T>(elem_cnt * num_ranks));
+  FOR_RANGE(int64_t, r, 0, num_ranks) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt * num_ranks) { send.at(r).at(i) = Value<T>(r, i); }
+  }
+  RunOnEveryRank(num_ranks, [&](int64_t r) {
+    comms.at(r)->ReduceScatter(send.at(r).data(), scattered.at(r).data(), elem_cnt,
+                               GetDataType<T>::value);
+    comms.at(r)->AllGather(scattered.at(r).data(), gathered.at(r).data(), elem_cnt,
+                           GetDataType<T>::value);
+  });
+  FOR_RANGE(int64_t, r, 0, num_ranks) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt * num_ranks) {
+      T expected = 0;
+      FOR_RANGE(int64_t, k, 0, num_ranks) { expected += Value<T>(k, i); }
+      if (i / elem_cnt == r) { ASSERT_EQ(scattered.at(r).at(i % elem_cnt), expected); }
+      ASSERT_EQ(gathered.at(r).at(i), expected)
+          << "num_ranks " << num_ranks << ", elem_cnt " << elem_cnt << ", rank " << r;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(CpuCollectiveComm, peers) {
+  ASSERT_EQ(CpuCollectiveComm::GetPeers(0, 1), std::vector<int64_t>());
+  ASSERT_EQ(CpuCollectiveComm::GetPeers(1, 2), std::vector<int64_t>({0}));
+  ASSERT_EQ(CpuCollectiveComm::GetPeers(2, 5), std::vector<int64_t>({1, 3}));
+  ASSERT_EQ(CpuCollectiveComm::GetPeers(5, 8), std::vector<int64_t>({1, 4, 6, 7}));
+}
+
+TEST(CpuCollectiveComm, ring_all_reduce) {
+  for (int64_t num_ranks : {1, 2, 3, 4, 5, 8}) {
+    for (int64_t elem_cnt : {0, 1, 7, 100, 10007}) {
+      TestAllReduce<float>(num_ranks, elem_cnt, 1024, 0, false);
+      TestAllReduce<int32_t>(num_ranks, elem_cnt, 64, 0, true);
+    }
+  }
+  TestAllReduce<double>(3, 100003, 256 << 10, 0, false);
+  TestAllReduce<int8_t>(4, 1001, 16, 0, false);
+  TestAllReduce<int64_t>(5, 1001, 24, 0, true);
+}
+
+TEST(CpuCollectiveComm, recursive_all_reduce) {
+  for (int64_t num_ranks : {4, 8}) {
+    for (int64_t elem_cnt : {1, 7, 100, 10007}) {
+      TestAllReduce<float>(num_ranks, elem_cnt, 1024, 1 << 20, false);
+      TestAllReduce<int64_t>(num_ranks, elem_cnt, 1024, 1 << 20, true);
+    }
+  }
+}
+
+TEST(CpuCollectiveComm, reduce_scatter_and_all_gather) {
+  for (int64_t num_ranks : {1, 2, 3, 4, 5, 8}) {
+    for (int64_t elem_cnt : {1, 9, 1000}) {
+      TestReduceScatterAndAllGather<float>(num_ranks, elem_cnt, 256, 0);
+      TestReduceScatterAndAllGather<double>(num_ranks, elem_cnt, 256, 1 << 20);
+    }
+  }
+}
+
+// every rank is a process of its own, connected by socket pairs
+TEST(CpuCollectiveComm, all_reduce_among_processes) {
+  const int64_t num_ranks = 4;
+  const int64_t elem_cnt = 300007;
+  std::vector<std::vector<int>> rank2fds(num_ranks, std::vector<int>(num_ranks, -1));
+  FOR_RANGE(int64_t, i, 0, num_ranks) {
+    for (int64_t j : CpuCollectiveComm::GetPeers(i, num_ranks)) {
+      if (j <= i) { continue; }
+      int fds[2];
+      PCHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+      rank2fds.at(i).at(j) = fds[0];
+      rank2fds.at(j).at(i) = fds[1];
+    }
+  }
+  std::vector<pid_t> pids;
+  FOR_RANGE(int64_t, r, 0, num_ranks) {
+    const pid_t pid = fork();
+    PCHECK(pid >= 0);
+    if (pid > 0) {
+      pids.push_back(pid);
+      continue;
+    }
+    std::vector<std::unique_ptr<CpuCollectiveLink>> rank2link(num_ranks);
+    FOR_RANGE(int64_t, i, 0, num_ranks) {
+      FOR_RANGE(int64_t, j, 0, num_ranks) {
+        const int fd = rank2fds.at(i).at(j);
+        if (fd == -1) { continue; }
+        if (i == r) {
+          rank2link.at(j) = NewSocketCpuCollectiveLink(fd);
+        } else {
+          close(fd);
+        }
+      }
+    }
+    bool ok = true;
+    {
+      CpuCollectiveComm comm(r, std::move(rank2link), 64 << 10, 0);
+      std::vector<float> buff(elem_cnt);
+      FOR_RANGE(int64_t, i, 0, elem_cnt) { buff.at(i) = Value<float>(r, i); }
+      comm.AllReduce(buff.data(), buff.data(), elem_cnt, DataType::kFloat);
+      FOR_RANGE(int64_t, i, 0, elem_cnt) {
+        float expected = 0;
+        FOR_RANGE(int64_t, k, 0, num_ranks) { expected += Value<float>(k, i); }
+        ok = ok && buff.at(i) == expected;
+      }
+    }
+    _exit(ok ? 0 : 1);
+  }
+  for (const auto& fds : rank2fds) {
+    for (int fd : fds) {
+      if (fd != -1) { close(fd); }
+    }
+  }
+  for (pid_t pid : pids) {
+    int status = 0;
+    PCHECK(waitpid(pid, &status, 0) == pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+  }
+}
+
+TEST(CpuCollectiveComm, all_reduce_benchmark_compared_with_reduce_and_broadcast) {
+  const int64_t num_ranks = 4;
+  const int64_t elem_cnt = 16 << 20;
+  const int64_t repeat = 3;
+  auto comms = NewInProcessComms(num_ranks, 256 << 10, 0);
+  // the root sums what every rank sends to it and broadcasts the result over the same links
+  auto links = NewInProcessLinks(num_ranks);
+  FOR_RANGE(int64_t, i, 1, num_ranks) {
+    if (links.at(0).at(i)) { continue; }
+    auto pair = NewInProcessCpuCollectiveLinkPair();
+    links.at(0).at(i) = std::move(pair.first);
+    links.at(i).at(0) = std::move(pair.second);
+  }
+  std::vector<std::vector<float>> buffs(num_ranks, std::vector<float>(elem_cnt, 1));
+  auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    RunOnEveryRank(num_ranks, [&](int64_t r) {
+      char* buff = reinterpret_cast<char*>(buffs.at(r).data());
+      const size_t size = elem_cnt * sizeof(float);
+      if (r == 0) {
+        float* sum = buffs.at(0).data();
+        FOR_RANGE(int64_t, k, 1, num_ranks) {
+          links.at(0).at(k)->RecvInto(size, [&](const char* piece, size_t offset, size_t n) {
+            float* out = sum + offset / sizeof(float);
+            const float* in = reinterpret_cast<const float*>(piece);
+            FOR_RANGE(size_t, j, 0, n / sizeof(float)) { out[j] += in[j]; }
+          });
+        }
+        FOR_RANGE(int64_t, k, 1, num_ranks) { links.at(0).at(k)->AsyncSend(buff, size); }
+        FOR_RANGE(int64_t, k, 1, num_ranks) { links.at(0).at(k)->WaitSendDone(); }
+      } else {
+        links.at(r).at(0)->AsyncSend(buff, size);
+        links.at(r).at(0)->WaitSendDone();
+        links.at(r).at(0)->Recv(buff, size);
+      }
+    });
+  }
+  const double naive_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    RunOnEveryRank(num_ranks, [&](int64_t r) {
+      comms.at(r)->AllReduce(buffs.at(r).data(), buffs.at(r).data(), elem_cnt, DataType::kFloat);
+    });
+  }
+  const double ring_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << "all-reduce of " << elem_cnt << " floats among " << num_ranks
+            << " threads, reduce and broadcast: " << naive_ms / repeat
+            << " ms, ring: " << ring_ms / repeat << " ms";
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
@@ -0,0 +1,193 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/dynamic_storage_allocation.h"
+#include <chrono>
+#include <limits>
+#include <numeric>
+
+namespace oneflow {
+
+int64_t DsaLiveSizeLowerBound(const std::vector<DsaBlock>& blocks) {
+  // (step, size delta), a block ending at step - 1 is released before one beginning at step
+  std::vector<std::pair<int64_t, int64_t>> events;
+  for (const DsaBlock& block : blocks) {
+    events.emplace_back(block.begin, block.size);
+    events.emplace_back(block.end + 1, -block.size);
+  }
+  std::sort(events.begin(), events.end());
+  int64_t live_size = 0;
+  int64_t lower_bound = 0;
+  for (const auto& event : events) {
+    live_size += event.second;
+    lower_bound = std::max(lower_bound, live_size);
+  }
+  CHECK_EQ(live_size, 0);
+  return lower_bound;
+}
+
+int64_t DsaDefaultMaxIter(int64_t num_blocks) {
+  constexpr int64_t kMaxBlockPairs = int64_t(1) << 27;
+  const int64_t num_pairs = std::max<int64_t>(num_blocks * num_blocks, 1);
+  return std::max<int64_t>(1, std::min<int64_t>(64 * num_blocks, kMaxBlockPairs / num_pairs));
+}
+
+struct DynamicStorageAllocator::Placement {
+  std::vector<int64_t> order;
+  // indexed by block, -1 for the blocks not placed yet
+  std::vector<int64_t> offsets;
+  // tops.at(i) is the buffer size needed by order[:i + 1]
+  std::vector<int64_t> tops;
+
+  int64_t buffer_size() const { return tops.empty() ? 0 : tops.back(); }
+};
+
+DynamicStorageAllocator::DynamicStorageAllocator(std::vector<DsaBlock> blocks)
+    : blocks_(std::move(blocks)), block2overlapped_blocks_(blocks_.size()) {
+  const int64_t num_blocks = blocks_.size();
+  std::vector<int64_t> sorted_blocks(num_blocks);
+  std::iota(sorted_blocks.begin(), sorted_blocks.end(), 0);
+  std::sort(sorted_blocks.begin(), sorted_blocks.end(), [&](int64_t lhs, int64_t rhs) {
+    return blocks_.at(lhs).begin < blocks_.at(rhs).begin;
+  });
+  // the blocks beginning during the lifetime of a block are all that overlap it from the right
+  FOR_RANGE(int64_t, i, 0, num_blocks) {
+    const DsaBlock& block = blocks_.at(sorted_blocks.at(i));
+    CHECK_GE(block.size, 0);
+    CHECK_LE(block.begin, block.end);
+    for (int64_t j = i + 1; j < num_blocks && blocks_.at(sorted_blocks.at(j)).begin <= block.end;
+         ++j) {
+      block2overlapped_blocks_.at(sorted_blocks.at(i)).push_back(sorted_blocks.at(j));
+      block2overlapped_blocks_.at(sorted_blocks.at(j)).push_back(sorted_blocks.at(i));
+    }
+  }
+  live_size_lower_bound_ = DsaLiveSizeLowerBound(blocks_);
+}
+
+void DynamicStorageAllocator::PlaceFrom(int64_t from, Placement* placement) const {
+  const int64_t num_blocks = placement->order.size();
+  FOR_RANGE(int64_t, i, from, num_blocks) { placement->offsets.at(placement->order.at(i)) = -1; }
+  placement->tops.resize(num_blocks);
+  std::vector<std::pair<int64_t, int64_t>> occupied;
+  FOR_RANGE(int64_t, i, from, num_blocks) {
+    const int64_t block_id = placement->order.at(i);
+    const int64_t size = blocks_.at(block_id).size;
+    occupied.clear();
+    for (int64_t overlapped : block2overlapped_blocks_.at(block_id)) {
+      const int64_t offset = placement->offsets.at(overlapped);
+      if (offset != -1) { occupied.emplace_back(offset, offset + blocks_.at(overlapped).size); }
+    }
+    std::sort(occupied.begin(), occupied.end());
+    // best fit among the gaps between the occupied ranges, on top of them if none fits
+    int64_t best_offset = -1;
+    int64_t best_gap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    for (const auto& range : occupied) {
+      const int64_t gap = range.first - cursor;
+      if (gap >= size && gap < best_gap) {
+        best_offset = cursor;
+        best_gap = gap;
+      }
+      cursor = std::max(cursor, range.second);
+    }
+    if (best_offset == -1) { best_offset = cursor; }
+    placement->offsets.at(block_id) = best_offset;
+    const int64_t prev_top = i == 0 ? 0 : placement->tops.at(i - 1);
+    placement->tops.at(i) = std::max(prev_top, best_offset + size);
+  }
+}
+
+int64_t DynamicStorageAllocator::AllocateByOrder(const std::vector<int64_t>& order,
+                                                 std::vector<int64_t>* offsets) const {
+  CHECK_EQ(order.size(), blocks_.size());
+  Placement placement;
+  placement.order = order;
+  placement.offsets.assign(blocks_.size(), -1);
+  PlaceFrom(0, &placement);
+  *offsets = placement.offsets;
+  return placement.buffer_size();
+}
+
+int64_t DynamicStorageAllocator::Allocate(int64_t max_iter, int64_t time_limit_ms,
+                                          std::vector<int64_t>* offsets) const {
+  const int64_t num_blocks = blocks_.size();
+  auto Length = [&](int64_t block_id) {
+    return blocks_.at(block_id).end - blocks_.at(block_id).begin + 1;
+  };
+  const std::vector<std::function<bool(int64_t, int64_t)>> comparators = {
+      [&](int64_t lhs, int64_t rhs) {
+        return std::make_pair(blocks_.at(lhs).size, Length(lhs))
+               > std::make_pair(blocks_.at(rhs).size, Length(rhs));
+      },
+      [&](int64_t lhs, int64_t rhs) {
+        return std::make_pair(Length(lhs), blocks_.at(lhs).size)
+               > std::make_pair(Length(rhs), blocks_.at(rhs).size);
+      },
+      [&](int64_t lhs, int64_t rhs) {
+        return blocks_.at(lhs).size * Length(lhs) > blocks_.at(rhs).size * Length(rhs);
+      },
+      [&](int64_t lhs, int64_t rhs) {
+        return std::make_pair(blocks_.at(lhs).begin, -blocks_.at(lhs).size)
+               < std::make_pair(blocks_.at(rhs).begin, -blocks_.at(rhs).size);
+      },
+  };
+  Placement best;
+  for (const auto& Comparator : comparators) {
+    Placement placement;
+    placement.order.resize(num_blocks);
+    std::iota(placement.order.begin(), placement.order.end(), 0);
+    std::stable_sort(placement.order.begin(), placement.order.end(), Comparator);
+    placement.offsets.assign(num_blocks, -1);
+    PlaceFrom(0, &placement);
+    if (best.order.empty() || placement.buffer_size() < best.buffer_size()) {
+      best = std::move(placement);
+    }
+  }
+
+  // a non positive time limit leaves the search bounded by max_iter only
+  const auto deadline = time_limit_ms > 0 ? std::chrono::steady_clock::now()
+                                                + std::chrono::milliseconds(time_limit_ms)
+                                          : std::chrono::steady_clock::time_point::max();
+  std::mt19937 gen(0);
+  Placement current = best;
+  std::vector<int64_t> top_positions;
+  FOR_RANGE(int64_t, iter, 0, max_iter) {
+    if (best.buffer_size() == live_size_lower_bound_) { break; }
+    if (std::chrono::steady_clock::now() > deadline) { break; }
+    top_positions.clear();
+    FOR_RANGE(int64_t, i, 1, num_blocks) {
+      const int64_t block_id = current.order.at(i);
+      if (current.offsets.at(block_id) + blocks_.at(block_id).size == current.buffer_size()) {
+        top_positions.push_back(i);
+      }
+    }
+    // only the first block reaches the top, which is then the size of a single block
+    if (top_positions.empty()) { break; }
+    const int64_t from = top_positions.at(gen() % top_positions.size());
+    const int64_t to = gen() % from;
+    Placement trial = current;
+    std::rotate(trial.order.begin() + to, trial.order.begin() + from,
+                trial.order.begin() + from + 1);
+    PlaceFrom(to, &trial);
+    if (trial.buffer_size() <= current.buffer_size()) {
+      current = std::move(trial);
+      if (current.buffer_size() < best.buffer_size()) { best = current; }
+    }
+  }
+  *offsets = std::move(best.offsets);
+  return best.buffer_size();
+}
+
+}  // namespace oneflow
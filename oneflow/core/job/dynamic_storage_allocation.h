@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_DYNAMIC_STORAGE_ALLOCATION_H_
+#define ONEFLOW_CORE_JOB_DYNAMIC_STORAGE_ALLOCATION_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A block of size bytes alive from step begin to step end, both inclusive.
+struct DsaBlock {
+  int64_t size;
+  int64_t begin;
+  int64_t end;
+};
+
+// the largest sum of the sizes of the blocks alive at one step, no buffer can be smaller
+int64_t DsaLiveSizeLowerBound(const std::vector<DsaBlock>& blocks);
+
+// A move places up to all the blocks again, each one against the blocks it overlaps, so its cost
+// grows about with the square of the number of blocks. The default number of moves keeps the
+// search of a mem chain at a similar cost whatever its size.
+int64_t DsaDefaultMaxIter(int64_t num_blocks);
+
+// Offline dynamic storage allocation: gives every block an offset in one buffer so that blocks
+// alive at a common step do not overlap, trying to keep the buffer small.
+//   - A placement walks the blocks in some order and puts each one at the best fitting gap left
+//     by the already placed blocks it shares a step with, or on top of them.
+//   - A few orders by size and lifetime are placed first, then the best one is improved by local
+//     search: the block reaching the top is moved to a random earlier position and the blocks
+//     behind are placed again, the move is kept unless the buffer grows.
+// The search stops at the live size lower bound, after max_iter moves or after time_limit_ms
+// (ignored when not positive), only the latter makes the result depend on the speed of the host.
+class DynamicStorageAllocator final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(DynamicStorageAllocator);
+  explicit DynamicStorageAllocator(std::vector<DsaBlock> blocks);
+  ~DynamicStorageAllocator() = default;
+
+  int64_t LiveSizeLowerBound() const { return live_size_lower_bound_; }
+  // returns the buffer size, offsets are indexed like the blocks
+  int64_t Allocate(int64_t max_iter, int64_t time_limit_ms, std::vector<int64_t>* offsets) const;
+  // a single placement in the given order, no search
+  int64_t AllocateByOrder(const std::vector<int64_t>& order, std::vector<int64_t>* offsets) const;
+
+ private:
+  struct Placement;
+  // places order[from:] behind the kept placement of order[:from]
+  void PlaceFrom(int64_t from, Placement* placement) const;
+
+  std::vector<DsaBlock> blocks_;
+  // blocks sharing a step with each block
+  std::vector<std::vector<int64_t>> block2overlapped_blocks_;
+  int64_t live_size_lower_bound_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_DYNAMIC_STORAGE_ALLOCATION_H_
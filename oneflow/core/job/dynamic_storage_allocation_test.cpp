@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <numeric>
+#include "oneflow/core/job/dynamic_storage_allocation.h"
+
+namespace oneflow {
+
+namespace {
+
+void CheckNoOverlap(const std::vector<DsaBlock>& blocks, const std::vector<int64_t>& offsets,
+                    int64_t buffer_size) {
+  ASSERT_EQ(offsets.size(), blocks.size());
+  FOR_RANGE(size_t, i, 0, blocks.size()) {
+    ASSERT_GE(offsets.at(i), 0);
+    ASSERT_LE(offsets.at(i) + blocks.at(i).size, buffer_size);
+    FOR_RANGE(size_t, j, 0, i) {
+      const bool share_step =
+          blocks.at(i).begin <= blocks.at(j).end && blocks.at(j).begin <= blocks.at(i).end;
+      const bool share_memory = offsets.at(i) < offsets.at(j) + blocks.at(j).size
+                                && offsets.at(j) < offsets.at(i) + blocks.at(i).size;
+      ASSERT_FALSE(share_step && share_memory) << "block " << i << " and " << j;
+    }
+  }
+}
+
+// forward activations live until their backward step, with short lived temporaries, skip
+// connections and gradients of mixed sizes in between, the way the registers of a training job do
+std::vector<DsaBlock> TrainingLikeBlocks(int64_t num_layers, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int64_t> size_dis(1, 64);
+  std::uniform_int_distribution<int64_t> skip_dis(1, 8);
+  const int64_t last_step = 2 * num_layers - 1;
+  std::vector<DsaBlock> blocks;
+  FOR_RANGE(int64_t, i, 0, num_layers) {
+    blocks.push_back({size_dis(gen) << 10, i, last_step - i});
+    blocks.push_back({size_dis(gen) << 8, i, i});
+    const int64_t skip_end = std::min(last_step, i + skip_dis(gen));
+    blocks.push_back({size_dis(gen) << 10, i, skip_end});
+    const int64_t backward_step = last_step - i;
+    blocks.push_back(
+        {size_dis(gen) << 10, backward_step, std::min(last_step, backward_step + skip_dis(gen))});
+  }
+  return blocks;
+}
+
+}  // namespace
+
+TEST(DynamicStorageAllocator, live_size_lower_bound) {
+  DynamicStorageAllocator allocator({{10, 0, 2}, {20, 1, 1}, {30, 2, 3}, {5, 3, 3}, {50, 4, 4}});
+  ASSERT_EQ(allocator.LiveSizeLowerBound(), 50);
+  std::vector<int64_t> offsets;
+  ASSERT_EQ(allocator.Allocate(100, 1000, &offsets), 50);
+}
+
+TEST(DynamicStorageAllocator, empty_and_single) {
+  std::vector<int64_t> offsets;
+  ASSERT_EQ(DynamicStorageAllocator({}).Allocate(100, 1000, &offsets), 0);
+  ASSERT_TRUE(offsets.empty());
+  ASSERT_EQ(DynamicStorageAllocator({{7, 3, 3}}).Allocate(100, 1000, &offsets), 7);
+  ASSERT_EQ(offsets, std::vector<int64_t>({0}));
+}
+
+TEST(DynamicStorageAllocator, best_fit_reuses_gap) {
+  // the short lived block in the middle leaves a hole that exactly fits the last one
+  const std::vector<DsaBlock> blocks = {{8, 0, 3}, {4, 0, 0}, {8, 0, 3}, {4, 1, 3}};
+  DynamicStorageAllocator allocator(blocks);
+  std::vector<int64_t> offsets;
+  const int64_t buffer_size = allocator.AllocateByOrder({0, 1, 2, 3}, &offsets);
+  CheckNoOverlap(blocks, offsets, buffer_size);
+  ASSERT_EQ(buffer_size, 20);
+  ASSERT_EQ(offsets.at(3), offsets.at(1));
+}
+
+TEST(DynamicStorageAllocator, random_blocks_do_not_overlap) {
+  FOR_RANGE(uint32_t, seed, 0, 20) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int64_t> size_dis(1, 1000);
+    std::uniform_int_distribution<int64_t> step_dis(0, 50);
+    std::vector<DsaBlock> blocks;
+    FOR_RANGE(int64_t, i, 0, 200) {
+      const int64_t begin = step_dis(gen);
+      blocks.push_back({size_dis(gen), begin, begin + step_dis(gen) / 5});
+    }
+    DynamicStorageAllocator allocator(blocks);
+    std::vector<int64_t> offsets;
+    const int64_t buffer_size = allocator.Allocate(200, 0, &offsets);
+    CheckNoOverlap(blocks, offsets, buffer_size);
+    ASSERT_GE(buffer_size, allocator.LiveSizeLowerBound());
+    // without a time limit the result does not depend on the host
+    std::vector<int64_t> again;
+    ASSERT_EQ(allocator.Allocate(200, 0, &again), buffer_size);
+    ASSERT_EQ(again, offsets);
+  }
+}
+
+TEST(DynamicStorageAllocator, benchmark_training_like_blocks) {
+  for (int64_t num_layers : {50, 200, 800}) {
+    const std::vector<DsaBlock> blocks = TrainingLikeBlocks(num_layers, 0);
+    DynamicStorageAllocator allocator(blocks);
+    std::vector<int64_t> order(blocks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int64_t lhs, int64_t rhs) {
+      return blocks.at(lhs).size > blocks.at(rhs).size;
+    });
+    std::vector<int64_t> offsets;
+    const int64_t size_first = allocator.AllocateByOrder(order, &offsets);
+    CheckNoOverlap(blocks, offsets, size_first);
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t searched = allocator.Allocate(DsaDefaultMaxIter(blocks.size()), 0, &offsets);
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CheckNoOverlap(blocks, offsets, searched);
+    ASSERT_LE(searched, size_first);
+    const double lower_bound = allocator.LiveSizeLowerBound();
+    LOG(INFO) << blocks.size() << " blocks, lower bound " << lower_bound
+              << ", size first placement: +" << (size_first / lower_bound - 1) * 100
+              << "%, searched: +" << (searched / lower_bound - 1) * 100 << "% in " << ms << " ms";
+  }
+}
+
+}  // namespace oneflow
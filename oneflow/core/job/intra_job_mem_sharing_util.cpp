@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/shape.h"
+#include "oneflow/core/job/dynamic_storage_allocation.h"
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/register/runtime_register_desc.h"
 #include "oneflow/core/thread/thread_pool.h"
@@ -27,6 +28,7 @@ enum MemAllocAlgoType {
   kMemSizeFirstAlgo = 0,
   kMutualExclusionFirstAlgo = 1,
   kTimeLineAlgo = 2,
+  kDynamicStorageAllocationAlgo = 3,
 };
 
 }  // namespace oneflow
@@ -584,6 +586,76 @@ void MemReusedAlgorithm_TimeLineAlgo(
   result->mem_block_size = bfc_allocator.buffer_size();
 }
 
+}  // namespace
+
+void GenDsaBlocks4Regsts(const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+                         const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
+                         std::vector<RegstDescProto*>* regsts, std::vector<DsaBlock>* blocks) {
+  HashMap<RegstDescProto*, int64_t> regst2free_index;
+  for (int64_t i = 0; i < free_regsts_timeline.size(); ++i) {
+    for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
+      CHECK(regst2free_index.emplace(free_regst, i).second);
+    }
+  }
+  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
+    // the order of a hash set depends on the pointer values, which vary between runs
+    std::vector<RegstDescProto*> alloc_regsts(alloc_regsts_timeline.at(i).begin(),
+                                              alloc_regsts_timeline.at(i).end());
+    std::sort(alloc_regsts.begin(), alloc_regsts.end(),
+              [](const RegstDescProto* lhs, const RegstDescProto* rhs) {
+                return lhs->regst_desc_id() < rhs->regst_desc_id();
+              });
+    for (RegstDescProto* alloc_regst : alloc_regsts) {
+      DsaBlock block;
+      block.size = RtRegstDesc(*alloc_regst).TotalMainByteSize4AllRegst();
+      block.begin = i;
+      block.end = regst2free_index.at(alloc_regst);
+      regsts->push_back(alloc_regst);
+      blocks->push_back(block);
+    }
+  }
+}
+
+namespace {
+
+void MemReusedAlgorithm_DynamicStorageAllocationAlgo(
+    const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline, MemBlockResultInfo* result) {
+  std::vector<RegstDescProto*> regsts;
+  std::vector<DsaBlock> blocks;
+  GenDsaBlocks4Regsts(alloc_regsts_timeline, free_regsts_timeline, &regsts, &blocks);
+  const int64_t max_iter = DsaDefaultMaxIter(blocks.size());
+  const int64_t time_limit_ms = GlobalJobDesc()
+                                    .job_conf()
+                                    .memory_allocation_algorithm_conf()
+                                    .dynamic_storage_allocation_time_limit_ms();
+  std::vector<int64_t> offsets;
+  result->mem_block_size =
+      DynamicStorageAllocator(std::move(blocks)).Allocate(max_iter, time_limit_ms, &offsets);
+  for (int64_t i = 0; i < regsts.size(); ++i) {
+    CHECK(result->regst_desc2offset.emplace(regsts.at(i), offsets.at(i)).second);
+  }
+}
+
+int64_t LiveSizeLowerBound(const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+                           const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline) {
+  std::vector<RegstDescProto*> regsts;
+  std::vector<DsaBlock> blocks;
+  GenDsaBlocks4Regsts(alloc_regsts_timeline, free_regsts_timeline, &regsts, &blocks);
+  return DsaLiveSizeLowerBound(blocks);
+}
+
+std::string MemAllocAlgoTypeName(MemAllocAlgoType algo_id) {
+  switch (algo_id) {
+    case kMemSizeFirstAlgo: return "mem_size_first";
+    case kMutualExclusionFirstAlgo: return "mutual_exclusion_first";
+    case kTimeLineAlgo: return "time_line";
+    case kDynamicStorageAllocationAlgo: return "dynamic_storage_allocation";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
 void SelectAlgorithmGenMemBlockOffset4Regsts(
     MemAllocAlgoType algo_id, const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
     const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
@@ -601,6 +673,10 @@ void SelectAlgorithmGenMemBlockOffset4Regsts(
     case kTimeLineAlgo:
       MemReusedAlgorithm_TimeLineAlgo(alloc_regsts_timeline, free_regsts_timeline, result);
       break;
+    case kDynamicStorageAllocationAlgo:
+      MemReusedAlgorithm_DynamicStorageAllocationAlgo(alloc_regsts_timeline, free_regsts_timeline,
+                                                      result);
+      break;
     default: UNIMPLEMENTED();
   }
   CHECK_GT(result->mem_block_size, 0);
@@ -614,6 +690,7 @@ int64_t CountMemAllocAlgoNum() {
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_time_line_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_dynamic_storage_allocation_algo()) { ++ret; }
   CHECK_GE(ret, 0);
   return ret;
 }
@@ -631,6 +708,9 @@ void InitAlgo2Result(HashMap<MemAllocAlgoType, MemBlockResultInfo>* algo2result)
   if (mem_alloc_algo_conf.use_time_line_algo()) {
     CHECK(algo2result->emplace(kTimeLineAlgo, MemBlockResultInfo()).second);
   }
+  if (mem_alloc_algo_conf.use_dynamic_storage_allocation_algo()) {
+    CHECK(algo2result->emplace(kDynamicStorageAllocationAlgo, MemBlockResultInfo()).second);
+  }
 }
 
 }  // namespace
@@ -693,12 +773,25 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(Plan* plan,
   // step 3: choose best one for each mem chain and set offset for inplace consumer regst
   for (const auto& pair : mem_chain2algo2result) {
     const MemBlockResultInfo* best_result = nullptr;
+    MemAllocAlgoType best_algo_id = kMemSizeFirstAlgo;
     for (const auto& algo_result_pair : pair.second) {
       if (!best_result || algo_result_pair.second.mem_block_size < best_result->mem_block_size) {
         best_result = &algo_result_pair.second;
+        best_algo_id = algo_result_pair.first;
       }
     }
     CHECK(best_result != nullptr);
+    const int64_t lower_bound = LiveSizeLowerBound(mem_chain2task2alloc_regsts.at(pair.first),
+                                                   mem_chain2task2free_regsts.at(pair.first));
+    CHECK_GE(best_result->mem_block_size, lower_bound);
+    const double overhead_percent =
+        100.0 * (best_result->mem_block_size - lower_bound) / std::max<int64_t>(lower_bound, 1);
+    const TaskProto* first_task = mem_chain2sorted_tasks.at(pair.first).front();
+    LOG(INFO) << "mem chain " << pair.first << " of machine " << first_task->machine_id()
+              << " gpu " << Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(first_task->thrd_id())
+              << ": mem block size " << best_result->mem_block_size << " by "
+              << MemAllocAlgoTypeName(best_algo_id) << " algo, live size lower bound "
+              << lower_bound << " (+" << overhead_percent << "%)";
     int64_t mem_block_id = Global<IDMgr>::Get()->NewMemBlockId();
     CHECK_EQ(mem_chain2mem_reused_regsts.at(pair.first).size(),
              (best_result->regst_desc2offset.size()
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_JOB_IN_JOB_MEM_SHARING_UTIL_H_
 
 #include "oneflow/core/job/plan.pb.h"
+#include "oneflow/core/job/dynamic_storage_allocation.h"
 #include "oneflow/core/graph/plan_task_graph.h"
 
 namespace oneflow {
@@ -25,6 +26,12 @@ struct IntraJobMemSharingUtil {
   static void InferMemBlockId4MemReusedRegst(Plan* plan, const PlanTaskGraph& plan_task_graph);
 };
 
+// The blocks of the regsts allocated at each step of the timeline, the regsts of a step in the
+// order of regst_desc_id so that the blocks do not depend on where the regsts are in memory.
+void GenDsaBlocks4Regsts(const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+                         const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
+                         std::vector<RegstDescProto*>* regsts, std::vector<DsaBlock>* blocks);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_JOB_IN_JOB_MEM_SHARING_UTIL_H_
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+#include "oneflow/core/job/intra_job_mem_sharing_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kRegstNum = 64;
+constexpr int64_t kStepNum = 24;
+
+// offset of every regst_desc_id, the regsts created and inserted in the order of regst_desc_ids
+HashMap<int64_t, int64_t> AllocateRegsts(const std::vector<int64_t>& regst_desc_ids,
+                                         int64_t* buffer_size) {
+  std::vector<std::unique_ptr<RegstDescProto>> regst_descs;
+  std::vector<HashSet<RegstDescProto*>> alloc_regsts_timeline(kStepNum);
+  std::vector<HashSet<RegstDescProto*>> free_regsts_timeline(kStepNum);
+  for (int64_t regst_desc_id : regst_desc_ids) {
+    regst_descs.emplace_back(new RegstDescProto());
+    RegstDescProto* regst_desc = regst_descs.back().get();
+    regst_desc->set_regst_desc_id(regst_desc_id);
+    // few sizes and lifetimes, the regsts of a step tie with each other in both
+    regst_desc->set_register_num(1 + regst_desc_id % 2);
+    const int64_t alloc_step = regst_desc_id % (kStepNum / 2);
+    const int64_t free_step = alloc_step + 1 + regst_desc_id / (kStepNum / 2) % 3;
+    alloc_regsts_timeline.at(alloc_step).insert(regst_desc);
+    free_regsts_timeline.at(free_step).insert(regst_desc);
+  }
+  std::vector<RegstDescProto*> regsts;
+  std::vector<DsaBlock> blocks;
+  GenDsaBlocks4Regsts(alloc_regsts_timeline, free_regsts_timeline, &regsts, &blocks);
+  std::vector<int64_t> offsets;
+  *buffer_size = DynamicStorageAllocator(blocks).Allocate(DsaDefaultMaxIter(blocks.size()), 0,
+                                                          &offsets);
+  HashMap<int64_t, int64_t> regst_desc_id2offset;
+  FOR_RANGE(size_t, i, 0, regsts.size()) {
+    CHECK(regst_desc_id2offset.emplace(regsts.at(i)->regst_desc_id(), offsets.at(i)).second);
+  }
+  return regst_desc_id2offset;
+}
+
+}  // namespace
+
+TEST(IntraJobMemSharingUtil, dsa_offsets_do_not_depend_on_regst_order) {
+  std::vector<int64_t> regst_desc_ids(kRegstNum);
+  std::iota(regst_desc_ids.begin(), regst_desc_ids.end(), 0);
+  int64_t buffer_size = 0;
+  const HashMap<int64_t, int64_t> regst_desc_id2offset =
+      AllocateRegsts(regst_desc_ids, &buffer_size);
+  ASSERT_EQ(regst_desc_id2offset.size(), kRegstNum);
+  std::mt19937 gen(0);
+  FOR_RANGE(int64_t, i, 0, 8) {
+    std::shuffle(regst_desc_ids.begin(), regst_desc_ids.end(), gen);
+    int64_t shuffled_buffer_size = 0;
+    ASSERT_EQ(AllocateRegsts(regst_desc_ids, &shuffled_buffer_size), regst_desc_id2offset);
+    ASSERT_EQ(shuffled_buffer_size, buffer_size);
+  }
+}
+
+}  // namespace oneflow
@@ -137,7 +137,9 @@ void MakeModelLoadJob(
   const OperatorConf foreign_input_op_conf = GenForeignInputOpConf(job_name, 65536);
   job_builder.AddOps(master_parallel_conf, {foreign_input_op_conf, tick_op_conf});
   if (var_op_name2op_conf.empty()) { return; }
-  std::string prev_post_model_load_tick_lbn = GenLogicalBlobName(
+  // unlike model init, loading has no cross rank barrier, so the variables are not chained one
+  // after another and the load ops of different devices read their snapshots concurrently
+  const std::string foreign_input_lbn = GenLogicalBlobName(
       foreign_input_op_conf.name(), foreign_input_op_conf.foreign_input_conf().out());
   for (const auto& pair : var_op_name2op_conf) {
     const auto& var_op_name = pair.first;
@@ -150,15 +152,12 @@ void MakeModelLoadJob(
     OperatorConf model_load_op_conf{};
     model_load_op_conf.set_name("System-ModelLoad-" + var_op_name);
     ModelLoadV2OpConf* model_load_conf = model_load_op_conf.mutable_model_load_v2_conf();
-    model_load_conf->set_path(GenLogicalBlobName(foreign_input_op_conf.name(),
-                                                 foreign_input_op_conf.foreign_input_conf().out()));
+    model_load_conf->set_path(foreign_input_lbn);
     model_load_conf->set_ref(GetVariableLbn(new_var_op_conf));
     *model_load_conf->mutable_variable_op_name() = var_op_name;
     *model_load_conf->mutable_original_variable_conf() = origin_variable_conf;
     *model_load_conf->mutable_out() = "out";
-    *model_load_conf->mutable_tick() = prev_post_model_load_tick_lbn;
-    prev_post_model_load_tick_lbn =
-        GenLogicalBlobName(model_load_op_conf.name(), model_load_conf->out());
+    *model_load_conf->mutable_tick() = foreign_input_lbn;
     job_builder.AddOps(variable_op_parallel_conf, {new_var_op_conf, model_load_op_conf});
   }
 }
@@ -34,6 +34,7 @@ limitations under the License.
 #include "oneflow/core/job/model_io_job.h"
 #include "oneflow/core/job/inter_job_mem_sharing_util.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/plan_cache.h"
 #include "oneflow/core/operator/interface_op_util.h"
 #include "oneflow/core/job/critical_section_desc.h"
 #include "oneflow/core/job/global_for.h"
@@ -180,6 +181,8 @@ void GetDeviceDesc(const TaskProto* task_proto, boxing::collective::DeviceDesc*
   device_desc->set_device_type(Global<IDMgr>::Get()->GetDeviceTypeFromThrdId(thrd_id));
   if (device_desc->device_type() == DeviceType::kGPU) {
     device_desc->set_device_id(Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(thrd_id));
+  } else if (device_desc->device_type() == DeviceType::kCPU) {
+    device_desc->set_device_id(thrd_id - Global<IDMgr>::Get()->GetCpuDeviceThrdId(0));
   } else {
     UNIMPLEMENTED();
   }
@@ -967,11 +970,53 @@ Maybe<void> CompileAndMergePlanOnMaster(const PbRpf<Job>& conf_jobs, Plan* plan)
   return Maybe<void>::Ok();
 }
 
+bool IsPlanCacheEnabled(const JobSet& job_set) {
+  if (Global<ResourceDesc, ForSession>::Get()->plan_cache_dir().empty()) { return false; }
+  // an improved plan depends on the act events of its experiment run
+  for (const Job& job : job_set.job()) {
+    if (job.job_conf().exp_run_conf().enable_experiment_run()) { return false; }
+  }
+  return true;
+}
+
+Maybe<void> LoadCachedOrCompileAndMergePlanOnMaster(const JobSet& job_set, Plan* plan) {
+  if (!IsPlanCacheEnabled(job_set)) { return CompileAndMergePlanOnMaster(job_set.job(), plan); }
+  const std::string cache_hit_key = "PlanCacheHit";
+  std::unique_ptr<PlanCache> plan_cache;
+  bool is_cache_hit = false;
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
+    plan_cache.reset(
+        new PlanCache(Global<ResourceDesc, ForSession>::Get()->plan_cache_dir(), job_set));
+    is_cache_hit = plan_cache->TryLoad(plan);
+    Global<CtrlClient>::Get()->PushKV(cache_hit_key, std::to_string(is_cache_hit));
+  } else {
+    std::string cache_hit;
+    Global<CtrlClient>::Get()->PullKV(cache_hit_key, &cache_hit);
+    is_cache_hit = cache_hit == "1";
+  }
+  OF_BARRIER();
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
+    Global<CtrlClient>::Get()->ClearKV(cache_hit_key);
+  }
+  if (!is_cache_hit) {
+    JUST(CompileAndMergePlanOnMaster(job_set.job(), plan));
+    if (Global<MachineCtx>::Get()->IsThisMachineMaster()) { plan_cache->Store(*plan); }
+    return Maybe<void>::Ok();
+  }
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
+    PushPlan("merged_plan", *plan);
+  } else {
+    PullPlan("merged_plan", plan);
+  }
+  OF_BARRIER();
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 Maybe<void> Oneflow::Init(const oneflow::JobSet& job_set) {
   // Runtime
-  JUST(CompileAndMergePlanOnMaster(job_set.job(), &plan_));
+  JUST(LoadCachedOrCompileAndMergePlanOnMaster(job_set, &plan_));
   if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
     runtime_buffers_scope_.reset(new RuntimeBuffersScope(plan_));
   }
@@ -0,0 +1,194 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/plan_cache.pb.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/critical_section_desc.h"
+#include "oneflow/core/job/inter_user_job_info.pb.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/common/str_util.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef WITH_CUDA
+#include <cuda_runtime.h>
+#include <cudnn.h>
+#endif  // WITH_CUDA
+
+namespace oneflow {
+
+namespace {
+
+// bumped whenever the entry or the compilation results outside the plan change
+const int32_t kPlanCacheFormatVersion = 1;
+
+std::string SerializeDeterministically(const PbMessage& msg) {
+  std::string ret;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&ret);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(msg.SerializePartialToCodedStream(&coded_stream));
+  }
+  return ret;
+}
+
+std::string BuildString() {
+  std::string ret = "format " + std::to_string(kPlanCacheFormatVersion);
+#ifdef WITH_GIT_VERSION
+  ret += ", oneflow " + std::string(GetOneFlowGitVersion());
+#endif  // WITH_GIT_VERSION
+#ifdef WITH_CUDA
+  int cuda_runtime_version = 0;
+  if (cudaRuntimeGetVersion(&cuda_runtime_version) == cudaSuccess) {
+    ret += ", cuda " + std::to_string(cuda_runtime_version);
+  }
+  ret += ", cudnn " + std::to_string(cudnnGetVersion());
+#endif  // WITH_CUDA
+  return ret;
+}
+
+// algorithms and workspaces of convolutions are chosen on the devices of the master
+std::string DeviceString() {
+  std::string ret;
+#ifdef WITH_CUDA
+  FOR_RANGE(int32_t, i, 0, (Global<ResourceDesc, ForSession>::Get()->GpuDeviceNum())) {
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, i) != cudaSuccess) { continue; }
+    ret += std::string(prop.name) + " sm_" + std::to_string(prop.major)
+           + std::to_string(prop.minor) + " " + std::to_string(prop.totalGlobalMem) + "; ";
+  }
+#endif  // WITH_CUDA
+  return ret;
+}
+
+// plain file io rather than LocalFS, which treats every failure as fatal
+bool ReadFile(const std::string& path, std::string* content) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) { return false; }
+  content->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return !in.bad();
+}
+
+bool CreateDirs(const std::string& dir) {
+  for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1)) {
+    if (mkdir(dir.substr(0, pos).c_str(), 0755) != 0 && errno != EEXIST) { return false; }
+  }
+  return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), content.size());
+  out.close();
+  return !out.fail();
+}
+
+}  // namespace
+
+PlanCache::PlanCache(const std::string& dir, const JobSet& job_set) : dir_(dir) {
+  PlanCacheKey key;
+  key.set_build(BuildString());
+  key.set_device(DeviceString());
+  *key.mutable_job_set() = job_set;
+  *key.mutable_resource() = Global<ResourceDesc, ForSession>::Get()->resource();
+  *key.mutable_io_conf() = *Global<const IOConf>::Get();
+  FOR_RANGE(int64_t, i, 0, Global<EnvDesc>::Get()->TotalMachineNum()) {
+    *key.mutable_machine()->Add() = Global<EnvDesc>::Get()->machine(i);
+  }
+  key_ = SerializeDeterministically(key);
+  char hash[32];
+  snprintf(hash, sizeof(hash), "%016zx", std::hash<std::string>()(key_));
+  file_path_ = JoinPath(dir_, std::string("plan_") + hash);
+  for (const Job& job : job_set.job()) { job_names_.push_back(job.job_conf().job_name()); }
+}
+
+bool PlanCache::TryLoad(Plan* plan) const {
+  std::string content;
+  if (!ReadFile(file_path_, &content)) {
+    LOG(INFO) << "plan cache miss: " << file_path_ << " not found";
+    return false;
+  }
+  PlanCacheEntry entry;
+  if (!entry.ParsePartialFromString(content)) {
+    LOG(WARNING) << "plan cache: " << file_path_ << " is corrupted, compiling";
+    return false;
+  }
+  if (entry.key() != key_) {
+    LOG(INFO) << "plan cache miss: the entry at " << file_path_ << " is of another job set";
+    return false;
+  }
+  for (const std::string& job_name : job_names_) {
+    if (entry.job_name2job_id().find(job_name) == entry.job_name2job_id().end()) {
+      LOG(WARNING) << "plan cache: job " << job_name << " is missing in " << file_path_
+                   << ", compiling";
+      return false;
+    }
+  }
+  if (entry.plan().task_size() == 0 || entry.critical_section_size() == 0) {
+    LOG(WARNING) << "plan cache: " << file_path_ << " holds an empty plan, compiling";
+    return false;
+  }
+  JobName2JobId* job_name2job_id = Global<JobName2JobId>::Get();
+  CHECK(job_name2job_id->empty());
+  for (const auto& pair : entry.job_name2job_id()) {
+    CHECK(job_name2job_id->emplace(pair.first, pair.second).second);
+  }
+  CriticalSectionDesc* critical_section_desc = Global<CriticalSectionDesc>::Get();
+  CHECK_EQ(critical_section_desc->CriticalSectionNum(), 0);
+  for (const CriticalSection& critical_section : entry.critical_section()) {
+    critical_section_desc->AddCriticalSection(std::make_unique<CriticalSection>(critical_section));
+  }
+  critical_section_desc->Done();
+  *Global<InterUserJobInfo>::Get() = entry.inter_user_job_info();
+  plan->Swap(entry.mutable_plan());
+  LOG(INFO) << "plan cache hit: " << file_path_;
+  return true;
+}
+
+void PlanCache::Store(const Plan& plan) const {
+  PlanCacheEntry entry;
+  entry.set_key(key_);
+  *entry.mutable_plan() = plan;
+  for (const auto& pair : *Global<JobName2JobId>::Get()) {
+    (*entry.mutable_job_name2job_id())[pair.first] = pair.second;
+  }
+  const CriticalSectionDesc* critical_section_desc = Global<CriticalSectionDesc>::Get();
+  FOR_RANGE(int64_t, i, 0, critical_section_desc->CriticalSectionNum()) {
+    *entry.mutable_critical_section()->Add() = critical_section_desc->GetCriticalSection(i);
+  }
+  *entry.mutable_inter_user_job_info() = *Global<InterUserJobInfo>::Get();
+  std::string content;
+  if (!entry.SerializePartialToString(&content)) {
+    LOG(WARNING) << "plan cache: failed to serialize the entry of " << file_path_;
+    return;
+  }
+  const std::string tmp_path = file_path_ + ".tmp." + std::to_string(getpid());
+  if (!CreateDirs(dir_) || !WriteFile(tmp_path, content)
+      || std::rename(tmp_path.c_str(), file_path_.c_str()) != 0) {
+    PLOG(WARNING) << "plan cache: failed to write " << file_path_;
+    std::remove(tmp_path.c_str());
+    return;
+  }
+  LOG(INFO) << "plan cache: stored " << content.size() << " bytes into " << file_path_;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// Keeps the merged plan of a job set on the local disk of the master, with the global descs the
+// compilation fills in besides it: job ids, critical sections and the push and pull jobs. A later
+// session running the same job set with the same resource, io conf and machines, on the same
+// build and devices, loads them instead of compiling.
+//   - An entry is a PlanCacheEntry file named by a hash of its key, it is only used if the whole
+//     key is equal byte by byte.
+//   - Entries are written into a temporary file that is then renamed, concurrent sessions never
+//     read half written ones.
+// Nothing measured while compiling is checked again on a hit, like whether the memory of a device
+// suffices, nor are the random seeds drawn for variables without one drawn again.
+class PlanCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PlanCache);
+  PlanCache(const std::string& dir, const JobSet& job_set);
+  ~PlanCache() = default;
+
+  // fills plan and the global descs on a hit, leaves them untouched on a miss
+  bool TryLoad(Plan* plan) const;
+  // logs and goes on if the entry can not be written
+  void Store(const Plan& plan) const;
+
+ private:
+  std::string dir_;
+  std::string key_;
+  std::string file_path_;
+  std::vector<std::string> job_names_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_CACHE_H_
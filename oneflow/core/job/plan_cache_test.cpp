@@ -0,0 +1,141 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/plan_cache.pb.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/critical_section_desc.h"
+#include "oneflow/core/job/inter_user_job_info.pb.h"
+#include <ftw.h>
+
+namespace oneflow {
+
+namespace {
+
+std::string TestRootDir() { return "/tmp/oneflow_plan_cache_test_" + std::to_string(getpid()); }
+
+std::string TestCacheDir() { return TestRootDir() + "/cache"; }
+
+// removes TestRootDir and everything below it, also when an assertion returns early
+class TestRootDirGuard final {
+ public:
+  TestRootDirGuard() = default;
+  ~TestRootDirGuard() {
+    nftw(
+        TestRootDir().c_str(),
+        [](const char* path, const struct stat*, int, struct FTW*) { return remove(path); }, 16,
+        FTW_DEPTH | FTW_PHYS);
+  }
+};
+
+// the session globals of a master, compiled or about to compile
+class PlanCacheTestScope final {
+ public:
+  explicit PlanCacheTestScope(int32_t gpu_device_num) {
+    EnvProto env_proto;
+    env_proto.add_machine()->set_addr("127.0.0.1");
+    Global<EnvDesc>::New(env_proto);
+    Resource resource;
+    resource.set_machine_num(1);
+    resource.set_gpu_device_num(gpu_device_num);
+    resource.set_plan_cache_dir(TestCacheDir());
+    Global<ResourceDesc, ForSession>::New(resource);
+    Global<const IOConf>::New(IOConf());
+    Global<JobName2JobId>::New();
+    Global<CriticalSectionDesc>::New();
+    Global<InterUserJobInfo>::New();
+  }
+  ~PlanCacheTestScope() {
+    Global<InterUserJobInfo>::Delete();
+    Global<CriticalSectionDesc>::Delete();
+    Global<JobName2JobId>::Delete();
+    Global<const IOConf>::Delete();
+    Global<ResourceDesc, ForSession>::Delete();
+    Global<EnvDesc>::Delete();
+  }
+};
+
+JobSet TestJobSet() {
+  JobSet job_set;
+  job_set.add_job()->mutable_job_conf()->set_job_name("train");
+  job_set.add_job()->mutable_job_conf()->set_job_name("System-ModelInit");
+  return job_set;
+}
+
+// what the compilation of TestJobSet leaves behind
+void FakeCompile(Plan* plan) {
+  plan->add_task()->set_task_id(42);
+  Global<JobName2JobId>::Get()->emplace("train", 0);
+  Global<JobName2JobId>::Get()->emplace("System-ModelInit", 1);
+  FOR_RANGE(int64_t, job_id, 0, 2) {
+    std::unique_ptr<CriticalSection> critical_section(new CriticalSection());
+    critical_section->set_job_id(job_id);
+    critical_section->set_source_tick_op_name("source_" + std::to_string(job_id));
+    critical_section->set_sink_tick_op_name("sink_" + std::to_string(job_id));
+    critical_section->mutable_total_job_critical_section();
+    critical_section->add_mem_block_id(job_id + 7);
+    Global<CriticalSectionDesc>::Get()->AddCriticalSection(std::move(critical_section));
+  }
+  Global<CriticalSectionDesc>::Get()->Done();
+  Global<InterUserJobInfo>::Get()->set_global_model_init_job_name("System-ModelInit");
+}
+
+}  // namespace
+
+TEST(PlanCache, store_and_load) {
+  TestRootDirGuard guard;
+  {
+    PlanCacheTestScope scope(0);
+    PlanCache plan_cache(TestCacheDir(), TestJobSet());
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(&plan));
+    ASSERT_EQ(plan.task_size(), 0);
+    FakeCompile(&plan);
+    plan_cache.Store(plan);
+  }
+  {
+    PlanCacheTestScope scope(0);
+    Plan plan;
+    ASSERT_TRUE(PlanCache(TestCacheDir(), TestJobSet()).TryLoad(&plan));
+    ASSERT_EQ(plan.task_size(), 1);
+    ASSERT_EQ(plan.task(0).task_id(), 42);
+    ASSERT_EQ(Global<JobName2JobId>::Get()->at("System-ModelInit"), 1);
+    const CriticalSectionDesc* critical_section_desc = Global<CriticalSectionDesc>::Get();
+    ASSERT_EQ(critical_section_desc->CriticalSectionNum(), 2);
+    ASSERT_EQ(critical_section_desc->GetCriticalSection(1).sink_tick_op_name(), "sink_1");
+    ASSERT_EQ(critical_section_desc->CriticalSectionIds4JobId(1).size(), 1);
+    ASSERT_EQ(Global<InterUserJobInfo>::Get()->global_model_init_job_name(), "System-ModelInit");
+  }
+  {
+    // another resource
+    PlanCacheTestScope scope(1);
+    Plan plan;
+    ASSERT_FALSE(PlanCache(TestCacheDir(), TestJobSet()).TryLoad(&plan));
+  }
+  {
+    // another job set
+    PlanCacheTestScope scope(0);
+    JobSet job_set = TestJobSet();
+    job_set.mutable_job(0)->mutable_job_conf()->set_total_batch_num(2);
+    Plan plan;
+    ASSERT_FALSE(PlanCache(TestCacheDir(), job_set).TryLoad(&plan));
+    ASSERT_TRUE(Global<JobName2JobId>::Get()->empty());
+  }
+}
+
+}  // namespace oneflow
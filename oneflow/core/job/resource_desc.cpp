@@ -38,6 +38,15 @@ int32_t ResourceDesc::ComputeThreadPoolSize() const {
   }
 }
 
+int32_t ResourceDesc::CompileThreadNum() const {
+  if (resource_.has_compile_thread_num()) {
+    CHECK_GT(resource_.compile_thread_num(), 0);
+    return resource_.compile_thread_num();
+  } else {
+    return std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+  }
+}
+
 bool ResourceDesc::enable_debug_mode() const {
   return std::getenv("ONEFLOW_DEBUG_MODE") != nullptr || resource_.enable_debug_mode();
 }
@@ -33,6 +33,7 @@ class ResourceDesc final {
   size_t TotalMachineNum() const;
   const Machine& machine(int32_t idx) const;
   size_t CommNetWorkerNum() const { return resource_.comm_net_worker_num(); }
+  int32_t CommNetStripeNum() const { return resource_.comm_net_stripe_num(); }
   size_t rdma_mem_block_byte() const { return resource_.rdma_mem_block_mbyte() * kMB; }
   size_t rdma_recv_msg_buf_byte() const { return resource_.rdma_recv_msg_buf_mbyte() * kMB; }
   int32_t CpuDeviceNum() const { return resource_.cpu_device_num(); }
@@ -42,15 +43,27 @@ class ResourceDesc final {
   size_t reserved_host_mem_byte() const { return resource_.reserved_host_mem_mbyte() * kMB; }
   size_t reserved_device_mem_byte() const { return resource_.reserved_device_mem_mbyte() * kMB; }
   bool use_rdma() const { return resource_.use_rdma(); }
+  bool enable_comm_net_zero_copy() const { return resource_.enable_comm_net_zero_copy(); }
+  bool enable_comm_net_shared_memory() const {
+    return resource_.enable_comm_net_shared_memory();
+  }
   bool enable_numa_aware_cuda_malloc_host() const {
     return resource_.enable_numa_aware_cuda_malloc_host();
   }
   bool thread_enable_local_message_queue() const {
     return resource_.thread_enable_local_message_queue();
   }
+  bool thread_enable_lock_free_message_queue() const {
+    return resource_.thread_enable_lock_free_message_queue();
+  }
+  size_t thread_lock_free_message_queue_capacity() const {
+    return resource_.thread_lock_free_message_queue_capacity();
+  }
   bool enable_thread_local_cache() const { return resource_.enable_thread_local_cache(); }
   size_t thread_local_cache_max_size() const { return resource_.thread_local_cache_max_size(); }
   int32_t ComputeThreadPoolSize() const;
+  int32_t CompileThreadNum() const;
+  const std::string& plan_cache_dir() const { return resource_.plan_cache_dir(); }
   bool enable_debug_mode() const;
   CollectiveBoxingConf collective_boxing_conf() const;
 
@@ -27,6 +27,7 @@ limitations under the License.
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/memory/host_caching_allocator.h"
 #include "oneflow/core/register/register_manager.h"
 #include "oneflow/user/summary/events_writer.h"
 #include "oneflow/core/job/collective_boxing_executor.h"
@@ -130,6 +131,7 @@ void Runtime::DeleteAllGlobal() {
   Global<ActorMsgBus>::Delete();
   Global<RegstMgr>::Delete();
   Global<MemoryAllocator>::Delete();
+  LOG(INFO) << HostCachingAllocator::Get()->StatsDebugString();
   Global<boxing::collective::CollectiveBoxingExecutor>::Delete();
   Global<CommNet>::Delete();
   Global<ActEventLogger>::Delete();
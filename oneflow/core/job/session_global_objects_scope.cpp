@@ -24,6 +24,7 @@ limitations under the License.
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/job/profiler.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot_write_queue.h"
 #include "oneflow/core/common/buffer_manager.h"
 #include "oneflow/core/job/foreign_job_instance.h"
 #include "oneflow/core/job/inter_user_job_info.pb.h"
@@ -75,6 +76,11 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
   DumpVersionInfo();
   Global<ResourceDesc, ForSession>::New(config_proto.resource());
   Global<const IOConf>::New(config_proto.io_conf());
+  if (Global<const IOConf>::Get()->enable_async_snapshot()) {
+    Global<SnapshotWriteQueue>::New(
+        SnapshotFS(), Global<const IOConf>::Get()->async_snapshot_worker_num(),
+        Global<const IOConf>::Get()->async_snapshot_max_staging_mbyte() * 1024 * 1024);
+  }
   Global<const ProfilerConf>::New(config_proto.profiler_conf());
   Global<IDMgr>::New();
   if (Global<MachineCtx>::Get()->IsThisMachineMaster()
@@ -111,6 +117,8 @@ SessionGlobalObjectsScope::~SessionGlobalObjectsScope() {
   if (Global<Profiler>::Get() != nullptr) { Global<Profiler>::Delete(); }
   Global<IDMgr>::Delete();
   Global<const ProfilerConf>::Delete();
+  // waits for the snapshots still being written
+  if (Global<SnapshotWriteQueue>::Get() != nullptr) { Global<SnapshotWriteQueue>::Delete(); }
   Global<const IOConf>::Delete();
   Global<ResourceDesc, ForSession>::Delete();
   Global<ResourceDesc, ForSession>::New(Global<ResourceDesc, ForEnv>::Get()->resource());
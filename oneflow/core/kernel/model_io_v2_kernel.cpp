@@ -336,9 +336,13 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
     SnapshotWriter writer(snapshot_path);
     const std::string var_lbn =
         GenLogicalBlobName(conf.variable_op_name(), original_variable_conf.out());
-    const std::string key = is_broadcast ? var_lbn : GetTmpPartKey(var_lbn, parallel_ctx);
-    writer.Write(key, in_accessor.host_blob());
-    if (!is_broadcast) {
+    if (is_broadcast) {
+      writer.Write(var_lbn, in_accessor.host_blob());
+    } else {
+      // the parts are read back by the first rank right after the barrier, possibly on another
+      // machine, so they are not left to the write queue
+      SnapshotWriter part_writer(snapshot_path, false);
+      part_writer.Write(GetTmpPartKey(var_lbn, parallel_ctx), in_accessor.host_blob());
       const int64_t parallel_num = parallel_ctx.parallel_num();
       Global<CtrlClient>::Get()->Barrier(
           snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(*counter_), parallel_num);
@@ -356,6 +360,9 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
       }
       writer.Write(var_lbn, total_blob.blob());
     }
+    // the save job writes no marker, whoever runs it takes its return as the snapshot being
+    // complete, so the queued files of it have to be on storage by then
+    writer.Flush();
   }
   std::unique_ptr<int64_t> counter_;
 };
@@ -14,9 +14,212 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
+namespace {
+
+// inputs this big are split by key hash into partitions made unique independently in parallel
+constexpr int64_t kMinPartitionedElemCnt = 1 << 16;
+constexpr int64_t kPartitionNum = 64;
+constexpr int64_t kScatterChunkNum = 64;
+constexpr int64_t kWorkspaceAlignSize = 64;
+// slots of a hash table before it grows
+constexpr int64_t kMinSlotNum = 1024;
+
+template<typename KEY, typename IDX>
+struct HashSlot {
+  KEY key;
+  // index of the key among the unique keys, -1 if the slot is empty
+  IDX idx;
+};
+
+// a table of 2x slots as many keys keeps linear probing short
+int64_t GetSlotNum(int64_t elem_cnt) { return 2 * elem_cnt; }
+
+template<typename KEY, typename IDX>
+struct UniqueWorkspace {
+  HashSlot<KEY, IDX>* slots;
+  // the keys and their positions in the input, grouped by partition
+  KEY* partitioned_keys;
+  IDX* partitioned_positions;
+
+  static int64_t SizeInBytes(int64_t n) {
+    int64_t size = RoundUp(GetSlotNum(n) * sizeof(HashSlot<KEY, IDX>), kWorkspaceAlignSize);
+    if (n >= kMinPartitionedElemCnt) {
+      size += RoundUp(n * sizeof(KEY), kWorkspaceAlignSize);
+      size += RoundUp(n * sizeof(IDX), kWorkspaceAlignSize);
+    }
+    return size;
+  }
+
+  UniqueWorkspace(int64_t n, void* workspace, int64_t workspace_size_in_bytes)
+      : slots(nullptr), partitioned_keys(nullptr), partitioned_positions(nullptr) {
+    CHECK_GE(workspace_size_in_bytes, SizeInBytes(n));
+    // slots are picked by 32 bits of the hash
+    CHECK_LE(GetSlotNum(n), int64_t(1) << 32);
+    char* ptr = static_cast<char*>(workspace);
+    slots = reinterpret_cast<HashSlot<KEY, IDX>*>(ptr);
+    if (n < kMinPartitionedElemCnt) { return; }
+    ptr += RoundUp(GetSlotNum(n) * sizeof(HashSlot<KEY, IDX>), kWorkspaceAlignSize);
+    partitioned_keys = reinterpret_cast<KEY*>(ptr);
+    ptr += RoundUp(n * sizeof(KEY), kWorkspaceAlignSize);
+    partitioned_positions = reinterpret_cast<IDX*>(ptr);
+  }
+};
+
+template<typename KEY>
+uint64_t HashKey(KEY key) {
+  // +0.0 and -0.0 are the same key
+  if (key == static_cast<KEY>(0)) { key = 0; }
+  uint64_t hash = 0;
+  std::memcpy(&hash, &key, sizeof(KEY));
+  // the finalizer of murmur3, so that every bit of the key affects the high bits probed from
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb3f97a87d6b9ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+template<typename KEY, typename IDX>
+HashSlot<KEY, IDX>* FindSlot(HashSlot<KEY, IDX>* slots, int64_t slot_num, KEY key) {
+  // maps the high bits of the hash onto [0, slot_num), slot_num needs not be a power of 2
+  int64_t slot_id = static_cast<int64_t>(((HashKey(key) >> 32) * slot_num) >> 32);
+  while (slots[slot_id].idx >= 0 && !(slots[slot_id].key == key)) {
+    if (++slot_id == slot_num) { slot_id = 0; }
+  }
+  return &slots[slot_id];
+}
+
+// Makes keys[0, n) unique in the open addressing table slots[0, max_slot_num), in the order the
+// keys first occur. The i-th key is the input at position positions[i], or at i if positions is
+// nullptr. unique_out may be keys itself: a unique key is written no further than it is read.
+// The table starts small and is rebuilt from unique_out twice as big whenever it gets half full,
+// so that inputs with many repeated keys probe a table fitting the cache.
+template<typename KEY, typename IDX>
+IDX UniqueByHashTable(int64_t n, const KEY* keys, const IDX* positions, HashSlot<KEY, IDX>* slots,
+                      int64_t max_slot_num, KEY* unique_out, IDX* idx_out, IDX* count) {
+  int64_t slot_num = std::min(max_slot_num, kMinSlotNum);
+  FOR_RANGE(int64_t, i, 0, slot_num) { slots[i].idx = -1; }
+  IDX unique_num = 0;
+  FOR_RANGE(int64_t, i, 0, n) {
+    const KEY key = keys[i];
+    HashSlot<KEY, IDX>* slot = FindSlot(slots, slot_num, key);
+    if (slot->idx < 0) {
+      slot->key = key;
+      slot->idx = unique_num;
+      unique_out[unique_num] = key;
+      if (count != nullptr) { count[unique_num] = 0; }
+      ++unique_num;
+      if (2 * unique_num > slot_num && slot_num < max_slot_num) {
+        slot_num = std::min(max_slot_num, 2 * slot_num);
+        FOR_RANGE(int64_t, j, 0, slot_num) { slots[j].idx = -1; }
+        FOR_RANGE(IDX, idx, 0, unique_num) {
+          HashSlot<KEY, IDX>* new_slot = FindSlot(slots, slot_num, unique_out[idx]);
+          new_slot->key = unique_out[idx];
+          new_slot->idx = idx;
+        }
+        slot = FindSlot(slots, slot_num, key);
+      }
+    }
+    idx_out[positions == nullptr ? i : positions[i]] = slot->idx;
+    if (count != nullptr) { ++count[slot->idx]; }
+  }
+  return unique_num;
+}
+
+void ParallelForIfPossible(int64_t num, const std::function<void(int64_t, int64_t)>& Handler) {
+  if (Global<ThreadPool>::Get() == nullptr) {
+    Handler(0, num);
+  } else {
+    ParallelFor(0, num, 1, Handler);
+  }
+}
+
+// The keys are scattered into partitions by hash, so that every key occurs in one partition
+// only. Each partition is then made unique in its own share of the table and finally given its
+// range of the output. The partition count does not depend on the thread count, which keeps
+// the output order the same on any machine.
+template<typename KEY, typename IDX>
+void PartitionedUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                                 IDX* idx_out, IDX* count,
+                                 const UniqueWorkspace<KEY, IDX>& workspace) {
+  const auto PartitionId = [](KEY key) -> int64_t { return HashKey(key) % kPartitionNum; };
+  const BalancedSplitter chunk_splitter(n, kScatterChunkNum);
+  // the number of keys of every chunk in every partition, then where they are scattered to
+  std::vector<int64_t> chunk_partition_offsets(kScatterChunkNum * kPartitionNum, 0);
+  ParallelForIfPossible(kScatterChunkNum, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, chunk_id, begin, end) {
+      int64_t* offsets = chunk_partition_offsets.data() + chunk_id * kPartitionNum;
+      const Range range = chunk_splitter.At(chunk_id);
+      FOR_RANGE(int64_t, i, range.begin(), range.end()) { ++offsets[PartitionId(in[i])]; }
+    }
+  });
+  std::vector<int64_t> partition_offsets(kPartitionNum + 1, 0);
+  FOR_RANGE(int64_t, partition_id, 0, kPartitionNum) {
+    int64_t offset = partition_offsets[partition_id];
+    FOR_RANGE(int64_t, chunk_id, 0, kScatterChunkNum) {
+      int64_t* chunk_partition_offset =
+          &chunk_partition_offsets[chunk_id * kPartitionNum + partition_id];
+      const int64_t key_cnt = *chunk_partition_offset;
+      *chunk_partition_offset = offset;
+      offset += key_cnt;
+    }
+    partition_offsets[partition_id + 1] = offset;
+  }
+  ParallelForIfPossible(kScatterChunkNum, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, chunk_id, begin, end) {
+      int64_t* offsets = chunk_partition_offsets.data() + chunk_id * kPartitionNum;
+      const Range range = chunk_splitter.At(chunk_id);
+      FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+        const int64_t dst = offsets[PartitionId(in[i])]++;
+        workspace.partitioned_keys[dst] = in[i];
+        workspace.partitioned_positions[dst] = i;
+      }
+    }
+  });
+  // the unique keys of a partition are compacted at the front of its keys, idx_out is local
+  std::vector<int64_t> partition_unique_nums(kPartitionNum);
+  ParallelForIfPossible(kPartitionNum, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, partition_id, begin, end) {
+      const int64_t offset = partition_offsets[partition_id];
+      const int64_t key_cnt = partition_offsets[partition_id + 1] - offset;
+      KEY* keys = workspace.partitioned_keys + offset;
+      partition_unique_nums[partition_id] = UniqueByHashTable<KEY, IDX>(
+          key_cnt, keys, workspace.partitioned_positions + offset,
+          workspace.slots + GetSlotNum(offset), GetSlotNum(key_cnt), keys, idx_out, nullptr);
+    }
+  });
+  std::vector<int64_t> partition_unique_offsets(kPartitionNum + 1, 0);
+  FOR_RANGE(int64_t, partition_id, 0, kPartitionNum) {
+    partition_unique_offsets[partition_id + 1] =
+        partition_unique_offsets[partition_id] + partition_unique_nums[partition_id];
+  }
+  *num_unique = partition_unique_offsets.back();
+  ParallelForIfPossible(kPartitionNum, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, partition_id, begin, end) {
+      const int64_t offset = partition_offsets[partition_id];
+      const int64_t key_cnt = partition_offsets[partition_id + 1] - offset;
+      const int64_t unique_offset = partition_unique_offsets[partition_id];
+      const int64_t unique_num = partition_unique_nums[partition_id];
+      std::copy_n(workspace.partitioned_keys + offset, unique_num, unique_out + unique_offset);
+      if (count != nullptr) { std::fill_n(count + unique_offset, unique_num, 0); }
+      FOR_RANGE(int64_t, i, offset, offset + key_cnt) {
+        const IDX position = workspace.partitioned_positions[i];
+        const IDX idx = idx_out[position] + unique_offset;
+        idx_out[position] = idx;
+        if (count != nullptr) { ++count[idx]; }
+      }
+    }
+  });
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -27,31 +230,22 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
+    const UniqueWorkspace<KEY, IDX> unique_workspace(n, workspace, workspace_size_in_bytes);
+    if (n >= kMinPartitionedElemCnt) {
+      PartitionedUniqueWithCounts<KEY, IDX>(n, in, num_unique, unique_out, idx_out, count,
+                                            unique_workspace);
+    } else {
+      *num_unique = UniqueByHashTable<KEY, IDX>(n, in, nullptr, unique_workspace.slots,
+                                                GetSlotNum(n), unique_out, idx_out, count);
     }
-    *num_unique = map.size();
   }
   static void GetUniqueWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = std::max<int64_t>(UniqueWorkspace<KEY, IDX>::SizeInBytes(n), 1);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = std::max<int64_t>(UniqueWorkspace<KEY, IDX>::SizeInBytes(n), 1);
   }
 };
 
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// ids drawn from a zipf distribution over the vocabulary, as the ids of sparse embeddings
+std::vector<int64_t> ZipfIds(int64_t n, int64_t vocab_size, double exponent) {
+  std::vector<double> weights(vocab_size);
+  FOR_RANGE(int64_t, i, 0, vocab_size) { weights[i] = 1 / std::pow(i + 1, exponent); }
+  std::discrete_distribution<int64_t> dis(weights.begin(), weights.end());
+  std::mt19937 gen(0);
+  // scatters the frequent ids over the key space
+  const int64_t stride = 2654435761LL;
+  std::vector<int64_t> ids(n);
+  for (int64_t& id : ids) { id = dis(gen) * stride; }
+  return ids;
+}
+
+template<typename KEY, typename IDX>
+class UniqueWithCountsResult final {
+ public:
+  explicit UniqueWithCountsResult(const std::vector<KEY>& in)
+      : num_unique_(0), unique_out_(in.size()), idx_out_(in.size()), count_(in.size()) {
+    int64_t workspace_size_in_bytes = 0;
+    UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::GetUniqueWithCountsWorkspaceSizeInBytes(
+        nullptr, in.size(), &workspace_size_in_bytes);
+    workspace_.resize(workspace_size_in_bytes);
+    UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::UniqueWithCounts(
+        nullptr, in.size(), in.data(), &num_unique_, unique_out_.data(), idx_out_.data(),
+        count_.data(), workspace_.data(), workspace_size_in_bytes);
+  }
+
+  void Check(const std::vector<KEY>& in) const {
+    HashMap<KEY, IDX> key2count;
+    for (KEY key : in) { key2count[key] += 1; }
+    ASSERT_EQ(num_unique_, key2count.size());
+    FOR_RANGE(size_t, i, 0, in.size()) {
+      ASSERT_GE(idx_out_[i], 0);
+      ASSERT_LT(idx_out_[i], num_unique_);
+      ASSERT_EQ(unique_out_[idx_out_[i]], in[i]);
+    }
+    FOR_RANGE(IDX, i, 0, num_unique_) {
+      ASSERT_EQ(count_[i], key2count.at(unique_out_[i]));
+      key2count.erase(unique_out_[i]);
+    }
+    ASSERT_TRUE(key2count.empty());
+  }
+
+ private:
+  IDX num_unique_;
+  std::vector<KEY> unique_out_;
+  std::vector<IDX> idx_out_;
+  std::vector<IDX> count_;
+  std::vector<char> workspace_;
+};
+
+class UniqueKernelUtilTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(UniqueKernelUtilTest, unique_with_counts) {
+  const std::vector<int32_t> small_in = {3, -1, 3, 7, 0, -1, 3};
+  UniqueWithCountsResult<int32_t, int32_t> small_result(small_in);
+  small_result.Check(small_in);
+  // the unique keys keep the order they first occur in
+  const std::vector<float> float_in = {2.5, 0, 1, 2.5, 1};
+  UniqueWithCountsResult<float, int64_t> float_result(float_in);
+  float_result.Check(float_in);
+  for (int64_t n : {1000, 100000}) {
+    const std::vector<int64_t> ids = ZipfIds(n, n, 1.05);
+    UniqueWithCountsResult<int64_t, int32_t> result(ids);
+    result.Check(ids);
+  }
+  const std::vector<int64_t> empty_in;
+  UniqueWithCountsResult<int64_t, int64_t> empty_result(empty_in);
+  empty_result.Check(empty_in);
+}
+
+}  // namespace oneflow
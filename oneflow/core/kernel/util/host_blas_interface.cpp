@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/kernel/util/host_blas_interface.h"
 #include "oneflow/core/register/blob.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -52,18 +54,95 @@ static void AxpyImpl(DeviceCtx* ctx, const int n, const T alpha, const T* x, con
   }
 }
 
+#ifdef WITH_MKL
+void CblasGemmBatch(const enum CBLAS_ORDER order, enum CBLAS_TRANSPOSE trans_a,
+                    enum CBLAS_TRANSPOSE trans_b, int m, int n, int k, float alpha,
+                    const float** a_array, int lda, const float** b_array, int ldb, float beta,
+                    float** c_array, int ldc, int batch_size) {
+  cblas_sgemm_batch(order, &trans_a, &trans_b, &m, &n, &k, &alpha, a_array, &lda, b_array, &ldb,
+                    &beta, c_array, &ldc, 1, &batch_size);
+}
+
+void CblasGemmBatch(const enum CBLAS_ORDER order, enum CBLAS_TRANSPOSE trans_a,
+                    enum CBLAS_TRANSPOSE trans_b, int m, int n, int k, double alpha,
+                    const double** a_array, int lda, const double** b_array, int ldb, double beta,
+                    double** c_array, int ldc, int batch_size) {
+  cblas_dgemm_batch(order, &trans_a, &trans_b, &m, &n, &k, &alpha, a_array, &lda, b_array, &ldb,
+                    &beta, c_array, &ldc, 1, &batch_size);
+}
+#endif  // WITH_MKL
+
+// fewer rows than this are not worth a gemm call of their own
+constexpr int kMinRowsPerGemmPart = 16;
+constexpr int64_t kMinFlopsPerTask = 1 << 22;
+
 template<typename T>
 void BatchedGemmImpl(DeviceCtx* ctx, const enum CBLAS_ORDER order,
                      const enum CBLAS_TRANSPOSE trans_a, const enum CBLAS_TRANSPOSE trans_b,
                      int batch_size, int m, int n, int k, const T alpha, const T* a, const T* b,
                      const T beta, T* c, T** buf) {
-  const int a_stride = m * k;
-  const int b_stride = k * n;
-  const int c_stride = m * n;
-  FOR_RANGE(int32_t, i, 0, batch_size) {
-    BlasIf<DeviceType::kCPU>::OFGemm(ctx, trans_a, trans_b, m, n, k, alpha, a + i * a_stride,
-                                     b + i * b_stride, beta, c + i * c_stride);
+  const int64_t a_stride = static_cast<int64_t>(m) * k;
+  const int64_t b_stride = static_cast<int64_t>(k) * n;
+  const int64_t c_stride = static_cast<int64_t>(m) * n;
+  const int lda = (trans_a == CblasNoTrans) ? k : m;
+  const int ldb = (trans_b == CblasNoTrans) ? n : k;
+  const int ldc = n;
+  const auto& RunMatrices = [&](int64_t begin, int64_t end) {
+#ifdef WITH_MKL
+    std::vector<const T*> a_array(end - begin);
+    std::vector<const T*> b_array(end - begin);
+    std::vector<T*> c_array(end - begin);
+    FOR_RANGE(int64_t, i, begin, end) {
+      a_array[i - begin] = a + i * a_stride;
+      b_array[i - begin] = b + i * b_stride;
+      c_array[i - begin] = c + i * c_stride;
+    }
+    CblasGemmBatch(order, trans_a, trans_b, m, n, k, alpha, a_array.data(), lda, b_array.data(),
+                   ldb, beta, c_array.data(), ldc, end - begin);
+#else
+    FOR_RANGE(int64_t, i, begin, end) {
+      cblas_gemm<T>(order, trans_a, trans_b, m, n, k, alpha, a + i * a_stride, lda,
+                    b + i * b_stride, ldb, beta, c + i * c_stride, ldc);
+    }
+#endif  // WITH_MKL
+  };
+#ifdef WITH_SEQUENTIAL_BLAS
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  const int thread_num = thread_pool == nullptr ? 1 : thread_pool->thread_num();
+  // a batch as big as the pool runs a gemm per task, a smaller one has its gemms split by rows
+  // of c so that every thread gets work
+  const int parts_to_fill_pool = (thread_num + batch_size - 1) / std::max(batch_size, 1);
+  const int part_num = std::max(1, std::min(parts_to_fill_pool, m / kMinRowsPerGemmPart));
+  const BalancedSplitter row_splitter(m, part_num);
+  const int64_t flops_per_part = 2 * (static_cast<int64_t>(m) / part_num) * n * k;
+  const auto& RunParts = [&](int64_t begin, int64_t end) {
+    if (part_num == 1) {
+      RunMatrices(begin, end);
+      return;
+    }
+    FOR_RANGE(int64_t, i, begin, end) {
+      const int64_t batch_id = i / part_num;
+      const Range rows = row_splitter.At(i % part_num);
+      const int64_t a_row_stride = (trans_a == CblasNoTrans) ? lda : 1;
+      const T* part_a = a + batch_id * a_stride + rows.begin() * a_row_stride;
+      cblas_gemm<T>(order, trans_a, trans_b, rows.size(), n, k, alpha, part_a, lda,
+                    b + batch_id * b_stride, ldb, beta,
+                    c + batch_id * c_stride + rows.begin() * ldc, ldc);
+    }
+  };
+  const int64_t part_cnt = static_cast<int64_t>(batch_size) * part_num;
+  const int64_t grain =
+      std::max<int64_t>(1, kMinFlopsPerTask / std::max<int64_t>(flops_per_part, 1));
+  if (thread_num == 1 || part_cnt <= grain) {
+    RunParts(0, part_cnt);
+  } else {
+    ParallelFor(0, part_cnt, grain, RunParts);
   }
+#else
+  // the blas runs a gemm on threads of its own, gemms called from tasks of the pool in parallel
+  // would oversubscribe the cpu
+  RunMatrices(0, batch_size);
+#endif  // WITH_SEQUENTIAL_BLAS
 }
 
 }  // namespace
@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_blas_interface.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+void NaiveBatchedGemm(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, int batch_size,
+                      int m, int n, int k, T alpha, const T* a, const T* b, T beta, T* c) {
+  FOR_RANGE(int, batch_id, 0, batch_size) {
+    const T* a_i = a + batch_id * m * k;
+    const T* b_i = b + batch_id * k * n;
+    T* c_i = c + batch_id * m * n;
+    FOR_RANGE(int, row, 0, m) {
+      FOR_RANGE(int, col, 0, n) {
+        T sum = 0;
+        FOR_RANGE(int, l, 0, k) {
+          const T a_val = trans_a == CblasNoTrans ? a_i[row * k + l] : a_i[l * m + row];
+          const T b_val = trans_b == CblasNoTrans ? b_i[l * n + col] : b_i[col * k + l];
+          sum += a_val * b_val;
+        }
+        c_i[row * n + col] = alpha * sum + beta * c_i[row * n + col];
+      }
+    }
+  }
+}
+
+void CheckBatchedGemm(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, int batch_size,
+                      int m, int n, int k) {
+  const std::vector<double> a = test::RandomVector<double>(batch_size * m * k);
+  const std::vector<double> b = test::RandomVector<double>(batch_size * k * n);
+  std::vector<double> c = test::RandomVector<double>(batch_size * m * n);
+  std::vector<double> ref_c = c;
+  BlasIf<DeviceType::kCPU>::OFBatchedGemm(nullptr, trans_a, trans_b, batch_size, m, n, k, 0.5,
+                                          a.data(), b.data(), 2, c.data(), nullptr);
+  NaiveBatchedGemm<double>(trans_a, trans_b, batch_size, m, n, k, 0.5, a.data(), b.data(), 2,
+                           ref_c.data());
+  FOR_RANGE(size_t, i, 0, c.size()) { ASSERT_NEAR(c[i], ref_c[i], 1e-9); }
+}
+
+class HostBatchedGemmTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(HostBatchedGemmTest, matches_naive_gemm) {
+  for (auto trans_a : {CblasNoTrans, CblasTrans}) {
+    for (auto trans_b : {CblasNoTrans, CblasTrans}) {
+      CheckBatchedGemm(trans_a, trans_b, 37, 5, 7, 3);
+      CheckBatchedGemm(trans_a, trans_b, 3, 70, 9, 11);
+      CheckBatchedGemm(trans_a, trans_b, 1, 129, 33, 17);
+      CheckBatchedGemm(trans_a, trans_b, 2, 1, 40, 8);
+    }
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,326 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include "oneflow/core/common/shape_vec.h"
+#include "oneflow/core/thread/thread_manager.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace oneflow {
+
+namespace {
+
+// elements on a side of a tile, a tile of 8 byte elements and its destination fit the L1 cache
+constexpr int64_t kTileSize = 32;
+// bigger elements are copied one by one, tiling them gains nothing
+constexpr size_t kMaxTiledElemSize = 64;
+constexpr int64_t kMinBytesPerTask = 128 * 1024;
+
+struct TransposeParam {
+  size_t elem_size;
+  // of x
+  DimVector dims;
+  std::vector<int32_t> permutation;
+};
+
+TransposeParam SimplifyTransposeParam(int32_t num_axis, const int64_t* x_dims,
+                                      const int32_t* permutation, size_t elem_size) {
+  std::vector<int32_t> x_axis2kept_axis(num_axis, -1);
+  DimVector kept_dims;
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    if (x_dims[i] == 1) { continue; }
+    x_axis2kept_axis[i] = kept_dims.size();
+    kept_dims.push_back(x_dims[i]);
+  }
+  // the kept x axes in y order, grouped into ranges of x axes staying adjacent in y
+  std::vector<std::pair<int32_t, int32_t>> groups;
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    const int32_t kept_axis = x_axis2kept_axis[permutation[i]];
+    if (kept_axis < 0) { continue; }
+    if (!groups.empty() && groups.back().second + 1 == kept_axis) {
+      groups.back().second = kept_axis;
+    } else {
+      groups.emplace_back(kept_axis, kept_axis);
+    }
+  }
+  std::vector<int32_t> x_order(groups.size());
+  std::iota(x_order.begin(), x_order.end(), 0);
+  std::sort(x_order.begin(), x_order.end(),
+            [&](int32_t lhs, int32_t rhs) { return groups[lhs].first < groups[rhs].first; });
+  std::vector<int32_t> group2x_axis(groups.size());
+  TransposeParam param;
+  param.elem_size = elem_size;
+  FOR_RANGE(int32_t, i, 0, x_order.size()) {
+    const auto& group = groups[x_order[i]];
+    group2x_axis[x_order[i]] = i;
+    int64_t dim = 1;
+    FOR_RANGE(int32_t, kept_axis, group.first, group.second + 1) { dim *= kept_dims[kept_axis]; }
+    param.dims.push_back(dim);
+  }
+  FOR_RANGE(int32_t, i, 0, groups.size()) { param.permutation.push_back(group2x_axis[i]); }
+  if (!param.dims.empty() && param.permutation.back() + 1 == param.dims.size()) {
+    param.elem_size *= param.dims.back();
+    param.dims.pop_back();
+    param.permutation.pop_back();
+  }
+  return param;
+}
+
+// Offsets in x and y, in elements, of the positions of some axes visited in row major order
+class OffsetWalker final {
+ public:
+  OffsetWalker(const DimVector& dims, const DimVector& x_strides, const DimVector& y_strides)
+      : dims_(dims), x_strides_(x_strides), y_strides_(y_strides), index_(dims.size()) {}
+
+  void Reset(int64_t pos) {
+    x_offset_ = 0;
+    y_offset_ = 0;
+    for (int32_t i = dims_.size() - 1; i >= 0; --i) {
+      index_[i] = pos % dims_[i];
+      pos /= dims_[i];
+      x_offset_ += index_[i] * x_strides_[i];
+      y_offset_ += index_[i] * y_strides_[i];
+    }
+  }
+  void Next() {
+    for (int32_t i = dims_.size() - 1; i >= 0; --i) {
+      x_offset_ += x_strides_[i];
+      y_offset_ += y_strides_[i];
+      if (++index_[i] < dims_[i]) { return; }
+      index_[i] = 0;
+      x_offset_ -= dims_[i] * x_strides_[i];
+      y_offset_ -= dims_[i] * y_strides_[i];
+    }
+  }
+  int64_t x_offset() const { return x_offset_; }
+  int64_t y_offset() const { return y_offset_; }
+
+ private:
+  const DimVector& dims_;
+  const DimVector& x_strides_;
+  const DimVector& y_strides_;
+  DimVector index_;
+  int64_t x_offset_;
+  int64_t y_offset_;
+};
+
+template<size_t elem_size>
+struct MicroBlock {
+  static constexpr int64_t kSize = 1;
+  static void Transpose(const char* x, int64_t x_ld, char* y, int64_t y_ld) {
+    std::memcpy(y, x, elem_size);
+  }
+};
+
+#if defined(__SSE2__)
+
+template<>
+struct MicroBlock<4> {
+  static constexpr int64_t kSize = 4;
+  static void Transpose(const char* x, int64_t x_ld, char* y, int64_t y_ld) {
+    const __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+    const __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + x_ld));
+    const __m128i row2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + 2 * x_ld));
+    const __m128i row3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + 3 * x_ld));
+    const __m128i lo01 = _mm_unpacklo_epi32(row0, row1);
+    const __m128i lo23 = _mm_unpacklo_epi32(row2, row3);
+    const __m128i hi01 = _mm_unpackhi_epi32(row0, row1);
+    const __m128i hi23 = _mm_unpackhi_epi32(row2, row3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y), _mm_unpacklo_epi64(lo01, lo23));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + y_ld), _mm_unpackhi_epi64(lo01, lo23));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + 2 * y_ld), _mm_unpacklo_epi64(hi01, hi23));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + 3 * y_ld), _mm_unpackhi_epi64(hi01, hi23));
+  }
+};
+
+template<>
+struct MicroBlock<8> {
+  static constexpr int64_t kSize = 2;
+  static void Transpose(const char* x, int64_t x_ld, char* y, int64_t y_ld) {
+    const __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+    const __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + x_ld));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y), _mm_unpacklo_epi64(row0, row1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + y_ld), _mm_unpackhi_epi64(row0, row1));
+  }
+};
+
+#endif
+
+// Writes the cols x rows transpose of a rows x cols tile. Leading dimensions are in bytes.
+template<size_t elem_size>
+void TransposeTile(size_t, const char* x, int64_t x_ld, char* y, int64_t y_ld, int64_t rows,
+                   int64_t cols) {
+  constexpr int64_t kSize = MicroBlock<elem_size>::kSize;
+  const int64_t block_rows = rows / kSize * kSize;
+  const int64_t block_cols = cols / kSize * kSize;
+  for (int64_t c = 0; c < block_cols; c += kSize) {
+    for (int64_t r = 0; r < block_rows; r += kSize) {
+      MicroBlock<elem_size>::Transpose(x + r * x_ld + c * elem_size, x_ld,
+                                       y + c * y_ld + r * elem_size, y_ld);
+    }
+  }
+  for (int64_t c = 0; c < cols; ++c) {
+    const int64_t r_begin = c < block_cols ? block_rows : 0;
+    for (int64_t r = r_begin; r < rows; ++r) {
+      std::memcpy(y + c * y_ld + r * elem_size, x + r * x_ld + c * elem_size, elem_size);
+    }
+  }
+}
+
+void TransposeTileOfAnyElemSize(size_t elem_size, const char* x, int64_t x_ld, char* y,
+                                int64_t y_ld, int64_t rows, int64_t cols) {
+  for (int64_t c = 0; c < cols; ++c) {
+    for (int64_t r = 0; r < rows; ++r) {
+      std::memcpy(y + c * y_ld + r * elem_size, x + r * x_ld + c * elem_size, elem_size);
+    }
+  }
+}
+
+using TransposeTileFn = void (*)(size_t, const char*, int64_t, char*, int64_t, int64_t, int64_t);
+
+TransposeTileFn GetTransposeTileFn(size_t elem_size) {
+  switch (elem_size) {
+    case 1: return &TransposeTile<1>;
+    case 2: return &TransposeTile<2>;
+    case 4: return &TransposeTile<4>;
+    case 8: return &TransposeTile<8>;
+    case 16: return &TransposeTile<16>;
+    default: return &TransposeTileOfAnyElemSize;
+  }
+}
+
+void ForEachChunk(int64_t unit_num, int64_t unit_bytes,
+                  const std::function<void(int64_t begin, int64_t end)>& Handler) {
+  const int64_t grain = std::max<int64_t>(1, kMinBytesPerTask / std::max<int64_t>(unit_bytes, 1));
+  // small transposes are not worth waking the workers up
+  if (unit_num <= grain || Global<ThreadPool>::Get() == nullptr) {
+    Handler(0, unit_num);
+  } else {
+    ParallelFor(0, unit_num, grain, Handler);
+  }
+}
+
+void CopyElemByElem(const TransposeParam& param, const DimVector& y_dims,
+                    const DimVector& x_strides_in_y_order, const char* x, char* y) {
+  const size_t elem_size = param.elem_size;
+  DimVector y_strides(y_dims.size());
+  int64_t elem_cnt = 1;
+  for (int32_t i = y_dims.size() - 1; i >= 0; --i) {
+    y_strides[i] = elem_cnt;
+    elem_cnt *= y_dims[i];
+  }
+  ForEachChunk(elem_cnt, elem_size, [&](int64_t begin, int64_t end) {
+    OffsetWalker walker(y_dims, x_strides_in_y_order, y_strides);
+    walker.Reset(begin);
+    FOR_RANGE(int64_t, i, begin, end) {
+      std::memcpy(y + i * elem_size, x + walker.x_offset() * elem_size, elem_size);
+      walker.Next();
+    }
+  });
+}
+
+// The innermost axis a of x becomes a column of y, the innermost axis b of y is a column of x.
+// Every position of the other (batch) axes holds a dims[b] x dims[a] matrix to transpose.
+void TransposeByTiles(const TransposeParam& param, const DimVector& x_strides,
+                      const DimVector& x_axis2y_stride, const char* x, char* y) {
+  const size_t elem_size = param.elem_size;
+  const int32_t num_axis = param.dims.size();
+  const int32_t a = num_axis - 1;
+  const int32_t b = param.permutation.back();
+  const int64_t rows = param.dims[b];
+  const int64_t cols = param.dims[a];
+  const int64_t x_ld = x_strides[b] * elem_size;
+  const int64_t y_ld = x_axis2y_stride[a] * elem_size;
+  DimVector batch_dims;
+  DimVector batch_x_strides;
+  DimVector batch_y_strides;
+  int64_t batch_num = 1;
+  for (int32_t x_axis : param.permutation) {
+    if (x_axis == a || x_axis == b) { continue; }
+    batch_dims.push_back(param.dims[x_axis]);
+    batch_x_strides.push_back(x_strides[x_axis]);
+    batch_y_strides.push_back(x_axis2y_stride[x_axis]);
+    batch_num *= param.dims[x_axis];
+  }
+  const TransposeTileFn TransposeTileOfElemSize = GetTransposeTileFn(elem_size);
+  const int64_t row_tile_num = RoundUp(rows, kTileSize) / kTileSize;
+  ForEachChunk(batch_num * row_tile_num, kTileSize * cols * elem_size,
+               [&](int64_t begin, int64_t end) {
+                 OffsetWalker batch_walker(batch_dims, batch_x_strides, batch_y_strides);
+                 batch_walker.Reset(begin / row_tile_num);
+                 int64_t row_tile = begin % row_tile_num;
+                 FOR_RANGE(int64_t, i, begin, end) {
+                   const int64_t r = row_tile * kTileSize;
+                   const int64_t tile_rows = std::min(kTileSize, rows - r);
+                   const char* x_rows = x + batch_walker.x_offset() * elem_size + r * x_ld;
+                   char* y_rows = y + batch_walker.y_offset() * elem_size + r * elem_size;
+                   for (int64_t c = 0; c < cols; c += kTileSize) {
+                     TransposeTileOfElemSize(elem_size, x_rows + c * elem_size, x_ld,
+                                             y_rows + c * y_ld, y_ld, tile_rows,
+                                             std::min(kTileSize, cols - c));
+                   }
+                   if (++row_tile == row_tile_num) {
+                     row_tile = 0;
+                     batch_walker.Next();
+                   }
+                 }
+               });
+}
+
+}  // namespace
+
+void HostTranspose(int32_t num_axis, const int64_t* x_dims, const int32_t* permutation,
+                   size_t elem_size, const void* x, void* y) {
+  int64_t elem_cnt = 1;
+  FOR_RANGE(int32_t, i, 0, num_axis) { elem_cnt *= x_dims[i]; }
+  if (elem_cnt == 0) { return; }
+  const TransposeParam param = SimplifyTransposeParam(num_axis, x_dims, permutation, elem_size);
+  const char* x_bytes = static_cast<const char*>(x);
+  char* y_bytes = static_cast<char*>(y);
+  if (param.dims.empty()) {
+    const int64_t byte_cnt = param.elem_size;
+    ForEachChunk(byte_cnt, 1, [&](int64_t begin, int64_t end) {
+      std::memcpy(y_bytes + begin, x_bytes + begin, end - begin);
+    });
+    return;
+  }
+  const int32_t simplified_num_axis = param.dims.size();
+  DimVector x_strides(simplified_num_axis);
+  int64_t stride = 1;
+  for (int32_t i = simplified_num_axis - 1; i >= 0; --i) {
+    x_strides[i] = stride;
+    stride *= param.dims[i];
+  }
+  DimVector y_dims(simplified_num_axis);
+  DimVector x_strides_in_y_order(simplified_num_axis);
+  DimVector x_axis2y_stride(simplified_num_axis);
+  stride = 1;
+  for (int32_t i = simplified_num_axis - 1; i >= 0; --i) {
+    const int32_t x_axis = param.permutation[i];
+    y_dims[i] = param.dims[x_axis];
+    x_strides_in_y_order[i] = x_strides[x_axis];
+    x_axis2y_stride[x_axis] = stride;
+    stride *= y_dims[i];
+  }
+  if (param.elem_size > kMaxTiledElemSize) {
+    CopyElemByElem(param, y_dims, x_strides_in_y_order, x_bytes, y_bytes);
+  } else {
+    TransposeByTiles(param, x_strides, x_axis2y_stride, x_bytes, y_bytes);
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,33 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+#define ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Writes to y the x of shape x_dims transposed so that axis i of y is axis permutation[i] of x.
+// Elements are moved as elem_size raw bytes. Size 1 axes are dropped and axes staying adjacent
+// are merged first; an unpermuted innermost axis is then folded into the elements. What is left
+// is moved in cache sized 2d tiles of the innermost axes of x and y, in parallel over the tiles
+// of the compute thread pool.
+void HostTranspose(int32_t num_axis, const int64_t* x_dims, const int32_t* permutation,
+                   size_t elem_size, const void* x, void* y);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// moves the elements one by one in x order
+void NaiveTranspose(const std::vector<int64_t>& x_dims, const std::vector<int32_t>& permutation,
+                    size_t elem_size, const char* x, char* y) {
+  const int32_t num_axis = x_dims.size();
+  std::vector<int64_t> x_axis2y_stride(num_axis);
+  int64_t elem_cnt = 1;
+  for (int32_t i = num_axis - 1; i >= 0; --i) {
+    x_axis2y_stride[permutation[i]] = elem_cnt;
+    elem_cnt *= x_dims[permutation[i]];
+  }
+  std::vector<int64_t> x_index(num_axis, 0);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    int64_t y_offset = 0;
+    FOR_RANGE(int32_t, axis, 0, num_axis) { y_offset += x_index[axis] * x_axis2y_stride[axis]; }
+    std::memcpy(y + y_offset * elem_size, x + i * elem_size, elem_size);
+    for (int32_t axis = num_axis - 1; axis >= 0; --axis) {
+      if (++x_index[axis] < x_dims[axis]) { break; }
+      x_index[axis] = 0;
+    }
+  }
+}
+
+int64_t ElemCnt(const std::vector<int64_t>& dims) {
+  return std::accumulate(dims.begin(), dims.end(), int64_t(1), std::multiplies<int64_t>());
+}
+
+void CheckTranspose(const std::vector<int64_t>& x_dims, const std::vector<int32_t>& permutation,
+                    size_t elem_size) {
+  const int64_t byte_cnt = ElemCnt(x_dims) * elem_size;
+  std::vector<char> x(byte_cnt);
+  FOR_RANGE(int64_t, i, 0, byte_cnt) { x[i] = static_cast<char>(i * 7 + i / 251); }
+  std::vector<char> y(byte_cnt);
+  std::vector<char> ref_y(byte_cnt);
+  HostTranspose(x_dims.size(), x_dims.data(), permutation.data(), elem_size, x.data(), y.data());
+  NaiveTranspose(x_dims, permutation, elem_size, x.data(), ref_y.data());
+  ASSERT_TRUE(y == ref_y);
+}
+
+class HostTransposeTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(HostTransposeTest, matches_naive_transpose) {
+  for (size_t elem_size : {1, 2, 4, 8, 12, 16, 128}) {
+    CheckTranspose({67, 45}, {1, 0}, elem_size);
+    CheckTranspose({3, 5, 7}, {0, 2, 1}, elem_size);
+    CheckTranspose({4, 17, 9, 6}, {0, 2, 3, 1}, elem_size);
+    CheckTranspose({4, 6, 17, 9}, {0, 3, 1, 2}, elem_size);
+    CheckTranspose({2, 33, 5, 70}, {0, 2, 1, 3}, elem_size);
+    CheckTranspose({3, 1, 4, 1, 5}, {4, 3, 2, 1, 0}, elem_size);
+    CheckTranspose({2, 3, 4, 5}, {0, 1, 2, 3}, elem_size);
+    CheckTranspose({6, 1, 7}, {1, 0, 2}, elem_size);
+    CheckTranspose({4, 0, 3}, {2, 1, 0}, elem_size);
+  }
+}
+
+TEST_F(HostTransposeTest, matches_naive_transpose_in_parallel) {
+  CheckTranspose({8, 64, 56, 56}, {0, 2, 3, 1}, 4);
+  CheckTranspose({8, 56, 56, 64}, {0, 3, 1, 2}, 4);
+  CheckTranspose({1000, 999}, {1, 0}, 8);
+  CheckTranspose({16, 128, 12, 64}, {0, 2, 1, 3}, 4);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_UTIL_TEST_UTIL_H_
+#define ONEFLOW_CORE_KERNEL_UTIL_TEST_UTIL_H_
+
+#include <random>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+namespace test {
+
+// the ParallelFor of the code under test splits its range over the threads of this pool
+class ThreadPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Global<ThreadPool>::New(4); }
+  void TearDown() override { Global<ThreadPool>::Delete(); }
+};
+
+// uniform in [offset - 1, offset + 1), the same values on every call
+template<typename T>
+std::vector<T> RandomVector(int64_t size, T offset = 0) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<T> dis(-1, 1);
+  std::vector<T> vec(size);
+  for (T& val : vec) { val = dis(gen) + offset; }
+  return vec;
+}
+
+}  // namespace test
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_UTIL_TEST_UTIL_H_
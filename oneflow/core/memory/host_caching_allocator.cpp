@@ -0,0 +1,362 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/host_caching_allocator.h"
+#include <sys/mman.h>
+#include <sstream>
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kBlockAlignBytes = 64;
+constexpr int32_t kLinearClassNum = 16;
+constexpr size_t kLinearClassMaxBytes = kLinearClassNum * kBlockAlignBytes;
+constexpr int32_t kLinearClassMaxLog2 = 10;
+constexpr int32_t kClassNumPerDoubling = 4;
+constexpr size_t kSlabBytes = 2 << 20;
+constexpr size_t kSlabHeaderBytes = kBlockAlignBytes;
+constexpr size_t kMaxSlabBlockBytes = 256 << 10;
+constexpr size_t kMaxCachedBlockBytes = 1 << 30;
+constexpr size_t kThreadCacheBytesPerClass = 256 << 10;
+constexpr int64_t kDefaultMaxCachedLargeMBytes = 4096;
+
+int32_t FloorLog2(size_t value) { return 63 ^ __builtin_clzll(value); }
+
+int32_t ClassIdx4Size(size_t size) {
+  if (size <= kLinearClassMaxBytes) {
+    return static_cast<int32_t>((std::max<size_t>(size, 1) + kBlockAlignBytes - 1)
+                                / kBlockAlignBytes)
+           - 1;
+  }
+  // size lies in (2^lg, 2^(lg + 1)], which is split into kClassNumPerDoubling classes
+  const int32_t lg = FloorLog2(size - 1);
+  const size_t step = static_cast<size_t>(1) << (lg - 2);
+  const int32_t sub = static_cast<int32_t>((size - 1 - (static_cast<size_t>(1) << lg)) / step);
+  return kLinearClassNum + (lg - kLinearClassMaxLog2) * kClassNumPerDoubling + sub;
+}
+
+size_t Size4ClassIdx(int32_t class_idx) {
+  if (class_idx < kLinearClassNum) { return (class_idx + 1) * kBlockAlignBytes; }
+  const int32_t lg = kLinearClassMaxLog2 + (class_idx - kLinearClassNum) / kClassNumPerDoubling;
+  const int32_t sub = (class_idx - kLinearClassNum) % kClassNumPerDoubling;
+  return (static_cast<size_t>(1) << lg) + (sub + 1) * (static_cast<size_t>(1) << (lg - 2));
+}
+
+// ClassIdx4Size(kMaxSlabBlockBytes) + 1 and ClassIdx4Size(kMaxCachedBlockBytes) + 1, checked in
+// the constructor
+constexpr int32_t kSlabClassNum = 48;
+constexpr int32_t kCachedClassNum = 96;
+
+// set once the thread cache of the calling thread is destroyed, blocks freed by thread_local
+// destructors running after that go straight to the shared pool
+thread_local bool is_thread_cache_destroyed = false;
+
+struct SlabHeader {
+  int32_t class_idx;
+};
+
+bool IsSlabBlock(const void* ptr) { return reinterpret_cast<uintptr_t>(ptr) % kSlabBytes != 0; }
+
+SlabHeader* SlabHeader4Block(void* ptr) {
+  return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(ptr) / kSlabBytes * kSlabBytes);
+}
+
+size_t ThreadCacheCapacity(int32_t class_idx) {
+  return std::max<size_t>(4, kThreadCacheBytesPerClass / Size4ClassIdx(class_idx));
+}
+
+void UpdatePeak(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t cur = peak->load(std::memory_order_relaxed);
+  while (value > cur && !peak->compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+}
+
+void* MapAnonymous(size_t size) {
+  return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+}
+
+int64_t EnvToInt64(const char* name, int64_t default_value) {
+  const char* value = std::getenv(name);
+  return value == nullptr ? default_value : std::atoll(value);
+}
+
+}  // namespace
+
+struct HostCachingAllocator::ThreadCache final {
+  std::vector<std::vector<void*>> class_idx2blocks;
+  ThreadCache() : class_idx2blocks(kSlabClassNum) {}
+  ~ThreadCache() {
+    is_thread_cache_destroyed = true;
+    FOR_RANGE(int32_t, class_idx, 0, kSlabClassNum) {
+      std::vector<void*>* blocks = &class_idx2blocks.at(class_idx);
+      HostCachingAllocator::Get()->ReturnToSharedPool(class_idx, blocks->size(), blocks);
+    }
+  }
+};
+
+HostCachingAllocator* HostCachingAllocator::Get() {
+  static HostCachingAllocator* allocator = new HostCachingAllocator();
+  return allocator;
+}
+
+HostCachingAllocator::HostCachingAllocator()
+    : enabled_(std::getenv("ONEFLOW_DISABLE_HOST_CACHING_ALLOCATOR") == nullptr),
+      max_cached_large_bytes_(EnvToInt64("ONEFLOW_HOST_CACHING_ALLOCATOR_MAX_CACHED_MB",
+                                         kDefaultMaxCachedLargeMBytes)
+                              << 20),
+      alloc_cnt_(0),
+      miss_cnt_(0),
+      in_use_bytes_(0),
+      peak_in_use_bytes_(0),
+      reserved_bytes_(0),
+      cached_large_bytes_(0) {
+  CHECK_EQ(ClassIdx4Size(kMaxSlabBlockBytes) + 1, kSlabClassNum);
+  CHECK_EQ(ClassIdx4Size(kMaxCachedBlockBytes) + 1, kCachedClassNum);
+  FOR_RANGE(int32_t, class_idx, 0, kCachedClassNum) {
+    const size_t size = Size4ClassIdx(class_idx);
+    CHECK_EQ(size % kBlockAlignBytes, 0);
+    CHECK_EQ(ClassIdx4Size(size), class_idx);
+    CHECK_EQ(ClassIdx4Size(size + 1), class_idx + 1);
+    size_classes_.emplace_back(new SizeClass());
+  }
+}
+
+HostCachingAllocator::ThreadCache* HostCachingAllocator::LocalThreadCache() {
+  if (is_thread_cache_destroyed) { return nullptr; }
+  static thread_local ThreadCache thread_cache;
+  return &thread_cache;
+}
+
+void* HostCachingAllocator::Allocate(size_t size, bool* is_zeroed) {
+  if (!enabled_) {
+    void* ptr = std::malloc(size);
+    CHECK_NOTNULL(ptr);
+    if (is_zeroed != nullptr) { *is_zeroed = false; }
+    return ptr;
+  }
+  alloc_cnt_.fetch_add(1, std::memory_order_relaxed);
+  bool is_fresh = false;
+  void* ptr = nullptr;
+  size_t block_size = 0;
+  if (size > kMaxCachedBlockBytes) {
+    block_size = RoundUp(size, kSlabBytes);
+    ptr = AllocateLargeBlock(-1, block_size, &is_fresh);
+  } else {
+    const int32_t class_idx = ClassIdx4Size(size);
+    block_size = Size4ClassIdx(class_idx);
+    if (class_idx < kSlabClassNum) {
+      ptr = AllocateSlabBlock(class_idx, &is_fresh);
+    } else {
+      ptr = AllocateLargeBlock(class_idx, block_size, &is_fresh);
+    }
+  }
+  if (is_fresh) { miss_cnt_.fetch_add(1, std::memory_order_relaxed); }
+  UpdatePeak(&peak_in_use_bytes_,
+             in_use_bytes_.fetch_add(block_size, std::memory_order_relaxed) + block_size);
+  if (is_zeroed != nullptr) { *is_zeroed = is_fresh; }
+  return ptr;
+}
+
+void HostCachingAllocator::Deallocate(void* ptr) {
+  if (!enabled_) {
+    std::free(ptr);
+    return;
+  }
+  if (ptr == nullptr) { return; }
+  if (!IsSlabBlock(ptr)) {
+    DeallocateLargeBlock(static_cast<char*>(ptr));
+    return;
+  }
+  const int32_t class_idx = SlabHeader4Block(ptr)->class_idx;
+  in_use_bytes_.fetch_sub(Size4ClassIdx(class_idx), std::memory_order_relaxed);
+  ThreadCache* thread_cache = LocalThreadCache();
+  if (thread_cache == nullptr) {
+    std::vector<void*> blocks{ptr};
+    ReturnToSharedPool(class_idx, 1, &blocks);
+    return;
+  }
+  std::vector<void*>* blocks = &thread_cache->class_idx2blocks.at(class_idx);
+  blocks->push_back(ptr);
+  const size_t capacity = ThreadCacheCapacity(class_idx);
+  if (blocks->size() > capacity) { ReturnToSharedPool(class_idx, capacity / 2, blocks); }
+}
+
+void* HostCachingAllocator::AllocateSlabBlock(int32_t class_idx, bool* is_fresh) {
+  ThreadCache* thread_cache = LocalThreadCache();
+  std::vector<void*> uncached_blocks;
+  std::vector<void*>* blocks =
+      thread_cache == nullptr ? &uncached_blocks : &thread_cache->class_idx2blocks.at(class_idx);
+  if (blocks->empty()) {
+    FetchFromSharedPool(class_idx, thread_cache == nullptr ? 1 : ThreadCacheCapacity(class_idx) / 2,
+                        blocks);
+  }
+  if (!blocks->empty()) {
+    void* ptr = blocks->back();
+    blocks->pop_back();
+    *is_fresh = false;
+    return ptr;
+  }
+  const size_t size = Size4ClassIdx(class_idx);
+  SizeClass* size_class = size_classes_.at(class_idx).get();
+  std::unique_lock<std::mutex> lock(size_class->mutex);
+  if (size_class->slab_cursor == nullptr || size_class->slab_cursor + size > size_class->slab_end) {
+    char* slab = MapMemory(kSlabBytes);
+    reinterpret_cast<SlabHeader*>(slab)->class_idx = class_idx;
+    size_class->slab_cursor = slab + kSlabHeaderBytes;
+    size_class->slab_end = slab + kSlabBytes;
+  }
+  void* ptr = size_class->slab_cursor;
+  size_class->slab_cursor += size;
+  *is_fresh = true;
+  return ptr;
+}
+
+void* HostCachingAllocator::AllocateLargeBlock(int32_t class_idx, size_t size, bool* is_fresh) {
+  if (class_idx >= 0) {
+    SizeClass* size_class = size_classes_.at(class_idx).get();
+    std::unique_lock<std::mutex> lock(size_class->mutex);
+    if (!size_class->free_blocks.empty()) {
+      void* ptr = size_class->free_blocks.back();
+      size_class->free_blocks.pop_back();
+      cached_large_bytes_.fetch_sub(size, std::memory_order_relaxed);
+      *is_fresh = false;
+      return ptr;
+    }
+  }
+  char* ptr = MapMemory(size);
+  {
+    std::unique_lock<std::mutex> lock(large_block_mutex_);
+    CHECK(large_block2size_.emplace(ptr, size).second);
+  }
+  *is_fresh = true;
+  return ptr;
+}
+
+void HostCachingAllocator::DeallocateLargeBlock(char* ptr) {
+  size_t size = 0;
+  {
+    std::unique_lock<std::mutex> lock(large_block_mutex_);
+    auto it = large_block2size_.find(ptr);
+    CHECK(it != large_block2size_.end()) << "Deallocate a pointer not allocated by this allocator";
+    size = it->second;
+  }
+  in_use_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  if (size <= kMaxCachedBlockBytes
+      && cached_large_bytes_.fetch_add(size, std::memory_order_relaxed) + static_cast<int64_t>(size)
+             <= max_cached_large_bytes_) {
+    SizeClass* size_class = size_classes_.at(ClassIdx4Size(size)).get();
+    std::unique_lock<std::mutex> lock(size_class->mutex);
+    size_class->free_blocks.push_back(ptr);
+    return;
+  }
+  if (size <= kMaxCachedBlockBytes) {
+    cached_large_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  }
+  {
+    std::unique_lock<std::mutex> lock(large_block_mutex_);
+    large_block2size_.erase(ptr);
+  }
+  UnmapMemory(ptr, size);
+}
+
+void HostCachingAllocator::FetchFromSharedPool(int32_t class_idx, size_t n,
+                                               std::vector<void*>* blocks) {
+  SizeClass* size_class = size_classes_.at(class_idx).get();
+  std::unique_lock<std::mutex> lock(size_class->mutex);
+  std::vector<void*>* free_blocks = &size_class->free_blocks;
+  n = std::min(n, free_blocks->size());
+  blocks->insert(blocks->end(), free_blocks->end() - n, free_blocks->end());
+  free_blocks->resize(free_blocks->size() - n);
+}
+
+void HostCachingAllocator::ReturnToSharedPool(int32_t class_idx, size_t n,
+                                              std::vector<void*>* blocks) {
+  if (n == 0) { return; }
+  SizeClass* size_class = size_classes_.at(class_idx).get();
+  std::unique_lock<std::mutex> lock(size_class->mutex);
+  size_class->free_blocks.insert(size_class->free_blocks.end(), blocks->end() - n, blocks->end());
+  blocks->resize(blocks->size() - n);
+}
+
+// Returns kSlabBytes aligned memory, which keeps slab blocks and large blocks apart by address
+// alone and lets huge pages back the whole range.
+char* HostCachingAllocator::MapMemory(size_t size) {
+  const size_t map_size = size + kSlabBytes;
+  void* mapped = MapAnonymous(map_size);
+  if (mapped == MAP_FAILED) {
+    ReleaseCachedLargeBlocks();
+    mapped = MapAnonymous(map_size);
+  }
+  CHECK(mapped != MAP_FAILED) << "Out of host memory when allocating " << size << " bytes, "
+                              << StatsDebugString();
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(mapped);
+  const uintptr_t aligned_begin = RoundUp(begin, kSlabBytes);
+  if (aligned_begin > begin) { munmap(mapped, aligned_begin - begin); }
+  const uintptr_t end = begin + map_size;
+  const uintptr_t aligned_end = aligned_begin + size;
+  if (end > aligned_end) { munmap(reinterpret_cast<void*>(aligned_end), end - aligned_end); }
+  char* ptr = reinterpret_cast<char*>(aligned_begin);
+#ifdef MADV_HUGEPAGE
+  if (size >= kSlabBytes) { madvise(ptr, size, MADV_HUGEPAGE); }
+#endif
+  reserved_bytes_.fetch_add(size, std::memory_order_relaxed);
+  return ptr;
+}
+
+void HostCachingAllocator::UnmapMemory(char* ptr, size_t size) {
+  PCHECK(munmap(ptr, size) == 0);
+  reserved_bytes_.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void HostCachingAllocator::ReleaseCachedLargeBlocks() {
+  FOR_RANGE(int32_t, class_idx, kSlabClassNum, kCachedClassNum) {
+    const size_t size = Size4ClassIdx(class_idx);
+    std::vector<void*> free_blocks;
+    {
+      SizeClass* size_class = size_classes_.at(class_idx).get();
+      std::unique_lock<std::mutex> lock(size_class->mutex);
+      free_blocks.swap(size_class->free_blocks);
+    }
+    for (void* ptr : free_blocks) {
+      {
+        std::unique_lock<std::mutex> lock(large_block_mutex_);
+        large_block2size_.erase(static_cast<char*>(ptr));
+      }
+      cached_large_bytes_.fetch_sub(size, std::memory_order_relaxed);
+      UnmapMemory(static_cast<char*>(ptr), size);
+    }
+  }
+}
+
+HostCachingAllocatorStats HostCachingAllocator::GetStats() const {
+  HostCachingAllocatorStats stats;
+  stats.alloc_cnt = alloc_cnt_.load(std::memory_order_relaxed);
+  stats.miss_cnt = miss_cnt_.load(std::memory_order_relaxed);
+  stats.in_use_bytes = in_use_bytes_.load(std::memory_order_relaxed);
+  stats.peak_in_use_bytes = peak_in_use_bytes_.load(std::memory_order_relaxed);
+  stats.reserved_bytes = reserved_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::string HostCachingAllocator::StatsDebugString() const {
+  const HostCachingAllocatorStats stats = GetStats();
+  std::ostringstream ss;
+  ss << "host caching allocator: alloc_cnt " << stats.alloc_cnt << ", miss_cnt " << stats.miss_cnt
+     << ", in_use_bytes " << stats.in_use_bytes << ", peak_in_use_bytes "
+     << stats.peak_in_use_bytes << ", reserved_bytes " << stats.reserved_bytes;
+  return ss.str();
+}
+
+}  // namespace oneflow
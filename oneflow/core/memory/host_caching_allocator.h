@@ -0,0 +1,102 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_MEMORY_HOST_CACHING_ALLOCATOR_H_
+#define ONEFLOW_CORE_MEMORY_HOST_CACHING_ALLOCATOR_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+struct HostCachingAllocatorStats {
+  int64_t alloc_cnt = 0;
+  // allocations that could not reuse a cached block and took fresh memory
+  int64_t miss_cnt = 0;
+  int64_t in_use_bytes = 0;
+  int64_t peak_in_use_bytes = 0;
+  // memory mapped from the os, in use or cached
+  int64_t reserved_bytes = 0;
+};
+
+// Size class based caching allocator for unpinned host memory, shared by the whole process.
+//
+// Requests are rounded up to a size class, 64 bytes apart up to 1KiB and then 4 classes per
+// doubling, so that at most 25% is wasted. Blocks are 64 bytes aligned.
+//   - Classes up to 256KiB are carved out of 2MiB slabs, every slab serves a single class and
+//     records it in its header. Freed blocks go to a per-thread cache first and spill to the
+//     shared pool of their class, they are never given back to the os.
+//   - Larger classes up to 1GiB are mapped one by one and cached in the shared pool, bounded by
+//     ONEFLOW_HOST_CACHING_ALLOCATOR_MAX_CACHED_MB (default 4096).
+//   - Anything larger is mapped on allocation and unmapped on deallocation.
+// Slabs and blocks of 2MiB or more are advised to be backed by transparent huge pages.
+// Setting ONEFLOW_DISABLE_HOST_CACHING_ALLOCATOR falls back to malloc and free.
+class HostCachingAllocator final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostCachingAllocator);
+
+  // never destroyed, thread caches may flush into it at any point of process exit
+  static HostCachingAllocator* Get();
+
+  // *is_zeroed (nullable) is set to whether the memory is known to be filled with zeros, which is
+  // the case for memory fresh from the os, so that callers needing zeroed memory may skip memset.
+  void* Allocate(size_t size, bool* is_zeroed);
+  void Deallocate(void* ptr);
+
+  HostCachingAllocatorStats GetStats() const;
+  std::string StatsDebugString() const;
+
+ private:
+  struct ThreadCache;
+  struct SizeClass {
+    std::mutex mutex;
+    std::vector<void*> free_blocks;
+    // bump pointer into the current slab, slab classes only
+    char* slab_cursor = nullptr;
+    char* slab_end = nullptr;
+  };
+
+  HostCachingAllocator();
+  ~HostCachingAllocator() = delete;
+
+  static ThreadCache* LocalThreadCache();
+
+  void* AllocateSlabBlock(int32_t class_idx, bool* is_fresh);
+  void* AllocateLargeBlock(int32_t class_idx, size_t size, bool* is_fresh);
+  void DeallocateLargeBlock(char* ptr);
+  // moves up to n blocks of the shared pool into blocks
+  void FetchFromSharedPool(int32_t class_idx, size_t n, std::vector<void*>* blocks);
+  // moves the last n blocks of blocks into the shared pool
+  void ReturnToSharedPool(int32_t class_idx, size_t n, std::vector<void*>* blocks);
+  char* MapMemory(size_t size);
+  void UnmapMemory(char* ptr, size_t size);
+  void ReleaseCachedLargeBlocks();
+
+  bool enabled_;
+  int64_t max_cached_large_bytes_;
+  std::vector<std::unique_ptr<SizeClass>> size_classes_;
+  std::mutex large_block_mutex_;
+  HashMap<char*, size_t> large_block2size_;
+
+  std::atomic<int64_t> alloc_cnt_;
+  std::atomic<int64_t> miss_cnt_;
+  std::atomic<int64_t> in_use_bytes_;
+  std::atomic<int64_t> peak_in_use_bytes_;
+  std::atomic<int64_t> reserved_bytes_;
+  std::atomic<int64_t> cached_large_bytes_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_MEMORY_HOST_CACHING_ALLOCATOR_H_
@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/memory/host_caching_allocator.h"
+
+namespace oneflow {
+
+namespace {
+
+// keeps the compiler from eliding malloc, memset and free of the benchmark
+void Escape(void* ptr) { asm volatile("" : : "r"(ptr) : "memory"); }
+
+}  // namespace
+
+TEST(HostCachingAllocator, reuse_alignment_and_zeroing) {
+  HostCachingAllocator* allocator = HostCachingAllocator::Get();
+  const int64_t in_use_bytes = allocator->GetStats().in_use_bytes;
+  for (size_t size : {1, 64, 65, 1000, 4097, 300 << 10, 3 << 20}) {
+    bool is_zeroed = false;
+    char* ptr = static_cast<char*>(allocator->Allocate(size, &is_zeroed));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % 64, 0);
+    if (is_zeroed) {
+      FOR_RANGE(size_t, i, 0, size) { ASSERT_EQ(ptr[i], 0); }
+    }
+    memset(ptr, 0xff, size);
+    allocator->Deallocate(ptr);
+    char* reused = static_cast<char*>(allocator->Allocate(size, &is_zeroed));
+    ASSERT_EQ(reused, ptr);
+    ASSERT_FALSE(is_zeroed);
+    allocator->Deallocate(reused);
+  }
+  ASSERT_EQ(allocator->GetStats().in_use_bytes, in_use_bytes);
+}
+
+TEST(HostCachingAllocator, blocks_do_not_overlap) {
+  HostCachingAllocator* allocator = HostCachingAllocator::Get();
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<size_t> dis(1, 64 << 10);
+  std::vector<std::pair<char*, size_t>> blocks;
+  FOR_RANGE(int64_t, i, 0, 2000) {
+    const size_t size = dis(gen);
+    char* ptr = static_cast<char*>(allocator->Allocate(size, nullptr));
+    memset(ptr, static_cast<int>(i % 256), size);
+    blocks.emplace_back(ptr, size);
+  }
+  FOR_RANGE(size_t, i, 0, blocks.size()) {
+    const char expected = static_cast<char>(i % 256);
+    ASSERT_EQ(blocks.at(i).first[0], expected);
+    ASSERT_EQ(blocks.at(i).first[blocks.at(i).second - 1], expected);
+    allocator->Deallocate(blocks.at(i).first);
+  }
+}
+
+TEST(HostCachingAllocator, free_on_another_thread) {
+  HostCachingAllocator* allocator = HostCachingAllocator::Get();
+  const int64_t in_use_bytes = allocator->GetStats().in_use_bytes;
+  const int64_t thread_num = 4;
+  const int64_t block_num = 10000;
+  std::vector<std::vector<void*>> thread_id2blocks(thread_num);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, t, 0, thread_num) {
+    threads.emplace_back([&, t]() {
+      FOR_RANGE(int64_t, i, 0, block_num) {
+        thread_id2blocks.at(t).push_back(allocator->Allocate(64 * (i % 32 + 1), nullptr));
+      }
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+  threads.clear();
+  FOR_RANGE(int64_t, t, 0, thread_num) {
+    threads.emplace_back([&, t]() {
+      for (void* ptr : thread_id2blocks.at((t + 1) % thread_num)) { allocator->Deallocate(ptr); }
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+  ASSERT_EQ(allocator->GetStats().in_use_bytes, in_use_bytes);
+}
+
+TEST(HostCachingAllocator, benchmark_compared_with_malloc) {
+  HostCachingAllocator* allocator = HostCachingAllocator::Get();
+  // the blobs of an eager step are alive together, every page of them gets written
+  std::vector<size_t> sizes;
+  FOR_RANGE(int64_t, i, 0, 64) {
+    for (size_t size : {256, 4 << 10, 64 << 10, 1 << 20, 4 << 20}) { sizes.push_back(size); }
+  }
+  const int64_t repeat = 20;
+  std::vector<void*> ptrs(sizes.size());
+  auto TouchPages = [&](void* ptr, size_t size) {
+    for (size_t offset = 0; offset < size; offset += 4096) { static_cast<char*>(ptr)[offset] = 1; }
+    Escape(ptr);
+  };
+  auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    FOR_RANGE(size_t, j, 0, sizes.size()) {
+      ptrs.at(j) = std::malloc(sizes.at(j));
+      TouchPages(ptrs.at(j), sizes.at(j));
+    }
+    for (void* ptr : ptrs) { std::free(ptr); }
+  }
+  const double malloc_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  const HostCachingAllocatorStats before = allocator->GetStats();
+  start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    FOR_RANGE(size_t, j, 0, sizes.size()) {
+      ptrs.at(j) = allocator->Allocate(sizes.at(j), nullptr);
+      TouchPages(ptrs.at(j), sizes.at(j));
+    }
+    for (void* ptr : ptrs) { allocator->Deallocate(ptr); }
+  }
+  const double cached_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  const HostCachingAllocatorStats after = allocator->GetStats();
+  ASSERT_EQ(after.alloc_cnt - before.alloc_cnt, repeat * sizes.size());
+  ASSERT_LE(after.miss_cnt - before.miss_cnt, sizes.size());
+  LOG(INFO) << "allocate, touch and free a step of " << sizes.size()
+            << " blobs, malloc: " << malloc_ms / repeat
+            << " ms, caching allocator: " << cached_ms / repeat << " ms";
+  LOG(INFO) << allocator->StatsDebugString();
+}
+
+}  // namespace oneflow
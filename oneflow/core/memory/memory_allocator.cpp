@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/memory/host_caching_allocator.h"
 #include "oneflow/core/comm_network/comm_network.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -34,8 +35,7 @@ void* MemoryAllocatorImpl::Allocate(MemoryCase mem_case, size_t size) {
         CudaCheck(cudaMallocHost(&ptr, size));
       }
     } else {
-      ptr = malloc(size);
-      CHECK_NOTNULL(ptr);
+      ptr = HostCachingAllocator::Get()->Allocate(size, nullptr);
     }
   } else if (mem_case.has_device_cuda_mem()) {
     CudaCurrentDeviceGuard guard(mem_case.device_cuda_mem().device_id());
@@ -51,7 +51,7 @@ void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case) {
     if (mem_case.host_mem().has_cuda_pinned_mem()) {
       CudaCheck(cudaFreeHost(ptr));
     } else {
-      free(ptr);
+      HostCachingAllocator::Get()->Deallocate(ptr);
     }
   } else if (mem_case.has_device_cuda_mem()) {
     CudaCurrentDeviceGuard guard(mem_case.device_cuda_mem().device_id());
@@ -62,12 +62,12 @@ void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case) {
 }
 
 void* MemoryAllocatorImpl::AllocateUnPinnedHostMem(size_t size) {
-  void* ptr = malloc(size);
-  CHECK_NOTNULL(ptr);
-  return ptr;
+  return HostCachingAllocator::Get()->Allocate(size, nullptr);
 }
 
-void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr) { free(ptr); }
+void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr) {
+  HostCachingAllocator::Get()->Deallocate(ptr);
+}
 
 MemoryAllocator::~MemoryAllocator() {
   for (std::function<void()> deleter : deleters_) { deleter(); }
@@ -75,10 +75,18 @@ MemoryAllocator::~MemoryAllocator() {
 
 char* MemoryAllocator::Allocate(MemoryCase mem_case, std::size_t size) {
   const int memset_val = 0;
-  char* dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
+  char* dptr = nullptr;
   if (mem_case.has_host_mem()) {
-    memset(dptr, memset_val, size);
+    bool is_zeroed = false;
+    if (mem_case.host_mem().has_cuda_pinned_mem()) {
+      dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
+    } else {
+      // memory fresh from the os is already zero filled, only recycled blocks need the memset
+      dptr = static_cast<char*>(HostCachingAllocator::Get()->Allocate(size, &is_zeroed));
+    }
+    if (!is_zeroed) { memset(dptr, memset_val, size); }
   } else if (mem_case.has_device_cuda_mem()) {
+    dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
     CudaCurrentDeviceGuard guard(mem_case.device_cuda_mem().device_id());
     CudaCheck(cudaMemset(dptr, memset_val, size));
   } else {
@@ -17,26 +17,278 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                            \
-  template<typename T, template<typename> class binary_func>                                       \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                     \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {              \
-      return false;                                                                                \
-    }                                                                                              \
-    static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x, \
-                       const XpuVarNdarray<T>& tmp_storage) {                                      \
-      UNIMPLEMENTED();                                                                             \
-    }                                                                                              \
-  }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeYReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+namespace {
+
+// independent accumulators advancing in lock step, so that the inner loops vectorize
+constexpr int64_t kLaneNum = 8;
+// elements reduced by the lanes, or rows reduced by the column accumulators, before the result is
+// folded into the total
+constexpr int64_t kBlockSize = 1024;
+constexpr int64_t kRowBlockSize = 128;
+// columns reduced together by a task, their accumulators stay in L1
+constexpr int64_t kColBlockSize = 1024;
+constexpr int64_t kMinElemCntPerTask = 32 * 1024;
+
+int64_t DivUp(int64_t n, int64_t val) { return (n + val - 1) / val; }
+
+template<typename T, template<typename> class binary_func, typename Enable = void>
+struct Accumulator final {
+  Accumulator() : val(UnitOfBinaryFunc<T, binary_func>::Val()) {}
+  void Add(T x) { val = binary_func<T>::Invoke(val, x); }
+  T Get() const { return val; }
+  T val;
+};
+
+// Floating point sums fold the blocks into a Kahan-Babuska (Neumaier) compensated total, so the
+// error does not grow with the number of blocks.
+template<typename T>
+struct Accumulator<T, BinaryFuncSum,
+                   typename std::enable_if<std::is_floating_point<T>::value>::type>
+    final {
+  Accumulator() : val(0), compensation(0) {}
+  void Add(T x) {
+    const T sum = val + x;
+    if (std::abs(val) >= std::abs(x)) {
+      compensation += (val - sum) + x;
+    } else {
+      compensation += (x - sum) + val;
+    }
+    val = sum;
+  }
+  T Get() const { return val + compensation; }
+  T val;
+  T compensation;
+};
+
+template<typename T, template<typename> class binary_func>
+T LaneReduce(const T* x, int64_t n) {
+  T lanes[kLaneNum];
+  std::fill(lanes, lanes + kLaneNum, UnitOfBinaryFunc<T, binary_func>::Val());
+  int64_t i = 0;
+  for (; i + kLaneNum <= n; i += kLaneNum) {
+    for (int64_t j = 0; j < kLaneNum; ++j) {
+      lanes[j] = binary_func<T>::Invoke(lanes[j], x[i + j]);
+    }
+  }
+  for (; i < n; ++i) { lanes[0] = binary_func<T>::Invoke(lanes[0], x[i]); }
+  for (int64_t width = kLaneNum / 2; width > 0; width /= 2) {
+    for (int64_t j = 0; j < width; ++j) {
+      lanes[j] = binary_func<T>::Invoke(lanes[j], lanes[j + width]);
+    }
+  }
+  return lanes[0];
+}
+
+template<typename T, template<typename> class binary_func>
+T ReduceContiguous(const T* x, int64_t n) {
+  Accumulator<T, binary_func> acc;
+  for (int64_t i = 0; i < n; i += kBlockSize) {
+    acc.Add(LaneReduce<T, binary_func>(x + i, std::min(kBlockSize, n - i)));
+  }
+  return acc.Get();
+}
+
+// y[b, c] = reduce(x[b, :, c]) for x of shape (batch_num, row_num, col_num). Tasks own a block of
+// columns of a batch and a chunk of rows, the rows are only split when the other two do not give
+// enough tasks. The partial results of the chunks are combined in order, so the result does not
+// depend on the number of threads.
+template<typename T, template<typename> class binary_func>
+void ReduceCols(const T* x, int64_t batch_num, int64_t row_num, int64_t col_num, T* y) {
+  if (batch_num * col_num == 0) { return; }
+  const int64_t col_block_size = std::min(col_num, kColBlockSize);
+  const int64_t col_block_num = DivUp(col_num, col_block_size);
+  const int64_t chunk_row_num =
+      RoundUp(std::max(kMinElemCntPerTask * 4 / col_block_size, kRowBlockSize), kRowBlockSize);
+  const int64_t chunk_num =
+      batch_num * col_block_num >= 64 ? 1 : std::max<int64_t>(DivUp(row_num, chunk_row_num), 1);
+  std::vector<T> chunk_results;
+  if (chunk_num > 1) { chunk_results.resize(chunk_num * batch_num * col_num); }
+  const int64_t task_num = batch_num * col_block_num * chunk_num;
+  const int64_t task_elem_cnt = col_block_size * std::min(row_num, chunk_row_num);
+  const int64_t grain =
+      std::max<int64_t>(1, kMinElemCntPerTask / std::max<int64_t>(task_elem_cnt, 1));
+  ParallelFor(0, task_num, grain, [&](int64_t begin, int64_t end) {
+    std::vector<T> partial(col_block_size);
+    std::vector<Accumulator<T, binary_func>> accs(col_block_size);
+    FOR_RANGE(int64_t, task, begin, end) {
+      const int64_t chunk = task % chunk_num;
+      const int64_t col_block = task / chunk_num % col_block_num;
+      const int64_t batch = task / chunk_num / col_block_num;
+      const int64_t col_begin = col_block * col_block_size;
+      const int64_t width = std::min(col_block_size, col_num - col_begin);
+      const int64_t row_end =
+          chunk_num == 1 ? row_num : std::min(row_num, (chunk + 1) * chunk_row_num);
+      const T* x_batch = x + batch * row_num * col_num + col_begin;
+      std::fill(accs.begin(), accs.end(), Accumulator<T, binary_func>());
+      for (int64_t row_begin = chunk * chunk_row_num; row_begin < row_end;
+           row_begin += kRowBlockSize) {
+        std::fill(partial.begin(), partial.begin() + width,
+                  UnitOfBinaryFunc<T, binary_func>::Val());
+        FOR_RANGE(int64_t, row, row_begin, std::min(row_end, row_begin + kRowBlockSize)) {
+          const T* x_row = x_batch + row * col_num;
+          for (int64_t c = 0; c < width; ++c) {
+            partial[c] = binary_func<T>::Invoke(partial[c], x_row[c]);
+          }
+        }
+        for (int64_t c = 0; c < width; ++c) { accs[c].Add(partial[c]); }
+      }
+      T* result = chunk_num == 1 ? y + batch * col_num + col_begin
+                                 : chunk_results.data() + (chunk * batch_num + batch) * col_num
+                                       + col_begin;
+      for (int64_t c = 0; c < width; ++c) { result[c] = accs[c].Get(); }
+    }
+  });
+  if (chunk_num == 1) { return; }
+  FOR_RANGE(int64_t, i, 0, batch_num * col_num) {
+    Accumulator<T, binary_func> acc;
+    FOR_RANGE(int64_t, chunk, 0, chunk_num) {
+      acc.Add(chunk_results[chunk * batch_num * col_num + i]);
+    }
+    y[i] = acc.Get();
+  }
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t n = x.shape().ElemNum();
+    const int64_t chunk_num = DivUp(n, kMinElemCntPerTask);
+    if (chunk_num <= 1) {
+      *y.ptr() = ReduceContiguous<T, binary_func>(x.ptr(), n);
+      return;
+    }
+    std::vector<T> chunk_results(chunk_num);
+    ParallelFor(0, chunk_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, chunk, begin, end) {
+        const int64_t offset = chunk * kMinElemCntPerTask;
+        chunk_results[chunk] = ReduceContiguous<T, binary_func>(
+            x.ptr() + offset, std::min(kMinElemCntPerTask, n - offset));
+      }
+    });
+    Accumulator<T, binary_func> acc;
+    for (const T& result : chunk_results) { acc.Add(result); }
+    *y.ptr() = acc.Get();
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t row_num = x.shape().At(0);
+    const int64_t col_num = x.shape().At(1);
+    const int64_t grain =
+        std::max<int64_t>(1, kMinElemCntPerTask / std::max<int64_t>(col_num, 1));
+    ParallelFor(0, row_num, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        y.ptr()[row] = ReduceContiguous<T, binary_func>(x.ptr() + row * col_num, col_num);
+      }
+    });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    ReduceCols<T, binary_func>(x.ptr(), 1, x.shape().At(0), x.shape().At(1), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeYReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1
+           && x.shape().At(2) == y.shape().At(2);
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    ReduceCols<T, binary_func>(x.ptr(), x.shape().At(0), x.shape().At(1), x.shape().At(2),
+                               y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+
+  // y[j] = reduce(x[:, j, :]), the bias gradient of NCHW. Tasks own a y[j] and a chunk of x's
+  // first axis, which is only split when there are few y[j].
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t outer_num = x.shape().At(0);
+    const int64_t mid_num = x.shape().At(1);
+    const int64_t inner_num = x.shape().At(2);
+    const int64_t chunk_outer_num =
+        std::max<int64_t>(1, kMinElemCntPerTask * 4 / std::max<int64_t>(inner_num, 1));
+    const int64_t chunk_num =
+        mid_num >= 64 ? 1 : std::max<int64_t>(DivUp(outer_num, chunk_outer_num), 1);
+    std::vector<T> chunk_results;
+    if (chunk_num > 1) { chunk_results.resize(chunk_num * mid_num); }
+    const int64_t task_elem_cnt = inner_num * std::min(outer_num, chunk_outer_num);
+    const int64_t grain =
+        std::max<int64_t>(1, kMinElemCntPerTask / std::max<int64_t>(task_elem_cnt, 1));
+    ParallelFor(0, mid_num * chunk_num, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, task, begin, end) {
+        const int64_t chunk = task % chunk_num;
+        const int64_t mid = task / chunk_num;
+        const int64_t outer_end =
+            chunk_num == 1 ? outer_num : std::min(outer_num, (chunk + 1) * chunk_outer_num);
+        Accumulator<T, binary_func> acc;
+        FOR_RANGE(int64_t, outer, chunk * chunk_outer_num, outer_end) {
+          acc.Add(ReduceContiguous<T, binary_func>(
+              x.ptr() + (outer * mid_num + mid) * inner_num, inner_num));
+        }
+        if (chunk_num == 1) {
+          y.ptr()[mid] = acc.Get();
+        } else {
+          chunk_results[chunk * mid_num + mid] = acc.Get();
+        }
+      }
+    });
+    if (chunk_num == 1) { return; }
+    FOR_RANGE(int64_t, mid, 0, mid_num) {
+      Accumulator<T, binary_func> acc;
+      FOR_RANGE(int64_t, chunk, 0, chunk_num) { acc.Add(chunk_results[chunk * mid_num + mid]); }
+      y.ptr()[mid] = acc.Get();
+    }
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
@@ -0,0 +1,125 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_reduce.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// x of shape x_dims reduced into y_dims in double, the way the per axis generic path does it
+std::vector<double> NaiveReduceSum(const std::vector<float>& x, const DimVector& x_dims,
+                                   const DimVector& y_dims) {
+  const Shape x_shape(x_dims);
+  const Shape y_shape(y_dims);
+  std::vector<double> y(y_shape.elem_cnt(), 0);
+  FOR_RANGE(int64_t, i, 0, x_shape.elem_cnt()) {
+    int64_t rest = i;
+    int64_t y_offset = 0;
+    int64_t y_stride = 1;
+    for (int64_t axis = x_dims.size() - 1; axis >= 0; --axis) {
+      const int64_t coord = rest % x_dims.at(axis);
+      rest /= x_dims.at(axis);
+      if (y_dims.at(axis) != 1) { y_offset += coord * y_stride; }
+      y_stride *= y_dims.at(axis);
+    }
+    y.at(y_offset) += x.at(i);
+  }
+  return y;
+}
+
+template<typename T, template<typename> class binary_func>
+void Reduce(const std::vector<T>& x, const DimVector& x_dims, const DimVector& y_dims,
+            std::vector<T>* y, bool use_default_path) {
+  // kept across calls, so that the benchmark does not time its allocation
+  static std::vector<T> tmp;
+  tmp.resize(x.size());
+  y->resize(Shape(y_dims).elem_cnt());
+  XpuVarNdarray<T> y_ndarray(Shape(y_dims), y->data());
+  XpuVarNdarray<const T> x_ndarray(Shape(x_dims), x.data());
+  XpuVarNdarray<T> tmp_ndarray(Shape(x_dims), tmp.data());
+  if (use_default_path) {
+    NdarrayDefaultReduce<DeviceType::kCPU, T, binary_func>::Reduce(nullptr, y_ndarray, x_ndarray,
+                                                                  tmp_ndarray);
+  } else {
+    NdarrayReduce<DeviceType::kCPU, T, binary_func>::Reduce(nullptr, y_ndarray, x_ndarray,
+                                                           tmp_ndarray);
+  }
+}
+
+struct ReduceCase {
+  DimVector x_dims;
+  DimVector y_dims;
+};
+
+// every layout with a fast path, shapes chosen to hit the row and column splits
+const std::vector<ReduceCase>& TestCases() {
+  static const std::vector<ReduceCase> cases = {
+      {{1000003}, {1}},
+      {{7, 11, 13}, {1, 1, 1}},
+      {{37, 1031}, {37, 1}},
+      {{100000, 3}, {100000, 1}},
+      {{5000, 37}, {1, 37}},
+      {{70000, 3}, {1, 3}},
+      {{3, 2051}, {1, 2051}},
+      {{4, 3000, 130}, {4, 1, 130}},
+      {{200, 50, 3}, {200, 1, 3}},
+      {{64, 32, 49}, {1, 32, 1}},
+      {{3000, 2, 100}, {1, 2, 1}},
+  };
+  return cases;
+}
+
+class NdarrayReduceTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(NdarrayReduceTest, float_sum_matches_double) {
+  for (const ReduceCase& c : TestCases()) {
+    // positive, so that the sums are far from 0 and checked by their relative error
+    const std::vector<float> x = test::RandomVector<float>(Shape(c.x_dims).elem_cnt(), 1);
+    std::vector<float> y;
+    Reduce<float, BinaryFuncSum>(x, c.x_dims, c.y_dims, &y, false);
+    const std::vector<double> ref = NaiveReduceSum(x, c.x_dims, c.y_dims);
+    ASSERT_EQ(y.size(), ref.size());
+    FOR_RANGE(size_t, i, 0, y.size()) {
+      // a few ulps of the result, independent of the number of elements reduced
+      ASSERT_NEAR(y.at(i), ref.at(i), 4 * std::abs(ref.at(i)) * FLT_EPSILON)
+          << Shape(c.x_dims).ToString() << " -> " << Shape(c.y_dims).ToString() << " at " << i;
+    }
+  }
+}
+
+TEST_F(NdarrayReduceTest, matches_default_path) {
+  for (const ReduceCase& c : TestCases()) {
+    const std::vector<float> x_float = test::RandomVector<float>(Shape(c.x_dims).elem_cnt());
+    std::vector<int32_t> x(x_float.size());
+    FOR_RANGE(size_t, i, 0, x.size()) { x.at(i) = static_cast<int32_t>(x_float.at(i) * 100); }
+    std::vector<int32_t> y;
+    std::vector<int32_t> default_y;
+    Reduce<int32_t, BinaryFuncSum>(x, c.x_dims, c.y_dims, &y, false);
+    Reduce<int32_t, BinaryFuncSum>(x, c.x_dims, c.y_dims, &default_y, true);
+    ASSERT_EQ(y, default_y);
+    Reduce<int32_t, BinaryFuncMax>(x, c.x_dims, c.y_dims, &y, false);
+    Reduce<int32_t, BinaryFuncMax>(x, c.x_dims, c.y_dims, &default_y, true);
+    ASSERT_EQ(y, default_y);
+    Reduce<int32_t, BinaryFuncMin>(x, c.x_dims, c.y_dims, &y, false);
+    Reduce<int32_t, BinaryFuncMin>(x, c.x_dims, c.y_dims, &default_y, true);
+    ASSERT_EQ(y, default_y);
+  }
+}
+
+}  // namespace oneflow
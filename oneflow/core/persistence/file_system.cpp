@@ -26,6 +26,39 @@ namespace oneflow {
 
 namespace fs {
 
+namespace {
+
+// runs this large, or this far apart, are read one by one
+const size_t kMinSeparateReadSize = 64 << 10;
+// bounds the buffer holding the range covered by runs read together
+const size_t kMaxCoveringReadSize = 16 << 20;
+
+}  // namespace
+
+void RandomAccessFile::ReadStrided(uint64_t offset, size_t run_size, uint64_t stride,
+                                   size_t num_runs, char* result) const {
+  if (num_runs == 0 || run_size == 0) { return; }
+  CHECK(num_runs == 1 || stride >= run_size);
+  if (num_runs == 1 || run_size >= kMinSeparateReadSize
+      || stride - run_size >= kMinSeparateReadSize) {
+    FOR_RANGE(size_t, i, 0, num_runs) {
+      Read(offset + i * stride, run_size, result + i * run_size);
+    }
+    return;
+  }
+  // small runs close to each other, one read of the range they cover costs less than many reads
+  const size_t runs_per_read = std::max<size_t>(kMaxCoveringReadSize / stride, 1);
+  std::vector<char> buffer;
+  for (size_t first = 0; first < num_runs; first += runs_per_read) {
+    const size_t n = std::min(runs_per_read, num_runs - first);
+    buffer.resize((n - 1) * stride + run_size);
+    Read(offset + first * stride, buffer.size(), buffer.data());
+    FOR_RANGE(size_t, i, 0, n) {
+      std::memcpy(result + (first + i) * run_size, buffer.data() + i * stride, run_size);
+    }
+  }
+}
+
 void FileSystem::CreateDirIfNotExist(const std::string& dirname) {
   if (IsDirectory(dirname)) { return; }
   CreateDir(dirname);
@@ -37,6 +37,17 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual void Read(uint64_t offset, size_t n, char* result) const = 0;
 
+  // Reads `num_runs` runs of `run_size` bytes, the i-th one starting at `offset + i * stride`,
+  // and packs them back to back into `result`.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void ReadStrided(uint64_t offset, size_t run_size, uint64_t stride, size_t num_runs,
+                           char* result) const;
+
+  // Hints that the `n` bytes starting at `offset` are going to be read soon, so that the file
+  // system may start fetching them in the background. Does nothing by default.
+  virtual void WillNeed(uint64_t offset, size_t n) const {}
+
  private:
 };
 
@@ -54,6 +54,12 @@ void TestFileOperation(FileSystem* file_system) {
   random_access_file->Read(0, file_size, read_array);
   std::string read_content(read_array, file_size);
   ASSERT_EQ(write_content + append_content, read_content);
+  // strided read, 4 runs of 3 bytes, 7 bytes apart
+  char strided_read_array[12];
+  random_access_file->ReadStrided(2, 3, 7, 4, strided_read_array);
+  std::string strided_content;
+  FOR_RANGE(int64_t, i, 0, 4) { strided_content += read_content.substr(2 + i * 7, 3); }
+  ASSERT_EQ(strided_content, std::string(strided_read_array, 12));
   file_system->DelFile(file_name);
   delete[] read_array;
 }
@@ -32,6 +32,14 @@ namespace oneflow {
 
 namespace fs {
 
+namespace {
+
+// runs this large are read one by one with pread
+const size_t kMinPreadRunSize = 64 << 10;
+const size_t kMaxMapWindowSize = 256 << 20;
+
+}  // namespace
+
 class PosixRandomAccessFile : public RandomAccessFile {
  private:
   std::string fname_;
@@ -60,6 +68,37 @@ class PosixRandomAccessFile : public RandomAccessFile {
       }
     }
   }
+
+  void ReadStrided(uint64_t offset, size_t run_size, uint64_t stride, size_t num_runs,
+                   char* result) const override {
+    if (num_runs <= 1 || run_size >= kMinPreadRunSize) {
+      RandomAccessFile::ReadStrided(offset, run_size, stride, num_runs, result);
+      return;
+    }
+    // small runs are gathered from a mapping of the range they cover, so that only the pages
+    // holding them are read in, window by window to bound the address space taken
+    static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t runs_per_window = std::max<size_t>(kMaxMapWindowSize / stride, 1);
+    for (size_t first = 0; first < num_runs; first += runs_per_window) {
+      const size_t n = std::min(runs_per_window, num_runs - first);
+      const uint64_t begin = offset + first * stride;
+      const uint64_t map_begin = begin / page_size * page_size;
+      const size_t map_size = begin + (n - 1) * stride + run_size - map_begin;
+      void* ptr = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd_, map_begin);
+      PCHECK(ptr != MAP_FAILED) << "Fail to map file " << fname_;
+      madvise(ptr, map_size, stride - run_size >= page_size ? MADV_RANDOM : MADV_SEQUENTIAL);
+      const char* src = static_cast<const char*>(ptr) + (begin - map_begin);
+      FOR_RANGE(size_t, i, 0, n) {
+        std::memcpy(result + (first + i) * run_size, src + i * stride, run_size);
+      }
+      PCHECK(munmap(ptr, map_size) == 0) << "Fail to unmap file " << fname_;
+    }
+  }
+
+  void WillNeed(uint64_t offset, size_t n) const override {
+    // a hint only, failures are of no consequence
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+  }
 };
 
 class PosixWritableFile : public WritableFile {
@@ -15,19 +15,27 @@ limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
-#include "oneflow/core/register/tensor_slice_copier.h"
-#include "oneflow/core/device/cpu_device_context.h"
+#include "oneflow/core/persistence/snapshot_write_queue.h"
+#include "oneflow/core/register/blob.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
 namespace {
 
+const int64_t kParallelReadSize = 16 << 20;
+
 std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+// a file saved by this process may still be in the write queue
+void WaitUntilWritten(const std::string& path) {
+  SnapshotWriteQueue* write_queue = Global<SnapshotWriteQueue>::Get();
+  if (write_queue != nullptr) { write_queue->WaitUntilWritten(path); }
+}
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
@@ -35,6 +43,7 @@ SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
 
 bool SnapshotReader::HasKey(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
+  WaitUntilWritten(path);
   return SnapshotFS()->FileExists(path);
 }
 
@@ -49,22 +58,67 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   const TensorSliceView logical_blob_slice(logical_blob_shape);
   CHECK(logical_blob_slice.Contains(slice));
   const std::string path = GenDataFilePath(root_path_, key);
-  const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
+  WaitUntilWritten(path);
+  const int64_t elem_size = GetSizeOfDataType(data_type);
+  const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * elem_size;
   CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
       << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
+  if (slice.shape().elem_cnt() == 0) { return; }
+  std::unique_ptr<fs::RandomAccessFile> file;
+  SnapshotFS()->NewRandomAccessFile(path, &file);
+  const int64_t num_axes = logical_blob_shape.NumAxes();
+  if (num_axes == 0) {
+    file->Read(0, elem_size, dst);
+    return;
+  }
+  // The slice is read as runs along run_axis, axes after it are whole so that a run is contiguous
+  // both in the file and in dst. Runs along the axis before run_axis are stride bytes apart in the
+  // file, and every index of the axes before that one starts another group of strided runs.
+  int64_t run_axis = num_axes - 1;
+  while (run_axis > 0 && slice.At(run_axis).size() == logical_blob_shape.At(run_axis)) {
+    run_axis -= 1;
+  }
+  const int64_t run_size = slice.shape().Count(run_axis) * elem_size;
+  const int64_t stride = run_axis > 0 ? logical_blob_shape.Count(run_axis) * elem_size : run_size;
+  const int64_t group_size = run_axis > 0 ? slice.At(run_axis - 1).size() : 1;
+  const int64_t group_num = run_axis > 1 ? slice.shape().Count(0, run_axis - 1) : 1;
+  auto GroupOffset = [&](int64_t group_id) {
+    int64_t elem_offset = 0;
+    for (int64_t axis = num_axes - 1; axis >= 0; --axis) {
+      int64_t index = slice.At(axis).begin();
+      if (axis < run_axis - 1) {
+        index += group_id % slice.At(axis).size();
+        group_id /= slice.At(axis).size();
+      }
+      elem_offset += index * logical_blob_shape.Count(axis + 1);
+    }
+    return elem_offset * elem_size;
+  };
+  // large reads are split into tasks run in parallel, which keeps more requests in flight for
+  // storage with deep queues or high latency
+  const int64_t runs_per_task = std::max<int64_t>(kParallelReadSize / run_size, 1);
+  const int64_t tasks_per_group = RoundUp(group_size, runs_per_task) / runs_per_task;
+  if (group_num * group_size > 1) {
+    ParallelFor(0, group_num * tasks_per_group, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, task_id, begin, end) {
+        const int64_t group_id = task_id / tasks_per_group;
+        const int64_t first_run = task_id % tasks_per_group * runs_per_task;
+        const int64_t num_runs = std::min(runs_per_task, group_size - first_run);
+        file->ReadStrided(GroupOffset(group_id) + first_run * stride, run_size, stride, num_runs,
+                          dst + (group_id * group_size + first_run) * run_size);
+      }
+    });
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type);
-    CpuDeviceCtx device_ctx;
-    std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+    // a single contiguous run, split into chunks
+    const int64_t offset = GroupOffset(0);
+    const int64_t chunk_num = RoundUp(run_size, kParallelReadSize) / kParallelReadSize;
+    ParallelFor(0, chunk_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, chunk_id, begin, end) {
+        const int64_t chunk_offset = chunk_id * kParallelReadSize;
+        file->Read(offset + chunk_offset, std::min(kParallelReadSize, run_size - chunk_offset),
+                   dst + chunk_offset);
+      }
+    });
   }
 }
 
@@ -77,7 +131,10 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
 void SnapshotReader::Close() {}
 
 SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {
+    : SnapshotWriter(snapshot_root_path, true) {}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path, bool is_async)
+    : root_path_(snapshot_root_path), is_async_(is_async) {
   OfCallOnce("SnapshotWriteCheckRootPath-" + snapshot_root_path, [&]() {
     if (SnapshotFS()->FileExists(snapshot_root_path)) {
       CHECK(SnapshotFS()->IsDirectory(snapshot_root_path))
@@ -95,16 +152,32 @@ void SnapshotWriter::Write(const std::string& key, const char* data, size_t size
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  SnapshotWriteQueue* write_queue = Global<SnapshotWriteQueue>::Get();
+  if (is_async_ && write_queue != nullptr) {
+    write_queue->Write(root_path_, path, data, size);
+  } else {
+    PersistentOutStream out_stream(SnapshotFS(), path);
+    out_stream.Write(data, size);
+  }
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
   Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
 }
 
+void SnapshotWriter::Flush() {
+  SnapshotWriteQueue* write_queue = Global<SnapshotWriteQueue>::Get();
+  if (is_async_ && write_queue != nullptr) { write_queue->WaitUntilRootWritten(root_path_); }
+}
+
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  const std::string marker_path = JoinPath(root_path_, "snapshot_done");
+  SnapshotWriteQueue* write_queue = Global<SnapshotWriteQueue>::Get();
+  if (is_async_ && write_queue != nullptr) {
+    write_queue->WriteMarker(root_path_, marker_path);
+  } else {
+    PersistentOutStream out_stream(SnapshotFS(), marker_path);
+  }
 }
 
 }  // namespace oneflow
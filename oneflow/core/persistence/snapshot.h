@@ -48,14 +48,20 @@ class SnapshotWriter final {
   OF_DISALLOW_COPY_AND_MOVE(SnapshotWriter);
   SnapshotWriter() = delete;
   explicit SnapshotWriter(const std::string& snapshot_root_path);
+  // writes go through Global<SnapshotWriteQueue> when is_async and the queue is enabled
+  SnapshotWriter(const std::string& snapshot_root_path, bool is_async);
   ~SnapshotWriter() = default;
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // blocks until every async write of the snapshot is complete
+  void Flush();
+  // marks the snapshot complete, after all its files when writes are async
   void Close();
 
  private:
   const std::string root_path_;
+  const bool is_async_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,120 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/snapshot_write_queue.h"
+#include "oneflow/core/memory/host_caching_allocator.h"
+
+namespace oneflow {
+
+SnapshotWriteQueue::SnapshotWriteQueue(fs::FileSystem* fs, int32_t worker_num,
+                                       size_t max_staging_bytes)
+    : fs_(fs), max_staging_bytes_(max_staging_bytes), staging_bytes_(0), io_pool_(worker_num) {}
+
+SnapshotWriteQueue::~SnapshotWriteQueue() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this]() { return root_path2state_.empty(); });
+}
+
+void SnapshotWriteQueue::Write(const std::string& root_path, const std::string& file_path,
+                               const char* data, size_t size) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // a blob larger than the whole budget still goes through, alone
+    cond_.wait(lock, [&]() {
+      return staging_bytes_ == 0 || staging_bytes_ + size <= max_staging_bytes_;
+    });
+    staging_bytes_ += size;
+    root_path2state_[root_path].pending_cnt += 1;
+    CHECK(pending_file_paths_.emplace(file_path).second)
+        << "snapshot file written twice, path: " << file_path;
+  }
+  char* staging = static_cast<char*>(HostCachingAllocator::Get()->Allocate(size, nullptr));
+  std::memcpy(staging, data, size);
+  io_pool_.AddWork([this, root_path, file_path, staging, size]() {
+    std::unique_ptr<fs::WritableFile> file;
+    fs_->NewWritableFile(file_path, &file);
+    file->Append(staging, size);
+    file->Close();
+    HostCachingAllocator::Get()->Deallocate(staging);
+    OnFileWritten(root_path, file_path, size);
+  });
+}
+
+void SnapshotWriteQueue::WriteMarker(const std::string& root_path,
+                                     const std::string& marker_path) {
+  std::vector<std::string> ready_marker_paths;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    RootState* state = &root_path2state_[root_path];
+    state->pending_cnt += 1;
+    state->marker_paths.push_back(marker_path);
+    ready_marker_paths = TakeReadyMarkers(state);
+  }
+  if (!ready_marker_paths.empty()) {
+    io_pool_.AddWork([this, root_path, ready_marker_paths]() {
+      WriteMarkers(root_path, ready_marker_paths);
+    });
+  }
+}
+
+void SnapshotWriteQueue::WaitUntilWritten(const std::string& file_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&]() { return pending_file_paths_.count(file_path) == 0; });
+}
+
+void SnapshotWriteQueue::WaitUntilRootWritten(const std::string& root_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&]() { return root_path2state_.count(root_path) == 0; });
+}
+
+void SnapshotWriteQueue::OnFileWritten(const std::string& root_path, const std::string& file_path,
+                                       size_t size) {
+  std::vector<std::string> ready_marker_paths;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    staging_bytes_ -= size;
+    pending_file_paths_.erase(file_path);
+    RootState* state = &root_path2state_.at(root_path);
+    state->pending_cnt -= 1;
+    ready_marker_paths = TakeReadyMarkers(state);
+    if (state->pending_cnt == 0) { root_path2state_.erase(root_path); }
+    cond_.notify_all();
+  }
+  if (!ready_marker_paths.empty()) { WriteMarkers(root_path, ready_marker_paths); }
+}
+
+void SnapshotWriteQueue::WriteMarkers(const std::string& root_path,
+                                      const std::vector<std::string>& marker_paths) {
+  for (const std::string& marker_path : marker_paths) {
+    std::unique_ptr<fs::WritableFile> file;
+    fs_->NewWritableFile(marker_path, &file);
+    file->Close();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  RootState* state = &root_path2state_.at(root_path);
+  state->pending_cnt -= marker_paths.size();
+  if (state->pending_cnt == 0) { root_path2state_.erase(root_path); }
+  cond_.notify_all();
+}
+
+std::vector<std::string> SnapshotWriteQueue::TakeReadyMarkers(RootState* state) {
+  std::vector<std::string> ready_marker_paths;
+  if (state->pending_cnt == static_cast<int64_t>(state->marker_paths.size())) {
+    ready_marker_paths.swap(state->marker_paths);
+  }
+  return ready_marker_paths;
+}
+
+}  // namespace oneflow
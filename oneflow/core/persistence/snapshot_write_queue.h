@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_QUEUE_H_
+#define ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_QUEUE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Writes snapshot files on a pool of background threads, so that saving a snapshot overlaps with
+// the iterations after it instead of stalling them.
+//
+// Write copies the data into a staging buffer and returns, it only blocks while the staged bytes
+// would exceed max_staging_bytes. Writes are tracked per snapshot root, so that the marker file of
+// a root is created only after every file of it is complete.
+class SnapshotWriteQueue final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotWriteQueue);
+  SnapshotWriteQueue(fs::FileSystem* fs, int32_t worker_num, size_t max_staging_bytes);
+  // waits for all the writes enqueued
+  ~SnapshotWriteQueue();
+
+  void Write(const std::string& root_path, const std::string& file_path, const char* data,
+             size_t size);
+  // creates the empty marker file once no write of root_path is pending any more
+  void WriteMarker(const std::string& root_path, const std::string& marker_path);
+  // blocks until the write of file_path, if any, is complete
+  void WaitUntilWritten(const std::string& file_path);
+  // blocks until no write of root_path, files and markers, is pending
+  void WaitUntilRootWritten(const std::string& root_path);
+
+ private:
+  struct RootState {
+    // file and marker writes not complete yet
+    int64_t pending_cnt = 0;
+    std::vector<std::string> marker_paths;
+  };
+
+  void OnFileWritten(const std::string& root_path, const std::string& file_path, size_t size);
+  void WriteMarkers(const std::string& root_path, const std::vector<std::string>& marker_paths);
+  // moves out the markers of root_path when they are the only pending writes of it
+  std::vector<std::string> TakeReadyMarkers(RootState* state);
+
+  fs::FileSystem* fs_;
+  const size_t max_staging_bytes_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  size_t staging_bytes_;
+  HashMap<std::string, RootState> root_path2state_;
+  HashSet<std::string> pending_file_paths_;
+  // destroyed first, joining the workers before the state they use is gone
+  ThreadPool io_pool_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_QUEUE_H_
@@ -0,0 +1,159 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/persistence/snapshot_write_queue.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+std::string MakeEmptyTestDir(fs::FileSystem* file_system, const std::string& name) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir = JoinPath(current_dir, name);
+  file_system->MakeEmptyDir(dir);
+  return dir;
+}
+
+std::string ReadFile(fs::FileSystem* file_system, const std::string& path) {
+  std::string content(file_system->GetFileSize(path), '\0');
+  std::unique_ptr<fs::RandomAccessFile> file;
+  file_system->NewRandomAccessFile(path, &file);
+  file->Read(0, content.size(), &content.at(0));
+  return content;
+}
+
+void SyncWrite(fs::FileSystem* file_system, const std::string& path, const char* data,
+               size_t size) {
+  std::unique_ptr<fs::WritableFile> file;
+  file_system->NewWritableFile(path, &file);
+  file->Append(data, size);
+  file->Close();
+}
+
+}  // namespace
+
+TEST(SnapshotWriteQueue, marker_after_files) {
+  fs::PosixFileSystem file_system;
+  const std::string root = MakeEmptyTestDir(&file_system, "tmp_test_snapshot_write_queue");
+  const std::string marker_path = JoinPath(root, "snapshot_done");
+  std::vector<std::string> contents;
+  {
+    // staging budget smaller than the sum of the files, later writes wait for earlier ones
+    SnapshotWriteQueue write_queue(&file_system, 2, 1 << 20);
+    FOR_RANGE(int64_t, i, 0, 8) {
+      std::string content(300 << 10, static_cast<char>('a' + i));
+      write_queue.Write(root, JoinPath(root, std::to_string(i)), content.data(), content.size());
+      // the source may be overwritten as soon as Write returns
+      std::fill(content.begin(), content.end(), 'z');
+      contents.push_back(std::string(300 << 10, static_cast<char>('a' + i)));
+    }
+    write_queue.WriteMarker(root, marker_path);
+    write_queue.WaitUntilWritten(JoinPath(root, "0"));
+    ASSERT_EQ(ReadFile(&file_system, JoinPath(root, "0")), contents.at(0));
+  }
+  ASSERT_TRUE(file_system.FileExists(marker_path));
+  FOR_RANGE(int64_t, i, 0, 8) {
+    ASSERT_EQ(ReadFile(&file_system, JoinPath(root, std::to_string(i))), contents.at(i));
+  }
+  file_system.RecursivelyDeleteDir(root);
+}
+
+TEST(SnapshotWriteQueue, wait_until_root_written) {
+  fs::PosixFileSystem file_system;
+  const std::string root = MakeEmptyTestDir(&file_system, "tmp_test_snapshot_write_queue_root");
+  const std::string other_root =
+      MakeEmptyTestDir(&file_system, "tmp_test_snapshot_write_queue_other_root");
+  SnapshotWriteQueue write_queue(&file_system, 2, 1 << 20);
+  // nothing pending
+  write_queue.WaitUntilRootWritten(root);
+  FOR_RANGE(int64_t, i, 0, 8) {
+    const std::string content(300 << 10, static_cast<char>('a' + i));
+    write_queue.Write(root, JoinPath(root, std::to_string(i)), content.data(), content.size());
+    write_queue.Write(other_root, JoinPath(other_root, std::to_string(i)), content.data(),
+                      content.size());
+  }
+  write_queue.WaitUntilRootWritten(root);
+  FOR_RANGE(int64_t, i, 0, 8) {
+    ASSERT_EQ(ReadFile(&file_system, JoinPath(root, std::to_string(i))),
+              std::string(300 << 10, static_cast<char>('a' + i)));
+  }
+  write_queue.WaitUntilRootWritten(other_root);
+  file_system.RecursivelyDeleteDir(root);
+  file_system.RecursivelyDeleteDir(other_root);
+}
+
+TEST(SnapshotWriteQueue, benchmark_training_step_stall) {
+  fs::PosixFileSystem file_system;
+  const std::string root = MakeEmptyTestDir(&file_system, "tmp_bench_snapshot_write_queue");
+  // a checkpoint of 16 variables of 4MiB, saved every 4 steps of about 20ms compute
+  const int64_t var_num = 16;
+  const std::vector<char> variable(4 << 20, 1);
+  const int64_t step_num = 16;
+  const int64_t save_interval = 4;
+  auto Compute = []() {
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {}
+  };
+  auto RunSteps = [&](const std::function<void(const std::string&)>& Save) {
+    double stall_ms = 0;
+    FOR_RANGE(int64_t, step, 0, step_num) {
+      Compute();
+      if ((step + 1) % save_interval == 0) {
+        const std::string snapshot_path = JoinPath(root, "snapshot_" + std::to_string(step));
+        file_system.CreateDir(snapshot_path);
+        const auto start = std::chrono::steady_clock::now();
+        Save(snapshot_path);
+        stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                              - start)
+                        .count();
+      }
+    }
+    return stall_ms / (step_num / save_interval);
+  };
+  const double sync_stall_ms = RunSteps([&](const std::string& snapshot_path) {
+    FOR_RANGE(int64_t, i, 0, var_num) {
+      SyncWrite(&file_system, JoinPath(snapshot_path, std::to_string(i)), variable.data(),
+                variable.size());
+    }
+    SyncWrite(&file_system, JoinPath(snapshot_path, "snapshot_done"), nullptr, 0);
+  });
+  file_system.MakeEmptyDir(root);
+  double async_stall_ms = 0;
+  {
+    SnapshotWriteQueue write_queue(&file_system, 4, 1 << 30);
+    async_stall_ms = RunSteps([&](const std::string& snapshot_path) {
+      FOR_RANGE(int64_t, i, 0, var_num) {
+        write_queue.Write(snapshot_path, JoinPath(snapshot_path, std::to_string(i)),
+                          variable.data(), variable.size());
+      }
+      write_queue.WriteMarker(snapshot_path, JoinPath(snapshot_path, "snapshot_done"));
+    });
+  }
+  LOG(INFO) << "stall of the training step saving a checkpoint of "
+            << var_num * variable.size() / (1 << 20) << "MiB, sync: " << sync_stall_ms
+            << " ms, async: " << async_stall_ms << " ms";
+  file_system.RecursivelyDeleteDir(root);
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -0,0 +1,334 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr uint32_t kIndexMagic = 0x4f465256;  // "OFRV"
+constexpr size_t kIndexAlignment = 8;
+
+enum WireType { kVarint = 0, kFixed64 = 1, kLengthDelimited = 2, kFixed32 = 5 };
+
+struct WireField {
+  uint32_t number;
+  uint32_t wire_type;
+  // the value of varint fields, the length delimited, fixed32 and fixed64 ones are [data, size)
+  uint64_t varint;
+  const char* data;
+  size_t size;
+};
+
+bool ReadVarint(const char** ptr, const char* end, uint64_t* val) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *ptr < end; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(**ptr);
+    *ptr += 1;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *val = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// returns false at the end of [*ptr, end), fails on malformed input
+bool ReadField(const char** ptr, const char* end, WireField* field) {
+  if (*ptr >= end) { return false; }
+  uint64_t tag = 0;
+  CHECK(ReadVarint(ptr, end, &tag)) << "malformed OFRecord";
+  field->number = static_cast<uint32_t>(tag >> 3);
+  field->wire_type = static_cast<uint32_t>(tag & 7);
+  field->data = *ptr;
+  switch (field->wire_type) {
+    case kVarint: CHECK(ReadVarint(ptr, end, &field->varint)) << "malformed OFRecord"; break;
+    case kFixed64: field->size = 8; break;
+    case kFixed32: field->size = 4; break;
+    case kLengthDelimited: {
+      uint64_t size = 0;
+      CHECK(ReadVarint(ptr, end, &size)) << "malformed OFRecord";
+      field->data = *ptr;
+      field->size = size;
+      break;
+    }
+    default: LOG(FATAL) << "unsupported wire type " << field->wire_type << " in OFRecord";
+  }
+  if (field->wire_type != kVarint) {
+    CHECK_LE(field->size, static_cast<size_t>(end - field->data)) << "truncated OFRecord";
+    *ptr = field->data + field->size;
+  }
+  return true;
+}
+
+int64_t CountVarints(const char* data, size_t size) {
+  int64_t cnt = 0;
+  FOR_RANGE(size_t, i, 0, size) { cnt += (static_cast<uint8_t>(data[i]) & 0x80) == 0; }
+  return cnt;
+}
+
+template<typename ValueT, typename T>
+int64_t CopyFixedValues(const char* data, size_t size, T* dst, int64_t n) {
+  const int64_t cnt = std::min<int64_t>(size / sizeof(ValueT), n);
+  if (std::is_same<ValueT, T>::value) {
+    std::memcpy(dst, data, cnt * sizeof(T));
+  } else {
+    FOR_RANGE(int64_t, i, 0, cnt) {
+      ValueT val;
+      std::memcpy(&val, data + i * sizeof(ValueT), sizeof(ValueT));
+      dst[i] = static_cast<T>(val);
+    }
+  }
+  return cnt;
+}
+
+template<typename ValueT, typename T>
+int64_t CopyVarintValues(const char* data, size_t size, T* dst, int64_t n) {
+  const char* ptr = data;
+  const char* end = data + size;
+  int64_t cnt = 0;
+  uint64_t val = 0;
+  while (cnt < n && ptr < end) {
+    CHECK(ReadVarint(&ptr, end, &val)) << "malformed OFRecord";
+    dst[cnt] = static_cast<T>(static_cast<ValueT>(val));
+    cnt += 1;
+  }
+  return cnt;
+}
+
+// copies up to n values of a field of a numeric list, packed or not
+template<typename T>
+int64_t CopyFieldValues(Feature::KindCase kind_case, const WireField& field, T* dst, int64_t n) {
+  if (field.wire_type == kVarint) {
+    CHECK(kind_case == Feature::kInt32List || kind_case == Feature::kInt64List);
+    if (kind_case == Feature::kInt32List) {
+      dst[0] = static_cast<T>(static_cast<int32_t>(field.varint));
+    } else {
+      dst[0] = static_cast<T>(static_cast<int64_t>(field.varint));
+    }
+    return 1;
+  }
+  switch (kind_case) {
+    case Feature::kFloatList: return CopyFixedValues<float>(field.data, field.size, dst, n);
+    case Feature::kDoubleList: return CopyFixedValues<double>(field.data, field.size, dst, n);
+    case Feature::kInt32List: return CopyVarintValues<int32_t>(field.data, field.size, dst, n);
+    case Feature::kInt64List: return CopyVarintValues<int64_t>(field.data, field.size, dst, n);
+    default: UNIMPLEMENTED();
+  }
+  return 0;
+}
+
+int CompareKey(const char* lhs, size_t lhs_size, const char* rhs, size_t rhs_size) {
+  const int ret = std::memcmp(lhs, rhs, std::min(lhs_size, rhs_size));
+  if (ret != 0) { return ret; }
+  return lhs_size < rhs_size ? -1 : (lhs_size > rhs_size ? 1 : 0);
+}
+
+}  // namespace
+
+struct OFRecordView::IndexEntry {
+  uint32_t key_offset;
+  uint32_t key_size;
+  uint32_t value_offset;
+  uint32_t value_size;
+  int32_t kind_case;
+};
+
+struct OFRecordView::IndexFooter {
+  uint32_t record_size;
+  uint32_t entry_num;
+  uint32_t magic;
+  uint32_t reserved;
+};
+
+int64_t OFRecordFeatureView::value_size() const {
+  const char* ptr = data_;
+  const char* end = data_ + size_;
+  WireField field;
+  int64_t cnt = 0;
+  while (ReadField(&ptr, end, &field)) {
+    if (field.number != 1) { continue; }
+    if (kind_case_ == Feature::kBytesList || field.wire_type != kLengthDelimited) {
+      cnt += 1;
+    } else if (kind_case_ == Feature::kFloatList) {
+      cnt += field.size / sizeof(float);
+    } else if (kind_case_ == Feature::kDoubleList) {
+      cnt += field.size / sizeof(double);
+    } else {
+      cnt += CountVarints(field.data, field.size);
+    }
+  }
+  return cnt;
+}
+
+void OFRecordFeatureView::GetBytes(int64_t idx, const char** data, size_t* size) const {
+  CHECK(has_bytes_list());
+  const char* ptr = data_;
+  const char* end = data_ + size_;
+  WireField field;
+  while (ReadField(&ptr, end, &field)) {
+    if (field.number != 1 || field.wire_type != kLengthDelimited) { continue; }
+    if (idx == 0) {
+      *data = field.data;
+      *size = field.size;
+      return;
+    }
+    idx -= 1;
+  }
+  LOG(FATAL) << "bytes list index out of range";
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyValues(T* dst, int64_t n) const {
+  const char* ptr = data_;
+  const char* end = data_ + size_;
+  WireField field;
+  int64_t copied = 0;
+  while (copied < n && ReadField(&ptr, end, &field)) {
+    if (field.number != 1) { continue; }
+    copied += CopyFieldValues(kind_case_, field, dst + copied, n - copied);
+  }
+  CHECK_EQ(copied, n) << "list of " << copied << " values, " << n << " requested";
+}
+
+#define INSTANTIATE_COPY_VALUES(type_cpp, type_proto) \
+  template void OFRecordFeatureView::CopyValues<type_cpp>(type_cpp * dst, int64_t n) const;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_COPY_VALUES, POD_DATA_TYPE_SEQ);
+#undef INSTANTIATE_COPY_VALUES
+
+OFRecordView::OFRecordView(const TensorBuffer& buffer) {
+  CHECK_EQ(buffer.data_type(), DataType::kChar);
+  const size_t size = buffer.elem_cnt();
+  CHECK_GE(size, sizeof(IndexFooter));
+  const char* data = buffer.data<char>();
+  IndexFooter footer;
+  std::memcpy(&footer, data + size - sizeof(IndexFooter), sizeof(IndexFooter));
+  CHECK_EQ(footer.magic, kIndexMagic) << "OFRecord without index";
+  const size_t index_offset = RoundUp(footer.record_size, kIndexAlignment);
+  CHECK_EQ(index_offset + footer.entry_num * sizeof(IndexEntry) + sizeof(IndexFooter), size);
+  record_ = data;
+  entries_ = reinterpret_cast<const IndexEntry*>(data + index_offset);
+  entry_num_ = footer.entry_num;
+}
+
+void OFRecordView::BuildIndex(TensorBuffer* buffer) {
+  CHECK_EQ(buffer->data_type(), DataType::kChar);
+  const size_t record_size = buffer->elem_cnt();
+  CHECK_LE(record_size, GetMaxVal<uint32_t>());
+  const char* record = buffer->data<char>();
+  std::vector<IndexEntry> entries;
+  const char* ptr = record;
+  const char* end = record + record_size;
+  WireField field;
+  while (ReadField(&ptr, end, &field)) {
+    if (field.number != 1 || field.wire_type != kLengthDelimited) { continue; }
+    // a map entry: the name is field 1, the feature field 2
+    IndexEntry entry{0, 0, 0, 0, Feature::KIND_NOT_SET};
+    const char* entry_ptr = field.data;
+    const char* entry_end = field.data + field.size;
+    WireField entry_field;
+    while (ReadField(&entry_ptr, entry_end, &entry_field)) {
+      if (entry_field.wire_type != kLengthDelimited) { continue; }
+      if (entry_field.number == 1) {
+        entry.key_offset = entry_field.data - record;
+        entry.key_size = entry_field.size;
+      } else if (entry_field.number == 2) {
+        const char* feature_ptr = entry_field.data;
+        const char* feature_end = entry_field.data + entry_field.size;
+        WireField list_field;
+        while (ReadField(&feature_ptr, feature_end, &list_field)) {
+          // the field numbers of the lists are their kind cases, the last one of a oneof wins
+          if (list_field.wire_type != kLengthDelimited || list_field.number < Feature::kBytesList
+              || list_field.number > Feature::kInt64List) {
+            continue;
+          }
+          entry.kind_case = list_field.number;
+          entry.value_offset = list_field.data - record;
+          entry.value_size = list_field.size;
+        }
+      }
+    }
+    entries.push_back(entry);
+  }
+  auto Less = [record](const IndexEntry& lhs, const IndexEntry& rhs) {
+    return CompareKey(record + lhs.key_offset, lhs.key_size, record + rhs.key_offset,
+                      rhs.key_size)
+           < 0;
+  };
+  std::stable_sort(entries.begin(), entries.end(), Less);
+  // a name appearing twice keeps its last feature, as parsing into a map does
+  size_t entry_num = 0;
+  FOR_RANGE(size_t, i, 0, entries.size()) {
+    if (i + 1 < entries.size() && !Less(entries.at(i), entries.at(i + 1))) { continue; }
+    entries.at(entry_num) = entries.at(i);
+    entry_num += 1;
+  }
+  entries.resize(entry_num);
+
+  const size_t index_offset = RoundUp(record_size, kIndexAlignment);
+  const size_t total_size =
+      index_offset + entries.size() * sizeof(IndexEntry) + sizeof(IndexFooter);
+  if (total_size > buffer->capacity()) {
+    TensorBuffer grown;
+    grown.Resize(Shape({static_cast<int64_t>(total_size)}), DataType::kChar);
+    std::memcpy(grown.mut_data<char>(), record, record_size);
+    buffer->Swap(&grown);
+  } else {
+    buffer->Resize(Shape({static_cast<int64_t>(total_size)}));
+    CHECK_EQ(buffer->data<char>(), record);
+  }
+  char* data = buffer->mut_data<char>();
+  std::memset(data + record_size, 0, index_offset - record_size);
+  std::memcpy(data + index_offset, entries.data(), entries.size() * sizeof(IndexEntry));
+  IndexFooter footer{static_cast<uint32_t>(record_size), static_cast<uint32_t>(entries.size()),
+                     kIndexMagic, 0};
+  std::memcpy(data + total_size - sizeof(IndexFooter), &footer, sizeof(IndexFooter));
+}
+
+const OFRecordView::IndexEntry* OFRecordView::LowerBound(const std::string& name) const {
+  return std::lower_bound(entries_, entries_ + entry_num_, name,
+                          [this](const IndexEntry& entry, const std::string& name) {
+                            return CompareKey(record_ + entry.key_offset, entry.key_size,
+                                              name.data(), name.size())
+                                   < 0;
+                          });
+}
+
+bool OFRecordView::HasFeature(const std::string& name) const {
+  OFRecordFeatureView feature;
+  return FindFeature(name, &feature);
+}
+
+bool OFRecordView::FindFeature(const std::string& name, OFRecordFeatureView* feature) const {
+  const IndexEntry* entry = LowerBound(name);
+  if (entry == entries_ + entry_num_
+      || CompareKey(record_ + entry->key_offset, entry->key_size, name.data(), name.size())
+             != 0) {
+    return false;
+  }
+  *feature = OFRecordFeatureView(static_cast<Feature::KindCase>(entry->kind_case),
+                                 record_ + entry->value_offset, entry->value_size);
+  return true;
+}
+
+OFRecordFeatureView OFRecordView::GetFeature(const std::string& name) const {
+  OFRecordFeatureView feature;
+  CHECK(FindFeature(name, &feature)) << "Field " << name << " not found";
+  return feature;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+#define ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+// A feature of a serialized OFRecord, referring to the bytes of its list in the record.
+class OFRecordFeatureView final {
+ public:
+  OFRecordFeatureView() : kind_case_(Feature::KIND_NOT_SET), data_(nullptr), size_(0) {}
+  OFRecordFeatureView(Feature::KindCase kind_case, const char* data, size_t size)
+      : kind_case_(kind_case), data_(data), size_(size) {}
+  ~OFRecordFeatureView() = default;
+
+  Feature::KindCase kind_case() const { return kind_case_; }
+  bool has_bytes_list() const { return kind_case_ == Feature::kBytesList; }
+  bool has_float_list() const { return kind_case_ == Feature::kFloatList; }
+  bool has_double_list() const { return kind_case_ == Feature::kDoubleList; }
+  bool has_int32_list() const { return kind_case_ == Feature::kInt32List; }
+  bool has_int64_list() const { return kind_case_ == Feature::kInt64List; }
+
+  // number of values of the list
+  int64_t value_size() const;
+  // value idx of a bytes list, pointing into the record
+  void GetBytes(int64_t idx, const char** data, size_t* size) const;
+  // the first n values of a float, double, int32 or int64 list, converted to T
+  template<typename T>
+  void CopyValues(T* dst, int64_t n) const;
+
+ private:
+  Feature::KindCase kind_case_;
+  const char* data_;
+  size_t size_;
+};
+
+// Lazily parsed OFRecord, kept in the TensorBuffer of chars it was loaded into. BuildIndex scans
+// the wire format once and appends an index of the features, sorted by name, to the serialized
+// record:
+//   | record | padding to 8 bytes | index entries | footer |
+// Views of a buffer with an index look features up by binary search and read their values in
+// place, nothing is parsed into protobuf messages.
+class OFRecordView final {
+ public:
+  explicit OFRecordView(const TensorBuffer& buffer);
+  ~OFRecordView() = default;
+
+  // buffer holds a serialized OFRecord, it is only reallocated when its capacity is too small
+  static void BuildIndex(TensorBuffer* buffer);
+
+  int64_t feature_size() const { return entry_num_; }
+  bool HasFeature(const std::string& name) const;
+  bool FindFeature(const std::string& name, OFRecordFeatureView* feature) const;
+  OFRecordFeatureView GetFeature(const std::string& name) const;
+
+ private:
+  struct IndexEntry;
+  struct IndexFooter;
+
+  const IndexEntry* LowerBound(const std::string& name) const;
+
+  const char* record_;
+  const IndexEntry* entries_;
+  int64_t entry_num_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
@@ -44,6 +44,8 @@ class ThreadMgr final {
 
 void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
 void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback);
+void ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                 const std::function<void(int64_t begin, int64_t end)>& Callback);
 
 }  // namespace oneflow
 
@@ -17,28 +17,201 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+const int64_t kWorkerSpinCount = 64;
+const int64_t kAutoGrainChunksPerThread = 8;
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int32_t current_worker_id = -1;
+
+}  // namespace
+
+struct ThreadPool::ParallelForCtx {
+  const std::function<void(int64_t, int64_t)>* fn;
+  int64_t grain;
+  std::atomic<int64_t> remaining;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool is_done;
+};
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : queues_(thread_num),
+      threads_(thread_num),
+      work_cnt_(0),
+      pending_task_cnt_(0),
+      idle_worker_cnt_(0),
+      is_shutdown_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { queues_.at(i).reset(new WorkerQueue()); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    is_shutdown_ = true;
+    idle_cond_.notify_all();
   }
+  for (std::thread& thread : threads_) { thread.join(); }
+}
+
+int32_t ThreadPool::CurrentWorkerId() const {
+  return current_pool == this ? current_worker_id : -1;
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  Task task;
+  task.work = work;
+  task.ctx = nullptr;
+  Push(CurrentWorkerId(), std::move(task));
+}
+
+void ThreadPool::Push(int32_t worker_id, Task&& task) {
+  if (worker_id < 0) {
+    worker_id = work_cnt_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  }
+  {
+    WorkerQueue* queue = queues_.at(worker_id).get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->tasks.push_back(std::move(task));
+  }
+  pending_task_cnt_.fetch_add(1);
+  if (idle_worker_cnt_.load() > 0) {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cond_.notify_one();
+  }
+}
+
+bool ThreadPool::Pop(int32_t worker_id, Task* task) {
+  WorkerQueue* queue = queues_.at(worker_id).get();
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (queue->tasks.empty()) { return false; }
+  *task = std::move(queue->tasks.back());
+  queue->tasks.pop_back();
+  pending_task_cnt_.fetch_sub(1);
+  return true;
+}
+
+bool ThreadPool::Steal(int32_t thief_id, Task* task) {
+  const int32_t queue_num = queues_.size();
+  const int32_t start = thief_id >= 0 ? thief_id + 1 : 0;
+  FOR_RANGE(int32_t, i, 0, queue_num) {
+    const int32_t victim_id = (start + i) % queue_num;
+    if (victim_id == thief_id) { continue; }
+    WorkerQueue* queue = queues_.at(victim_id).get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (queue->tasks.empty()) { continue; }
+    *task = std::move(queue->tasks.front());
+    queue->tasks.pop_front();
+    pending_task_cnt_.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+// takes a pending chunk of ctx, the newest one of the own queue, or else the oldest, and biggest,
+// one of another queue
+bool ThreadPool::TakeRange(int32_t worker_id, const ParallelForCtx* ctx, Task* task) {
+  const int32_t queue_num = queues_.size();
+  const int32_t start = worker_id >= 0 ? worker_id : 0;
+  auto IsOfCtx = [ctx](const Task& queued) { return queued.ctx == ctx; };
+  FOR_RANGE(int32_t, i, 0, queue_num) {
+    const int32_t queue_id = (start + i) % queue_num;
+    WorkerQueue* queue = queues_.at(queue_id).get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    std::deque<Task>::iterator it = queue->tasks.end();
+    if (queue_id == worker_id) {
+      auto r_it = std::find_if(queue->tasks.rbegin(), queue->tasks.rend(), IsOfCtx);
+      if (r_it != queue->tasks.rend()) { it = std::next(r_it).base(); }
+    } else {
+      it = std::find_if(queue->tasks.begin(), queue->tasks.end(), IsOfCtx);
+    }
+    if (it == queue->tasks.end()) { continue; }
+    *task = std::move(*it);
+    queue->tasks.erase(it);
+    pending_task_cnt_.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  current_pool = this;
+  current_worker_id = worker_id;
+  Task task;
+  while (true) {
+    bool has_task = false;
+    FOR_RANGE(int64_t, i, 0, kWorkerSpinCount) {
+      has_task = Pop(worker_id, &task) || Steal(worker_id, &task);
+      if (has_task || pending_task_cnt_.load() == 0) { break; }
+    }
+    if (has_task) {
+      RunTask(worker_id, &task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_worker_cnt_.fetch_add(1);
+    idle_cond_.wait(lock, [this]() { return pending_task_cnt_.load() > 0 || is_shutdown_; });
+    idle_worker_cnt_.fetch_sub(1);
+    if (is_shutdown_ && pending_task_cnt_.load() == 0) { break; }
+  }
+}
+
+void ThreadPool::RunTask(int32_t worker_id, Task* task) {
+  if (task->ctx == nullptr) {
+    task->work();
+    task->work = std::function<void()>();
+  } else {
+    RunRange(worker_id, task->ctx, task->begin, task->end);
+  }
+}
+
+void ThreadPool::RunRange(int32_t worker_id, ParallelForCtx* ctx, int64_t begin, int64_t end) {
+  while (end - begin > ctx->grain) {
+    const int64_t mid = begin + (end - begin) / 2;
+    Task task;
+    task.ctx = ctx;
+    task.begin = mid;
+    task.end = end;
+    Push(worker_id, std::move(task));
+    end = mid;
+  }
+  (*ctx->fn)(begin, end);
+  if (ctx->remaining.fetch_sub(end - begin) == end - begin) {
+    // ctx lives on the stack of ParallelFor, it must not be touched after the lock is released
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    ctx->is_done = true;
+    ctx->cond.notify_all();
+  }
+}
+
+void ThreadPool::ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                             const std::function<void(int64_t, int64_t)>& fn) {
+  if (end <= begin) { return; }
+  const int64_t num = end - begin;
+  if (grain <= 0) {
+    grain = std::max<int64_t>(1, num / (thread_num() * kAutoGrainChunksPerThread));
+  }
+  if (num <= grain || thread_num() <= 1) {
+    fn(begin, end);
+    return;
+  }
+  ParallelForCtx ctx;
+  ctx.fn = &fn;
+  ctx.grain = grain;
+  ctx.remaining = num;
+  ctx.is_done = false;
+  const int32_t worker_id = CurrentWorkerId();
+  RunRange(worker_id, &ctx, begin, end);
+  Task task;
+  while (ctx.remaining.load() > 0 && TakeRange(worker_id, &ctx, &task)) {
+    RunRange(worker_id, &ctx, task.begin, task.end);
+  }
+  std::unique_lock<std::mutex> lock(ctx.mutex);
+  ctx.cond.wait(lock, [&ctx]() { return ctx.is_done; });
 }
 
 }  // namespace oneflow
@@ -16,11 +16,13 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
+#include <deque>
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
 
 namespace oneflow {
 
+// Work-stealing thread pool. Every worker owns a deque: the owner pushes and pops at the back,
+// idle workers steal from the front of the others.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,11 +33,45 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  // Calls fn(chunk_begin, chunk_end) on disjoint chunks covering [begin, end) and blocks until all
+  // of them finish. Ranges are split in halves lazily, so idle workers steal the biggest pending
+  // pieces; a chunk is never split below grain elements. grain <= 0 picks a grain from the range
+  // size. The calling thread helps running the chunks of this range while waiting, other tasks
+  // are left to the workers, as they may block on something only this caller does later.
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                   const std::function<void(int64_t, int64_t)>& fn);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  struct ParallelForCtx;
+  struct Task {
+    std::function<void()> work;
+    ParallelForCtx* ctx;
+    int64_t begin;
+    int64_t end;
+  };
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void WorkerLoop(int32_t worker_id);
+  void Push(int32_t worker_id, Task&& task);
+  bool Pop(int32_t worker_id, Task* task);
+  bool Steal(int32_t thief_id, Task* task);
+  bool TakeRange(int32_t worker_id, const ParallelForCtx* ctx, Task* task);
+  void RunTask(int32_t worker_id, Task* task);
+  void RunRange(int32_t worker_id, ParallelForCtx* ctx, int64_t begin, int64_t end);
+  int32_t CurrentWorkerId() const;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
   std::vector<std::thread> threads_;
 
   std::atomic<size_t> work_cnt_;
+  std::atomic<int64_t> pending_task_cnt_;
+  std::atomic<int32_t> idle_worker_cnt_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_shutdown_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,142 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <thread>
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+namespace {
+
+// The old MultiThreadLoop: one statically split range per thread.
+void StaticSplitLoop(ThreadPool* pool, size_t num, const std::function<void(size_t)>& Callback) {
+  const size_t thread_num = std::min<size_t>(num, pool->thread_num());
+  BalancedSplitter bs(num, thread_num);
+  BlockingCounter bc(thread_num);
+  FOR_RANGE(size_t, range_id, 0, thread_num) {
+    pool->AddWork([&bc, &bs, range_id, &Callback] {
+      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+}
+
+// The first 8 items cost 8x more, the way a few big JPEGs do in a decoding batch.
+void SkewedWork(size_t i) {
+  const int64_t cost_us = i < 8 ? 800 : 100;
+  const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(cost_us);
+  while (std::chrono::steady_clock::now() < end) {}
+}
+
+double MaxLatencyMs(const std::function<void()>& Loop, int64_t repeat) {
+  double max_ms = 0;
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    const auto start = std::chrono::steady_clock::now();
+    Loop();
+    const auto end = std::chrono::steady_clock::now();
+    max_ms = std::max(max_ms, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return max_ms;
+}
+
+}  // namespace
+
+TEST(ThreadPool, parallel_for_visits_every_index_once) {
+  ThreadPool pool(4);
+  for (int64_t grain : {-1, 1, 3, 1000}) {
+    std::vector<std::atomic<int32_t>> visits(997);
+    for (auto& visit : visits) { visit = 0; }
+    pool.ParallelFor(0, visits.size(), grain, [&](int64_t begin, int64_t end) {
+      ASSERT_LT(begin, end);
+      if (grain > 0) { ASSERT_LE(end - begin, grain); }
+      FOR_RANGE(int64_t, i, begin, end) { visits.at(i) += 1; }
+    });
+    for (const auto& visit : visits) { ASSERT_EQ(visit.load(), 1); }
+  }
+}
+
+TEST(ThreadPool, nested_parallel_for_and_add_work) {
+  ThreadPool pool(3);
+  std::atomic<int64_t> sum(0);
+  BlockingCounter bc(8);
+  FOR_RANGE(int64_t, i, 0, 8) {
+    pool.AddWork([&]() {
+      pool.ParallelFor(0, 100, 7, [&](int64_t begin, int64_t end) {
+        pool.ParallelFor(begin, end, 1, [&](int64_t b, int64_t e) { sum += e - b; });
+      });
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(sum.load(), 800);
+}
+
+TEST(ThreadPool, parallel_for_leaves_other_tasks_to_the_workers) {
+  ThreadPool pool(2);
+  std::atomic<bool> second_chunk_started(false);
+  std::atomic<bool> other_task_queued(false);
+  std::atomic<std::thread::id> caller_id;
+  std::atomic<bool> caller_in_parallel_for(false);
+  std::atomic<bool> other_task_ran_in_parallel_for(false);
+  BlockingCounter bc(2);
+  pool.AddWork([&]() {
+    caller_id = std::this_thread::get_id();
+    caller_in_parallel_for = true;
+    pool.ParallelFor(0, 2, 1, [&](int64_t begin, int64_t end) {
+      if (begin == 0) {
+        // queued on the caller's own worker while the other chunk still runs, the way an actor
+        // queues a blocking rpc
+        while (!second_chunk_started) {}
+        pool.AddWork([&]() {
+          other_task_ran_in_parallel_for =
+              std::this_thread::get_id() == caller_id.load() && caller_in_parallel_for;
+          bc.Decrease();
+        });
+        other_task_queued = true;
+      } else {
+        second_chunk_started = true;
+        while (!other_task_queued) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+    });
+    caller_in_parallel_for = false;
+    bc.Decrease();
+  });
+  bc.WaitUntilCntEqualZero();
+  ASSERT_FALSE(other_task_ran_in_parallel_for.load());
+}
+
+TEST(ThreadPool, skewed_loop_tail_latency) {
+  ThreadPool pool(4);
+  const size_t num = 64;
+  const int64_t repeat = 10;
+  const double static_ms =
+      MaxLatencyMs([&]() { StaticSplitLoop(&pool, num, SkewedWork); }, repeat);
+  const double stealing_ms = MaxLatencyMs(
+      [&]() {
+        pool.ParallelFor(0, num, 1, [](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, i, begin, end) { SkewedWork(i); }
+        });
+      },
+      repeat);
+  LOG(INFO) << "skewed loop max latency, static split: " << static_ms
+            << " ms, work stealing: " << stealing_ms << " ms";
+}
+
+}  // namespace oneflow
@@ -13,18 +13,19 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-#include <cstdlib>
 #include "oneflow/core/vm/cpu_allocator.h"
-#include "oneflow/core/common/util.h"
+#include "oneflow/core/memory/host_caching_allocator.h"
 
 namespace oneflow {
 namespace vm {
 
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
-  *mem_ptr = reinterpret_cast<char*>(std::malloc(size));
+  *mem_ptr = reinterpret_cast<char*>(HostCachingAllocator::Get()->Allocate(size, nullptr));
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  HostCachingAllocator::Get()->Deallocate(mem_ptr);
+}
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
@@ -17,19 +17,36 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// rounds spinning while the vm waits for nothing but the streams, before yielding the cpu
+const int64_t kSpinRoundNum = 1024;
+
+}  // namespace
+
 OneflowVM::OneflowVM(const Resource& resource, int64_t this_machine_id)
     : vm_(ObjectMsgPtr<vm::VirtualMachine>::New(vm::MakeVmDesc(resource, this_machine_id).Get())) {
   OBJECT_MSG_LIST_UNSAFE_FOR_EACH_PTR(vm_->mut_thread_ctx_list(), thread_ctx) {
-    auto thread_pool = std::make_unique<ThreadPool>(1);
-    CHECK(thread_ctx2thread_pool_.emplace(thread_ctx, std::move(thread_pool)).second);
+    worker_threads_.emplace_back([thread_ctx]() { thread_ctx->LoopRun(); });
+  }
+}
+
+OneflowVM::~OneflowVM() {
+  OBJECT_MSG_LIST_UNSAFE_FOR_EACH_PTR(vm_->mut_thread_ctx_list(), thread_ctx) {
+    thread_ctx->mut_pending_instruction_list()->Close();
   }
+  for (auto& worker_thread : worker_threads_) { worker_thread.join(); }
 }
 
-void OneflowVM::TryReceiveAndRun() {
-  for (auto& pair : thread_ctx2thread_pool_) {
-    vm::ThreadCtx* thread_ctx = pair.first;
-    if (thread_ctx->mut_pending_instruction_list()->Empty()) { continue; }
-    pair.second->AddWork([thread_ctx]() { thread_ctx->TryReceiveAndRun(); });
+void OneflowVM::ScheduleUntilEmpty() {
+  int64_t idle_round_num = 0;
+  while (!vm_->Empty()) {
+    vm_->Schedule();
+    if (vm_->pending_msg_list().empty() && vm_->ready_instruction_list().empty()) {
+      if (++idle_round_num > kSpinRoundNum) { std::this_thread::yield(); }
+    } else {
+      idle_round_num = 0;
+    }
   }
 }
 
@@ -19,7 +19,7 @@ limitations under the License.
 #include "oneflow/core/vm/interpret_type.h"
 #include "oneflow/core/vm/vm_desc.msg.h"
 #include "oneflow/core/vm/virtual_machine.msg.h"
-#include "oneflow/core/thread/thread_pool.h"
+#include <thread>
 
 namespace oneflow {
 
@@ -33,14 +33,16 @@ class OneflowVM final {
   OneflowVM(const OneflowVM&) = delete;
   OneflowVM(OneflowVM&&) = delete;
   OneflowVM(const Resource& resource, int64_t this_machine_id);
-  ~OneflowVM() = default;
+  ~OneflowVM();
 
   vm::VirtualMachine* mut_vm() { return vm_.Mutable(); }
-  void TryReceiveAndRun();
+  // schedules on the calling thread until every received instruction is done, the instructions of
+  // the other streams run on a thread of their own per thread ctx
+  void ScheduleUntilEmpty();
 
  private:
   ObjectMsgPtr<vm::VirtualMachine> vm_;
-  HashMap<vm::ThreadCtx*, std::unique_ptr<ThreadPool>> thread_ctx2thread_pool_;
+  std::vector<std::thread> worker_threads_;
 };
 
 }  // namespace oneflow
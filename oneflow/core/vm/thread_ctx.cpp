@@ -29,8 +29,9 @@ ObjectMsgConditionListStatus ThreadCtx::ReceiveAndRun() {
   OBJECT_MSG_LIST(Instruction, pending_instruction_link) tmp_list;
   ObjectMsgConditionListStatus status = mut_pending_instruction_list()->MoveTo(&tmp_list);
   OBJECT_MSG_LIST_FOR_EACH_PTR(&tmp_list, instruction) {
-    stream_type.Run(instruction);
+    CHECK_GT(instruction->ref_cnt(), 1);
     tmp_list.Erase(instruction);
+    stream_type.Run(instruction);
   }
   return status;
 }
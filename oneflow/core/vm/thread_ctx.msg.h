@@ -37,6 +37,9 @@ OBJECT_MSG_BEGIN(ThreadCtx);
   OBJECT_MSG_DEFINE_LIST_HEAD(Stream, thread_ctx_stream_link, stream_list);
   OBJECT_MSG_DEFINE_CONDITION_LIST_HEAD(Instruction, pending_instruction_link,
                                         pending_instruction_list);
+  // instructions dispatched to this thread during a round of scheduling, moved into
+  // pending_instruction_list at once at the end of the round. accessed by the vm thread only
+  OBJECT_MSG_DEFINE_LIST_HEAD(Instruction, pending_instruction_link, dispatched_instruction_list);
 
   OF_PRIVATE ObjectMsgConditionListStatus ReceiveAndRun();
   OF_PUBLIC ObjectMsgConditionListStatus TryReceiveAndRun();
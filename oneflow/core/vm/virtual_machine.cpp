@@ -122,12 +122,12 @@ const MirroredObject* VirtualMachine::GetMirroredObject(int64_t logical_object_i
 }
 
 template<int64_t (*TransformLogicalObjectId)(int64_t), typename DoEachT>
-void VirtualMachine::ForEachMirroredObject(Id2LogicalObject* id2logical_object,
+void VirtualMachine::ForEachMirroredObject(LogicalObjectFinder* logical_object_finder,
                                            const Operand& operand, int64_t global_device_id,
                                            const DoEachT& DoEach) {
   int64_t logical_object_id = operand.logical_object_id();
   logical_object_id = TransformLogicalObjectId(logical_object_id);
-  auto* logical_object = id2logical_object->FindPtr(logical_object_id);
+  auto* logical_object = logical_object_finder->FindPtr(logical_object_id);
   if (logical_object == nullptr) { return; }
   auto* map = logical_object->mut_global_device_id2mirrored_object();
   if (operand.has_all_mirrored_object()) {
@@ -140,16 +140,18 @@ void VirtualMachine::ForEachMirroredObject(Id2LogicalObject* id2logical_object,
 
 template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
 void VirtualMachine::ForEachConstMirroredObject(
-    InterpretType interpret_type, Id2LogicalObject* id2logical_object,
+    InterpretType interpret_type, LogicalObjectFinder* logical_object_finder,
     const ModifiedOperand<kConstModifier, mem_zone_modifier>& const_operand,
     int64_t global_device_id, const DoEachT& DoEach) {
   const Operand& operand = const_operand.operand();
   if (interpret_type == InterpretType::kCompute) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
-    ForEachMirroredObject<&IdUtil::GetValueId>(id2logical_object, operand, global_device_id,
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
+    ForEachMirroredObject<&IdUtil::GetValueId>(logical_object_finder, operand, global_device_id,
                                                DoEach);
   } else if (interpret_type == InterpretType::kInfer) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
   } else {
     UNIMPLEMENTED();
   }
@@ -157,12 +159,13 @@ void VirtualMachine::ForEachConstMirroredObject(
 
 template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
 void VirtualMachine::ForEachConstMirroredObject(
-    const InterpretType interpret_type, Id2LogicalObject* id2logical_object,
+    const InterpretType interpret_type, LogicalObjectFinder* logical_object_finder,
     const ModifiedOperand<kDataMutableModifier, mem_zone_modifier>& mutable_operand,
     int64_t global_device_id, const DoEachT& DoEach) {
   const Operand& operand = mutable_operand.operand();
   if (interpret_type == InterpretType::kCompute) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
   } else if (interpret_type == InterpretType::kInfer) {
     // do nothing
   } else {
@@ -172,15 +175,16 @@ void VirtualMachine::ForEachConstMirroredObject(
 
 template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
 void VirtualMachine::ForEachMutMirroredObject(
-    const InterpretType interpret_type, Id2LogicalObject* id2logical_object,
+    const InterpretType interpret_type, LogicalObjectFinder* logical_object_finder,
     const ModifiedOperand<kDataMutableModifier, mem_zone_modifier>& mutable_operand,
     int64_t global_device_id, const DoEachT& DoEach) {
   const Operand& operand = mutable_operand.operand();
   if (interpret_type == InterpretType::kCompute) {
-    ForEachMirroredObject<&IdUtil::GetValueId>(id2logical_object, operand, global_device_id,
+    ForEachMirroredObject<&IdUtil::GetValueId>(logical_object_finder, operand, global_device_id,
                                                DoEach);
   } else if (interpret_type == InterpretType::kInfer) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
   } else {
     UNIMPLEMENTED();
   }
@@ -188,16 +192,18 @@ void VirtualMachine::ForEachMutMirroredObject(
 
 template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
 void VirtualMachine::ForEachMutMirroredObject(
-    const InterpretType interpret_type, Id2LogicalObject* id2logical_object,
+    const InterpretType interpret_type, LogicalObjectFinder* logical_object_finder,
     const ModifiedOperand<kTypeAndDataMutableModifier, mem_zone_modifier>& mut2_operand,
     int64_t global_device_id, const DoEachT& DoEach) {
   const Operand& operand = mut2_operand.operand();
   if (interpret_type == InterpretType::kCompute) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
-    ForEachMirroredObject<&IdUtil::GetValueId>(id2logical_object, operand, global_device_id,
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
+    ForEachMirroredObject<&IdUtil::GetValueId>(logical_object_finder, operand, global_device_id,
                                                DoEach);
   } else if (interpret_type == InterpretType::kInfer) {
-    ForEachMirroredObject<&IdUtil::GetTypeId>(id2logical_object, operand, global_device_id, DoEach);
+    ForEachMirroredObject<&IdUtil::GetTypeId>(logical_object_finder, operand, global_device_id,
+                                              DoEach);
   } else {
     UNIMPLEMENTED();
   }
@@ -230,6 +236,8 @@ void VirtualMachine::ConnectInstruction(Instruction* src_instruction,
 
 void VirtualMachine::ConsumeMirroredObjects(Id2LogicalObject* id2logical_object,
                                             NewInstructionList* new_instruction_list) {
+  // no logical object is added or erased meanwhile
+  LogicalObjectFinder logical_object_finder(id2logical_object);
   OBJECT_MSG_LIST_FOR_EACH_PTR(new_instruction_list, instruction) {
     int64_t global_device_id = instruction->stream().global_device_id();
     InterpretType interpret_type = instruction->stream().stream_type_id().interpret_type();
@@ -242,17 +250,17 @@ void VirtualMachine::ConsumeMirroredObjects(Id2LogicalObject* id2logical_object,
     const auto& operands = instruction->instr_msg().operand();
     for (const auto& operand : operands) {
       if (operand->has_mut_operand()) {
-        ForEachMutMirroredObject<kDeviceMemZoneModifier>(interpret_type, id2logical_object,
+        ForEachMutMirroredObject<kDeviceMemZoneModifier>(interpret_type, &logical_object_finder,
                                                          operand->mut_operand(), global_device_id,
                                                          ConsumeMutMirroredObject);
       } else if (operand->has_mut2_operand()) {
-        ForEachMutMirroredObject<kDeviceMemZoneModifier>(interpret_type, id2logical_object,
+        ForEachMutMirroredObject<kDeviceMemZoneModifier>(interpret_type, &logical_object_finder,
                                                          operand->mut2_operand(), global_device_id,
                                                          ConsumeMutMirroredObject);
       } else if (operand->has_init_symbol_operand()) {
         const auto& symbol_operand = operand->init_symbol_operand().operand();
         CHECK(symbol_operand.has_sole_mirrored_object());
-        ForEachMutMirroredObject<kHostConstMemZoneModifier>(interpret_type, id2logical_object,
+        ForEachMutMirroredObject<kHostConstMemZoneModifier>(interpret_type, &logical_object_finder,
                                                             operand->init_symbol_operand(), 0,
                                                             ConsumeMutMirroredObject);
       } else {
@@ -262,24 +270,24 @@ void VirtualMachine::ConsumeMirroredObjects(Id2LogicalObject* id2logical_object,
     for (const auto& operand : operands) {
       if (operand->has_const_operand()) {
         ForEachConstMirroredObject<kDeviceMemZoneModifier>(
-            interpret_type, id2logical_object, operand->const_operand(), global_device_id,
+            interpret_type, &logical_object_finder, operand->const_operand(), global_device_id,
             ConsumeConstMirroredObject);
       } else if (operand->has_mut_operand()) {
-        ForEachConstMirroredObject<kDeviceMemZoneModifier>(interpret_type, id2logical_object,
+        ForEachConstMirroredObject<kDeviceMemZoneModifier>(interpret_type, &logical_object_finder,
                                                            operand->mut_operand(), global_device_id,
                                                            ConsumeConstMirroredObject);
       } else if (operand->has_symbol_operand()) {
         const auto& symbol_operand = operand->symbol_operand().operand();
         CHECK(symbol_operand.has_sole_mirrored_object());
-        ForEachConstMirroredObject<kHostConstMemZoneModifier>(interpret_type, id2logical_object,
-                                                              operand->symbol_operand(), 0,
-                                                              ConsumeConstMirroredObject);
+        ForEachConstMirroredObject<kHostConstMemZoneModifier>(
+            interpret_type, &logical_object_finder, operand->symbol_operand(), 0,
+            ConsumeConstMirroredObject);
       } else if (operand->has_init_symbol_operand()) {
         const auto& symbol_operand = operand->init_symbol_operand().operand();
         CHECK(symbol_operand.has_sole_mirrored_object());
-        ForEachConstMirroredObject<kHostConstMemZoneModifier>(interpret_type, id2logical_object,
-                                                              operand->init_symbol_operand(), 0,
-                                                              ConsumeConstMirroredObject);
+        ForEachConstMirroredObject<kHostConstMemZoneModifier>(
+            interpret_type, &logical_object_finder, operand->init_symbol_operand(), 0,
+            ConsumeConstMirroredObject);
       } else {
         // do nothing
       }
@@ -328,12 +336,18 @@ void VirtualMachine::DispatchAndPrescheduleInstructions(
     if (stream_type.SharingVirtualMachineThread()) {
       stream_type.Run(this, instruction);
     } else {
-      stream->mut_thread_ctx()->mut_pending_instruction_list()->PushBack(instruction);
+      stream->mut_thread_ctx()->mut_dispatched_instruction_list()->PushBack(instruction);
     }
     TryMoveWaitingToReady(instruction, &prescheduled,
                           [stream](Instruction* dst) { return &dst->stream() == stream; });
   }
   prescheduled.MoveTo(ready_instruction_list);
+  // one lock and wakeup per thread instead of one per instruction
+  OBJECT_MSG_LIST_UNSAFE_FOR_EACH_PTR(mut_thread_ctx_list(), thread_ctx) {
+    auto* dispatched_instruction_list = thread_ctx->mut_dispatched_instruction_list();
+    if (dispatched_instruction_list->empty()) { continue; }
+    thread_ctx->mut_pending_instruction_list()->MoveFrom(dispatched_instruction_list);
+  }
 }
 
 template<typename ReadyList, typename IsEdgeReadyT>
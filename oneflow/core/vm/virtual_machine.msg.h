@@ -32,6 +32,31 @@ namespace oneflow {
 namespace vm {
 
 class VmDesc;
+
+// Finds logical objects by id, remembering what it found. The instructions scheduled together
+// mostly share their symbols and blobs, which spares most lookups in the skiplist of ids.
+template<typename Id2LogicalObjectT>
+class CachedLogicalObjectFinder final {
+ public:
+  CachedLogicalObjectFinder(const CachedLogicalObjectFinder&) = delete;
+  CachedLogicalObjectFinder(CachedLogicalObjectFinder&&) = delete;
+  explicit CachedLogicalObjectFinder(Id2LogicalObjectT* id2logical_object)
+      : id2logical_object_(id2logical_object) {}
+  ~CachedLogicalObjectFinder() = default;
+
+  LogicalObject* FindPtr(int64_t logical_object_id) {
+    const auto& iter = id2found_.find(logical_object_id);
+    if (iter != id2found_.end()) { return iter->second; }
+    LogicalObject* logical_object = id2logical_object_->FindPtr(logical_object_id);
+    id2found_.emplace(logical_object_id, logical_object);
+    return logical_object;
+  }
+
+ private:
+  Id2LogicalObjectT* id2logical_object_;
+  HashMap<int64_t, LogicalObject*> id2found_;
+};
+
 // clang-format off
 OBJECT_MSG_BEGIN(VirtualMachine);
   // methods
@@ -71,6 +96,7 @@ OBJECT_MSG_BEGIN(VirtualMachine);
   using ReadyInstructionList = VirtualMachine::ready_instruction_list_ObjectMsgListType;
   using Id2LogicalObject = VirtualMachine::id2logical_object_ObjectMsgSkipListType;
   using ActiveStreamList = VirtualMachine::active_stream_list_ObjectMsgListType;
+  using LogicalObjectFinder = CachedLogicalObjectFinder<Id2LogicalObject>;
 
   void ReleaseInstruction(Instruction* instruction,
                             /*out*/ ReadyInstructionList* ready_instruction_list);
@@ -80,27 +106,27 @@ OBJECT_MSG_BEGIN(VirtualMachine);
   void MakeInstructions(TmpPendingInstrMsgList* instr_msg_list,
                          /*out*/ NewInstructionList* ret_instruction_list);
   template<int64_t (*TransformLogicalObjectId)(int64_t), typename DoEachT>
-  void ForEachMirroredObject(Id2LogicalObject* id2logical_object,
+  void ForEachMirroredObject(LogicalObjectFinder* logical_object_finder,
                              const Operand& operand,
                              int64_t global_device_id, const DoEachT& DoEach);
   template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
   void ForEachConstMirroredObject(const InterpretType interpret_type,
-                                  Id2LogicalObject* id2logical_object,
+                                  LogicalObjectFinder* logical_object_finder,
                                   const ModifiedOperand<kConstModifier, mem_zone_modifier>& const_operand,
                                   int64_t global_device_id, const DoEachT& DoEach);
   template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
   void ForEachConstMirroredObject(const InterpretType interpret_type,
-                                  Id2LogicalObject* id2logical_object,
+                                  LogicalObjectFinder* logical_object_finder,
                                   const ModifiedOperand<kDataMutableModifier, mem_zone_modifier>& mutable_operand,
                                   int64_t global_device_id, const DoEachT& DoEach);
   template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
   void ForEachMutMirroredObject(const InterpretType interpret_type,
-                                Id2LogicalObject* id2logical_object,
+                                LogicalObjectFinder* logical_object_finder,
                                 const ModifiedOperand<kDataMutableModifier, mem_zone_modifier>& mutable_operand,
                                 int64_t global_device_id, const DoEachT& DoEach);
   template<OperandMemZoneModifier mem_zone_modifier, typename DoEachT>
   void ForEachMutMirroredObject(const InterpretType interpret_type,
-                                Id2LogicalObject* id2logical_object,
+                                LogicalObjectFinder* logical_object_finder,
                                 const ModifiedOperand<kTypeAndDataMutableModifier, mem_zone_modifier>& mut2_operand,
                                 int64_t global_device_id, const DoEachT& DoEach);
   enum OperandAccessType {
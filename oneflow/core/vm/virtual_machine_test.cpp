@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <iostream>
+#include <chrono>
+#include <thread>
 #include "oneflow/core/vm/virtual_machine.msg.h"
 #include "oneflow/core/vm/control_stream_type.h"
 #include "oneflow/core/vm/vm_desc.msg.h"
@@ -32,6 +34,8 @@ namespace test {
 
 namespace {
 
+using InstructionMsgList = OBJECT_MSG_LIST(InstructionMsg, instr_msg_link);
+
 TEST(VirtualMachine, __Init__) {
   auto vm_desc = ObjectMsgPtr<VmDesc>::New(TestUtil::NewVmResourceDesc().Get());
   TestUtil::AddStreamDescByInstrNames(vm_desc.Mutable(), {"Nop", "NewObject"});
@@ -47,6 +51,38 @@ TEST(VirtualMachine, ToDot) {
   // std::cout << std::endl;
 }
 
+TEST(VirtualMachine, nop_instruction_throughput) {
+  TestResourceDescScope scope(1, 1);
+  auto vm_desc = ObjectMsgPtr<VmDesc>::New(TestUtil::NewVmResourceDesc().Get());
+  TestUtil::AddStreamDescByInstrNames(vm_desc.Mutable(), {"Nop", "NewObject"});
+  auto vm = ObjectMsgPtr<VirtualMachine>::New(vm_desc.Get());
+  std::vector<std::thread> worker_threads;
+  OBJECT_MSG_LIST_UNSAFE_FOR_EACH_PTR(vm->mut_thread_ctx_list(), thread_ctx) {
+    worker_threads.emplace_back([thread_ctx]() { thread_ctx->LoopRun(); });
+  }
+  const int64_t object_num = 16;
+  const int64_t instr_num = 100000;
+  InstructionMsgList list;
+  std::vector<int64_t> object_ids;
+  FOR_RANGE(int64_t, i, 0, object_num) {
+    object_ids.push_back(TestUtil::NewObject(&list, "cpu", "0:0"));
+  }
+  FOR_RANGE(int64_t, i, 0, instr_num) {
+    auto nop_instr_msg = NewInstruction("Nop");
+    nop_instr_msg->add_mut_operand(object_ids.at(i % object_num));
+    list.EmplaceBack(std::move(nop_instr_msg));
+  }
+  const auto start = std::chrono::steady_clock::now();
+  vm->Receive(&list);
+  while (!vm->Empty()) { vm->Schedule(); }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  LOG(INFO) << "nop instructions: " << instr_num / elapsed.count() << " instructions/s";
+  OBJECT_MSG_LIST_UNSAFE_FOR_EACH_PTR(vm->mut_thread_ctx_list(), thread_ctx) {
+    thread_ctx->mut_pending_instruction_list()->Close();
+  }
+  for (auto& worker_thread : worker_threads) { worker_thread.join(); }
+}
+
 }  // namespace
 
 }  // namespace test
@@ -47,12 +47,8 @@ Maybe<void> Run(const InstructionListProto& instruction_list_proto) {
     instr_msg_list.EmplaceBack(std::move(instr_msg));
   }
   auto* oneflow_vm = JUST(GlobalMaybe<OneflowVM>());
-  auto* vm = oneflow_vm->mut_vm();
-  vm->Receive(&instr_msg_list);
-  while (!vm->Empty()) {
-    vm->Schedule();
-    oneflow_vm->TryReceiveAndRun();
-  }
+  oneflow_vm->mut_vm()->Receive(&instr_msg_list);
+  oneflow_vm->ScheduleUntilEmpty();
   return Maybe<void>::Ok();
 }
 
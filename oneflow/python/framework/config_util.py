@@ -108,6 +108,99 @@ def comm_net_worker_num(val):
     sess.config_proto.resource.comm_net_worker_num = val
 
 
+@oneflow_export("config.comm_net_stripe_num")
+def api_comm_net_stripe_num(val: int) -> None:
+    r"""Set up the number of sockets to each peer in epoll mode network.
+            Large register bodies are read in stripes over all of them, which helps a single
+            peer saturate a fast link. Works best with comm_net_worker_num no less than it.
+
+    Args:
+        val (int): number of sockets to each peer
+    """
+    return enable_if.unique([comm_net_stripe_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_stripe_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 1
+    sess.config_proto.resource.comm_net_stripe_num = val
+
+
+@oneflow_export("config.enable_comm_net_zero_copy")
+def api_enable_comm_net_zero_copy(val: bool = True) -> None:
+    r"""Whether or not send large register bodies with MSG_ZEROCOPY in epoll mode network.
+            It needs Linux 4.14 or later and pays off for bodies of tens of KiB or more.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_comm_net_zero_copy, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_comm_net_zero_copy(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.enable_comm_net_zero_copy = val
+
+
+@oneflow_export("config.enable_comm_net_shared_memory")
+def api_enable_comm_net_shared_memory(val: bool = True) -> None:
+    r"""Whether or not exchange messages and register bodies with processes on the same host
+            over shared memory instead of loopback sockets in epoll mode network.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_comm_net_shared_memory, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_comm_net_shared_memory(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.enable_comm_net_shared_memory = val
+
+
+@oneflow_export("config.compile_thread_num")
+def api_compile_thread_num(val: int) -> None:
+    r"""Set up the number of threads compiling a job into a plan, 1 compiles on a single thread.
+
+    Args:
+        val (int): number of threads, the number of cpu cores by default
+    """
+    return enable_if.unique([compile_thread_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def compile_thread_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.compile_thread_num = val
+
+
+@oneflow_export("config.plan_cache_dir")
+def api_plan_cache_dir(val: str) -> None:
+    r"""Set up a directory on the master where the compiled plans of job sets are cached, so that
+            restarting with the same jobs, resource and machines skips compilation.
+            Variables without a random seed are initialized with the seeds drawn when the cached
+            plan was compiled.
+
+    Args:
+        val (str): path of the directory, empty to disable the cache
+    """
+    return enable_if.unique([plan_cache_dir, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def plan_cache_dir(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    sess.config_proto.resource.plan_cache_dir = val
+
+
 @oneflow_export("config.max_mdsave_worker_num")
 def api_max_mdsave_worker_num(val: int) -> None:
     r"""Set up max number of workers for mdsave process.
@@ -262,6 +355,41 @@ def thread_enable_local_message_queue(val):
     sess.config_proto.resource.thread_enable_local_message_queue = val
 
 
+@oneflow_export("config.thread_enable_lock_free_message_queue")
+def api_thread_enable_lock_free_message_queue(val: bool) -> None:
+    """Whether or not actor threads receive messages through a lock-free multi-producer
+    single-consumer queue instead of a mutex protected one.
+
+    Args:
+        val (bool):  True or False
+    """
+    return enable_if.unique([thread_enable_lock_free_message_queue, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def thread_enable_lock_free_message_queue(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.thread_enable_lock_free_message_queue = val
+
+
+@oneflow_export("config.thread_lock_free_message_queue_capacity")
+def api_thread_lock_free_message_queue_capacity(val: int) -> None:
+    """Set up the ring buffer capacity of the lock-free message queue of each actor thread.
+
+    Args:
+        val (int):  number of messages, rounded up to a power of two
+    """
+    return enable_if.unique([thread_lock_free_message_queue_capacity, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def thread_lock_free_message_queue_capacity(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.thread_lock_free_message_queue_capacity = val
+
+
 @oneflow_export("config.enable_debug_mode")
 def api_enable_debug_mode(val: bool) -> None:
     r"""Whether use debug mode or not.
@@ -330,6 +458,60 @@ def enable_model_io_v2(val):
     sess.config_proto.io_conf.enable_model_io_v2 = val
 
 
+@oneflow_export("config.enable_async_snapshot")
+def api_enable_async_snapshot(val: bool = True) -> None:
+    r"""Whether or not write snapshots on background threads, so that saving a checkpoint
+    overlaps with the training iterations after it. The snapshot_done file of a snapshot is
+    created once all its files are written.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_async_snapshot, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_async_snapshot(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.enable_async_snapshot = val
+
+
+@oneflow_export("config.async_snapshot_worker_num")
+def api_async_snapshot_worker_num(val: int) -> None:
+    r"""Set up the number of threads writing snapshots in the background.
+
+    Args:
+        val (int): number of threads
+    """
+    return enable_if.unique([async_snapshot_worker_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def async_snapshot_worker_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.async_snapshot_worker_num = val
+
+
+@oneflow_export("config.async_snapshot_max_staging_mbyte")
+def api_async_snapshot_max_staging_mbyte(val: int) -> None:
+    r"""Set up the size of host memory holding the copies of variables waiting to be written,
+    saving blocks when it is used up.
+
+    Args:
+        val (int): size in MiB
+    """
+    return enable_if.unique([async_snapshot_max_staging_mbyte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def async_snapshot_max_staging_mbyte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.async_snapshot_max_staging_mbyte = val
+
+
 @oneflow_export("config.collect_act_event")
 def api_collect_act_event(val: bool = True) -> None:
     r"""Whether or not collect active event.
@@ -520,6 +702,58 @@ def nccl_fusion_broadcast(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_fusion_broadcast = val
 
 
+@oneflow_export("config.collective_boxing.enable_cpu_backend")
+def api_enable_cpu_backend(val: bool = True) -> None:
+    r"""Whether or not use collective boxing between cpu devices
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_cpu_backend, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_cpu_backend(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.enable_cpu_backend = val
+
+
+@oneflow_export("config.collective_boxing.cpu_chunk_size_kb")
+def api_cpu_chunk_size_kb(val: int) -> None:
+    r"""Set up the size of the chunks pipelined by cpu collective boxing
+
+    Args:
+        val (int): int number, e.g. 256(kb)
+    """
+    return enable_if.unique([cpu_chunk_size_kb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_chunk_size_kb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_chunk_size_kb = val
+
+
+@oneflow_export("config.collective_boxing.cpu_recursive_threshold_kb")
+def api_cpu_recursive_threshold_kb(val: int) -> None:
+    r"""Set up the size up to which cpu collective boxing uses recursive halving and doubling
+            instead of a ring, with a power of two devices
+
+    Args:
+        val (int): int number, e.g. 64(kb)
+    """
+    return enable_if.unique([cpu_recursive_threshold_kb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_recursive_threshold_kb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_recursive_threshold_kb = val
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("Nothing happened because the session is running")
@@ -342,10 +342,26 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config(
+    "static_mem_alloc_policy_white_list.policy_dynamic_storage_allocation"
+)
+def policy_dynamic_storage_allocation(func_desc):
+    r"""A static memory allocation policy called: dynamic_storage_allocation
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_dynamic_storage_allocation_algo"
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     r"""Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_dynamic_storage_allocation_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -357,6 +373,7 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_dynamic_storage_allocation_algo",
     ]
 
 
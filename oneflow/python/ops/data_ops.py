@@ -288,6 +288,9 @@ def ofrecord_reader(
     random_shuffle: bool = False,
     shuffle_buffer_size: int = 1024,
     shuffle_after_epoch: bool = False,
+    lazy_parse: bool = False,
+    num_reader_threads: int = 1,
+    prefetch_buffer_size: int = 4,
     name: Optional[str] = None,
 ) -> remote_blob_util.BlobDef:
     if name is None:
@@ -305,6 +308,9 @@ def ofrecord_reader(
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
         .Attr("part_name_suffix_length", part_name_suffix_length)
+        .Attr("lazy_parse", lazy_parse)
+        .Attr("num_reader_threads", num_reader_threads)
+        .Attr("prefetch_buffer_size", prefetch_buffer_size)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
@@ -66,6 +66,8 @@ def api_ofrecord_image_decoder_random_crop(
     seed: Optional[int] = None,
     random_area: Sequence[float] = [0.08, 1.0],
     random_aspect_ratio: Sequence[float] = [0.75, 1.333333],
+    target_resize_x: int = 0,
+    target_resize_y: int = 0,
     name: str = "OFRecordImageDecoderRandomCrop",
 ) -> BlobDef:
     assert isinstance(name, str)
@@ -80,6 +82,8 @@ def api_ofrecord_image_decoder_random_crop(
             random_seed=seed,
             random_area=random_area,
             random_aspect_ratio=random_aspect_ratio,
+            target_resize_x=target_resize_x,
+            target_resize_y=target_resize_y,
             name=name,
         ),
     )
@@ -95,6 +99,8 @@ class OFRecordImageDecoderRandomCropModule(module_util.Module):
         random_seed: Optional[int],
         random_area: Sequence[float],
         random_aspect_ratio: Sequence[float],
+        target_resize_x: int,
+        target_resize_y: int,
         name: str,
     ):
         module_util.Module.__init__(self, name)
@@ -108,6 +114,8 @@ class OFRecordImageDecoderRandomCropModule(module_util.Module):
             .Attr("num_attempts", num_attempts)
             .Attr("random_area", random_area)
             .Attr("random_aspect_ratio", random_aspect_ratio)
+            .Attr("target_resize_x", target_resize_x)
+            .Attr("target_resize_y", target_resize_y)
             .Attr("has_seed", has_seed)
             .Attr("seed", seed)
             .CheckAndComplete()
@@ -288,6 +296,8 @@ def image_decode(
     images_bytes_buffer: BlobDef,
     dtype: dtype_util.dtype = dtype_util.uint8,
     color_space: str = "BGR",
+    target_resize_x: int = 0,
+    target_resize_y: int = 0,
     name: Optional[str] = None,
 ) -> BlobDef:
     # TODO: check color_space valiad
@@ -301,6 +311,8 @@ def image_decode(
         .Output("out")
         .Attr("color_space", color_space)
         .Attr("data_type", dtype)
+        .Attr("target_resize_x", target_resize_x)
+        .Attr("target_resize_y", target_resize_y)
         .Build()
     )
     return op.InferAndTryRun().SoleOutputBlob()
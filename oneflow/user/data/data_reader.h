@@ -31,8 +31,10 @@ class DataReader {
  public:
   using LoadTargetPtr = std::shared_ptr<LoadTarget>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
-  DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+  DataReader(user_op::KernelInitContext* ctx) : DataReader(ctx, kDataReaderBatchBufferSize) {}
+  // batch_buffer_size batches are loaded ahead of Read
+  DataReader(user_op::KernelInitContext* ctx, size_t batch_buffer_size)
+      : is_closed_(false), batch_buffer_(batch_buffer_size) {}
   virtual ~DataReader() {
     Close();
     if (load_thrd_.joinable()) { load_thrd_.join(); }
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/ofrecord_dataset.h"
 #include "oneflow/user/data/ofrecord_parser.h"
+#include "oneflow/user/data/parallel_ofrecord_dataset.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
 #include <iostream>
@@ -28,13 +29,29 @@ namespace data {
 
 class OFRecordDataReader final : public DataReader<TensorBuffer> {
  public:
-  OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
-    loader_.reset(new OFRecordDataset(ctx));
-    parser_.reset(new OFRecordParser());
+  OFRecordDataReader(user_op::KernelInitContext* ctx)
+      : DataReader<TensorBuffer>(ctx, ctx->Attr<int32_t>("prefetch_buffer_size")) {
+    int32_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
+    const int32_t num_reader_threads = ctx->Attr<int32_t>("num_reader_threads");
+    if (num_reader_threads > 1) {
+      const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+      CHECK_LE(parallel_num, ctx->Attr<int32_t>("data_part_num"));
+      BalancedSplitter bs(ctx->Attr<int32_t>("data_part_num"), parallel_num);
+      // the readers hold as many batches ahead as the batch buffer
+      const size_t queue_size =
+          RoundUp(batch_size * ctx->Attr<int32_t>("prefetch_buffer_size"), num_reader_threads)
+          / num_reader_threads;
+      loader_.reset(new ParallelOFRecordDataset(
+          DataFS(), GetOFRecordDataFilePaths(ctx), bs.At(ctx->parallel_ctx().parallel_id()),
+          num_reader_threads, queue_size, ctx->Attr<bool>("shuffle_after_epoch"),
+          Global<const IOConf>::Get()->save_downloaded_file_to_local_fs()));
+    } else {
+      loader_.reset(new OFRecordDataset(ctx));
+    }
+    parser_.reset(new OFRecordParser(ctx->Attr<bool>("lazy_parse")));
     if (ctx->Attr<bool>("random_shuffle")) {
       loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
     }
-    int32_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size, std::move(loader_)));
     StartLoadThread();
   }
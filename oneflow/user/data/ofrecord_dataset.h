@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_USER_DATA_OFRECORD_DATASET_H_
 
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/tensor_buffer_pool.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
@@ -26,6 +27,22 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+// paths of the data_part_num part files under data_dir
+inline std::vector<std::string> GetOFRecordDataFilePaths(user_op::KernelInitContext* ctx) {
+  const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+  const std::string& data_dir = ctx->Attr<std::string>("data_dir");
+  const std::string& part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
+  const int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+  std::vector<std::string> data_file_paths;
+  for (int i = 0; i < data_part_num; ++i) {
+    std::string num = std::to_string(i);
+    int32_t zero_count = std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
+    data_file_paths.push_back(
+        JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
+  }
+  return data_file_paths;
+}
+
 class OFRecordDataset final : public Dataset<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
@@ -37,17 +54,7 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
     // in stream
     data_part_num_ = ctx->Attr<int32_t>("data_part_num");
-    std::string data_dir = ctx->Attr<std::string>("data_dir");
-    std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
-    int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
-
-    for (int i = 0; i < data_part_num_; ++i) {
-      std::string num = std::to_string(i);
-      int32_t zero_count =
-          std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
-      data_file_paths_.push_back(
-          JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
-    }
+    data_file_paths_ = GetOFRecordDataFilePaths(ctx);
 
     parallel_id_ = ctx->parallel_ctx().parallel_id();
     parallel_num_ = ctx->parallel_ctx().parallel_num();
@@ -63,14 +70,12 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
-    LoadTargetPtr sample_ptr(new TensorBuffer());
-    ReadSample(*sample_ptr);
-    ret.push_back(std::move(sample_ptr));
+    ret.push_back(ReadSample());
     return ret;
   }
 
  private:
-  void ReadSample(TensorBuffer& tensor) {
+  LoadTargetPtr ReadSample() {
     int64_t OFRecord_size = -1;
     char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
     if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
@@ -78,8 +83,10 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       CHECK_EQ(in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
     }
     CHECK_GT(OFRecord_size, 0);
-    tensor.Resize(Shape({OFRecord_size}), DataType::kChar);
-    CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
+    LoadTargetPtr sample_ptr =
+        TensorBufferPool::Get()->New(Shape({OFRecord_size}), DataType::kChar);
+    CHECK_EQ(in_stream_->ReadFully(sample_ptr->mut_data<char>(), OFRecord_size), 0);
+    return sample_ptr;
   }
 
   void ShuffleAfterEpoch() {
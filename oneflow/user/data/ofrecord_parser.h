@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/data/parser.h"
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/record/record.pb.h"
+#include "oneflow/core/record/ofrecord_view.h"
 #include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
@@ -28,22 +29,36 @@ class OFRecordParser final : public Parser<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
-  OFRecordParser() = default;
+  // lazy: index the serialized records in place with OFRecordView::BuildIndex and hand the
+  // buffers out as TensorBuffer instead of parsing them into OFRecord
+  explicit OFRecordParser(bool lazy) : lazy_(lazy) {}
   ~OFRecordParser() = default;
 
   void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
              user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
-    OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
-    MultiThreadLoop(batch_data->size(), [&](size_t i) {
-      TensorBuffer* buffer = batch_data->at(i).get();
-      CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
-    });
+    if (lazy_) {
+      TensorBuffer* dptr = out_tensor->mut_dptr<TensorBuffer>();
+      MultiThreadLoop(batch_data->size(), [&](size_t i) {
+        TensorBuffer* buffer = batch_data->at(i).get();
+        OFRecordView::BuildIndex(buffer);
+        dptr[i].Swap(buffer);
+      });
+    } else {
+      OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
+      MultiThreadLoop(batch_data->size(), [&](size_t i) {
+        TensorBuffer* buffer = batch_data->at(i).get();
+        CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
+      });
+    }
     if (batch_data->size() != out_tensor->shape().elem_cnt()) {
       CHECK_EQ(out_tensor->mut_shape()->NumAxes(), 1);
       out_tensor->mut_shape()->Set(0, batch_data->size());
     }
   }
+
+ private:
+  bool lazy_;
 };
 
 }  // namespace data
@@ -0,0 +1,185 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/parallel_ofrecord_dataset.h"
+#include "oneflow/user/data/tensor_buffer_pool.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// how far the file system is asked to read ahead of a reader, and when to ask again
+constexpr size_t kReadaheadSize = 16 << 20;
+constexpr size_t kReadaheadTrigger = kReadaheadSize / 2;
+constexpr int64_t kStatsLogIntervalSec = 60;
+
+double SecondsSince(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - time).count();
+}
+
+}  // namespace
+
+ParallelOFRecordDataset::ParallelOFRecordDataset(fs::FileSystem* fs,
+                                                 const std::vector<std::string>& data_file_paths,
+                                                 Range range, int32_t reader_num,
+                                                 size_t queue_size, bool shuffle_after_epoch,
+                                                 bool with_local_copy)
+    : fs_(fs),
+      data_file_paths_(data_file_paths),
+      range_(range),
+      shuffle_after_epoch_(shuffle_after_epoch),
+      with_local_copy_(with_local_copy),
+      next_reader_id_(0),
+      epoch_done_reader_cnt_(0),
+      epoch_record_cnt_(0),
+      start_time_(std::chrono::steady_clock::now()),
+      last_log_time_(start_time_),
+      read_bytes_(0),
+      read_record_cnt_(0),
+      queued_record_cnt_(0),
+      starved_cnt_(0) {
+  CHECK_GE(range_.begin(), 0);
+  CHECK_LE(range_.end(), static_cast<int64_t>(data_file_paths_.size()));
+  CHECK_GT(range_.size(), 0);
+  CHECK_GT(reader_num, 0);
+  CHECK_GT(queue_size, 0);
+  // every reader needs a file of its own
+  reader_num = std::min<int64_t>(reader_num, range_.size());
+  FOR_RANGE(int32_t, i, 0, reader_num) {
+    queues_.emplace_back(new Buffer<LoadTargetPtr>(queue_size));
+  }
+  reader_id2epoch_done_.assign(reader_num, false);
+  FOR_RANGE(int32_t, i, 0, reader_num) {
+    readers_.emplace_back(&ParallelOFRecordDataset::ReaderLoop, this, i);
+  }
+}
+
+ParallelOFRecordDataset::~ParallelOFRecordDataset() {
+  for (auto& queue : queues_) { queue->Close(); }
+  for (std::thread& reader : readers_) { reader.join(); }
+  LOG(INFO) << StatsDebugString();
+}
+
+ParallelOFRecordDataset::LoadTargetPtrList ParallelOFRecordDataset::Next() {
+  LoadTargetPtr sample_ptr;
+  while (!sample_ptr) {
+    if (epoch_done_reader_cnt_ == static_cast<int32_t>(queues_.size())) {
+      CHECK_GT(epoch_record_cnt_, 0) << "the part files are empty";
+      reader_id2epoch_done_.assign(queues_.size(), false);
+      epoch_done_reader_cnt_ = 0;
+      epoch_record_cnt_ = 0;
+      next_reader_id_ = 0;
+    }
+    const int32_t reader_id = next_reader_id_;
+    next_reader_id_ = (next_reader_id_ + 1) % queues_.size();
+    if (reader_id2epoch_done_.at(reader_id)) { continue; }
+    Buffer<LoadTargetPtr>* queue = queues_.at(reader_id).get();
+    BufferStatus status = queue->TryReceive(&sample_ptr);
+    if (status == kBufferStatusEmpty) {
+      starved_cnt_ += 1;
+      status = queue->Receive(&sample_ptr);
+    }
+    CHECK_EQ(status, kBufferStatusSuccess);
+    // a null record marks the end of the epoch of the reader
+    if (!sample_ptr) {
+      reader_id2epoch_done_.at(reader_id) = true;
+      epoch_done_reader_cnt_ += 1;
+    }
+  }
+  epoch_record_cnt_ += 1;
+  queued_record_cnt_ -= 1;
+  if (SecondsSince(last_log_time_) >= kStatsLogIntervalSec) {
+    last_log_time_ = std::chrono::steady_clock::now();
+    VLOG(1) << StatsDebugString();
+  }
+  LoadTargetPtrList ret;
+  ret.push_back(std::move(sample_ptr));
+  return ret;
+}
+
+OFRecordReadStats ParallelOFRecordDataset::GetStats() const {
+  OFRecordReadStats stats;
+  stats.read_bytes = read_bytes_;
+  stats.read_record_cnt = read_record_cnt_;
+  stats.queued_record_cnt = queued_record_cnt_;
+  stats.starved_cnt = starved_cnt_;
+  stats.elapsed_sec = SecondsSince(start_time_);
+  return stats;
+}
+
+std::string ParallelOFRecordDataset::StatsDebugString() const {
+  const OFRecordReadStats stats = GetStats();
+  const double elapsed_sec = std::max(stats.elapsed_sec, 1e-6);
+  std::ostringstream oss;
+  oss << "ParallelOFRecordDataset of " << queues_.size() << " readers, read "
+      << stats.read_record_cnt << " records, " << (stats.read_bytes >> 20) << " MiB in "
+      << stats.elapsed_sec << " s (" << stats.read_bytes / elapsed_sec / (1 << 20) << " MiB/s, "
+      << stats.read_record_cnt / elapsed_sec << " records/s), " << stats.queued_record_cnt
+      << " records queued, waited for readers " << stats.starved_cnt << " times";
+  return oss.str();
+}
+
+void ParallelOFRecordDataset::ReaderLoop(int32_t reader_id) {
+  Buffer<LoadTargetPtr>* queue = queues_.at(reader_id).get();
+  const int32_t reader_num = queues_.size();
+  std::vector<std::string> data_file_paths = data_file_paths_;
+  for (int64_t epoch = 0;; ++epoch) {
+    if (epoch > 0 && shuffle_after_epoch_) {
+      std::mt19937 g(kOneflowDatasetSeed + epoch);
+      std::shuffle(data_file_paths.begin(), data_file_paths.end(), g);
+    }
+    for (int64_t i = range_.begin() + reader_id; i < range_.end(); i += reader_num) {
+      if (!ReadFile(data_file_paths.at(i), queue)) { return; }
+    }
+    if (queue->Send(LoadTargetPtr()) != kBufferStatusSuccess) { return; }
+  }
+}
+
+bool ParallelOFRecordDataset::ReadFile(const std::string& path, Buffer<LoadTargetPtr>* queue) {
+  PersistentInStream in_stream(fs_, std::vector<std::string>({path}), false, with_local_copy_);
+  // the local copy is read from the local file system
+  std::unique_ptr<fs::RandomAccessFile> file;
+  uint64_t file_size = 0;
+  if (!with_local_copy_) {
+    fs_->NewRandomAccessFile(path, &file);
+    file_size = fs_->GetFileSize(path);
+  }
+  uint64_t pos = 0;
+  uint64_t readahead_end = 0;
+  while (true) {
+    if (file && readahead_end < file_size && pos + kReadaheadTrigger >= readahead_end) {
+      const uint64_t begin = std::max(pos, readahead_end);
+      file->WillNeed(begin, std::min<uint64_t>(kReadaheadSize, file_size - begin));
+      readahead_end = begin + kReadaheadSize;
+    }
+    int64_t record_size = -1;
+    if (in_stream.ReadFully(reinterpret_cast<char*>(&record_size), sizeof(int64_t)) != 0) {
+      return true;
+    }
+    CHECK_GT(record_size, 0);
+    LoadTargetPtr sample_ptr = TensorBufferPool::Get()->New(Shape({record_size}), DataType::kChar);
+    CHECK_EQ(in_stream.ReadFully(sample_ptr->mut_data<char>(), record_size), 0);
+    pos += sizeof(int64_t) + record_size;
+    read_bytes_ += sizeof(int64_t) + record_size;
+    read_record_cnt_ += 1;
+    queued_record_cnt_ += 1;
+    if (queue->Send(sample_ptr) != kBufferStatusSuccess) { return false; }
+  }
+}
+
+}  // namespace data
+}  // namespace oneflow
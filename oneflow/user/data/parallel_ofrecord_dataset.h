@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_PARALLEL_OFRECORD_DATASET_H_
+#define ONEFLOW_USER_DATA_PARALLEL_OFRECORD_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/core/common/buffer.h"
+#include "oneflow/core/common/range.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+namespace data {
+
+struct OFRecordReadStats {
+  int64_t read_bytes = 0;
+  int64_t read_record_cnt = 0;
+  // records read ahead and waiting in the queues of the reader threads
+  int64_t queued_record_cnt = 0;
+  // times Next found the queue it takes from empty and had to wait for the reader
+  int64_t starved_cnt = 0;
+  double elapsed_sec = 0;
+};
+
+// OFRecord part files read by a pool of reader threads, the counterpart of OFRecordDataset for
+// storage fast enough that a single reading thread cannot keep up.
+//
+// The local part files, range of data_file_paths, are dealt out to the readers round robin, file
+// i goes to reader i % reader_num. Every reader reads its files one after another, asking the
+// file system to read ahead of it, and queues up to queue_size records followed by an end of
+// epoch marker. Next takes the records from the queues in turn, skipping the readers done with
+// the epoch until all of them are, so that an epoch yields every record exactly once and the
+// order of records only depends on the part files.
+// With shuffle_after_epoch the files are shuffled after every epoch like OFRecordDataset does,
+// every reader shuffles its own copy of the file list the same way.
+class ParallelOFRecordDataset final : public Dataset<TensorBuffer> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ParallelOFRecordDataset);
+  ParallelOFRecordDataset(fs::FileSystem* fs, const std::vector<std::string>& data_file_paths,
+                          Range range, int32_t reader_num, size_t queue_size,
+                          bool shuffle_after_epoch, bool with_local_copy);
+  ~ParallelOFRecordDataset() override;
+
+  LoadTargetPtrList Next() override;
+
+  OFRecordReadStats GetStats() const;
+  std::string StatsDebugString() const;
+
+ private:
+  void ReaderLoop(int32_t reader_id);
+  // returns false once the queue of the reader is closed
+  bool ReadFile(const std::string& path, Buffer<LoadTargetPtr>* queue);
+
+  fs::FileSystem* fs_;
+  std::vector<std::string> data_file_paths_;
+  Range range_;
+  bool shuffle_after_epoch_;
+  bool with_local_copy_;
+
+  std::vector<std::unique_ptr<Buffer<LoadTargetPtr>>> queues_;
+  std::vector<std::thread> readers_;
+  int32_t next_reader_id_;
+  // the readers whose end of epoch marker Next has taken in the current epoch
+  std::vector<bool> reader_id2epoch_done_;
+  int32_t epoch_done_reader_cnt_;
+  int64_t epoch_record_cnt_;
+
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point last_log_time_;
+  std::atomic<int64_t> read_bytes_;
+  std::atomic<int64_t> read_record_cnt_;
+  std::atomic<int64_t> queued_record_cnt_;
+  std::atomic<int64_t> starved_cnt_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_PARALLEL_OFRECORD_DATASET_H_
@@ -0,0 +1,181 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/user/data/parallel_ofrecord_dataset.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+class ParallelOFRecordDatasetTest : public testing::Test {
+ protected:
+  void SetUp() override { Global<const IOConf>::New(); }
+  void TearDown() override { Global<const IOConf>::Delete(); }
+};
+
+std::string MakeEmptyTestDir(fs::FileSystem* file_system, const std::string& name) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir = JoinPath(current_dir, name);
+  file_system->MakeEmptyDir(dir);
+  return dir;
+}
+
+// writes the records in the layout of OFRecord part files, each one preceded by its int64 size
+std::string WritePartFile(fs::FileSystem* file_system, const std::string& dir, int64_t part_id,
+                          const std::vector<std::string>& records) {
+  const std::string path = JoinPath(dir, "part-" + std::to_string(part_id));
+  std::unique_ptr<fs::WritableFile> file;
+  file_system->NewWritableFile(path, &file);
+  for (const std::string& record : records) {
+    const int64_t size = record.size();
+    file->Append(reinterpret_cast<const char*>(&size), sizeof(int64_t));
+    file->Append(record.data(), record.size());
+  }
+  file->Close();
+  return path;
+}
+
+std::string NextRecord(ParallelOFRecordDataset* dataset) {
+  auto samples = dataset->Next();
+  CHECK_EQ(samples.size(), 1);
+  return std::string(samples.at(0)->data<char>(), samples.at(0)->nbytes());
+}
+
+}  // namespace
+
+TEST_F(ParallelOFRecordDatasetTest, records_interleaved_by_reader) {
+  fs::PosixFileSystem file_system;
+  const std::string dir = MakeEmptyTestDir(&file_system, "tmp_test_parallel_ofrecord_dataset");
+  std::vector<std::string> paths;
+  std::vector<std::vector<std::string>> part_id2records(5);
+  FOR_RANGE(int64_t, part_id, 0, 5) {
+    FOR_RANGE(int64_t, i, 0, 2 + part_id) {
+      part_id2records.at(part_id).push_back("part " + std::to_string(part_id) + " record "
+                                            + std::to_string(i));
+    }
+    paths.push_back(WritePartFile(&file_system, dir, part_id, part_id2records.at(part_id)));
+  }
+  // local parts 1 to 4, reader 0 reads parts 1 and 4, reader 1 part 2 and reader 2 part 3. The
+  // readers done with the epoch are skipped until all of them are, so an epoch yields every
+  // record once.
+  std::vector<std::vector<std::string>> reader_id2records(3);
+  for (int64_t part_id : {1, 4}) {
+    for (const std::string& record : part_id2records.at(part_id)) {
+      reader_id2records.at(0).push_back(record);
+    }
+  }
+  reader_id2records.at(1) = part_id2records.at(2);
+  reader_id2records.at(2) = part_id2records.at(3);
+  std::vector<std::string> epoch_records;
+  FOR_RANGE(size_t, i, 0, reader_id2records.at(0).size()) {
+    for (const std::vector<std::string>& records : reader_id2records) {
+      if (i < records.size()) { epoch_records.push_back(records.at(i)); }
+    }
+  }
+  ASSERT_EQ(epoch_records.size(), 18);
+  ParallelOFRecordDataset dataset(&file_system, paths, Range(1, 5), 3, 2, false, false);
+  FOR_RANGE(int64_t, i, 0, 60) {
+    ASSERT_EQ(NextRecord(&dataset), epoch_records.at(i % epoch_records.size()));
+  }
+  const OFRecordReadStats stats = dataset.GetStats();
+  ASSERT_GE(stats.read_record_cnt, 60);
+  ASSERT_EQ(stats.read_record_cnt - stats.queued_record_cnt, 60);
+  file_system.RecursivelyDeleteDir(dir);
+}
+
+TEST_F(ParallelOFRecordDatasetTest, shuffle_after_epoch_is_deterministic) {
+  fs::PosixFileSystem file_system;
+  const std::string dir = MakeEmptyTestDir(&file_system, "tmp_test_parallel_ofrecord_shuffle");
+  // parts of different sizes, so that the readers finish their files at different times
+  std::vector<std::string> paths;
+  std::vector<int64_t> part_id2record_num;
+  FOR_RANGE(int64_t, part_id, 0, 8) {
+    std::vector<std::string> records;
+    FOR_RANGE(int64_t, i, 0, part_id % 3 + 1) {
+      records.push_back(std::to_string(part_id) + " " + std::to_string(i));
+    }
+    part_id2record_num.push_back(records.size());
+    paths.push_back(WritePartFile(&file_system, dir, part_id, records));
+  }
+  std::vector<std::string> records;
+  {
+    ParallelOFRecordDataset dataset(&file_system, paths, Range(0, 4), 2, 1, true, false);
+    FOR_RANGE(int64_t, i, 0, 60) { records.push_back(NextRecord(&dataset)); }
+  }
+  ParallelOFRecordDataset dataset(&file_system, paths, Range(0, 4), 2, 3, true, false);
+  FOR_RANGE(int64_t, i, 0, 60) { ASSERT_EQ(NextRecord(&dataset), records.at(i)); }
+  // every epoch takes all the records of 4 parts once, later epochs take other parts than the
+  // first 4
+  std::set<int64_t> parts;
+  std::set<std::string> epoch_records;
+  HashMap<int64_t, int64_t> part_id2epoch_record_cnt;
+  int64_t epoch_cnt = 0;
+  for (const std::string& record : records) {
+    ASSERT_TRUE(epoch_records.insert(record).second) << record;
+    const int64_t part_id = std::stoll(record.substr(0, record.find(' ')));
+    parts.insert(part_id);
+    part_id2epoch_record_cnt[part_id] += 1;
+    ASSERT_LE(part_id2epoch_record_cnt.size(), 4);
+    bool epoch_done = part_id2epoch_record_cnt.size() == 4;
+    for (const auto& pair : part_id2epoch_record_cnt) {
+      epoch_done = epoch_done && pair.second == part_id2record_num.at(pair.first);
+    }
+    if (epoch_done) {
+      epoch_records.clear();
+      part_id2epoch_record_cnt.clear();
+      epoch_cnt += 1;
+    }
+  }
+  ASSERT_GE(epoch_cnt, 5);
+  ASSERT_GT(parts.size(), 4);
+  file_system.RecursivelyDeleteDir(dir);
+}
+
+TEST_F(ParallelOFRecordDatasetTest, benchmark_reader_num) {
+  fs::PosixFileSystem file_system;
+  const std::string dir = MakeEmptyTestDir(&file_system, "tmp_test_parallel_ofrecord_benchmark");
+  const int64_t part_num = 8;
+  const int64_t record_num = 2000;
+  std::vector<std::string> paths;
+  const std::vector<std::string> records(record_num, std::string(8 << 10, 'x'));
+  FOR_RANGE(int64_t, part_id, 0, part_num) {
+    paths.push_back(WritePartFile(&file_system, dir, part_id, records));
+  }
+  for (int32_t reader_num : {1, 2, 4, 8}) {
+    ParallelOFRecordDataset dataset(&file_system, paths, Range(0, part_num), reader_num, 256,
+                                    false, false);
+    const auto start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, part_num * record_num) { dataset.Next(); }
+    const double sec =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << reader_num << " readers, "
+              << part_num * record_num * (8 << 10) / sec / (1 << 20) << " MiB/s";
+  }
+  file_system.RecursivelyDeleteDir(dir);
+}
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
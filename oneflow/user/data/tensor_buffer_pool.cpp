@@ -0,0 +1,268 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/tensor_buffer_pool.h"
+#include <sstream>
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// the storage of a TensorBuffer is a multiple of 1KiB
+constexpr size_t kStorageAlignBytes = 1024;
+constexpr int32_t kLinearClassNum = 16;
+constexpr size_t kLinearClassMaxBytes = kLinearClassNum * kStorageAlignBytes;
+constexpr int32_t kLinearClassMaxLog2 = 14;
+constexpr int32_t kClassNumPerDoubling = 16;
+constexpr size_t kMaxPooledBytes = 64 << 20;
+// buffers of a class are usually released on another thread than the one taking them, so a
+// thread cache holds few of them to not keep them away from the pool for long
+constexpr size_t kThreadCacheBytesPerClass = 16 << 20;
+constexpr size_t kMaxThreadCacheBufferNum = 16;
+constexpr size_t kControlBlockBytes = 64;
+constexpr int64_t kDefaultMaxCachedMBytes = 1024;
+
+int32_t FloorLog2(size_t value) { return 63 ^ __builtin_clzll(value); }
+
+int32_t ClassIdx4Size(size_t size) {
+  if (size <= kLinearClassMaxBytes) {
+    return static_cast<int32_t>((std::max<size_t>(size, 1) + kStorageAlignBytes - 1)
+                                / kStorageAlignBytes)
+           - 1;
+  }
+  // size lies in (2^lg, 2^(lg + 1)], which is split into kClassNumPerDoubling classes
+  const int32_t lg = FloorLog2(size - 1);
+  const size_t step = static_cast<size_t>(1) << (lg - 4);
+  const int32_t sub = static_cast<int32_t>((size - 1 - (static_cast<size_t>(1) << lg)) / step);
+  return kLinearClassNum + (lg - kLinearClassMaxLog2) * kClassNumPerDoubling + sub;
+}
+
+size_t Size4ClassIdx(int32_t class_idx) {
+  if (class_idx < kLinearClassNum) { return (class_idx + 1) * kStorageAlignBytes; }
+  const int32_t lg = kLinearClassMaxLog2 + (class_idx - kLinearClassNum) / kClassNumPerDoubling;
+  const int32_t sub = (class_idx - kLinearClassNum) % kClassNumPerDoubling;
+  return (static_cast<size_t>(1) << lg) + (sub + 1) * (static_cast<size_t>(1) << (lg - 4));
+}
+
+// ClassIdx4Size(kMaxPooledBytes) + 1, checked in the constructor
+constexpr int32_t kClassNum = 208;
+
+// set once the thread cache of the calling thread is destroyed, buffers released by thread_local
+// destructors running after that go straight to the shared pool
+thread_local bool is_thread_cache_destroyed = false;
+
+size_t ThreadCacheCapacity(int32_t class_idx) {
+  const size_t capacity = kThreadCacheBytesPerClass / Size4ClassIdx(class_idx);
+  return std::max<size_t>(2, std::min(kMaxThreadCacheBufferNum, capacity));
+}
+
+int64_t EnvToInt64(const char* name, int64_t default_value) {
+  const char* value = std::getenv(name);
+  return value == nullptr ? default_value : std::atoll(value);
+}
+
+struct NoopDeleter {
+  void operator()(TensorBuffer*) const {}
+};
+
+}  // namespace
+
+struct TensorBufferPool::Entry final {
+  TensorBuffer buffer;
+  int32_t class_idx;
+  // memory of the control block of the shared_ptr handed out, see ControlBlockAllocator
+  alignas(std::max_align_t) char control_block[kControlBlockBytes];
+};
+
+// Places the control block of a shared_ptr into its entry. The control block is deallocated
+// after the last shared_ptr and weak_ptr referring to it are gone and after it is destroyed, which
+// is when the entry is released to the pool.
+template<typename T>
+struct TensorBufferPool::ControlBlockAllocator final {
+  using value_type = T;
+
+  explicit ControlBlockAllocator(Entry* entry) : entry(entry) {}
+  template<typename U>
+  ControlBlockAllocator(const ControlBlockAllocator<U>& other) : entry(other.entry) {}
+
+  T* allocate(size_t n) {
+    static_assert(sizeof(T) <= kControlBlockBytes, "");
+    static_assert(alignof(T) <= alignof(std::max_align_t), "");
+    CHECK_EQ(n, 1);
+    return reinterpret_cast<T*>(entry->control_block);
+  }
+  void deallocate(T* ptr, size_t n) { TensorBufferPool::Get()->Release(entry); }
+
+  template<typename U>
+  bool operator==(const ControlBlockAllocator<U>& other) const {
+    return entry == other.entry;
+  }
+  template<typename U>
+  bool operator!=(const ControlBlockAllocator<U>& other) const {
+    return entry != other.entry;
+  }
+
+  Entry* entry;
+};
+
+struct TensorBufferPool::ThreadCache final {
+  std::vector<std::vector<Entry*>> class_idx2entries;
+  ThreadCache() : class_idx2entries(kClassNum) {}
+  ~ThreadCache() {
+    is_thread_cache_destroyed = true;
+    FOR_RANGE(int32_t, class_idx, 0, kClassNum) {
+      std::vector<Entry*>* entries = &class_idx2entries.at(class_idx);
+      TensorBufferPool::Get()->ReturnToSharedPool(class_idx, entries->size(), entries);
+    }
+  }
+};
+
+TensorBufferPool* TensorBufferPool::Get() {
+  static TensorBufferPool* pool = new TensorBufferPool();
+  return pool;
+}
+
+TensorBufferPool::TensorBufferPool()
+    : max_cached_bytes_(
+          EnvToInt64("ONEFLOW_TENSOR_BUFFER_POOL_MAX_CACHED_MB", kDefaultMaxCachedMBytes) << 20),
+      alloc_cnt_(0),
+      miss_cnt_(0),
+      in_use_cnt_(0),
+      cached_bytes_(0) {
+  CHECK_EQ(ClassIdx4Size(kMaxPooledBytes) + 1, kClassNum);
+  FOR_RANGE(int32_t, class_idx, 0, kClassNum) {
+    const size_t size = Size4ClassIdx(class_idx);
+    CHECK_EQ(size % kStorageAlignBytes, 0);
+    CHECK_EQ(ClassIdx4Size(size), class_idx);
+    CHECK_EQ(ClassIdx4Size(size + 1), class_idx + 1);
+    size_classes_.emplace_back(new SizeClass());
+  }
+}
+
+TensorBufferPool::ThreadCache* TensorBufferPool::LocalThreadCache() {
+  if (is_thread_cache_destroyed) { return nullptr; }
+  static thread_local ThreadCache thread_cache;
+  return &thread_cache;
+}
+
+std::shared_ptr<TensorBuffer> TensorBufferPool::New(const Shape& shape, DataType data_type) {
+  alloc_cnt_ += 1;
+  const size_t size = RoundUp(shape.elem_cnt() * GetSizeOfDataType(data_type), kStorageAlignBytes);
+  if (size == 0 || size > kMaxPooledBytes) {
+    miss_cnt_ += 1;
+    std::shared_ptr<TensorBuffer> buffer = std::make_shared<TensorBuffer>();
+    buffer->Resize(shape, data_type);
+    return buffer;
+  }
+  Entry* entry = Acquire(ClassIdx4Size(size));
+  entry->buffer.Resize(shape, data_type);
+  in_use_cnt_ += 1;
+  return std::shared_ptr<TensorBuffer>(&entry->buffer, NoopDeleter(),
+                                       ControlBlockAllocator<TensorBuffer>(entry));
+}
+
+TensorBufferPool::Entry* TensorBufferPool::Acquire(int32_t class_idx) {
+  ThreadCache* cache = LocalThreadCache();
+  std::vector<Entry*> shared_entries;
+  std::vector<Entry*>* entries = cache == nullptr ? &shared_entries
+                                                  : &cache->class_idx2entries.at(class_idx);
+  if (entries->empty()) {
+    FetchFromSharedPool(class_idx, (ThreadCacheCapacity(class_idx) + 1) / 2, entries);
+  }
+  Entry* entry = nullptr;
+  if (entries->empty()) {
+    miss_cnt_ += 1;
+    entry = new Entry();
+    entry->class_idx = class_idx;
+    entry->buffer.reserve(Size4ClassIdx(class_idx));
+  } else {
+    entry = entries->back();
+    entries->pop_back();
+    cached_bytes_ -= entry->buffer.capacity();
+  }
+  if (cache == nullptr) { ReturnToSharedPool(class_idx, entries->size(), entries); }
+  return entry;
+}
+
+void TensorBufferPool::Release(Entry* entry) {
+  in_use_cnt_ -= 1;
+  const size_t capacity = entry->buffer.capacity();
+  // the storage may have been resized or swapped by the user, only storage of a class size is kept
+  if (capacity == 0 || capacity > kMaxPooledBytes
+      || capacity != Size4ClassIdx(ClassIdx4Size(capacity))) {
+    delete entry;
+    return;
+  }
+  entry->class_idx = ClassIdx4Size(capacity);
+  if (cached_bytes_.fetch_add(capacity) + static_cast<int64_t>(capacity) > max_cached_bytes_) {
+    cached_bytes_ -= capacity;
+    delete entry;
+    return;
+  }
+  ThreadCache* cache = LocalThreadCache();
+  if (cache == nullptr) {
+    std::vector<Entry*> entries{entry};
+    ReturnToSharedPool(entry->class_idx, 1, &entries);
+    return;
+  }
+  std::vector<Entry*>* entries = &cache->class_idx2entries.at(entry->class_idx);
+  entries->push_back(entry);
+  const size_t capacity_of_cache = ThreadCacheCapacity(entry->class_idx);
+  if (entries->size() > capacity_of_cache) {
+    ReturnToSharedPool(entry->class_idx, entries->size() - capacity_of_cache / 2, entries);
+  }
+}
+
+void TensorBufferPool::FetchFromSharedPool(int32_t class_idx, size_t n,
+                                           std::vector<Entry*>* entries) {
+  SizeClass* size_class = size_classes_.at(class_idx).get();
+  std::unique_lock<std::mutex> lock(size_class->mutex);
+  n = std::min(n, size_class->entries.size());
+  entries->insert(entries->end(), size_class->entries.end() - n, size_class->entries.end());
+  size_class->entries.resize(size_class->entries.size() - n);
+}
+
+void TensorBufferPool::ReturnToSharedPool(int32_t class_idx, size_t n,
+                                          std::vector<Entry*>* entries) {
+  if (n == 0) { return; }
+  SizeClass* size_class = size_classes_.at(class_idx).get();
+  {
+    std::unique_lock<std::mutex> lock(size_class->mutex);
+    size_class->entries.insert(size_class->entries.end(), entries->end() - n, entries->end());
+  }
+  entries->resize(entries->size() - n);
+}
+
+TensorBufferPoolStats TensorBufferPool::GetStats() const {
+  TensorBufferPoolStats stats;
+  stats.alloc_cnt = alloc_cnt_;
+  stats.miss_cnt = miss_cnt_;
+  stats.in_use_cnt = in_use_cnt_;
+  stats.cached_bytes = cached_bytes_;
+  return stats;
+}
+
+std::string TensorBufferPool::StatsDebugString() const {
+  const TensorBufferPoolStats stats = GetStats();
+  std::ostringstream oss;
+  oss << "TensorBufferPool: " << stats.alloc_cnt << " allocations, " << stats.miss_cnt
+      << " missed the pool, " << stats.in_use_cnt << " buffers in use, "
+      << (stats.cached_bytes >> 20) << " MiB cached";
+  return oss.str();
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_TENSOR_BUFFER_POOL_H_
+#define ONEFLOW_USER_DATA_TENSOR_BUFFER_POOL_H_
+
+#include "oneflow/core/common/tensor_buffer.h"
+
+namespace oneflow {
+namespace data {
+
+struct TensorBufferPoolStats {
+  int64_t alloc_cnt = 0;
+  // allocations that had to create a TensorBuffer or allocate its storage
+  int64_t miss_cnt = 0;
+  int64_t in_use_cnt = 0;
+  // storage of the buffers waiting in the pool for reuse
+  int64_t cached_bytes = 0;
+};
+
+// Recycles the TensorBuffers of the data pipeline together with their storage, shared by the
+// whole process.
+//
+// New hands out a buffer of the given shape in a shared_ptr, the buffer goes back to the pool
+// once the last reference to it is dropped, e.g. when the batch holding it has been parsed.
+// Buffers are kept by the size class of their storage, 1KiB apart up to 16KiB and then 16
+// classes per doubling, so that a buffer of a class never reallocates when resized to any size
+// of the class. Released buffers go to a per-thread cache first and spill to the shared pool of
+// their class, which holds up to ONEFLOW_TENSOR_BUFFER_POOL_MAX_CACHED_MB (default 1024) of
+// storage. The control block of the shared_ptr is kept with the buffer too, so a warm pool does
+// not allocate memory at all.
+class TensorBufferPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TensorBufferPool);
+
+  // never destroyed, thread caches may flush into it at any point of process exit
+  static TensorBufferPool* Get();
+
+  std::shared_ptr<TensorBuffer> New(const Shape& shape, DataType data_type);
+
+  TensorBufferPoolStats GetStats() const;
+  std::string StatsDebugString() const;
+
+ private:
+  struct Entry;
+  struct ThreadCache;
+  struct SizeClass {
+    std::mutex mutex;
+    std::vector<Entry*> entries;
+  };
+  template<typename T>
+  struct ControlBlockAllocator;
+
+  TensorBufferPool();
+  ~TensorBufferPool() = delete;
+
+  static ThreadCache* LocalThreadCache();
+
+  Entry* Acquire(int32_t class_idx);
+  void Release(Entry* entry);
+  // moves up to n entries of the shared pool into entries
+  void FetchFromSharedPool(int32_t class_idx, size_t n, std::vector<Entry*>* entries);
+  // moves the last n entries of entries into the shared pool, which has no limit of its own: the
+  // cached bytes are capped in Release, before an entry enters any cache
+  void ReturnToSharedPool(int32_t class_idx, size_t n, std::vector<Entry*>* entries);
+
+  int64_t max_cached_bytes_;
+  std::vector<std::unique_ptr<SizeClass>> size_classes_;
+
+  std::atomic<int64_t> alloc_cnt_;
+  std::atomic<int64_t> miss_cnt_;
+  std::atomic<int64_t> in_use_cnt_;
+  std::atomic<int64_t> cached_bytes_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_TENSOR_BUFFER_POOL_H_
@@ -0,0 +1,140 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/user/data/tensor_buffer_pool.h"
+#include "oneflow/core/common/buffer.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+using Batch = std::vector<std::shared_ptr<TensorBuffer>>;
+
+// sizes of the records of a batch, from a few bytes to a few hundred KiB
+std::vector<int64_t> BatchRecordSizes(int64_t batch_size) {
+  std::mt19937 gen(0);
+  std::lognormal_distribution<double> dis(10, 1.5);
+  std::vector<int64_t> sizes(batch_size);
+  for (int64_t& size : sizes) { size = std::min<int64_t>(dis(gen), 8 << 20) + 1; }
+  return sizes;
+}
+
+}  // namespace
+
+TEST(TensorBufferPool, reuse_buffer_of_same_class) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  for (int64_t size : {1, 1024, 1025, 16 << 10, (16 << 10) + 1, 100 << 10, 3 << 20}) {
+    std::shared_ptr<TensorBuffer> buffer = pool->New(Shape({size}), DataType::kChar);
+    ASSERT_EQ(buffer->nbytes(), size);
+    const void* data = buffer->data();
+    buffer.reset();
+    const int64_t miss_cnt = pool->GetStats().miss_cnt;
+    // storage is 1KiB aligned, a buffer of floats of the same class gets the same storage
+    const int64_t float_num = RoundUp(size, 1024) / sizeof(float);
+    buffer = pool->New(Shape({float_num}), DataType::kFloat);
+    ASSERT_EQ(buffer->data(), data);
+    ASSERT_EQ(buffer->shape(), Shape({float_num}));
+    ASSERT_EQ(pool->GetStats().miss_cnt, miss_cnt);
+  }
+}
+
+TEST(TensorBufferPool, weak_ptr_keeps_buffer_out_of_pool) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  const int64_t in_use_cnt = pool->GetStats().in_use_cnt;
+  std::shared_ptr<TensorBuffer> buffer = pool->New(Shape({5000}), DataType::kChar);
+  std::weak_ptr<TensorBuffer> weak = buffer;
+  const void* data = buffer->data();
+  buffer.reset();
+  ASSERT_TRUE(weak.expired());
+  std::shared_ptr<TensorBuffer> other = pool->New(Shape({5000}), DataType::kChar);
+  ASSERT_NE(other->data(), data);
+  other.reset();
+  weak.reset();
+  ASSERT_EQ(pool->GetStats().in_use_cnt, in_use_cnt);
+}
+
+TEST(TensorBufferPool, steady_state_without_misses) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  const std::vector<int64_t> sizes = BatchRecordSizes(64);
+  const int64_t miss_cnt = pool->GetStats().miss_cnt;
+  FOR_RANGE(int64_t, i, 0, 100) {
+    Batch batch;
+    for (int64_t size : sizes) { batch.push_back(pool->New(Shape({size}), DataType::kChar)); }
+    // only the first batch misses, the sizes of it may be in the pool already
+    ASSERT_LE(pool->GetStats().miss_cnt - miss_cnt, sizes.size());
+  }
+}
+
+TEST(TensorBufferPool, misses_bounded_across_threads) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  const std::vector<int64_t> sizes = BatchRecordSizes(64);
+  // a loader thread fills the batches and the batches are consumed on this thread, like the
+  // loader and the kernel of a DataReader
+  Buffer<std::shared_ptr<Batch>> batch_buffer(4);
+  const int64_t batch_num = 1000;
+  const int64_t miss_cnt = pool->GetStats().miss_cnt;
+  std::thread loader([&]() {
+    std::mt19937 gen(0);
+    std::vector<int64_t> shuffled_sizes = sizes;
+    FOR_RANGE(int64_t, i, 0, batch_num) {
+      std::shuffle(shuffled_sizes.begin(), shuffled_sizes.end(), gen);
+      std::shared_ptr<Batch> batch(new Batch());
+      for (int64_t size : shuffled_sizes) {
+        batch->push_back(pool->New(Shape({size}), DataType::kChar));
+      }
+      CHECK_EQ(batch_buffer.Send(batch), kBufferStatusSuccess);
+    }
+  });
+  FOR_RANGE(int64_t, i, 0, batch_num) {
+    std::shared_ptr<Batch> batch;
+    CHECK_EQ(batch_buffer.Receive(&batch), kBufferStatusSuccess);
+  }
+  loader.join();
+  LOG(INFO) << pool->StatsDebugString();
+  // the batches in flight and the buffers in the thread caches, not a miss per batch
+  ASSERT_LE(pool->GetStats().miss_cnt - miss_cnt, 32 * sizes.size());
+}
+
+TEST(TensorBufferPool, benchmark_compared_with_new) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  const std::vector<int64_t> sizes = BatchRecordSizes(256);
+  const int64_t repeat = 200;
+  Batch batch;
+  auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    for (int64_t size : sizes) {
+      batch.emplace_back(new TensorBuffer());
+      batch.back()->Resize(Shape({size}), DataType::kChar);
+    }
+    batch.clear();
+  }
+  const double new_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, repeat) {
+    for (int64_t size : sizes) { batch.push_back(pool->New(Shape({size}), DataType::kChar)); }
+    batch.clear();
+  }
+  const double pool_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << "new and free a batch of " << sizes.size()
+            << " records, new TensorBuffer: " << new_ms / repeat
+            << " ms, pool: " << pool_ms / repeat << " ms";
+}
+
+}  // namespace data
+}  // namespace oneflow
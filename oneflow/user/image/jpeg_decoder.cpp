@@ -0,0 +1,137 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/image/jpeg_decoder.h"
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+namespace oneflow {
+
+namespace {
+
+struct JpegErrorManager {
+  jpeg_error_mgr pub;
+  jmp_buf jump_buffer;
+};
+
+// libjpeg exits the process on errors by default
+void OnJpegError(j_common_ptr cinfo) {
+  longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump_buffer, 1);
+}
+
+void OnJpegMessage(j_common_ptr cinfo) {}
+
+bool GetJpegColorSpace(const std::string& color_space, J_COLOR_SPACE* out_color_space) {
+  if (color_space == "BGR") {
+    *out_color_space = JCS_EXT_BGR;
+  } else if (color_space == "RGB") {
+    *out_color_space = JCS_EXT_RGB;
+  } else if (color_space == "GRAY") {
+    *out_color_space = JCS_GRAYSCALE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
+                                      RandomCropGenerator* random_crop_gen, CropWindow* crop,
+                                      int64_t target_resize_x, int64_t target_resize_y,
+                                      const std::string& color_space, TensorBuffer* buffer) {
+  if (length < 2 || data[0] != 0xFF || data[1] != 0xD8) { return false; }
+  J_COLOR_SPACE out_color_space = JCS_UNKNOWN;
+  if (!GetJpegColorSpace(color_space, &out_color_space)) { return false; }
+  jpeg_decompress_struct cinfo;
+  JpegErrorManager jerr;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = OnJpegError;
+  jerr.pub.output_message = OnJpegMessage;
+  // declared before setjmp, nothing with a destructor may live in the frames longjmp unwinds
+  std::vector<JSAMPLE> row;
+  if (setjmp(jerr.jump_buffer)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, data, length);
+  jpeg_read_header(&cinfo, TRUE);
+  // cmyk and ycck only convert to cmyk
+  if (cinfo.jpeg_color_space != JCS_YCbCr && cinfo.jpeg_color_space != JCS_GRAYSCALE
+      && cinfo.jpeg_color_space != JCS_RGB) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = out_color_space;
+  const int64_t H = cinfo.image_height;
+  const int64_t W = cinfo.image_width;
+  int64_t y = 0;
+  int64_t x = 0;
+  int64_t crop_h = H;
+  int64_t crop_w = W;
+  if (random_crop_gen != nullptr) {
+    random_crop_gen->GenerateCropWindow({H, W}, crop);
+    y = crop->anchor.At(0);
+    x = crop->anchor.At(1);
+    crop_h = crop->shape.At(0);
+    crop_w = crop->shape.At(1);
+    CHECK(crop_w > 0 && x + crop_w <= W);
+    CHECK(crop_h > 0 && y + crop_h <= H);
+  }
+  cinfo.scale_num = 8;
+  cinfo.scale_denom = 8;
+  if (target_resize_x > 0 && target_resize_y > 0) {
+    while (cinfo.scale_num > 1 && crop_w * (cinfo.scale_num / 2) >= target_resize_x * 8
+           && crop_h * (cinfo.scale_num / 2) >= target_resize_y * 8) {
+      cinfo.scale_num /= 2;
+    }
+  }
+  jpeg_start_decompress(&cinfo);
+
+  // the window in scaled coordinates, rounded outwards
+  const int64_t scaled_h = cinfo.output_height;
+  const int64_t scaled_w = cinfo.output_width;
+  const int64_t y_begin = y * scaled_h / H;
+  const int64_t y_end = std::min(scaled_h, ((y + crop_h) * scaled_h + H - 1) / H);
+  const int64_t x_begin = x * scaled_w / W;
+  const int64_t x_end = std::min(scaled_w, ((x + crop_w) * scaled_w + W - 1) / W);
+  // widened to iMCU boundaries by libjpeg
+  JDIMENSION decoded_x = x_begin;
+  JDIMENSION decoded_w = x_end - x_begin;
+  if (decoded_w < cinfo.output_width) { jpeg_crop_scanline(&cinfo, &decoded_x, &decoded_w); }
+  const int64_t c = cinfo.output_components;
+  const int64_t row_size = (x_end - x_begin) * c;
+  const int64_t row_offset = (x_begin - decoded_x) * c;
+  row.resize(cinfo.output_width * c);
+  buffer->Resize(Shape({y_end - y_begin, x_end - x_begin, c}), DataType::kUInt8);
+  uint8_t* dst = buffer->mut_data<uint8_t>();
+  if (y_begin > 0) {
+    const JDIMENSION skipped = jpeg_skip_scanlines(&cinfo, y_begin);
+    CHECK_EQ(skipped, y_begin);
+  }
+  while (cinfo.output_scanline < y_end) {
+    JSAMPROW row_ptr = row.data();
+    jpeg_read_scanlines(&cinfo, &row_ptr, 1);
+    memcpy(dst, row.data() + row_offset, row_size);
+    dst += row_size;
+  }
+  // the rows below the window are dropped with the decompressor
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+}  // namespace oneflow
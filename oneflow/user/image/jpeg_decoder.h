@@ -0,0 +1,45 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
+#define ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
+
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/user/image/random_crop_generator.h"
+
+namespace oneflow {
+
+// Decodes a jpeg with libjpeg-turbo into an HWC uint8 image of color_space ("BGR", "RGB" or
+// "GRAY"), only decoding the crop window drawn from random_crop_gen (nullable, no crop).
+//   - Rows above the window and columns outside of its iMCU aligned span are only entropy
+//     decoded, they skip the inverse DCT, upsampling and color conversion. Rows below the window
+//     are not decoded at all.
+//   - When target_resize_x and target_resize_y are positive the window is downscaled by 1/2, 1/4
+//     or 1/8 in the DCT domain, as far as it stays at least target_resize_x wide and
+//     target_resize_y high, so that the following resize to the target works on fewer pixels.
+//   - The EXIF orientation is not applied and the IDCT differs from the one of cv::imdecode, so
+//     pixels may change slightly, callers only take this path when a target resize is asked for.
+// The drawn window is stored in crop (required with random_crop_gen, default constructed), an
+// empty crop->shape means none was drawn. Returns false when data is not a jpeg of a color space
+// libjpeg-turbo can convert or libjpeg fails, callers fall back to OpenCV then and reuse the
+// window in crop if one was drawn.
+bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
+                                      RandomCropGenerator* random_crop_gen, CropWindow* crop,
+                                      int64_t target_resize_x, int64_t target_resize_y,
+                                      const std::string& color_space, TensorBuffer* buffer);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_IMAGE_JPEG_DECODER_H_
@@ -0,0 +1,277 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <cstdio>
+#include <jpeglib.h>
+#include "oneflow/user/image/jpeg_decoder.h"
+
+namespace oneflow {
+
+namespace {
+
+// a smooth gradient with some noise, so that the encoded size is close to that of a photo
+std::vector<unsigned char> EncodeJpeg(int height, int width, bool color, bool subsampled) {
+  std::mt19937 gen(height * width);
+  std::uniform_int_distribution<int> noise(-8, 8);
+  const int c = color ? 3 : 1;
+  std::vector<unsigned char> pixels(height * width * c);
+  FOR_RANGE(int, i, 0, height) {
+    FOR_RANGE(int, j, 0, width) {
+      FOR_RANGE(int, k, 0, c) {
+        const int val = (i * (k + 1) * 255 / height + j * (3 - k) * 255 / width) / 4 + noise(gen);
+        pixels.at((i * width + j) * c + k) = std::max(0, std::min(255, val));
+      }
+    }
+  }
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char* out = nullptr;
+  unsigned long out_size = 0;
+  jpeg_mem_dest(&cinfo, &out, &out_size);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = c;
+  cinfo.in_color_space = color ? JCS_RGB : JCS_GRAYSCALE;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  if (color && !subsampled) {
+    FOR_RANGE(int, k, 0, 3) {
+      cinfo.comp_info[k].h_samp_factor = 1;
+      cinfo.comp_info[k].v_samp_factor = 1;
+    }
+  }
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row = &pixels.at(cinfo.next_scanline * width * c);
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  std::vector<unsigned char> jpeg(out, out + out_size);
+  free(out);
+  return jpeg;
+}
+
+// decodes the whole image, the way cv::imdecode does, at scale_num / 8
+void FullDecode(const std::vector<unsigned char>& jpeg, J_COLOR_SPACE out_color_space,
+                int scale_num, TensorBuffer* buffer) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = out_color_space;
+  cinfo.scale_num = scale_num;
+  cinfo.scale_denom = 8;
+  jpeg_start_decompress(&cinfo);
+  const int64_t row_size = cinfo.output_width * cinfo.output_components;
+  buffer->Resize(Shape({cinfo.output_height, cinfo.output_width, cinfo.output_components}),
+                 DataType::kUInt8);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = buffer->mut_data<uint8_t>() + cinfo.output_scanline * row_size;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+}
+
+void Crop(const TensorBuffer& image, int64_t y, int64_t x, int64_t h, int64_t w,
+          TensorBuffer* cropped) {
+  const int64_t c = image.shape().At(2);
+  cropped->Resize(Shape({h, w, c}), DataType::kUInt8);
+  FOR_RANGE(int64_t, i, 0, h) {
+    memcpy(cropped->mut_data<uint8_t>() + i * w * c,
+           image.data<uint8_t>() + ((y + i) * image.shape().At(1) + x) * c, w * c);
+  }
+}
+
+int64_t MaxAbsDiff(const TensorBuffer& lhs, const TensorBuffer& rhs) {
+  CHECK_EQ(lhs.shape(), rhs.shape());
+  int64_t max_diff = 0;
+  FOR_RANGE(int64_t, i, 0, lhs.elem_cnt()) {
+    const int64_t diff = std::abs(lhs.data<uint8_t>()[i] - rhs.data<uint8_t>()[i]);
+    max_diff = std::max(max_diff, diff);
+  }
+  return max_diff;
+}
+
+}  // namespace
+
+TEST(JpegDecoder, crop_matches_full_decode) {
+  const int height = 375;
+  const int width = 500;
+  for (bool subsampled : {false, true}) {
+    for (const std::string color_space : {"BGR", "RGB", "GRAY"}) {
+      const J_COLOR_SPACE out_color_space = color_space == "BGR"   ? JCS_EXT_BGR
+                                            : color_space == "RGB" ? JCS_EXT_RGB
+                                                                   : JCS_GRAYSCALE;
+      const std::vector<unsigned char> jpeg = EncodeJpeg(height, width, true, subsampled);
+      TensorBuffer full;
+      FullDecode(jpeg, out_color_space, 8, &full);
+      TensorBuffer decoded;
+      ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), nullptr, nullptr, 0,
+                                                   0, color_space, &decoded));
+      ASSERT_EQ(MaxAbsDiff(decoded, full), 0);
+      // the same generator draws the same windows
+      RandomCropGenerator gen({0.75, 1.333333}, {0.08, 1.0}, 1, 10);
+      RandomCropGenerator ref_gen({0.75, 1.333333}, {0.08, 1.0}, 1, 10);
+      FOR_RANGE(int, i, 0, 20) {
+        CropWindow crop;
+        ref_gen.GenerateCropWindow({height, width}, &crop);
+        TensorBuffer expected;
+        Crop(full, crop.anchor.At(0), crop.anchor.At(1), crop.shape.At(0), crop.shape.At(1),
+             &expected);
+        CropWindow drawn;
+        ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), &gen, &drawn, 0, 0,
+                                                     color_space, &decoded));
+        ASSERT_EQ(drawn.anchor, crop.anchor);
+        ASSERT_EQ(drawn.shape, crop.shape);
+        // fancy upsampling of chroma may differ by rounding at the cropped edges
+        ASSERT_LE(MaxAbsDiff(decoded, expected), subsampled ? 2 : 0)
+            << color_space << " subsampled " << subsampled;
+      }
+    }
+  }
+}
+
+TEST(JpegDecoder, downscale_keeps_target_size) {
+  const int height = 960;
+  const int width = 1280;
+  const std::vector<unsigned char> jpeg = EncodeJpeg(height, width, true, true);
+  RandomCropGenerator gen({0.75, 1.333333}, {0.08, 1.0}, 2, 10);
+  RandomCropGenerator ref_gen({0.75, 1.333333}, {0.08, 1.0}, 2, 10);
+  FOR_RANGE(int, i, 0, 20) {
+    CropWindow crop;
+    ref_gen.GenerateCropWindow({height, width}, &crop);
+    TensorBuffer decoded;
+    CropWindow drawn;
+    ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), &gen, &drawn, 224, 224,
+                                                 "BGR", &decoded));
+    ASSERT_GE(decoded.shape().At(0), 224);
+    ASSERT_GE(decoded.shape().At(1), 224);
+    ASSERT_LE(decoded.shape().At(0), crop.shape.At(0));
+    ASSERT_LE(decoded.shape().At(1), crop.shape.At(1));
+    // the scale the decoder must have picked
+    int scale_num = 8;
+    while (scale_num > 1 && crop.shape.At(1) * (scale_num / 2) >= 224 * 8
+           && crop.shape.At(0) * (scale_num / 2) >= 224 * 8) {
+      scale_num /= 2;
+    }
+    TensorBuffer scaled;
+    FullDecode(jpeg, JCS_EXT_BGR, scale_num, &scaled);
+    const int64_t scaled_h = scaled.shape().At(0);
+    const int64_t scaled_w = scaled.shape().At(1);
+    const int64_t y = crop.anchor.At(0) * scaled_h / height;
+    const int64_t x = crop.anchor.At(1) * scaled_w / width;
+    TensorBuffer expected;
+    Crop(scaled, y, x, decoded.shape().At(0), decoded.shape().At(1), &expected);
+    ASSERT_LE(MaxAbsDiff(decoded, expected), 2);
+  }
+}
+
+TEST(JpegDecoder, falls_back_without_drawing_a_crop) {
+  const std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  std::vector<unsigned char> truncated = EncodeJpeg(64, 64, true, true);
+  truncated.resize(16);
+  RandomCropGenerator gen({0.75, 1.333333}, {0.08, 1.0}, 3, 10);
+  TensorBuffer decoded;
+  CropWindow crop;
+  ASSERT_FALSE(JpegPartialDecodeRandomCropImage(png.data(), png.size(), &gen, &crop, 0, 0, "BGR",
+                                                &decoded));
+  ASSERT_FALSE(JpegPartialDecodeRandomCropImage(truncated.data(), truncated.size(), &gen, &crop,
+                                                0, 0, "BGR", &decoded));
+  ASSERT_EQ(crop.shape.elem_cnt(), 0);
+  RandomCropGenerator ref_gen({0.75, 1.333333}, {0.08, 1.0}, 3, 10);
+  CropWindow ref_crop;
+  gen.GenerateCropWindow({375, 500}, &crop);
+  ref_gen.GenerateCropWindow({375, 500}, &ref_crop);
+  ASSERT_EQ(crop.anchor, ref_crop.anchor);
+  ASSERT_EQ(crop.shape, ref_crop.shape);
+}
+
+TEST(JpegDecoder, keeps_the_crop_drawn_before_failing) {
+  // the first component refers to an undefined quantization table, which libjpeg only notices
+  // in jpeg_start_decompress, after the header was read and the window drawn
+  std::vector<unsigned char> jpeg = EncodeJpeg(375, 500, true, true);
+  FOR_RANGE(size_t, i, 2, jpeg.size() - 12) {
+    if (jpeg.at(i) == 0xFF && jpeg.at(i + 1) == 0xC0) {
+      jpeg.at(i + 12) = 3;
+      break;
+    }
+  }
+  RandomCropGenerator gen({0.75, 1.333333}, {0.08, 1.0}, 5, 10);
+  RandomCropGenerator ref_gen({0.75, 1.333333}, {0.08, 1.0}, 5, 10);
+  TensorBuffer decoded;
+  CropWindow crop;
+  ASSERT_FALSE(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), &gen, &crop, 224, 224,
+                                                "BGR", &decoded));
+  CropWindow ref_crop;
+  ref_gen.GenerateCropWindow({375, 500}, &ref_crop);
+  ASSERT_EQ(crop.anchor, ref_crop.anchor);
+  ASSERT_EQ(crop.shape, ref_crop.shape);
+  // the fallback reuses it, the next image gets the next window
+  gen.GenerateCropWindow({375, 500}, &crop);
+  ref_gen.GenerateCropWindow({375, 500}, &ref_crop);
+  ASSERT_EQ(crop.anchor, ref_crop.anchor);
+  ASSERT_EQ(crop.shape, ref_crop.shape);
+}
+
+TEST(JpegDecoder, benchmark_compared_with_full_decode) {
+  // imagenet sized and larger photos, random crops to be resized to 224x224
+  for (const std::pair<int, int>& size : {std::make_pair(375, 500), std::make_pair(960, 1280)}) {
+    const int height = size.first;
+    const int width = size.second;
+    const std::vector<unsigned char> jpeg = EncodeJpeg(height, width, true, true);
+    const int64_t image_num = 200;
+    RandomCropGenerator gen({0.75, 1.333333}, {0.08, 1.0}, 4, 10);
+    TensorBuffer full;
+    TensorBuffer decoded;
+    auto start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, image_num) {
+      FullDecode(jpeg, JCS_EXT_BGR, 8, &full);
+      CropWindow crop;
+      gen.GenerateCropWindow({height, width}, &crop);
+      Crop(full, crop.anchor.At(0), crop.anchor.At(1), crop.shape.At(0), crop.shape.At(1),
+           &decoded);
+    }
+    const double full_s =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, image_num) {
+      CropWindow crop;
+      CHECK(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), &gen, &crop, 0, 0, "BGR",
+                                             &decoded));
+    }
+    const double crop_s =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, image_num) {
+      CropWindow crop;
+      CHECK(JpegPartialDecodeRandomCropImage(jpeg.data(), jpeg.size(), &gen, &crop, 224, 224,
+                                             "BGR", &decoded));
+    }
+    const double scaled_s =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "random crop of " << height << "x" << width << " jpegs, images/sec per core, "
+              << "full decode: " << image_num / full_s << ", partial decode: "
+              << image_num / crop_s << ", partial and scaled decode: " << image_num / scaled_s;
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,267 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct ConvGeometry {
+  int64_t channel_num;
+  int64_t in_dims[3];
+  int64_t out_dims[3];
+  int64_t kernel_dims[3];
+  int64_t strides[3];
+  int64_t dilation_rate[3];
+  int64_t padding_before[3];
+};
+
+ConvGeometry MakeConvGeometry(const ShapeView& in_shape, const ShapeView& weight_shape,
+                              const ShapeView& out_shape, int32_t dhw_offset,
+                              const int32_t* strides, const int32_t* dilation_rate,
+                              const int32_t* padding_before) {
+  ConvGeometry geometry;
+  geometry.channel_num = in_shape.At(dhw_offset == 2 ? 1 : 4);
+  FOR_RANGE(int32_t, i, 0, 3) {
+    geometry.in_dims[i] = in_shape.At(dhw_offset + i);
+    geometry.out_dims[i] = out_shape.At(dhw_offset + i);
+    geometry.kernel_dims[i] = weight_shape.At(dhw_offset + i);
+    geometry.strides[i] = strides[i];
+    geometry.dilation_rate[i] = dilation_rate[i];
+    geometry.padding_before[i] = padding_before[i];
+  }
+  return geometry;
+}
+
+// [*out_begin, *out_end) are the output positions o whose input position in_begin + o * stride
+// falls inside [0, in_num)
+void ValidOutRange(int64_t in_begin, int64_t stride, int64_t in_num, int64_t out_num,
+                   int64_t* out_begin, int64_t* out_end) {
+  int64_t begin = in_begin >= 0 ? 0 : (stride - 1 - in_begin) / stride;
+  int64_t end = in_begin >= in_num ? 0 : (in_num - in_begin + stride - 1) / stride;
+  begin = std::min(begin, out_num);
+  end = std::max(begin, std::min(end, out_num));
+  *out_begin = begin;
+  *out_end = end;
+}
+
+// The two directions share one walk over the column buffer and only differ in what happens to a
+// run of n column elements, resolved at compile time instead of through a call per element.
+template<typename T>
+struct Im2ColOp final {
+  using ImPtr = const T*;
+  using ColPtr = T*;
+  static void Pad(ColPtr col, int64_t n) { std::fill(col, col + n, static_cast<T>(0)); }
+  template<int64_t kImStride>
+  static void Copy(ImPtr im, int64_t im_stride, ColPtr col, int64_t n) {
+    if (kImStride == 1) {
+      std::copy(im, im + n, col);
+    } else {
+      const int64_t stride = kImStride > 0 ? kImStride : im_stride;
+      for (int64_t i = 0; i < n; ++i) { col[i] = im[i * stride]; }
+    }
+  }
+};
+
+template<typename T>
+struct Col2ImOp final {
+  using ImPtr = T*;
+  using ColPtr = const T*;
+  static void Pad(ColPtr col, int64_t n) {}
+  template<int64_t kImStride>
+  static void Copy(ImPtr im, int64_t im_stride, ColPtr col, int64_t n) {
+    const int64_t stride = kImStride > 0 ? kImStride : im_stride;
+    for (int64_t i = 0; i < n; ++i) { im[i * stride] += col[i]; }
+  }
+};
+
+// A zero template argument means the value is only known at runtime.
+template<typename Op, int64_t kKernelH, int64_t kKernelW, int64_t kStrideW>
+void NCDHWColBufWalk(const ConvGeometry& g, typename Op::ImPtr im, typename Op::ColPtr col) {
+  const int64_t kernel_h = kKernelH > 0 ? kKernelH : g.kernel_dims[1];
+  const int64_t kernel_w = kKernelW > 0 ? kKernelW : g.kernel_dims[2];
+  const int64_t stride_w = kStrideW > 0 ? kStrideW : g.strides[2];
+  const int64_t id_num = g.in_dims[0];
+  const int64_t ih_num = g.in_dims[1];
+  const int64_t iw_num = g.in_dims[2];
+  const int64_t od_num = g.out_dims[0];
+  const int64_t oh_num = g.out_dims[1];
+  const int64_t ow_num = g.out_dims[2];
+  const int64_t im_channel_size = id_num * ih_num * iw_num;
+  FOR_RANGE(int64_t, c, 0, g.channel_num) {
+    typename Op::ImPtr im_c = im + c * im_channel_size;
+    FOR_RANGE(int64_t, kd, 0, g.kernel_dims[0]) {
+      for (int64_t kh = 0; kh < kernel_h; ++kh) {
+        for (int64_t kw = 0; kw < kernel_w; ++kw) {
+          const int64_t iw_begin = kw * g.dilation_rate[2] - g.padding_before[2];
+          int64_t ow_begin = 0;
+          int64_t ow_end = 0;
+          ValidOutRange(iw_begin, stride_w, iw_num, ow_num, &ow_begin, &ow_end);
+          int64_t id = kd * g.dilation_rate[0] - g.padding_before[0];
+          for (int64_t od = 0; od < od_num; ++od, id += g.strides[0]) {
+            if (id < 0 || id >= id_num) {
+              Op::Pad(col, oh_num * ow_num);
+              col += oh_num * ow_num;
+              continue;
+            }
+            int64_t ih = kh * g.dilation_rate[1] - g.padding_before[1];
+            for (int64_t oh = 0; oh < oh_num; ++oh, ih += g.strides[1], col += ow_num) {
+              if (ih < 0 || ih >= ih_num) {
+                Op::Pad(col, ow_num);
+                continue;
+              }
+              typename Op::ImPtr im_row = im_c + (id * ih_num + ih) * iw_num;
+              Op::Pad(col, ow_begin);
+              Op::template Copy<kStrideW>(im_row + (iw_begin + ow_begin * stride_w), stride_w,
+                                          col + ow_begin, ow_end - ow_begin);
+              Op::Pad(col + ow_end, ow_num - ow_end);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Rows are (kd, kh, kw, c). All channels of one output row are produced together so that the
+// input pixels they gather from stay in cache.
+template<typename Op, int64_t kKernelH, int64_t kKernelW>
+void NDHWCColBufWalk(const ConvGeometry& g, typename Op::ImPtr im, typename Op::ColPtr col) {
+  const int64_t kernel_h = kKernelH > 0 ? kKernelH : g.kernel_dims[1];
+  const int64_t kernel_w = kKernelW > 0 ? kKernelW : g.kernel_dims[2];
+  const int64_t channel_num = g.channel_num;
+  const int64_t id_num = g.in_dims[0];
+  const int64_t ih_num = g.in_dims[1];
+  const int64_t iw_num = g.in_dims[2];
+  const int64_t od_num = g.out_dims[0];
+  const int64_t oh_num = g.out_dims[1];
+  const int64_t ow_num = g.out_dims[2];
+  const int64_t col_row_size = od_num * oh_num * ow_num;
+  const int64_t im_pixel_stride = g.strides[2] * channel_num;
+  FOR_RANGE(int64_t, kd, 0, g.kernel_dims[0]) {
+    for (int64_t kh = 0; kh < kernel_h; ++kh) {
+      for (int64_t kw = 0; kw < kernel_w; ++kw) {
+        typename Op::ColPtr col_k = col + ((kd * kernel_h + kh) * kernel_w + kw) * channel_num
+                                              * col_row_size;
+        const int64_t iw_begin = kw * g.dilation_rate[2] - g.padding_before[2];
+        int64_t ow_begin = 0;
+        int64_t ow_end = 0;
+        ValidOutRange(iw_begin, g.strides[2], iw_num, ow_num, &ow_begin, &ow_end);
+        int64_t id = kd * g.dilation_rate[0] - g.padding_before[0];
+        for (int64_t od = 0; od < od_num; ++od, id += g.strides[0]) {
+          int64_t ih = kh * g.dilation_rate[1] - g.padding_before[1];
+          for (int64_t oh = 0; oh < oh_num; ++oh, ih += g.strides[1]) {
+            typename Op::ColPtr col_row = col_k + (od * oh_num + oh) * ow_num;
+            if (id < 0 || id >= id_num || ih < 0 || ih >= ih_num) {
+              FOR_RANGE(int64_t, c, 0, channel_num) { Op::Pad(col_row + c * col_row_size, ow_num); }
+              continue;
+            }
+            const int64_t iw = iw_begin + ow_begin * g.strides[2];
+            typename Op::ImPtr im_row = im + ((id * ih_num + ih) * iw_num + iw) * channel_num;
+            FOR_RANGE(int64_t, c, 0, channel_num) {
+              typename Op::ColPtr col_c = col_row + c * col_row_size;
+              Op::Pad(col_c, ow_begin);
+              Op::template Copy<0>(im_row + c, im_pixel_stride, col_c + ow_begin,
+                                   ow_end - ow_begin);
+              Op::Pad(col_c + ow_end, ow_num - ow_end);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// 1x1 and 3x3 kernels with unit width stride cover nearly all of ResNet, they get fully unrolled
+// kernel loops and contiguous row copies.
+template<typename Op>
+void NCDHWColBufWalkDispatch(const ConvGeometry& g, typename Op::ImPtr im,
+                             typename Op::ColPtr col) {
+  const int64_t kernel_h = g.kernel_dims[1];
+  const int64_t kernel_w = g.kernel_dims[2];
+  if (g.strides[2] == 1) {
+    if (kernel_h == 1 && kernel_w == 1) {
+      NCDHWColBufWalk<Op, 1, 1, 1>(g, im, col);
+    } else if (kernel_h == 3 && kernel_w == 3) {
+      NCDHWColBufWalk<Op, 3, 3, 1>(g, im, col);
+    } else {
+      NCDHWColBufWalk<Op, 0, 0, 1>(g, im, col);
+    }
+  } else {
+    NCDHWColBufWalk<Op, 0, 0, 0>(g, im, col);
+  }
+}
+
+template<typename Op>
+void NDHWCColBufWalkDispatch(const ConvGeometry& g, typename Op::ImPtr im,
+                             typename Op::ColPtr col) {
+  const int64_t kernel_h = g.kernel_dims[1];
+  const int64_t kernel_w = g.kernel_dims[2];
+  if (kernel_h == 1 && kernel_w == 1) {
+    NDHWCColBufWalk<Op, 1, 1>(g, im, col);
+  } else if (kernel_h == 3 && kernel_w == 3) {
+    NDHWCColBufWalk<Op, 3, 3>(g, im, col);
+  } else {
+    NDHWCColBufWalk<Op, 0, 0>(g, im, col);
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void ConvCpuKernelUtil<T>::NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                                       const ShapeView& weight_shape, const ShapeView& out_shape,
+                                       const int32_t* strides, const int32_t* dilation_rate,
+                                       const int32_t* padding_before, T* col_buf) {
+  NCDHWColBufWalkDispatch<Im2ColOp<T>>(MakeConvGeometry(in_shape, weight_shape, out_shape, 2,
+                                                        strides, dilation_rate, padding_before),
+                                       in_dptr, col_buf);
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                                       const ShapeView& weight_shape, const ShapeView& out_shape,
+                                       const int32_t* strides, const int32_t* dilation_rate,
+                                       const int32_t* padding_before, T* col_buf) {
+  NDHWCColBufWalkDispatch<Im2ColOp<T>>(MakeConvGeometry(in_shape, weight_shape, out_shape, 1,
+                                                        strides, dilation_rate, padding_before),
+                                       in_dptr, col_buf);
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::NCDHWCol2Im(const T* col_buf, const ShapeView& in_shape,
+                                       const ShapeView& weight_shape, const ShapeView& out_shape,
+                                       const int32_t* strides, const int32_t* dilation_rate,
+                                       const int32_t* padding_before, T* in_diff_ptr) {
+  NCDHWColBufWalkDispatch<Col2ImOp<T>>(MakeConvGeometry(in_shape, weight_shape, out_shape, 2,
+                                                        strides, dilation_rate, padding_before),
+                                       in_diff_ptr, col_buf);
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::NDHWCCol2Im(const T* col_buf, const ShapeView& in_shape,
+                                       const ShapeView& weight_shape, const ShapeView& out_shape,
+                                       const int32_t* strides, const int32_t* dilation_rate,
+                                       const int32_t* padding_before, T* in_diff_ptr) {
+  NDHWCColBufWalkDispatch<Col2ImOp<T>>(MakeConvGeometry(in_shape, weight_shape, out_shape, 1,
+                                                        strides, dilation_rate, padding_before),
+                                       in_diff_ptr, col_buf);
+}
+
+template struct ConvCpuKernelUtil<float>;
+template struct ConvCpuKernelUtil<double>;
+
+}  // namespace oneflow
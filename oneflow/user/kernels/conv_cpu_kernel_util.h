@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/shape_view.h"
+
+namespace oneflow {
+
+// All shapes are 5d, (N, C, D, H, W) or (N, D, H, W, C) for in/out and (F, C, KD, KH, KW) or
+// (F, KD, KH, KW, C) for weight; in_dptr, col_buf and in_diff_ptr point to a single image.
+// The column buffer is (C * KD * KH * KW, OD * OH * OW) for both layouts, its rows ordered the
+// same way as the weight.
+template<typename T>
+struct ConvCpuKernelUtil final {
+  static void NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* col_buf);
+  static void NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* col_buf);
+  // col2im accumulates into in_diff_ptr
+  static void NCDHWCol2Im(const T* col_buf, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* in_diff_ptr);
+  static void NDHWCCol2Im(const T* col_buf, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* in_diff_ptr);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct Conv2DCase {
+  int64_t channel;
+  int64_t in_hw;
+  int64_t kernel;
+  int32_t stride;
+  int32_t dilation;
+  int32_t padding;
+};
+
+int64_t OutSize(const Conv2DCase& c) {
+  return (c.in_hw + 2 * c.padding - c.dilation * (c.kernel - 1) - 1) / c.stride + 1;
+}
+
+struct Conv2DShapes {
+  Conv2DShapes(const Conv2DCase& c, bool channels_first) {
+    const int64_t out_hw = OutSize(c);
+    if (channels_first) {
+      in = Shape({1, c.channel, 1, c.in_hw, c.in_hw});
+      out = Shape({1, 1, 1, out_hw, out_hw});
+      weight = Shape({1, c.channel, 1, c.kernel, c.kernel});
+    } else {
+      in = Shape({1, 1, c.in_hw, c.in_hw, c.channel});
+      out = Shape({1, 1, out_hw, out_hw, 1});
+      weight = Shape({1, 1, c.kernel, c.kernel, c.channel});
+    }
+    strides = {1, c.stride, c.stride};
+    dilation_rate = {1, c.dilation, c.dilation};
+    padding_before = {0, c.padding, c.padding};
+  }
+  Shape in;
+  Shape out;
+  Shape weight;
+  std::vector<int32_t> strides;
+  std::vector<int32_t> dilation_rate;
+  std::vector<int32_t> padding_before;
+};
+
+// One bounds checked index computation per column element, the way the removed ColBufWriter did.
+template<typename T>
+void NaiveIm2Col(const Conv2DCase& c, bool channels_first, const T* in, T* col) {
+  const int64_t out_hw = OutSize(c);
+  FOR_RANGE(int64_t, row, 0, c.channel * c.kernel * c.kernel) {
+    int64_t ch = 0;
+    int64_t kh = 0;
+    int64_t kw = 0;
+    if (channels_first) {
+      ch = row / (c.kernel * c.kernel);
+      kh = row / c.kernel % c.kernel;
+      kw = row % c.kernel;
+    } else {
+      kh = row / (c.kernel * c.channel);
+      kw = row / c.channel % c.kernel;
+      ch = row % c.channel;
+    }
+    FOR_RANGE(int64_t, oh, 0, out_hw) {
+      FOR_RANGE(int64_t, ow, 0, out_hw) {
+        const int64_t ih = oh * c.stride + kh * c.dilation - c.padding;
+        const int64_t iw = ow * c.stride + kw * c.dilation - c.padding;
+        T val = 0;
+        if (ih >= 0 && ih < c.in_hw && iw >= 0 && iw < c.in_hw) {
+          val = channels_first ? in[(ch * c.in_hw + ih) * c.in_hw + iw]
+                               : in[(ih * c.in_hw + iw) * c.channel + ch];
+        }
+        col[(row * out_hw + oh) * out_hw + ow] = val;
+      }
+    }
+  }
+}
+
+template<typename T>
+void Im2Col(const Conv2DShapes& s, bool channels_first, const T* in, T* col) {
+  auto Func =
+      channels_first ? ConvCpuKernelUtil<T>::NCDHWIm2Col : ConvCpuKernelUtil<T>::NDHWCIm2Col;
+  Func(in, ShapeView(s.in), ShapeView(s.weight), ShapeView(s.out), s.strides.data(),
+       s.dilation_rate.data(), s.padding_before.data(), col);
+}
+
+template<typename T>
+void Col2Im(const Conv2DShapes& s, bool channels_first, const T* col, T* in_diff) {
+  auto Func =
+      channels_first ? ConvCpuKernelUtil<T>::NCDHWCol2Im : ConvCpuKernelUtil<T>::NDHWCCol2Im;
+  Func(col, ShapeView(s.in), ShapeView(s.weight), ShapeView(s.out), s.strides.data(),
+       s.dilation_rate.data(), s.padding_before.data(), in_diff);
+}
+
+const std::vector<Conv2DCase>& TestCases() {
+  static const std::vector<Conv2DCase> cases = {
+      {3, 9, 1, 1, 1, 0}, {3, 9, 1, 2, 1, 0}, {2, 8, 3, 1, 1, 1}, {2, 8, 3, 2, 1, 1},
+      {4, 7, 3, 1, 2, 2}, {3, 11, 5, 3, 1, 2}, {2, 6, 2, 1, 1, 0}, {1, 5, 7, 2, 1, 3},
+  };
+  return cases;
+}
+
+}  // namespace
+
+TEST(ConvCpuKernelUtil, im2col_matches_naive) {
+  for (const Conv2DCase& c : TestCases()) {
+    for (bool channels_first : {true, false}) {
+      const Conv2DShapes s(c, channels_first);
+      const std::vector<double> in = test::RandomVector<double>(s.in.elem_cnt());
+      const int64_t col_size = s.weight.Count(1) * s.out.Count(1);
+      std::vector<double> col(col_size, -1);
+      std::vector<double> ref_col(col_size);
+      Im2Col(s, channels_first, in.data(), col.data());
+      NaiveIm2Col(c, channels_first, in.data(), ref_col.data());
+      ASSERT_EQ(col, ref_col) << "kernel " << c.kernel << ", stride " << c.stride
+                              << ", channels_first " << channels_first;
+    }
+  }
+}
+
+// col2im is the adjoint of im2col: <im2col(x), y> == <x, col2im(y)>
+TEST(ConvCpuKernelUtil, col2im_is_adjoint_of_im2col) {
+  for (const Conv2DCase& c : TestCases()) {
+    for (bool channels_first : {true, false}) {
+      const Conv2DShapes s(c, channels_first);
+      const int64_t col_size = s.weight.Count(1) * s.out.Count(1);
+      const std::vector<double> x = test::RandomVector<double>(s.in.elem_cnt());
+      const std::vector<double> y = test::RandomVector<double>(col_size);
+      std::vector<double> col(col_size);
+      std::vector<double> x_diff(x.size(), 0);
+      Im2Col(s, channels_first, x.data(), col.data());
+      Col2Im(s, channels_first, y.data(), x_diff.data());
+      double lhs = 0;
+      double rhs = 0;
+      FOR_RANGE(int64_t, i, 0, col_size) { lhs += col[i] * y[i]; }
+      FOR_RANGE(size_t, i, 0, x.size()) { rhs += x[i] * x_diff[i]; }
+      ASSERT_NEAR(lhs, rhs, 1e-9);
+    }
+  }
+}
+
+}  // namespace oneflow
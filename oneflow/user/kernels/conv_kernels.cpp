@@ -16,6 +16,9 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/ops/nn_util.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -73,222 +76,50 @@ size_t CalcElemNumOfColBuf(const ShapeView& out_shape, const ShapeView& weight_s
   return col_buf_elem_cnt;
 }
 
-template<typename T>
-class ColBufWriter {
- public:
-  ColBufWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : src_ptr_(src_ptr),
-        dst_ptr_(dst_ptr),
-        c_size_(c_size),
-        id_size_(id_size),
-        ih_size_(ih_size),
-        iw_size_(iw_size),
-        od_size_(od_size),
-        oh_size_(oh_size),
-        ow_size_(ow_size) {}
-  virtual ~ColBufWriter() = default;
-  virtual void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
-  virtual void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
-  virtual void InvalidDFunc() = 0;
-  virtual void InvalidHFunc() = 0;
-  virtual void InvalidWFunc() = 0;
-  virtual void NextImCSize() = 0;
-
- protected:
-  const T* src_ptr_;
-  T* dst_ptr_;
-  int64_t c_size_;
-  int64_t id_size_;
-  int64_t ih_size_;
-  int64_t iw_size_;
-  int64_t od_size_;
-  int64_t oh_size_;
-  int64_t ow_size_;
-};
+// Images of a batch are lowered and multiplied concurrently, each in flight image owning a column
+// buffer. The cap bounds the tmp buffer of large batches.
+constexpr int64_t kMaxConcurrentImageNum = 8;
 
-template<typename T>
-class Im2ColWriter final : public ColBufWriter<T> {
- public:
-  Im2ColWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
-                                      oh_size, ow_size) {}
-  ~Im2ColWriter() = default;
-  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    *(this->dst_ptr_++) =
-        this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c];
-  }
-  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    *(this->dst_ptr_++) = this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw];
-  }
-  void InvalidDFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->od_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void InvalidHFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->oh_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void InvalidWFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->ow_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void NextImCSize() override { this->src_ptr_ += this->c_size_; }
-};
-
-template<typename T>
-class Col2ImWriter final : public ColBufWriter<T> {
- public:
-  Col2ImWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
-                                      oh_size, ow_size) {}
-  ~Col2ImWriter() = default;
-  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c] +=
-        *(this->src_ptr_++);
-  }
-  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw] += *(this->src_ptr_++);
-  }
-  void InvalidDFunc() override { this->src_ptr_ += this->od_size_; }
-  void InvalidHFunc() override { this->src_ptr_ += this->oh_size_; }
-  void InvalidWFunc() override { this->src_ptr_ += this->ow_size_; }
-  void NextImCSize() override { this->dst_ptr_ += this->c_size_; }
-};
-
-template<typename T>
-using DHWValidFunc = void (ColBufWriter<T>::*)(int64_t c, int64_t kd, int64_t kh, int64_t kw);
+int64_t ConcurrentImageNum(int64_t batch) {
+  return std::max<int64_t>(std::min(batch, kMaxConcurrentImageNum), 1);
+}
 
-template<typename T>
-class ColBufUtil final {
- public:
-  ColBufUtil(const ShapeView& in_shape, const ShapeView& out_shape, int32_t dhw_offset,
-             const int32_t* strides, const int32_t* dilation_rate, const int32_t* padding_before)
-      : strides_(strides), dilation_rate_(dilation_rate), padding_before_(padding_before) {
-    id_num_ = in_shape.At(dhw_offset);
-    ih_num_ = in_shape.At(dhw_offset + 1);
-    iw_num_ = in_shape.At(dhw_offset + 2);
-    od_num_ = out_shape.At(dhw_offset);
-    oh_num_ = out_shape.At(dhw_offset + 1);
-    ow_num_ = out_shape.At(dhw_offset + 2);
-    if (dhw_offset == 2) {
-      dhw_valid_func_ = &ColBufWriter<T>::CDHWWrite;
-    } else {
-      dhw_valid_func_ = &ColBufWriter<T>::DHWCWrite;
-    }
-  }
-  void operator()(ColBufWriter<T>* col_buf_writer, int64_t c, int64_t kd, int64_t kh, int64_t kw) {
-    int64_t id = kd * dilation_rate_[0] - padding_before_[0];
-    FOR_RANGE(int64_t, od, 0, od_num_) {
-      if (id < 0 || id >= id_num_) {
-        col_buf_writer->InvalidDFunc();
-      } else {
-        int64_t ih = kh * dilation_rate_[1] - padding_before_[1];
-        FOR_RANGE(int64_t, oh, 0, oh_num_) {
-          if (ih < 0 || ih >= ih_num_) {
-            col_buf_writer->InvalidHFunc();
-          } else {
-            int64_t iw = kw * dilation_rate_[2] - padding_before_[2];
-            FOR_RANGE(int64_t, ow, 0, ow_num_) {
-              if (iw < 0 || iw >= iw_num_) {
-                col_buf_writer->InvalidWFunc();
-              } else {
-                (col_buf_writer->*dhw_valid_func_)(c, id, ih, iw);
-              }
-              iw += strides_[2];
-            }
-          }
-          ih += strides_[1];
-        }
-      }
-      id += strides_[0];
+void ForEachImageInParallel(int64_t batch,
+                            const std::function<void(int64_t slot, int64_t img_idx)>& Handler) {
+  const int64_t slot_num = ConcurrentImageNum(batch);
+  BalancedSplitter bs(batch, slot_num);
+  ParallelFor(0, slot_num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, slot, begin, end) {
+      FOR_RANGE(int64_t, i, bs.At(slot).begin(), bs.At(slot).end()) { Handler(slot, i); }
     }
-  }
-
- private:
-  int64_t id_num_;
-  int64_t ih_num_;
-  int64_t iw_num_;
-  int64_t od_num_;
-  int64_t oh_num_;
-  int64_t ow_num_;
-  const int32_t* strides_;
-  const int32_t* dilation_rate_;
-  const int32_t* padding_before_;
-  DHWValidFunc<T> dhw_valid_func_;
-};
-
-template<typename T>
-struct ConvKernelUtil final {
- public:
-  static void NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* col_buf_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
-    Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(3),
-                                   in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
-    DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
+  });
+}
 
-  static void NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* col_buf_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
-    Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(2),
-                                   in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
-                                   out_shape.Count(3, 4), 1);
-    DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
+// A 1x1 kernel with unit strides and no padding needs no im2col, the image itself is the column
+// buffer (transposed for channels last).
+template<typename ContextT>
+bool IsPointwiseConv(const ContextT* ctx) {
+  const auto& kernel_size = ctx->template Attr<std::vector<int32_t>>("kernel_size");
+  const auto& strides = ctx->template Attr<std::vector<int32_t>>("strides");
+  const auto& padding_before = ctx->template Attr<std::vector<int32_t>>("padding_before");
+  for (int32_t k : kernel_size) {
+    if (k != 1) { return false; }
   }
-
-  static void NCDHWCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* in_diff_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
-    Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(3),
-                                   in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
-    DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
+  for (int32_t s : strides) {
+    if (s != 1) { return false; }
   }
-
-  static void NDHWCCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* in_diff_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
-    Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(2),
-                                   in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
-                                   out_shape.Count(3, 4), 1);
-    DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
-
- private:
-  static void DoNCDWHFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
-                          ColBufWriter<T>* col_buf_writer) {
-    for (int64_t c = 0; c != weight_shape.At(1); col_buf_writer->NextImCSize(), ++c) {
-      for (int64_t kd = 0; kd != weight_shape.At(2); ++kd) {
-        for (int64_t kh = 0; kh != weight_shape.At(3); ++kh) {
-          for (int64_t kw = 0; kw != weight_shape.At(4); ++kw) {
-            col_buf_util(col_buf_writer, c, kd, kh, kw);
-          }
-        }
-      }
-    }
+  for (int32_t p : padding_before) {
+    if (p != 0) { return false; }
   }
+  return true;
+}
 
-  static void DoNDWHCFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
-                          ColBufWriter<T>* col_buf_writer) {
-    for (int64_t kd = 0; kd != weight_shape.At(1); ++kd) {
-      for (int64_t kh = 0; kh != weight_shape.At(2); ++kh) {
-        for (int64_t kw = 0; kw != weight_shape.At(3); ++kw) {
-          for (int64_t c = 0; c != weight_shape.At(4); ++c) {
-            col_buf_util(col_buf_writer, c, kd, kh, kw);
-          }
-        }
-      }
-    }
-  }
-};
+size_t ColBufsByteSize(const user_op::InferContext* ctx, const Shape& out_shape,
+                       const Shape& weight_shape, int32_t idx_offset, size_t dtype_size) {
+  if (IsPointwiseConv(ctx)) { return 0; }
+  return ConcurrentImageNum(out_shape.At(0))
+         * CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * dtype_size;
+}
 
 template<typename T>
 struct ConvOpKernelState final : public user_op::OpKernelState {
@@ -307,6 +138,7 @@ struct ConvOpKernelState final : public user_op::OpKernelState {
   enum CBLAS_TRANSPOSE is_out_diff_need_trans_;
   int32_t idx_offset_;
   bool is_dynamic_;
+  bool is_pointwise_;
 
   void Update(const ShapeView& x_shape, const ShapeView& out_shape) {
     auto Gen5DShape = [](const ShapeView& shape, int32_t idx_offset) -> Shape {
@@ -333,14 +165,14 @@ std::shared_ptr<user_op::OpKernelState> CreateConvOpKernelState(user_op::KernelI
 
   std::shared_ptr<ConvOpKernelState<T>> state(new ConvOpKernelState<T>());
   if (data_format == "channels_first") {
-    state->im2col_func_ = ConvKernelUtil<T>::NCDHWIm2Col;
-    state->col2im_func_ = ConvKernelUtil<T>::NCDHWCol2Im;
+    state->im2col_func_ = ConvCpuKernelUtil<T>::NCDHWIm2Col;
+    state->col2im_func_ = ConvCpuKernelUtil<T>::NCDHWCol2Im;
     state->forward_func_ = Gemm4ChannelFirst;
     state->is_out_diff_need_trans_ = CblasNoTrans;
     state->idx_offset_ = 2;
   } else {
-    state->im2col_func_ = ConvKernelUtil<T>::NDHWCIm2Col;
-    state->col2im_func_ = ConvKernelUtil<T>::NDHWCCol2Im;
+    state->im2col_func_ = ConvCpuKernelUtil<T>::NDHWCIm2Col;
+    state->col2im_func_ = ConvCpuKernelUtil<T>::NDHWCCol2Im;
     state->forward_func_ = Gemm4ChannelLast;
     state->is_out_diff_need_trans_ = CblasTrans;
     state->idx_offset_ = 1;
@@ -367,6 +199,7 @@ std::shared_ptr<user_op::OpKernelState> CreateConvOpKernelState(user_op::KernelI
   state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
   state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
   state->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
+  state->is_pointwise_ = IsPointwiseConv(ctx);
   const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
   FOR_RANGE(uint8_t, dim, 0, 3) {
     int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
@@ -402,55 +235,61 @@ class ConvCpuKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
-
     auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
-    conv_state->Update(in->shape(), out->shape());
     CHECK_NOTNULL(conv_state);
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf_dptr);
+    conv_state->Update(in->shape(), out->shape());
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t out_spatial_cnt = conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3);
+
+    // tmp buffer: [bias_mul (if bias)][col_buf of every concurrent image (if not pointwise)]
+    T* bias_mul_dptr = tmp_buffer->mut_dptr<T>();
+    T* col_bufs_dptr = tmp_buffer->mut_dptr<T>();
+    if (bias != nullptr) {
+      InitBiasMulBuf(bias_mul_dptr, out_spatial_cnt);
+      col_bufs_dptr += out_spatial_cnt;
+    }
+    const int64_t col_buf_elem_cnt =
+        conv_state->is_pointwise_ ? 0
+                                  : CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
+    ForEachImageInParallel(in->shape().At(0), [&](int64_t slot, int64_t i) {
+      const T* col_buf_dptr = GetImgDptr<T>(in, i);
+      enum CBLAS_TRANSPOSE col_buf_trans = conv_state->is_out_diff_need_trans_;
+      if (!conv_state->is_pointwise_) {
+        T* slot_col_buf_dptr = col_bufs_dptr + slot * col_buf_elem_cnt;
+        conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
+                                 ShapeView(conv_state->weight_5d_shape_),
+                                 ShapeView(conv_state->out_5d_shape_),
+                                 conv_state->strides_3d_.data(),
+                                 conv_state->dilation_rate_3d_.data(),
+                                 conv_state->padding_before_3d_.data(), slot_col_buf_dptr);
+        col_buf_dptr = slot_col_buf_dptr;
+        col_buf_trans = CblasNoTrans;
+      }
 
       // channels first: out = weight * col_buf
       // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_state->idx_offset_;
-      conv_state->forward_func_(
-          CblasNoTrans, CblasNoTrans,
-          conv_state->weight_5d_shape_.At(0),                           // filter
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_state->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul = tmp_buffer->shape().elem_cnt() - num_of_col_buf;
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf * sizeof(T);
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
+      conv_state->forward_func_(CblasNoTrans, col_buf_trans,
+                                conv_state->weight_5d_shape_.At(0),     // filter
+                                out_spatial_cnt,                        // od * oh * ow
+                                conv_state->weight_5d_shape_.Count(1),  // ci * kd * kh * kw
+                                static_cast<T>(1), weight->dptr<T>(), col_buf_dptr,
+                                static_cast<T>(0), GetImgMutDptr<T>(out, i));
 
+      if (bias != nullptr) {
         // channels first:  out += bias * bias_mul
         // channels last:   out += (bias * bias_mul)(T)
-        conv_state->forward_func_(
-            CblasNoTrans, CblasNoTrans,
-            conv_state->weight_5d_shape_.At(0),                           // filter
-            conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
+        conv_state->forward_func_(CblasNoTrans, CblasNoTrans,
+                                  conv_state->weight_5d_shape_.At(0),  // filter
+                                  out_spatial_cnt,                     // od * oh * ow
+                                  1,                                   // 1
+                                  static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr,
+                                  static_cast<T>(1), GetImgMutDptr<T>(out, i));
       }
-    }
+    });
   }
 };
 
@@ -467,7 +306,7 @@ class ConvCpuKernel final : public user_op::OpKernel {
                                                                                             \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
         tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
+            ColBufsByteSize(ctx, out_shape, weight_shape, idx_offset, sizeof(dtype));       \
                                                                                             \
         const auto* bias = ctx->TensorDesc4ArgNameAndIndex("bias", 0);                      \
         if (bias != nullptr) {                                                              \
@@ -508,46 +347,67 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
     user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     conv_state->Update(dx->shape(), dy->shape());
+
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t filter_num = conv_state->weight_5d_shape_.At(0);
+    const int64_t col_buf_row_num = conv_state->weight_5d_shape_.Count(1);
+    const int64_t out_spatial_cnt = conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3);
+    if (conv_state->is_pointwise_) {
+      ForEachImageInParallel(dy->shape().At(0), [&](int64_t slot, int64_t i) {
+        if (idx_offset == 2) {
+          // channels first:  in[i]' = weight(T) * out[i]'
+          NewKernelUtil<DeviceType::kCPU>::OFGemm(
+              nullptr, CblasTrans, CblasNoTrans, col_buf_row_num, out_spatial_cnt, filter_num,
+              static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
+              GetImgMutDptr<T>(dx, i));
+        } else {
+          // channels last :  in[i]' = out[i]' * weight
+          NewKernelUtil<DeviceType::kCPU>::OFGemm(
+              nullptr, CblasNoTrans, CblasNoTrans, out_spatial_cnt, col_buf_row_num, filter_num,
+              static_cast<T>(1), GetImgDptr<T>(dy, i), filter->dptr<T>(), static_cast<T>(0),
+              GetImgMutDptr<T>(dx, i));
+        }
+      });
+      return;
+    }
+
     Memset<DeviceType::kCPU>(ctx->device_ctx(), dx->mut_dptr<T>(), 0,
                              dx->shape().elem_cnt() * sizeof(T));
-
-    int32_t idx_offset = conv_state->idx_offset_;
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
+    const int64_t col_buf_elem_cnt = CalcElemNumOfColBuf(dy->shape(), filter->shape(), idx_offset);
+    ForEachImageInParallel(dy->shape().At(0), [&](int64_t slot, int64_t i) {
+      T* col_buf_dptr = col_buf->mut_dptr<T>() + slot * col_buf_elem_cnt;
       // channels first:  col_buf' = weight(T) * out[i]'
       // channels last :  col_buf' = weight(T) * out[i]'(T)
       NewKernelUtil<DeviceType::kCPU>::OFGemm(
           nullptr, CblasTrans, conv_state->is_out_diff_need_trans_,
-          conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          conv_state->weight_5d_shape_.At(0),                           //  filter
+          col_buf_row_num,  //  ci * kd * kh * kw
+          out_spatial_cnt,  //  od * oh * ow
+          filter_num,       //  filter
           static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
-          col_buf->mut_dptr<T>());
+          col_buf_dptr);
 
       // in' = col2im(col_buf')
-      conv_state->col2im_func_(col_buf->dptr<T>(), ShapeView(conv_state->in_5d_shape_),
+      conv_state->col2im_func_(col_buf_dptr, ShapeView(conv_state->in_5d_shape_),
                                ShapeView(conv_state->weight_5d_shape_),
                                ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
                                conv_state->dilation_rate_3d_.data(),
                                conv_state->padding_before_3d_.data(), GetImgMutDptr<T>(dx, i));
-    }
+    });
   }
 };
 
-#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                     \
-  REGISTER_USER_KERNEL(#op_name)                                                           \
-      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                         \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                        \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))     \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                        \
-        size_t tmp_buffer_size = 0;                                                        \
-        const auto& out_diff_shape = ctx->TensorDesc4ArgNameAndIndex("dy", 0)->shape();    \
-        const auto& weight_shape = ctx->TensorDesc4ArgNameAndIndex("filter", 0)->shape();  \
-                                                                                           \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));             \
-        tmp_buffer_size +=                                                                 \
-            CalcElemNumOfColBuf(out_diff_shape, weight_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                            \
+#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                            \
+  REGISTER_USER_KERNEL(#op_name)                                                                  \
+      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                                \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                             \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                               \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))            \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                               \
+        const auto& out_diff_shape = ctx->TensorDesc4ArgNameAndIndex("dy", 0)->shape();           \
+        const auto& weight_shape = ctx->TensorDesc4ArgNameAndIndex("filter", 0)->shape();         \
+                                                                                                  \
+        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                    \
+        return ColBufsByteSize(ctx, out_diff_shape, weight_shape, idx_offset, sizeof(dtype));     \
       })
 
 REGISTER_CONV_DATA_GRAD_KERNEL(conv_data_grad, float);
@@ -575,48 +435,82 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
     const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
     const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
     user_op::Tensor* filter_diff = ctx->Tensor4ArgNameAndIndex("filter_diff", 0);
-    user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     conv_state->Update(x->shape(), dy->shape());
 
+    const int32_t idx_offset = conv_state->idx_offset_;
+    const int64_t batch = dy->shape().At(0);
+    const int64_t slot_num = ConcurrentImageNum(batch);
+    const int64_t filter_elem_cnt = filter_diff->shape().elem_cnt();
+    const int64_t col_buf_elem_cnt =
+        conv_state->is_pointwise_
+            ? 0
+            : CalcElemNumOfColBuf(dy->shape(), filter_diff->shape(), idx_offset);
+    // tmp buffer: [col_buf of every concurrent image][filter_diff partial sum of slot 1, 2, ...]
+    T* col_bufs_dptr = tmp_buffer->mut_dptr<T>();
+    T* partial_filter_diffs_dptr = col_bufs_dptr + slot_num * col_buf_elem_cnt;
     Memset<DeviceType::kCPU>(ctx->device_ctx(), filter_diff->mut_dptr<T>(), 0,
-                             filter_diff->shape().elem_cnt() * sizeof(T));
-    int32_t idx_offset = conv_state->idx_offset_;
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      conv_state->im2col_func_(GetImgDptr<T>(x, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf->mut_dptr<T>());
+                             filter_elem_cnt * sizeof(T));
+    Memset<DeviceType::kCPU>(ctx->device_ctx(), partial_filter_diffs_dptr, 0,
+                             (slot_num - 1) * filter_elem_cnt * sizeof(T));
+    ForEachImageInParallel(batch, [&](int64_t slot, int64_t i) {
+      T* slot_filter_diff_dptr = slot == 0
+                                     ? filter_diff->mut_dptr<T>()
+                                     : partial_filter_diffs_dptr + (slot - 1) * filter_elem_cnt;
+      const T* col_buf_dptr = GetImgDptr<T>(x, i);
+      enum CBLAS_TRANSPOSE col_buf_trans = idx_offset == 2 ? CblasTrans : CblasNoTrans;
+      if (!conv_state->is_pointwise_) {
+        T* slot_col_buf_dptr = col_bufs_dptr + slot * col_buf_elem_cnt;
+        conv_state->im2col_func_(GetImgDptr<T>(x, i), ShapeView(conv_state->in_5d_shape_),
+                                 ShapeView(conv_state->weight_5d_shape_),
+                                 ShapeView(conv_state->out_5d_shape_),
+                                 conv_state->strides_3d_.data(),
+                                 conv_state->dilation_rate_3d_.data(),
+                                 conv_state->padding_before_3d_.data(), slot_col_buf_dptr);
+        col_buf_dptr = slot_col_buf_dptr;
+        col_buf_trans = CblasTrans;
+      }
 
       // channels first:  weight' += out[i]' * col_buf(T)
       // channels last :  weight' += out[i]'(T) * col_buf(T)
       NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          nullptr, conv_state->is_out_diff_need_trans_, CblasTrans,
+          nullptr, conv_state->is_out_diff_need_trans_, col_buf_trans,
           conv_state->weight_5d_shape_.At(0),                           //  filter
           conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
           conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          static_cast<T>(1), GetImgDptr<T>(dy, i), col_buf->dptr<T>(), static_cast<T>(1),
-          filter_diff->mut_dptr<T>());
+          static_cast<T>(1), GetImgDptr<T>(dy, i), col_buf_dptr, static_cast<T>(1),
+          slot_filter_diff_dptr);
+    });
+    if (slot_num > 1) {
+      T* filter_diff_dptr = filter_diff->mut_dptr<T>();
+      ParallelFor(0, filter_elem_cnt, -1, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, slot, 1, slot_num) {
+          const T* partial_dptr = partial_filter_diffs_dptr + (slot - 1) * filter_elem_cnt;
+          FOR_RANGE(int64_t, j, begin, end) { filter_diff_dptr[j] += partial_dptr[j]; }
+        }
+      });
     }
   }
 };
 
-#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                        \
-  REGISTER_USER_KERNEL(#op_name)                                                                \
-      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                            \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                             \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))          \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
-        size_t tmp_buffer_size = 0;                                                             \
-        const auto& out_diff_shape = ctx->TensorDesc4ArgNameAndIndex("dy", 0)->shape();         \
-        const auto& weight_diff_shape =                                                         \
-            ctx->TensorDesc4ArgNameAndIndex("filter_diff", 0)->shape();                         \
-                                                                                                \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                  \
-        tmp_buffer_size +=                                                                      \
-            CalcElemNumOfColBuf(out_diff_shape, weight_diff_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                                 \
+#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                         \
+  REGISTER_USER_KERNEL(#op_name)                                                                 \
+      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                            \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                              \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))           \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        size_t tmp_buffer_size = 0;                                                              \
+        const auto& out_diff_shape = ctx->TensorDesc4ArgNameAndIndex("dy", 0)->shape();          \
+        const auto& weight_diff_shape =                                                          \
+            ctx->TensorDesc4ArgNameAndIndex("filter_diff", 0)->shape();                          \
+                                                                                                 \
+        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                   \
+        tmp_buffer_size +=                                                                       \
+            ColBufsByteSize(ctx, out_diff_shape, weight_diff_shape, idx_offset, sizeof(dtype));  \
+        tmp_buffer_size += (ConcurrentImageNum(out_diff_shape.At(0)) - 1)                        \
+                           * weight_diff_shape.elem_cnt() * sizeof(dtype);                       \
+        return tmp_buffer_size;                                                                  \
       })
 
 REGISTER_CONV_FILTER_GRAD_KERNEL(conv_filter_grad, float);
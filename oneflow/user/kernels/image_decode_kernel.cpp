@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include <opencv2/opencv.hpp>
 
 namespace oneflow {
@@ -23,10 +24,31 @@ namespace oneflow {
 namespace {
 
 void DecodeImage(const TensorBuffer& raw_bytes, TensorBuffer* image_buffer,
-                 const std::string& color_space, DataType data_type) {
+                 const std::string& color_space, DataType data_type, int64_t target_resize_x,
+                 int64_t target_resize_y) {
   // should only support kChar, but numpy ndarray maybe cannot convert to char*
   CHECK(raw_bytes.data_type() == DataType::kChar || raw_bytes.data_type() == DataType::kInt8
         || raw_bytes.data_type() == DataType::kUInt8);
+  const auto* src_data = static_cast<const unsigned char*>(raw_bytes.data());
+  // the libjpeg path is only taken when a target resize is asked for
+  const bool partial_decode = target_resize_x > 0 && target_resize_y > 0;
+  if (partial_decode && data_type == DataType::kUInt8) {
+    if (JpegPartialDecodeRandomCropImage(src_data, raw_bytes.elem_cnt(), nullptr, nullptr,
+                                         target_resize_x, target_resize_y, color_space,
+                                         image_buffer)) {
+      return;
+    }
+  } else if (partial_decode && data_type == DataType::kFloat) {
+    TensorBuffer decoded;
+    if (JpegPartialDecodeRandomCropImage(src_data, raw_bytes.elem_cnt(), nullptr, nullptr,
+                                         target_resize_x, target_resize_y, color_space,
+                                         &decoded)) {
+      image_buffer->Resize(decoded.shape(), DataType::kFloat);
+      std::copy(decoded.data<uint8_t>(), decoded.data<uint8_t>() + decoded.elem_cnt(),
+                image_buffer->mut_data<float>());
+      return;
+    }
+  }
   cv::_InputArray raw_bytes_arr(raw_bytes.data<char>(), raw_bytes.elem_cnt());
   cv::Mat image_mat = cv::imdecode(
       raw_bytes_arr, (ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE)
@@ -76,9 +98,12 @@ class ImageDecodeKernel final : public user_op::OpKernel {
     TensorBuffer* out_img_buf = out_tensor->mut_dptr<TensorBuffer>();
     const std::string& color_space = ctx->Attr<std::string>("color_space");
     const DataType data_type = ctx->Attr<DataType>("data_type");
+    const int64_t target_resize_x = ctx->Attr<int64_t>("target_resize_x");
+    const int64_t target_resize_y = ctx->Attr<int64_t>("target_resize_y");
 
     MultiThreadLoop(in_tensor->shape().elem_cnt(), [&](size_t i) {
-      DecodeImage(in_img_buf[i], out_img_buf + i, color_space, data_type);
+      DecodeImage(in_img_buf[i], out_img_buf + i, color_space, data_type, target_resize_x,
+                  target_resize_y);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
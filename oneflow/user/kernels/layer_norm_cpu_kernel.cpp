@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -25,7 +26,37 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    const T* gamma = nullptr;
+    const T* beta = nullptr;
+    T* normalized = nullptr;
+    int64_t param_size = 1;
+    if (scale) {
+      const user_op::Tensor* gamma_tensor = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      gamma = gamma_tensor->dptr<T>();
+      param_size = gamma_tensor->shape().elem_cnt();
+      normalized = ctx->Tensor4ArgNameAndIndex("normalized", 0)->mut_dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta_tensor = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      beta = beta_tensor->dptr<T>();
+      param_size = beta_tensor->shape().elem_cnt();
+    }
+    const int64_t num_instances = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % num_instances, 0);
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    CHECK_EQ(y->shape().elem_cnt() % param_size, 0);
+    LayerNormCpuKernelUtil<T>::Forward(num_instances, norm_size, param_size,
+                                       ctx->Attr<double>("epsilon"), x->dptr<T>(), gamma, beta,
+                                       y->mut_dptr<T>(), normalized, mean->mut_dptr<T>(),
+                                       inv_variance->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
@@ -45,7 +76,19 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % num_instances, 0);
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    LayerNormCpuKernelUtil<T>::Backward(num_instances, norm_size, dy->dptr<T>(), x->dptr<T>(),
+                                        mean->dptr<T>(), inv_variance->dptr<T>(),
+                                        dx->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
@@ -65,7 +108,22 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const user_op::Tensor* normalized = ctx->Tensor4ArgNameAndIndex("normalized", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t param_size = dy->shape().Count(begin_params_axis);
+    const int64_t n = dy->shape().elem_cnt() / param_size;
+    LayerNormCpuKernelUtil<T>::ParamBackward(
+        n, param_size, dy->dptr<T>(), gamma_diff ? normalized->dptr<T>() : nullptr,
+        gamma ? gamma->dptr<T>() : nullptr, beta_diff ? beta_diff->mut_dptr<T>() : nullptr,
+        gamma_diff ? gamma_diff->mut_dptr<T>() : nullptr,
+        normalized_diff ? normalized_diff->mut_dptr<T>() : nullptr);
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
@@ -0,0 +1,202 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_manager.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kWelfordLaneNum = 8;
+constexpr int64_t kMinElemCntPerTask = 32 * 1024;
+
+int64_t InstanceGrain(int64_t norm_size) {
+  return std::max<int64_t>(1, kMinElemCntPerTask / std::max<int64_t>(norm_size, 1));
+}
+
+// Single pass mean and (biased) variance. kWelfordLaneNum Welford accumulators advance in lock
+// step so that the inner loop vectorizes; the lanes and the tail are then merged with Chan's
+// pairwise update.
+template<typename T>
+void WelfordMeanAndVariance(const T* x, int64_t n, T* mean, T* variance) {
+  T lane_mean[kWelfordLaneNum] = {0};
+  T lane_m2[kWelfordLaneNum] = {0};
+  const int64_t block_num = n / kWelfordLaneNum;
+  for (int64_t b = 0; b < block_num; ++b) {
+    const T inv_count = static_cast<T>(1) / static_cast<T>(b + 1);
+    const T* block = x + b * kWelfordLaneNum;
+    for (int64_t l = 0; l < kWelfordLaneNum; ++l) {
+      const T delta = block[l] - lane_mean[l];
+      lane_mean[l] += delta * inv_count;
+      lane_m2[l] += delta * (block[l] - lane_mean[l]);
+    }
+  }
+  T count = 0;
+  T m = 0;
+  T m2 = 0;
+  if (block_num > 0) {
+    const T lane_count = static_cast<T>(block_num);
+    count = lane_count;
+    m = lane_mean[0];
+    m2 = lane_m2[0];
+    for (int64_t l = 1; l < kWelfordLaneNum; ++l) {
+      const T new_count = count + lane_count;
+      const T delta = lane_mean[l] - m;
+      m += delta * lane_count / new_count;
+      m2 += lane_m2[l] + delta * delta * count * lane_count / new_count;
+      count = new_count;
+    }
+  }
+  for (int64_t i = block_num * kWelfordLaneNum; i < n; ++i) {
+    count += 1;
+    const T delta = x[i] - m;
+    m += delta / count;
+    m2 += delta * (x[i] - m);
+  }
+  *mean = m;
+  *variance = m2 / static_cast<T>(n);
+}
+
+// y[j] = in[j] * gamma[p] + beta[p] where p walks the params starting at param_offset.
+template<typename T>
+void AffineTransform(const T* in, int64_t size, const T* gamma, const T* beta,
+                     int64_t param_offset, int64_t param_size, T* y) {
+  if (param_offset == 0 && param_size == size) {
+    if (gamma != nullptr && beta != nullptr) {
+      for (int64_t j = 0; j < size; ++j) { y[j] = in[j] * gamma[j] + beta[j]; }
+    } else if (gamma != nullptr) {
+      for (int64_t j = 0; j < size; ++j) { y[j] = in[j] * gamma[j]; }
+    } else {
+      for (int64_t j = 0; j < size; ++j) { y[j] = in[j] + beta[j]; }
+    }
+  } else {
+    int64_t p = param_offset;
+    for (int64_t j = 0; j < size; ++j) {
+      T val = in[j];
+      if (gamma != nullptr) { val *= gamma[p]; }
+      if (beta != nullptr) { val += beta[p]; }
+      y[j] = val;
+      p += 1;
+      if (p == param_size) { p = 0; }
+    }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Forward(int64_t num_instances, int64_t norm_size,
+                                        int64_t param_size, double epsilon, const T* x,
+                                        const T* gamma, const T* beta, T* y, T* normalized,
+                                        T* mean, T* inv_variance) {
+  ParallelFor(0, num_instances, InstanceGrain(norm_size), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T* x_i = x + i * norm_size;
+      T* y_i = y + i * norm_size;
+      T* normalized_i = normalized == nullptr ? y_i : normalized + i * norm_size;
+      T mean_i = 0;
+      T variance_i = 0;
+      WelfordMeanAndVariance(x_i, norm_size, &mean_i, &variance_i);
+      const T inv_variance_i = static_cast<T>(1) / std::sqrt(variance_i + static_cast<T>(epsilon));
+      mean[i] = mean_i;
+      inv_variance[i] = inv_variance_i;
+      if (gamma != nullptr && beta != nullptr && param_size == norm_size) {
+        // the common transformer case, one pass writes both outputs
+        for (int64_t j = 0; j < norm_size; ++j) {
+          const T normalized_val = (x_i[j] - mean_i) * inv_variance_i;
+          normalized_i[j] = normalized_val;
+          y_i[j] = normalized_val * gamma[j] + beta[j];
+        }
+        continue;
+      }
+      for (int64_t j = 0; j < norm_size; ++j) {
+        normalized_i[j] = (x_i[j] - mean_i) * inv_variance_i;
+      }
+      if (gamma != nullptr || beta != nullptr) {
+        AffineTransform(normalized_i, norm_size, gamma, beta, (i * norm_size) % param_size,
+                        param_size, y_i);
+      }
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Backward(int64_t num_instances, int64_t norm_size, const T* dy,
+                                         const T* x, const T* mean, const T* inv_variance,
+                                         T* dx) {
+  ParallelFor(0, num_instances, InstanceGrain(norm_size), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T* dy_i = dy + i * norm_size;
+      const T* x_i = x + i * norm_size;
+      T* dx_i = dx + i * norm_size;
+      const T mean_i = mean[i];
+      const T inv_variance_i = inv_variance[i];
+      T sum_dy = 0;
+      T sum_dy_normalized = 0;
+      for (int64_t j = 0; j < norm_size; ++j) {
+        sum_dy += dy_i[j];
+        sum_dy_normalized += dy_i[j] * (x_i[j] - mean_i) * inv_variance_i;
+      }
+      const T mean_dy = sum_dy / static_cast<T>(norm_size);
+      const T mean_dy_normalized = sum_dy_normalized / static_cast<T>(norm_size);
+      for (int64_t j = 0; j < norm_size; ++j) {
+        const T normalized = (x_i[j] - mean_i) * inv_variance_i;
+        dx_i[j] = inv_variance_i * (dy_i[j] - mean_dy - normalized * mean_dy_normalized);
+      }
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::ParamBackward(int64_t n, int64_t param_size, const T* dy,
+                                              const T* normalized, const T* gamma, T* beta_diff,
+                                              T* gamma_diff, T* normalized_diff) {
+  // split by columns so that every task owns its slice of beta_diff/gamma_diff and walks the rows
+  // with contiguous inner loops
+  ParallelFor(0, param_size, -1, [&](int64_t begin, int64_t end) {
+    const int64_t width = end - begin;
+    if (beta_diff != nullptr) { std::fill(beta_diff + begin, beta_diff + end, static_cast<T>(0)); }
+    if (gamma_diff != nullptr) {
+      std::fill(gamma_diff + begin, gamma_diff + end, static_cast<T>(0));
+    }
+    FOR_RANGE(int64_t, r, 0, n) {
+      const T* dy_r = dy + r * param_size + begin;
+      if (beta_diff != nullptr) {
+        T* beta_diff_r = beta_diff + begin;
+        for (int64_t c = 0; c < width; ++c) { beta_diff_r[c] += dy_r[c]; }
+      }
+      if (gamma_diff != nullptr) {
+        const T* normalized_r = normalized + r * param_size + begin;
+        T* gamma_diff_r = gamma_diff + begin;
+        for (int64_t c = 0; c < width; ++c) { gamma_diff_r[c] += dy_r[c] * normalized_r[c]; }
+      }
+      if (normalized_diff != nullptr) {
+        T* normalized_diff_r = normalized_diff + r * param_size + begin;
+        if (gamma != nullptr) {
+          const T* gamma_r = gamma + begin;
+          for (int64_t c = 0; c < width; ++c) { normalized_diff_r[c] = dy_r[c] * gamma_r[c]; }
+        } else {
+          std::copy(dy_r, dy_r + width, normalized_diff_r);
+        }
+      }
+    }
+  });
+}
+
+template struct LayerNormCpuKernelUtil<float>;
+template struct LayerNormCpuKernelUtil<double>;
+
+}  // namespace oneflow
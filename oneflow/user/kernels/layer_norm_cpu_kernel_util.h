@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x is viewed as (num_instances, norm_size); gamma and beta (nullable) are broadcast along the
+// flattened element index modulo param_size, the same way the gpu kernel views y as
+// (elem_cnt / param_size, param_size).
+template<typename T>
+struct LayerNormCpuKernelUtil {
+  static void Forward(int64_t num_instances, int64_t norm_size, int64_t param_size,
+                      double epsilon, const T* x, const T* gamma, const T* beta, T* y,
+                      T* normalized, T* mean, T* inv_variance);
+  static void Backward(int64_t num_instances, int64_t norm_size, const T* dy, const T* x,
+                       const T* mean, const T* inv_variance, T* dx);
+  // dy is viewed as (n, param_size); any of the outputs may be nullptr
+  static void ParamBackward(int64_t n, int64_t param_size, const T* dy, const T* normalized,
+                            const T* gamma, T* beta_diff, T* gamma_diff, T* normalized_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+void NaiveTwoPassLayerNorm(int64_t num_instances, int64_t norm_size, double epsilon, const T* x,
+                           const T* gamma, const T* beta, T* y, T* mean, T* inv_variance) {
+  FOR_RANGE(int64_t, i, 0, num_instances) {
+    const T* x_i = x + i * norm_size;
+    T sum = 0;
+    FOR_RANGE(int64_t, j, 0, norm_size) { sum += x_i[j]; }
+    mean[i] = sum / norm_size;
+    T square_sum = 0;
+    FOR_RANGE(int64_t, j, 0, norm_size) { square_sum += (x_i[j] - mean[i]) * (x_i[j] - mean[i]); }
+    inv_variance[i] = 1 / std::sqrt(square_sum / norm_size + static_cast<T>(epsilon));
+    FOR_RANGE(int64_t, j, 0, norm_size) {
+      y[i * norm_size + j] = (x_i[j] - mean[i]) * inv_variance[i] * gamma[j] + beta[j];
+    }
+  }
+}
+
+class LayerNormCpuKernelUtilTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(LayerNormCpuKernelUtilTest, forward_matches_two_pass) {
+  const int64_t num_instances = 37;
+  const int64_t norm_size = 771;
+  const double epsilon = 1e-5;
+  // a large offset makes the naive E[x^2] - E[x]^2 formula useless, Welford must stay accurate
+  const std::vector<double> x = test::RandomVector<double>(num_instances * norm_size, 1000);
+  const std::vector<double> gamma = test::RandomVector<double>(norm_size, 1);
+  const std::vector<double> beta = test::RandomVector<double>(norm_size, 0);
+  std::vector<double> y(x.size()), normalized(x.size()), mean(num_instances),
+      inv_variance(num_instances);
+  std::vector<double> ref_y(x.size()), ref_mean(num_instances), ref_inv_variance(num_instances);
+  LayerNormCpuKernelUtil<double>::Forward(num_instances, norm_size, norm_size, epsilon, x.data(),
+                                          gamma.data(), beta.data(), y.data(), normalized.data(),
+                                          mean.data(), inv_variance.data());
+  NaiveTwoPassLayerNorm(num_instances, norm_size, epsilon, x.data(), gamma.data(), beta.data(),
+                        ref_y.data(), ref_mean.data(), ref_inv_variance.data());
+  FOR_RANGE(int64_t, i, 0, num_instances) {
+    ASSERT_NEAR(mean[i], ref_mean[i], 1e-9);
+    ASSERT_NEAR(inv_variance[i], ref_inv_variance[i], 1e-6);
+  }
+  FOR_RANGE(size_t, i, 0, y.size()) { ASSERT_NEAR(y[i], ref_y[i], 1e-6); }
+}
+
+TEST_F(LayerNormCpuKernelUtilTest, backward_matches_finite_difference) {
+  const int64_t norm_size = 16;
+  const double epsilon = 1e-5;
+  std::vector<double> x = test::RandomVector<double>(norm_size, 0);
+  const std::vector<double> dy = test::RandomVector<double>(norm_size, 0.5);
+  double mean = 0;
+  double inv_variance = 0;
+  std::vector<double> y(norm_size);
+  auto Loss = [&]() {
+    LayerNormCpuKernelUtil<double>::Forward(1, norm_size, norm_size, epsilon, x.data(), nullptr,
+                                            nullptr, y.data(), nullptr, &mean, &inv_variance);
+    double loss = 0;
+    FOR_RANGE(int64_t, j, 0, norm_size) { loss += y[j] * dy[j]; }
+    return loss;
+  };
+  Loss();
+  std::vector<double> dx(norm_size);
+  LayerNormCpuKernelUtil<double>::Backward(1, norm_size, dy.data(), x.data(), &mean,
+                                           &inv_variance, dx.data());
+  const double delta = 1e-6;
+  FOR_RANGE(int64_t, j, 0, norm_size) {
+    const double origin = x[j];
+    x[j] = origin + delta;
+    const double loss_plus = Loss();
+    x[j] = origin - delta;
+    const double loss_minus = Loss();
+    x[j] = origin;
+    ASSERT_NEAR(dx[j], (loss_plus - loss_minus) / (2 * delta), 1e-5);
+  }
+}
+
+}  // namespace oneflow
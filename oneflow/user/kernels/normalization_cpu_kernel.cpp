@@ -0,0 +1,200 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// x is viewed as (outer, channel, inner). inner == 1 is the channels_last layout, where a row of
+// channel values is contiguous; otherwise every (outer, channel) plane is contiguous.
+struct BnDims {
+  int64_t outer;
+  int64_t channel;
+  int64_t inner;
+};
+
+BnDims InferBnDims(const ShapeView& x_shape, const int32_t axis) {
+  CHECK_GE(axis, 0);
+  CHECK_LT(axis, x_shape.NumAxes());
+  BnDims dims;
+  dims.outer = x_shape.Count(0, axis);
+  dims.channel = x_shape.At(axis);
+  dims.inner = x_shape.Count(axis + 1);
+  return dims;
+}
+
+void CheckParamTensor(const user_op::Tensor* tensor, const BnDims& dims, DataType data_type) {
+  CHECK_EQ(tensor->shape().NumAxes(), 1);
+  CHECK_EQ(tensor->shape().At(0), dims.channel);
+  CHECK_EQ(tensor->data_type(), data_type);
+}
+
+template<typename T>
+class NormalizationInferenceCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationInferenceCpuKernel() = default;
+  ~NormalizationInferenceCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool training = ctx->Attr<bool>("training");
+    CHECK(!training);
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    const auto* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    const auto* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+
+    const DataType data_type = x->data_type();
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), data_type);
+    const BnDims dims = InferBnDims(x->shape(), axis);
+    CheckParamTensor(gamma, dims, data_type);
+    CheckParamTensor(beta, dims, data_type);
+    CheckParamTensor(moving_mean, dims, data_type);
+    CheckParamTensor(moving_variance, dims, data_type);
+
+    NormalizationCpuKernelUtil<T>::ForwardInference(
+        dims.outer, dims.channel, dims.inner, epsilon, x->dptr<T>(), gamma->dptr<T>(),
+        beta->dptr<T>(), moving_mean->dptr<T>(), moving_variance->dptr<T>(), y->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_INFERENCE_CPU_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("normalization")                                              \
+      .SetCreateFn<NormalizationInferenceCpuKernel<dtype>>()                         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value) \
+                       & (user_op::HobAttr<bool>("training") == false));
+
+REGISTER_BN_INFERENCE_CPU_KERNEL(float)
+REGISTER_BN_INFERENCE_CPU_KERNEL(double)
+
+#undef REGISTER_BN_INFERENCE_CPU_KERNEL
+
+template<typename T>
+class NormalizationTrainCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationTrainCpuKernel() = default;
+  ~NormalizationTrainCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool training = ctx->Attr<bool>("training");
+    CHECK(training);
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    auto* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    auto* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto momentum = ctx->Attr<float>("momentum");
+    auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+
+    const DataType data_type = x->data_type();
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), data_type);
+    const BnDims dims = InferBnDims(x->shape(), axis);
+    CheckParamTensor(gamma, dims, data_type);
+    CheckParamTensor(beta, dims, data_type);
+    CheckParamTensor(moving_mean, dims, data_type);
+    CheckParamTensor(moving_variance, dims, data_type);
+    CheckParamTensor(mean, dims, data_type);
+    CheckParamTensor(inv_variance, dims, data_type);
+
+    NormalizationCpuKernelUtil<T>::ForwardTraining(
+        dims.outer, dims.channel, dims.inner, epsilon, momentum, x->dptr<T>(), gamma->dptr<T>(),
+        beta->dptr<T>(), y->mut_dptr<T>(), moving_mean->mut_dptr<T>(),
+        moving_variance->mut_dptr<T>(), mean->mut_dptr<T>(), inv_variance->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class NormalizationGradCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationGradCpuKernel() = default;
+  ~NormalizationGradCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const auto* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    auto* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    auto* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    const auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+
+    const DataType data_type = x->data_type();
+    CHECK_EQ(dy->shape(), x->shape());
+    CHECK_EQ(dy->data_type(), data_type);
+    CHECK_EQ(dx->shape(), x->shape());
+    CHECK_EQ(dx->data_type(), data_type);
+    const BnDims dims = InferBnDims(x->shape(), axis);
+    CheckParamTensor(gamma, dims, data_type);
+    CheckParamTensor(gamma_diff, dims, data_type);
+    CheckParamTensor(beta_diff, dims, data_type);
+    CheckParamTensor(mean, dims, data_type);
+    CheckParamTensor(inv_variance, dims, data_type);
+
+    NormalizationCpuKernelUtil<T>::Backward(
+        dims.outer, dims.channel, dims.inner, x->dptr<T>(), dy->dptr<T>(), gamma->dptr<T>(),
+        mean->dptr<T>(), inv_variance->dptr<T>(), dx->mut_dptr<T>(), gamma_diff->mut_dptr<T>(),
+        beta_diff->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_TRAIN_CPU_KERNEL(dtype)                                          \
+  REGISTER_USER_KERNEL("normalization")                                              \
+      .SetCreateFn<NormalizationTrainCpuKernel<dtype>>()                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value) \
+                       & (user_op::HobAttr<bool>("training") == true));
+
+#define REGISTER_BN_GRAD_CPU_KERNEL(dtype)                                \
+  REGISTER_USER_KERNEL("normalization_grad")                              \
+      .SetCreateFn<NormalizationGradCpuKernel<dtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)     \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_BN_TRAIN_CPU_KERNEL(float)
+REGISTER_BN_TRAIN_CPU_KERNEL(double)
+
+REGISTER_BN_GRAD_CPU_KERNEL(float)
+REGISTER_BN_GRAD_CPU_KERNEL(double)
+
+#undef REGISTER_BN_TRAIN_CPU_KERNEL
+#undef REGISTER_BN_GRAD_CPU_KERNEL
+
+}  // namespace
+
+}  // namespace oneflow
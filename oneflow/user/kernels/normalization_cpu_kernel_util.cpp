@@ -0,0 +1,214 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinElemCntPerTask = 32 * 1024;
+
+struct BnDims {
+  int64_t outer;
+  int64_t channel;
+  int64_t inner;
+  int64_t ReduceSize() const { return outer * inner; }
+};
+
+// the number of units of unit_elem_cnt elements a task takes at least
+int64_t Grain(int64_t unit_elem_cnt) {
+  return std::max<int64_t>(1, kMinElemCntPerTask / std::max<int64_t>(unit_elem_cnt, 1));
+}
+
+// sum0[c] and sum1[c] accumulate Func(index, c, &s0, &s1) over every element of channel c
+template<typename T, typename F>
+void ChannelSums(const BnDims& dims, const F& Func, T* sum0, T* sum1) {
+  if (dims.inner > 1) {
+    ParallelFor(0, dims.channel, Grain(dims.ReduceSize()), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, c, begin, end) {
+        T s0 = 0;
+        T s1 = 0;
+        FOR_RANGE(int64_t, o, 0, dims.outer) {
+          const int64_t offset = (o * dims.channel + c) * dims.inner;
+          T plane_s0 = 0;
+          T plane_s1 = 0;
+          FOR_RANGE(int64_t, i, offset, offset + dims.inner) { Func(i, c, &plane_s0, &plane_s1); }
+          s0 += plane_s0;
+          s1 += plane_s1;
+        }
+        sum0[c] = s0;
+        sum1[c] = s1;
+      }
+    });
+  } else {
+    // channels_last: every part reduces a block of at least Grain(channel) rows into its own
+    // partial sums, vectorized along the channels, and the partial sums are added up afterwards
+    const int64_t thread_num = Global<ThreadPool>::Get()->thread_num();
+    const int64_t part_num = std::max<int64_t>(
+        1, std::min<int64_t>(dims.outer / Grain(dims.channel), thread_num));
+    const BalancedSplitter bs(dims.outer, part_num);
+    std::vector<T> partial_sums(part_num * dims.channel * 2, 0);
+    ParallelFor(0, part_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, part_id, begin, end) {
+        T* part_s0 = partial_sums.data() + part_id * dims.channel * 2;
+        T* part_s1 = part_s0 + dims.channel;
+        FOR_RANGE(int64_t, o, bs.At(part_id).begin(), bs.At(part_id).end()) {
+          const int64_t offset = o * dims.channel;
+          FOR_RANGE(int64_t, c, 0, dims.channel) {
+            Func(offset + c, c, part_s0 + c, part_s1 + c);
+          }
+        }
+      }
+    });
+    std::fill(sum0, sum0 + dims.channel, static_cast<T>(0));
+    std::fill(sum1, sum1 + dims.channel, static_cast<T>(0));
+    FOR_RANGE(int64_t, part_id, 0, part_num) {
+      const T* part_s0 = partial_sums.data() + part_id * dims.channel * 2;
+      const T* part_s1 = part_s0 + dims.channel;
+      FOR_RANGE(int64_t, c, 0, dims.channel) {
+        sum0[c] += part_s0[c];
+        sum1[c] += part_s1[c];
+      }
+    }
+  }
+}
+
+// calls Func(index, c) for every element
+template<typename F>
+void ChannelMap(const BnDims& dims, const F& Func) {
+  if (dims.inner > 1) {
+    ParallelFor(0, dims.outer * dims.channel, Grain(dims.inner), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const int64_t c = plane % dims.channel;
+        const int64_t offset = plane * dims.inner;
+        FOR_RANGE(int64_t, i, offset, offset + dims.inner) { Func(i, c); }
+      }
+    });
+  } else {
+    ParallelFor(0, dims.outer, Grain(dims.channel), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, o, begin, end) {
+        const int64_t offset = o * dims.channel;
+        FOR_RANGE(int64_t, c, 0, dims.channel) { Func(offset + c, c); }
+      }
+    });
+  }
+}
+
+// y = x * scale[c] + shift[c]
+template<typename T>
+void ChannelAffine(const BnDims& dims, const T* x, const T* scale, const T* shift, T* y) {
+  ChannelMap(dims, [&](int64_t i, int64_t c) { y[i] = x[i] * scale[c] + shift[c]; });
+}
+
+}  // namespace
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ForwardInference(int64_t outer, int64_t channel,
+                                                     int64_t inner, double epsilon, const T* x,
+                                                     const T* gamma, const T* beta,
+                                                     const T* moving_mean,
+                                                     const T* moving_variance, T* y) {
+  const BnDims dims{outer, channel, inner};
+  // the whole normalization collapses to one per-channel affine transform
+  std::vector<T> scale(channel);
+  std::vector<T> shift(channel);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    scale[c] = gamma[c] / std::sqrt(moving_variance[c] + static_cast<T>(epsilon));
+    shift[c] = beta[c] - moving_mean[c] * scale[c];
+  }
+  ChannelAffine(dims, x, scale.data(), shift.data(), y);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ForwardTraining(int64_t outer, int64_t channel, int64_t inner,
+                                                    double epsilon, double momentum, const T* x,
+                                                    const T* gamma, const T* beta, T* y,
+                                                    T* moving_mean, T* moving_variance, T* mean,
+                                                    T* inv_variance) {
+  const BnDims dims{outer, channel, inner};
+  const int64_t reduce_size = dims.ReduceSize();
+  std::vector<T> unused(channel);
+  ChannelSums<T>(
+      dims, [&](int64_t i, int64_t c, T* s0, T* s1) { *s0 += x[i]; }, mean, unused.data());
+  FOR_RANGE(int64_t, c, 0, channel) { mean[c] /= static_cast<T>(reduce_size); }
+  // two passes keep the variance accurate for inputs with a large mean
+  std::vector<T> square_sum(channel);
+  ChannelSums<T>(
+      dims,
+      [&](int64_t i, int64_t c, T* s0, T* s1) {
+        const T diff = x[i] - mean[c];
+        *s0 += diff * diff;
+      },
+      square_sum.data(), unused.data());
+
+  std::vector<T> scale(channel);
+  std::vector<T> shift(channel);
+  const T unbiased_factor =
+      reduce_size > 1 ? static_cast<T>(reduce_size) / static_cast<T>(reduce_size - 1) : 1;
+  const T t_momentum = static_cast<T>(momentum);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    const T variance = square_sum[c] / static_cast<T>(reduce_size);
+    inv_variance[c] = static_cast<T>(1) / std::sqrt(variance + static_cast<T>(epsilon));
+    scale[c] = gamma[c] * inv_variance[c];
+    shift[c] = beta[c] - mean[c] * scale[c];
+    // the same update as cudnn with exponentialAverageFactor = 1 - momentum
+    moving_mean[c] = moving_mean[c] * t_momentum + mean[c] * (1 - t_momentum);
+    moving_variance[c] =
+        moving_variance[c] * t_momentum + variance * unbiased_factor * (1 - t_momentum);
+  }
+  ChannelAffine(dims, x, scale.data(), shift.data(), y);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Backward(int64_t outer, int64_t channel, int64_t inner,
+                                             const T* x, const T* dy, const T* gamma,
+                                             const T* mean, const T* inv_variance, T* dx,
+                                             T* gamma_diff, T* beta_diff) {
+  const BnDims dims{outer, channel, inner};
+  // beta_diff = sum(dy), gamma_diff = sum(dy * x_hat)
+  ChannelSums<T>(
+      dims,
+      [&](int64_t i, int64_t c, T* s0, T* s1) {
+        *s0 += dy[i];
+        *s1 += dy[i] * (x[i] - mean[c]);
+      },
+      beta_diff, gamma_diff);
+  FOR_RANGE(int64_t, c, 0, channel) { gamma_diff[c] *= inv_variance[c]; }
+
+  // dx = gamma * inv_std * (dy - mean(dy) - x_hat * mean(dy * x_hat)), folded into
+  // dx = dy * scale + x * x_scale + shift per channel
+  const T inv_reduce_size = static_cast<T>(1) / static_cast<T>(dims.ReduceSize());
+  std::vector<T> scale(channel);
+  std::vector<T> x_scale(channel);
+  std::vector<T> shift(channel);
+  FOR_RANGE(int64_t, c, 0, channel) {
+    const T inv_std = inv_variance[c];
+    scale[c] = gamma[c] * inv_std;
+    x_scale[c] = -scale[c] * inv_std * gamma_diff[c] * inv_reduce_size;
+    shift[c] = -scale[c] * beta_diff[c] * inv_reduce_size - x_scale[c] * mean[c];
+  }
+  ChannelMap(dims, [&](int64_t i, int64_t c) {
+    dx[i] = dy[i] * scale[c] + x[i] * x_scale[c] + shift[c];
+  });
+}
+
+template struct NormalizationCpuKernelUtil<float>;
+template struct NormalizationCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,41 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x is viewed as (outer, channel, inner), the statistics and the parameters have channel
+// elements. inner == 1 is the channels_last layout.
+template<typename T>
+struct NormalizationCpuKernelUtil {
+  static void ForwardInference(int64_t outer, int64_t channel, int64_t inner, double epsilon,
+                               const T* x, const T* gamma, const T* beta, const T* moving_mean,
+                               const T* moving_variance, T* y);
+  // moving_mean and moving_variance are updated in place
+  static void ForwardTraining(int64_t outer, int64_t channel, int64_t inner, double epsilon,
+                              double momentum, const T* x, const T* gamma, const T* beta, T* y,
+                              T* moving_mean, T* moving_variance, T* mean, T* inv_variance);
+  static void Backward(int64_t outer, int64_t channel, int64_t inner, const T* x, const T* dy,
+                       const T* gamma, const T* mean, const T* inv_variance, T* dx,
+                       T* gamma_diff, T* beta_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,178 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/kernel/util/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// x is (outer, channel, inner), the statistics are computed in two passes per channel
+template<typename T>
+void NaiveNormalization(int64_t outer, int64_t channel, int64_t inner, double epsilon,
+                        const T* x, const T* gamma, const T* beta, const T* mean,
+                        const T* variance, T* y) {
+  FOR_RANGE(int64_t, o, 0, outer) {
+    FOR_RANGE(int64_t, c, 0, channel) {
+      FOR_RANGE(int64_t, i, 0, inner) {
+        const int64_t idx = (o * channel + c) * inner + i;
+        y[idx] = (x[idx] - mean[c]) / std::sqrt(variance[c] + static_cast<T>(epsilon)) * gamma[c]
+                 + beta[c];
+      }
+    }
+  }
+}
+
+template<typename T>
+void NaiveMeanAndVariance(int64_t outer, int64_t channel, int64_t inner, const T* x, T* mean,
+                          T* variance) {
+  const int64_t reduce_size = outer * inner;
+  FOR_RANGE(int64_t, c, 0, channel) {
+    T sum = 0;
+    FOR_RANGE(int64_t, o, 0, outer) {
+      FOR_RANGE(int64_t, i, 0, inner) { sum += x[(o * channel + c) * inner + i]; }
+    }
+    mean[c] = sum / reduce_size;
+    T square_sum = 0;
+    FOR_RANGE(int64_t, o, 0, outer) {
+      FOR_RANGE(int64_t, i, 0, inner) {
+        const T diff = x[(o * channel + c) * inner + i] - mean[c];
+        square_sum += diff * diff;
+      }
+    }
+    variance[c] = square_sum / reduce_size;
+  }
+}
+
+struct TestDims {
+  int64_t outer;
+  int64_t channel;
+  int64_t inner;
+};
+
+// channels first (n, c, h * w) and channels last (n * h * w, c, 1), large enough for several
+// tasks and with a reduce size that does not split evenly among them
+const std::vector<TestDims> kDimsList = {{8, 16, 4099}, {32771, 16, 1}};
+
+class NormalizationCpuKernelUtilTest : public test::ThreadPoolTest {};
+
+}  // namespace
+
+TEST_F(NormalizationCpuKernelUtilTest, inference_matches_naive) {
+  const double epsilon = 1e-5;
+  for (const TestDims& dims : kDimsList) {
+    const int64_t outer = dims.outer;
+    const int64_t channel = dims.channel;
+    const int64_t inner = dims.inner;
+    const std::vector<double> x = test::RandomVector<double>(outer * channel * inner, 3);
+    const std::vector<double> gamma = test::RandomVector<double>(channel, 1);
+    const std::vector<double> beta = test::RandomVector<double>(channel, 0);
+    const std::vector<double> moving_mean = test::RandomVector<double>(channel, 3);
+    const std::vector<double> moving_variance = test::RandomVector<double>(channel, 2);
+    std::vector<double> y(x.size()), ref_y(x.size());
+    NormalizationCpuKernelUtil<double>::ForwardInference(
+        outer, channel, inner, epsilon, x.data(), gamma.data(), beta.data(), moving_mean.data(),
+        moving_variance.data(), y.data());
+    NaiveNormalization(outer, channel, inner, epsilon, x.data(), gamma.data(), beta.data(),
+                       moving_mean.data(), moving_variance.data(), ref_y.data());
+    FOR_RANGE(size_t, i, 0, y.size()) { ASSERT_NEAR(y[i], ref_y[i], 1e-9) << "inner " << inner; }
+  }
+}
+
+TEST_F(NormalizationCpuKernelUtilTest, training_matches_naive) {
+  const double epsilon = 1e-5;
+  const double momentum = 0.9;
+  for (const TestDims& dims : kDimsList) {
+    const int64_t outer = dims.outer;
+    const int64_t channel = dims.channel;
+    const int64_t inner = dims.inner;
+    const int64_t reduce_size = outer * inner;
+    // a large offset checks that the variance does not cancel out
+    const std::vector<double> x = test::RandomVector<double>(outer * channel * inner, 1000);
+    const std::vector<double> gamma = test::RandomVector<double>(channel, 1);
+    const std::vector<double> beta = test::RandomVector<double>(channel, 0);
+    std::vector<double> moving_mean(channel, 1), moving_variance(channel, 2);
+    std::vector<double> y(x.size()), mean(channel), inv_variance(channel);
+    NormalizationCpuKernelUtil<double>::ForwardTraining(
+        outer, channel, inner, epsilon, momentum, x.data(), gamma.data(), beta.data(), y.data(),
+        moving_mean.data(), moving_variance.data(), mean.data(), inv_variance.data());
+    std::vector<double> ref_y(x.size()), ref_mean(channel), ref_variance(channel);
+    NaiveMeanAndVariance(outer, channel, inner, x.data(), ref_mean.data(), ref_variance.data());
+    NaiveNormalization(outer, channel, inner, epsilon, x.data(), gamma.data(), beta.data(),
+                       ref_mean.data(), ref_variance.data(), ref_y.data());
+    FOR_RANGE(int64_t, c, 0, channel) {
+      ASSERT_NEAR(mean[c], ref_mean[c], 1e-9);
+      ASSERT_NEAR(inv_variance[c], 1 / std::sqrt(ref_variance[c] + epsilon), 1e-9);
+      ASSERT_NEAR(moving_mean[c], 0.9 + ref_mean[c] * 0.1, 1e-9);
+      ASSERT_NEAR(moving_variance[c], 1.8 + ref_variance[c] * reduce_size / (reduce_size - 1) * 0.1,
+                  1e-9);
+    }
+    FOR_RANGE(size_t, i, 0, y.size()) { ASSERT_NEAR(y[i], ref_y[i], 1e-6) << "inner " << inner; }
+  }
+}
+
+TEST_F(NormalizationCpuKernelUtilTest, backward_matches_finite_difference) {
+  const double epsilon = 1e-5;
+  // channels first (n, c, h * w) and channels last (n * h * w, c, 1)
+  for (const TestDims& dims : std::vector<TestDims>{{3, 4, 5}, {15, 4, 1}}) {
+    const int64_t outer = dims.outer;
+    const int64_t channel = dims.channel;
+    const int64_t inner = dims.inner;
+    const int64_t elem_cnt = outer * channel * inner;
+    std::vector<double> x = test::RandomVector<double>(elem_cnt, 0);
+    const std::vector<double> dy = test::RandomVector<double>(elem_cnt, 0.5);
+    std::vector<double> gamma = test::RandomVector<double>(channel, 1);
+    const std::vector<double> beta = test::RandomVector<double>(channel, 0);
+    std::vector<double> y(elem_cnt), mean(channel), inv_variance(channel);
+    std::vector<double> moving_mean(channel), moving_variance(channel);
+    auto Loss = [&]() {
+      NormalizationCpuKernelUtil<double>::ForwardTraining(
+          outer, channel, inner, epsilon, 0.9, x.data(), gamma.data(), beta.data(), y.data(),
+          moving_mean.data(), moving_variance.data(), mean.data(), inv_variance.data());
+      double loss = 0;
+      FOR_RANGE(int64_t, i, 0, elem_cnt) { loss += y[i] * dy[i]; }
+      return loss;
+    };
+    Loss();
+    std::vector<double> dx(elem_cnt), gamma_diff(channel), beta_diff(channel);
+    NormalizationCpuKernelUtil<double>::Backward(outer, channel, inner, x.data(), dy.data(),
+                                                 gamma.data(), mean.data(), inv_variance.data(),
+                                                 dx.data(), gamma_diff.data(), beta_diff.data());
+    const double delta = 1e-6;
+    auto CentralDifference = [&](double* val) {
+      const double origin = *val;
+      *val = origin + delta;
+      const double loss_plus = Loss();
+      *val = origin - delta;
+      const double loss_minus = Loss();
+      *val = origin;
+      return (loss_plus - loss_minus) / (2 * delta);
+    };
+    FOR_RANGE(int64_t, i, 0, elem_cnt) {
+      ASSERT_NEAR(dx[i], CentralDifference(&x[i]), 1e-5) << "inner " << inner;
+    }
+    FOR_RANGE(int64_t, c, 0, channel) {
+      ASSERT_NEAR(gamma_diff[c], CentralDifference(&gamma[c]), 1e-5) << "inner " << inner;
+      double beta_sum = 0;
+      FOR_RANGE(int64_t, o, 0, outer) {
+        FOR_RANGE(int64_t, i, 0, inner) { beta_sum += dy[(o * channel + c) * inner + i]; }
+      }
+      ASSERT_NEAR(beta_diff[c], beta_sum, 1e-9);
+    }
+  }
+}
+
+}  // namespace oneflow
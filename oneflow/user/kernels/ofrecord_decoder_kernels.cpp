@@ -19,9 +19,11 @@ limitations under the License.
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/record/ofrecord_view.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/user/image/jpeg_decoder.h"
 #include "oneflow/user/kernels/op_kernel_state_wrapper.h"
 #include "oneflow/user/kernels/random_seed_util.h"
 
@@ -67,6 +69,34 @@ void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_c
   }
 }
 
+template<typename T>
+void DecodeOneRawOFRecord(const OFRecordFeatureView& feature, T* dptr, int64_t sample_elem_cnt,
+                          bool dim1_varying_length, bool auto_zero_padding) {
+  if (feature.has_bytes_list()) {
+    CHECK_EQ(feature.value_size(), 1);
+    const char* value0 = nullptr;
+    size_t size = 0;
+    feature.GetBytes(0, &value0, &size);
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, size);
+    CopyElem<int8_t, T>(reinterpret_cast<const int8_t*>(value0), dptr, sample_elem_cnt);
+  } else if (feature.kind_case() != Feature::KIND_NOT_SET) {
+    const int64_t value_size = feature.value_size();
+    const int64_t padding_elem_num = auto_zero_padding ? sample_elem_cnt - value_size : 0;
+    if (dim1_varying_length || auto_zero_padding) {
+      CHECK_LE(value_size, sample_elem_cnt);
+      sample_elem_cnt = value_size;
+    } else {
+      CHECK_EQ(sample_elem_cnt, value_size);
+    }
+    feature.CopyValues(dptr, sample_elem_cnt);
+    if (padding_elem_num > 0) {
+      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
 }  // namespace
 
 template<typename T>
@@ -83,13 +113,23 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
     bool auto_zero_padding = ctx->Attr<bool>("auto_zero_padding");
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
+    if (in_blob->data_type() == DataType::kTensorBuffer) {
+      const TensorBuffer* records = in_blob->dptr<TensorBuffer>();
+      MultiThreadLoop(record_num, [&](size_t i) {
+        T* dptr = out_dptr + i * sample_elem_cnt;
+        const OFRecordFeatureView feature = OFRecordView(records[i]).GetFeature(name);
+        DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, auto_zero_padding,
+                             dim1_varying_length);
+      });
+      return;
+    }
+    const OFRecord* records = in_blob->dptr<OFRecord>();
     MultiThreadLoop(record_num, [&](size_t i) {
       const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
@@ -102,11 +142,12 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                      \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                  \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                           \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)           \
-                       & (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                          \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)        \
+                          | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)) \
                        & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
 REGISTER_RAW_DECODER_KERNEL(char)
@@ -119,19 +160,41 @@ REGISTER_RAW_DECODER_KERNEL(uint8_t)
 
 namespace {
 
-void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
-                                        const std::string& name, const std::string& color_space,
-                                        RandomCropGenerator* random_crop_gen) {
+// the encoded image of feature name, pointing into the record
+void GetEncodedImage(const OFRecord& record, const std::string& name, const char** data,
+                     size_t* size) {
   CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
   const Feature& feature = record.feature().at(name);
   CHECK(feature.has_bytes_list());
   CHECK(feature.bytes_list().value_size() == 1);
   const std::string& src_data = feature.bytes_list().value(0);
+  *data = src_data.data();
+  *size = src_data.size();
+}
+
+void GetEncodedImage(const TensorBuffer& record, const std::string& name, const char** data,
+                     size_t* size) {
+  const OFRecordFeatureView feature = OFRecordView(record).GetFeature(name);
+  CHECK(feature.has_bytes_list());
+  CHECK(feature.value_size() == 1);
+  feature.GetBytes(0, data, size);
+}
 
-  // cv::_InputArray image_data(src_data.data(), src_data.size());
+void DecodeRandomCropImage(const char* src_data, size_t src_size, TensorBuffer* buffer,
+                           const std::string& color_space, RandomCropGenerator* random_crop_gen,
+                           int64_t target_resize_x, int64_t target_resize_y) {
+  // a window drawn by the libjpeg path before it failed is reused, not drawn again
+  CropWindow crop;
+  if (target_resize_x > 0 && target_resize_y > 0
+      && JpegPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data),
+                                          src_size, random_crop_gen, &crop, target_resize_x,
+                                          target_resize_y, color_space, buffer)) {
+    return;
+  }
+  // cv::_InputArray image_data(src_data, src_size);
   // cv::Mat image = cv::imdecode(image_data, cv::IMREAD_ANYCOLOR);
   cv::Mat image =
-      cv::imdecode(cv::Mat(1, src_data.size(), CV_8UC1, (void*)(src_data.data())),  // NOLINT
+      cv::imdecode(cv::Mat(1, src_size, CV_8UC1, const_cast<char*>(src_data)),
                    ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
   int W = image.cols;
   int H = image.rows;
@@ -140,8 +203,7 @@ void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* bu
   if (random_crop_gen != nullptr) {
     CHECK(image.data != nullptr);
     cv::Mat image_roi;
-    CropWindow crop;
-    random_crop_gen->GenerateCropWindow({H, W}, &crop);
+    if (crop.shape.elem_cnt() == 0) { random_crop_gen->GenerateCropWindow({H, W}, &crop); }
     const int y = crop.anchor.At(0);
     const int x = crop.anchor.At(1);
     const int newH = crop.shape.At(0);
@@ -172,6 +234,21 @@ void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* bu
   memcpy(buffer->mut_data<uint8_t>(), image.ptr(), image_shape.elem_cnt());
 }
 
+// records are OFRecord or, for lazily parsed ones, TensorBuffer
+template<typename RecordT>
+void DecodeRandomCropImages(const RecordT* records, int64_t record_num, TensorBuffer* buffers,
+                            const std::string& name, const std::string& color_space,
+                            const std::function<RandomCropGenerator*(int64_t)>& GetGen,
+                            int64_t target_resize_x, int64_t target_resize_y) {
+  MultiThreadLoop(record_num, [&](size_t i) {
+    const char* src_data = nullptr;
+    size_t src_size = 0;
+    GetEncodedImage(records[i], name, &src_data, &src_size);
+    DecodeRandomCropImage(src_data, src_size, buffers + i, color_space, GetGen(i),
+                          target_resize_x, target_resize_y);
+  });
+}
+
 class RandCropGens final : public user_op::OpKernelState {
  public:
   explicit RandCropGens(int32_t size) : gens_(size) {}
@@ -234,17 +311,20 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
-
-    MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
-      TensorBuffer* buffer = buffers + i;
-      RandomCropGenerator* gen = crop_window_generators->Get(i);
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, gen);
-    });
+    const int64_t target_resize_x = ctx->Attr<int64_t>("target_resize_x");
+    const int64_t target_resize_y = ctx->Attr<int64_t>("target_resize_y");
+    auto GetGen = [&](int64_t i) { return crop_window_generators->Get(i); };
+
+    if (in_blob->data_type() == DataType::kTensorBuffer) {
+      DecodeRandomCropImages(in_blob->dptr<TensorBuffer>(), record_num, buffers, name,
+                             color_space, GetGen, target_resize_x, target_resize_y);
+    } else {
+      DecodeRandomCropImages(in_blob->dptr<OFRecord>(), record_num, buffers, name, color_space,
+                             GetGen, target_resize_x, target_resize_y);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -252,7 +332,8 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
     .SetCreateFn<OFRecordImageDecoderRandomCropKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                        | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 class OFRecordImageDecoderKernel final : public user_op::OpKernel {
@@ -267,16 +348,18 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
-
-    MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
-      TensorBuffer* buffer = buffers + i;
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, nullptr);
-    });
+    auto GetGen = [](int64_t) -> RandomCropGenerator* { return nullptr; };
+
+    if (in_blob->data_type() == DataType::kTensorBuffer) {
+      DecodeRandomCropImages(in_blob->dptr<TensorBuffer>(), record_num, buffers, name,
+                             color_space, GetGen, 0, 0);
+    } else {
+      DecodeRandomCropImages(in_blob->dptr<OFRecord>(), record_num, buffers, name, color_space,
+                             GetGen, 0, 0);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -284,7 +367,8 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder")
     .SetCreateFn<OFRecordImageDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                        | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 }  // namespace oneflow
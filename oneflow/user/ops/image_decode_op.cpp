@@ -22,6 +22,9 @@ REGISTER_CPU_ONLY_USER_OP("image_decode")
     .Output("out")
     .Attr<std::string>("color_space", UserOpAttrType::kAtString, "BGR")
     .Attr<DataType>("data_type", UserOpAttrType::kAtDataType, DataType::kUInt8)
+    // the resize following the decoder, lets jpegs be decoded downscaled when both are positive
+    .Attr<int64_t>("target_resize_x", UserOpAttrType::kAtInt64, 0)
+    .Attr<int64_t>("target_resize_y", UserOpAttrType::kAtInt64, 0)
     .SetCheckAttrFn([](const user_op::UserOpDefWrapper& def,
                        const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
       bool check_failed = false;
@@ -29,7 +29,9 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_raw_decoder")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      // TensorBuffer in holds records indexed by OFRecordView, see OFRecordReader's lazy_parse
+      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord
+                      || in_tensor->data_type() == DataType::kTensorBuffer);
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       Shape conf_shape = ctx->Attr<Shape>("shape");
       DimVector dim_vec(1 + conf_shape.NumAxes());
@@ -66,7 +68,8 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_decoder")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord
+                      || in_tensor->data_type() == DataType::kTensorBuffer);
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       *out_tensor->mut_shape() = in_tensor->shape();
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
@@ -101,10 +104,14 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_decoder_random_crop")
     .Attr<bool>("has_seed", UserOpAttrType::kAtBool, false)
     .Attr<std::vector<float>>("random_area", UserOpAttrType::kAtListFloat, {0.08, 1.0})
     .Attr<std::vector<float>>("random_aspect_ratio", UserOpAttrType::kAtListFloat, {0.75, 1.333333})
+    // the resize following the decoder, lets jpegs be decoded downscaled when both are positive
+    .Attr<int64_t>("target_resize_x", UserOpAttrType::kAtInt64, 0)
+    .Attr<int64_t>("target_resize_y", UserOpAttrType::kAtInt64, 0)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* in_tensor = ctx->TensorDesc4ArgNameAndIndex("in", 0);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
-      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord);
+      CHECK_OR_RETURN(in_tensor->data_type() == DataType::kOFRecord
+                      || in_tensor->data_type() == DataType::kTensorBuffer);
       CHECK_OR_RETURN(in_tensor->shape().NumAxes() == 1 && in_tensor->shape().At(0) >= 1);
       *out_tensor->mut_shape() = in_tensor->shape();
       *out_tensor->mut_data_type() = DataType::kTensorBuffer;
@@ -28,7 +28,12 @@ REGISTER_CPU_ONLY_USER_OP("OFRecordReader")
     .Attr<int64_t>("seed", UserOpAttrType::kAtInt64, -1)
     .Attr<int32_t>("shuffle_buffer_size", UserOpAttrType::kAtInt32, 1024)
     .Attr<bool>("shuffle_after_epoch", UserOpAttrType::kAtBool, false)
+    .Attr<bool>("lazy_parse", UserOpAttrType::kAtBool, false)
+    .Attr<int32_t>("num_reader_threads", UserOpAttrType::kAtInt32, 1)
+    .Attr<int32_t>("prefetch_buffer_size", UserOpAttrType::kAtInt32, 4)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
+      CHECK_GE_OR_RETURN(ctx->Attr<int32_t>("num_reader_threads"), 1);
+      CHECK_GE_OR_RETURN(ctx->Attr<int32_t>("prefetch_buffer_size"), 1);
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
       int32_t local_batch_size = ctx->Attr<int32_t>("batch_size");
       const SbpParallel& sbp = ctx->SbpParallel4ArgNameAndIndex("out", 0);
@@ -38,7 +43,9 @@ REGISTER_CPU_ONLY_USER_OP("OFRecordReader")
         local_batch_size /= parallel_num;
       }
       *out_tensor->mut_shape() = Shape({local_batch_size});
-      *out_tensor->mut_data_type() = DataType::kOFRecord;
+      // lazy parsing outputs the serialized records indexed by OFRecordView
+      *out_tensor->mut_data_type() =
+          ctx->Attr<bool>("lazy_parse") ? DataType::kTensorBuffer : DataType::kOFRecord;
       return Maybe<void>::Ok();
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {